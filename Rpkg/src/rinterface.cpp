@@ -756,6 +756,42 @@ RcppExport SEXP R_FG_compute_directed_triangles(SEXP graph, SEXP ptype)
 	return res;
 }
 
+RcppExport SEXP R_FG_estimate_triangles(SEXP graph, SEXP prate,
+		SEXP pmethod, SEXP pconfidence)
+{
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	double rate = REAL(prate)[0];
+	double confidence = REAL(pconfidence)[0];
+
+	std::string method_str = CHAR(STRING_ELT(pmethod, 0));
+	triangle_sampling_method method;
+	if (method_str == "wedge")
+		method = triangle_sampling_method::WEDGE_SAMPLING;
+	else if (method_str == "edge")
+		method = triangle_sampling_method::EDGE_SAMPLING;
+	else {
+		fprintf(stderr, "wrong sampling method\n");
+		return R_NilValue;
+	}
+
+	approx_triangle_count count;
+	try {
+		count = estimate_triangles(fg, rate, method, confidence);
+	} catch(std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return R_NilValue;
+	}
+	Rcpp::List ret;
+	ret["triangles"] = count.num_triangles;
+	ret["triangles.ci"] = Rcpp::NumericVector::create(
+			count.num_triangles_lower, count.num_triangles_upper);
+	ret["transitivity"] = count.transitivity;
+	ret["transitivity.ci"] = Rcpp::NumericVector::create(
+			count.transitivity_lower, count.transitivity_upper);
+	ret["samples"] = (double) count.num_samples;
+	return ret;
+}
+
 RcppExport SEXP R_FG_compute_local_scan(SEXP graph, SEXP porder)
 {
 	FG_graph::ptr fg = R_FG_get_graph(graph);
@@ -807,6 +843,49 @@ RcppExport SEXP R_FG_compute_kcore(SEXP graph, SEXP _k, SEXP _kmax)
 	return res;
 }
 
+RcppExport SEXP R_FG_compute_sssp(SEXP graph, SEXP psource, SEXP pdelta)
+{
+	vertex_id_t source = REAL(psource)[0];
+	double delta = REAL(pdelta)[0];
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	FG_vector<double>::ptr fg_vec = compute_sssp(fg, source, delta);
+	if (fg_vec == NULL)
+		return R_NilValue;
+	Rcpp::NumericVector res(fg_vec->get_size());
+	fg_vec->copy_to(res.begin(), fg_vec->get_size());
+	return res;
+}
+
+RcppExport SEXP R_FG_random_walks(SEXP graph, SEXP pfile, SEXP pnum_walks,
+		SEXP plength, SEXP ptype, SEXP pp, SEXP pq)
+{
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	std::string out_file = CHAR(STRING_ELT(pfile, 0));
+	int num_walks = INTEGER(pnum_walks)[0];
+	int walk_length = INTEGER(plength)[0];
+	double p = REAL(pp)[0];
+	double q = REAL(pq)[0];
+
+	std::string type_str = CHAR(STRING_ELT(ptype, 0));
+	walk_transition transition;
+	if (type_str == "uniform")
+		transition = UNIFORM_WALK;
+	else if (type_str == "weighted")
+		transition = WEIGHTED_WALK;
+	else if (type_str == "node2vec")
+		transition = NODE2VEC_WALK;
+	else {
+		fprintf(stderr, "wrong walk type\n");
+		return R_NilValue;
+	}
+
+	size_t num_steps = generate_random_walks(fg, out_file, num_walks,
+			walk_length, transition, p, q);
+	Rcpp::NumericVector ret(1);
+	ret[0] = num_steps;
+	return ret;
+}
+
 RcppExport SEXP R_FG_compute_overlap(SEXP graph, SEXP _vids)
 {
 	Rcpp::IntegerVector Rvids(_vids);
@@ -22,6 +22,7 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 namespace fg
 {
@@ -30,9 +31,21 @@ namespace fg
   * \brief Basic data types used in FlashGraph
 */
 
+#ifdef FG_64BIT_VERTEX_ID
+/*
+ * With 64-bit vertex IDs, a graph can have more than 4B vertices and
+ * a vertex can have more than 4B edges. The size of vertex IDs is recorded
+ * in the graph header, so a graph image can only be loaded by the build
+ * that uses the same vertex ID size.
+ */
+typedef uint64_t vsize_t;
+typedef uint64_t vertex_id_t; /** Used to represent vertex IDs in graph */
+const vertex_id_t MAX_VERTEX_ID = UINT64_MAX;
+#else
 typedef unsigned int vsize_t; 
 typedef unsigned int vertex_id_t; /** Used to represent vertex IDs in graph */
 const vertex_id_t MAX_VERTEX_ID = UINT_MAX;
+#endif
 const vertex_id_t INVALID_VERTEX_ID = -1;
 const size_t MAX_VERTEX_SIZE = INT_MAX;
 
@@ -26,6 +26,7 @@
 #include "in_mem_storage.h"
 #include "vertex_index.h"
 #include "safs_file.h"
+#include "ts_graph.h"
 
 using namespace safs;
 
@@ -76,10 +77,14 @@ FG_graph::ptr FG_graph::create(const std::string &graph_file,
 		// in the local filesystem.
 		index_data = vertex_index::load(index_file);
 
+	ptr ret;
 	if (graph_data)
-		return ptr(new FG_graph(graph_data, index_data, graph_file, configs));
+		ret = ptr(new FG_graph(graph_data, index_data, graph_file, configs));
 	else
-		return ptr(new FG_graph(graph_file, index_data, configs));
+		ret = ptr(new FG_graph(graph_file, index_data, configs));
+	ret->index_file = index_file;
+	ret->index_in_safs = index_in_safs;
+	return ret;
 }
 
 FG_graph::FG_graph(const std::string &graph_file, vertex_index::ptr index_data,
@@ -89,6 +94,8 @@ FG_graph::FG_graph(const std::string &graph_file, vertex_index::ptr index_data,
 	this->index_data = index_data;
 	this->configs = configs;
 	this->header = index_data->get_graph_header();
+	this->index_in_safs = false;
+	this->preloaded = false;
 }
 
 FG_graph::FG_graph(in_mem_graph::ptr graph_data, vertex_index::ptr index_data,
@@ -99,6 +106,8 @@ FG_graph::FG_graph(in_mem_graph::ptr graph_data, vertex_index::ptr index_data,
 	this->configs = configs;
 	graph_file = graph_name;
 	header = index_data->get_graph_header();
+	index_in_safs = false;
+	preloaded = false;
 }
 
 graph_engine::ptr FG_graph::create_engine(graph_index::ptr index)
@@ -106,6 +115,22 @@ graph_engine::ptr FG_graph::create_engine(graph_index::ptr index)
 	return graph_engine::create(*this, index);
 }
 
+void FG_graph::add_edges(
+		const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges)
+{
+	if (delta == NULL)
+		delta = graph_delta::create(header, graph_conf.get_num_threads());
+	delta->add_edges(edges);
+}
+
+void FG_graph::delete_edges(
+		const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges)
+{
+	if (delta == NULL)
+		delta = graph_delta::create(header, graph_conf.get_num_threads());
+	delta->delete_edges(edges);
+}
+
 file_io_factory::shared_ptr FG_graph::get_graph_io_factory(int access_option)
 {
 	if (graph_data)
@@ -356,10 +381,7 @@ public:
 	ts_degree_vertex(vertex_id_t id): compute_vertex(id) {
 	}
 
-	void run(vertex_program &prog) {
-		vertex_id_t id = prog.get_vertex_id(*this);
-		request_vertices(&id, 1);
-	}
+	void run(vertex_program &prog);
 
 	void run(vertex_program &prog, const page_vertex &vertex);
 
@@ -373,13 +395,19 @@ class ts_degree_vertex_program: public vertex_program_impl<ts_degree_vertex>
 	time_t time_interval;
 	edge_type type;
 	FG_vector<vsize_t>::ptr degree_vec;
+	ts_index::ptr index;
 public:
 	ts_degree_vertex_program(FG_vector<vsize_t>::ptr degree_vec, edge_type type,
-			time_t start_time, time_t time_interval) {
+			time_t start_time, time_t time_interval, ts_index::ptr index) {
 		this->degree_vec = degree_vec;
 		this->type = type;
 		this->start_time = start_time;
 		this->time_interval = time_interval;
+		this->index = index;
+	}
+
+	const ts_index &get_index() const {
+		return *index;
 	}
 
 	time_t get_start_time() const {
@@ -405,22 +433,42 @@ class ts_degree_vertex_program_creater: public vertex_program_creater
 	time_t time_interval;
 	FG_vector<vertex_id_t>::ptr degree_vec;
 	edge_type type;
+	ts_index::ptr index;
 public:
 	ts_degree_vertex_program_creater(
 			FG_vector<vertex_id_t>::ptr degree_vec, edge_type type,
-			time_t start_time, time_t time_interval) {
+			time_t start_time, time_t time_interval, ts_index::ptr index) {
 		this->degree_vec = degree_vec;
 		this->type = type;
 		this->start_time = start_time;
 		this->time_interval = time_interval;
+		this->index = index;
 	}
 
 	vertex_program::ptr create() const {
 		return vertex_program::ptr(new ts_degree_vertex_program(
-					degree_vec, type, start_time, time_interval));
+					degree_vec, type, start_time, time_interval, index));
 	}
 };
 
+void ts_degree_vertex::run(vertex_program &prog)
+{
+	ts_degree_vertex_program &degree_vprog = (ts_degree_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	edge_type type = degree_vprog.get_edge_type();
+	time_t start_time = degree_vprog.get_start_time();
+	time_t time_interval = degree_vprog.get_time_interval();
+	const ts_index &index = degree_vprog.get_index();
+	// We only need to read the vertices whose time range crosses
+	// the boundaries of the time interval.
+	if (!index.overlap(id, type, start_time, time_interval))
+		degree_vprog.set_degree(id, 0);
+	else if (index.within(id, type, start_time, time_interval))
+		degree_vprog.set_degree(id, prog.get_graph().get_num_edges(id, type));
+	else
+		request_vertices(&id, 1);
+}
+
 void ts_degree_vertex::run(vertex_program &prog, const page_vertex &vertex)
 {
 	ts_degree_vertex_program &degree_vprog = (ts_degree_vertex_program &) prog;
@@ -451,6 +499,7 @@ void ts_degree_vertex::run(vertex_program &prog, const page_vertex &vertex)
 FG_vector<vsize_t>::ptr get_ts_degree(FG_graph::ptr fg, edge_type type,
 		time_t start_time, time_t time_interval)
 {
+	ts_index::ptr ts_idx = get_ts_index(fg);
 	graph_index::ptr index = NUMA_graph_index<ts_degree_vertex>::create(
 			fg->get_graph_header());
 	graph_engine::ptr graph = fg->create_engine(index);
@@ -459,122 +508,18 @@ FG_vector<vsize_t>::ptr get_ts_degree(FG_graph::ptr fg, edge_type type,
 	FG_vector<vsize_t>::ptr degree_vec = FG_vector<vsize_t>::create(graph);
 	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
 				new ts_degree_vertex_program_creater(degree_vec, type,
-					start_time, time_interval)));
+					start_time, time_interval, ts_idx)));
 	graph->wait4complete();
 	return degree_vec;
 }
 
 /************** Get the time range of the time-series graph *******************/
 
-namespace {
-
-class time_range_vertex: public compute_vertex
-{
-public:
-	time_range_vertex(vertex_id_t id): compute_vertex(id) {
-	}
-
-	void run(vertex_program &prog) {
-		vertex_id_t id = prog.get_vertex_id(*this);
-		request_vertices(&id, 1);
-	}
-
-	void run(vertex_program &prog, const page_vertex &vertex);
-
-	void run_on_message(vertex_program &, const vertex_message &msg) {
-	}
-};
-
-class time_range_vertex_program: public vertex_program_impl<time_range_vertex>
-{
-	time_t start_time;
-	time_t end_time;
-public:
-	time_range_vertex_program() {
-		start_time = std::numeric_limits<time_t>::max();
-		end_time = std::numeric_limits<time_t>::min();
-	}
-
-	time_t get_start_time() const {
-		return start_time;
-	}
-
-	time_t get_end_time() const {
-		return end_time;
-	}
-
-	void set_start_time(time_t start_time) {
-		this->start_time = std::min(start_time, this->start_time);
-	}
-
-	void set_end_time(time_t end_time) {
-		this->end_time = std::max(end_time, this->end_time);
-	}
-};
-
-class time_range_vertex_program_creater: public vertex_program_creater
-{
-public:
-	time_range_vertex_program_creater() {
-	}
-
-	vertex_program::ptr create() const {
-		return vertex_program::ptr(new time_range_vertex_program());
-	}
-};
-
-void time_range_vertex::run(vertex_program &prog, const page_vertex &vertex)
-{
-	time_range_vertex_program &range_vprog = (time_range_vertex_program &) prog;
-	if (prog.get_graph().is_directed()) {
-		const page_directed_vertex &dv = (const page_directed_vertex &) vertex;
-
-		if (dv.get_num_edges(IN_EDGE) > 0) {
-			page_byte_array::const_iterator<ts_edge_data> it
-				= dv.get_data_begin<ts_edge_data>(IN_EDGE);
-			range_vprog.set_start_time((*it).get_timestamp());
-			it = it + (dv.get_num_edges(IN_EDGE) - 1);
-			range_vprog.set_end_time((*it).get_timestamp());
-		}
-
-		if (dv.get_num_edges(OUT_EDGE) > 0) {
-			page_byte_array::const_iterator<ts_edge_data> it
-				= dv.get_data_begin<ts_edge_data>(OUT_EDGE);
-			range_vprog.set_start_time((*it).get_timestamp());
-			it = it + (dv.get_num_edges(OUT_EDGE) - 1);
-			range_vprog.set_end_time((*it).get_timestamp());
-		}
-	}
-	else {
-		ABORT_MSG("undirected graph isn't supported");
-	}
-}
-
-}
-
 std::pair<time_t, time_t> get_time_range(FG_graph::ptr fg)
 {
-	graph_index::ptr index = NUMA_graph_index<time_range_vertex>::create(
-			fg->get_graph_header());
-	graph_engine::ptr graph = fg->create_engine(index);
-	assert(graph->get_graph_header().has_edge_data());
-
-	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
-				new time_range_vertex_program_creater()));
-	graph->wait4complete();
-
-	std::vector<vertex_program::ptr> vprogs;
-	graph->get_vertex_programs(vprogs);
-	time_t start_time = std::numeric_limits<time_t>::max();
-	time_t end_time = std::numeric_limits<time_t>::min();
-	BOOST_FOREACH(vertex_program::ptr prog, vprogs) {
-		start_time = std::min(start_time,
-				((time_range_vertex_program &)(*prog)).get_start_time());
-		end_time = std::max(end_time,
-				((time_range_vertex_program &)(*prog)).get_end_time());
-	}
-	assert(start_time <= end_time);
-	return std::pair<time_t, time_t>(start_time, end_time);
+	std::pair<time_t, time_t> range = get_ts_index(fg)->get_time_range();
+	assert(range.first <= range.second);
+	return range;
 }
 
 }
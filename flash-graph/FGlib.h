@@ -33,6 +33,8 @@ namespace safs
 namespace fg
 {
 
+class ts_index;
+
 /**
   * \brief A user-friendly wrapper for FlashGraph's raw graph type.
   *         Very usefule when when utilizing FlashGraph 
@@ -44,9 +46,21 @@ class FG_graph
 	graph_header header;
 	std::string graph_file;
 	std::string index_file;
+	// Indicate whether the index file is in SAFS.
+	bool index_in_safs;
 	std::shared_ptr<in_mem_graph> graph_data;
 	std::shared_ptr<vertex_index> index_data;
 	config_map::ptr configs;
+	// The edge updates that haven't been merged to the graph image.
+	graph_delta::ptr delta;
+	// The adjacency lists of high-degree vertices kept in memory.
+	hot_vertex_store::ptr hot_store;
+	// The compressed vertex index shared by all engines on the graph.
+	in_mem_query_vertex_index::ptr query_index;
+	// The time index of a time-series graph.
+	std::shared_ptr<ts_index> ts_idx;
+	// Indicate whether the graph has been preloaded to the page cache.
+	bool preloaded;
 
 	// In this case, the graph file is kept in SAFS and the index is read to
 	// memory.
@@ -74,6 +88,19 @@ public:
 	static ptr create(const std::string &graph_file,
 			const std::string &index_file, config_map::ptr configs);
 
+	/**
+	 * \brief  Method to instantiate a graph object whose adjacency lists
+	 *         are in SAFS and whose index is already in memory.
+	 *
+	 * \param graph_file Path to the graph file in SAFS.
+	 * \param index_data The index of the graph stored in memory.
+	 * \param configs Configuration in configuration file.
+	 */
+	static ptr create(const std::string &graph_file,
+			std::shared_ptr<vertex_index> index_data, config_map::ptr configs) {
+		return ptr(new FG_graph(graph_file, index_data, configs));
+	}
+
 	/**
 	 * \brief  Method to instantiate a graph object.
 	 *         This method is used in lieu of explicitly calling a ctor.
@@ -114,6 +141,113 @@ public:
 
 	graph_engine::ptr create_engine(graph_index::ptr index);
 
+	/**
+	 * \brief Insert edges to the graph. The edges are buffered in
+	 *        an in-memory delta store and are merged to the adjacency lists
+	 *        read from the graph image when algorithms run on the graph.
+	 * \param edges The edges to be inserted.
+	 */
+	void add_edges(const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges);
+
+	/**
+	 * \brief Delete edges from the graph. All duplicated edges between
+	 *        two vertices are deleted.
+	 * \param edges The edges to be deleted.
+	 */
+	void delete_edges(const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges);
+
+	/**
+	 * \brief Get the delta store with the edge updates of the graph.
+	 * \return The delta store or NULL if the graph hasn't been updated.
+	 */
+	graph_delta::ptr get_delta() const {
+		return delta;
+	}
+
+	/**
+	 * \brief Get the in-memory store of the adjacency lists of
+	 *        high-degree vertices.
+	 * \return The store or NULL if it hasn't been built.
+	 */
+	hot_vertex_store::ptr get_hot_store() const {
+		return hot_store;
+	}
+
+	/**
+	 * \brief Set the in-memory store of the adjacency lists of
+	 *        high-degree vertices. The store is built by the first graph
+	 *        engine created on the graph and shared by the others.
+	 * \param store The hot vertex store.
+	 */
+	void set_hot_store(hot_vertex_store::ptr store) {
+		this->hot_store = store;
+	}
+
+	/**
+	 * \brief Get the compressed in-memory vertex index of the graph.
+	 *        The index is built by the first graph engine created on
+	 *        the graph and shared by the others, so creating an engine
+	 *        doesn't need to scan the whole vertex index.
+	 * \return The vertex index or NULL if it hasn't been built.
+	 */
+	in_mem_query_vertex_index::ptr get_in_mem_index() const {
+		return query_index;
+	}
+
+	/**
+	 * \brief Set the compressed in-memory vertex index of the graph.
+	 * \param index The compressed vertex index.
+	 */
+	void set_in_mem_index(in_mem_query_vertex_index::ptr index) {
+		this->query_index = index;
+	}
+
+	/**
+	 * \brief Get the index file that the graph is loaded with.
+	 * \return The file name or an empty string if the index is created
+	 *         in memory.
+	 */
+	const std::string &get_index_file() const {
+		return index_file;
+	}
+
+	/**
+	 * \brief Determine whether the index file is in SAFS or in
+	 *        the local Linux filesystem.
+	 */
+	bool is_index_in_safs() const {
+		return index_in_safs;
+	}
+
+	/**
+	 * \brief Get the time index of a time-series graph.
+	 * \return The time index or NULL if it hasn't been built.
+	 */
+	std::shared_ptr<ts_index> get_ts_index() const {
+		return ts_idx;
+	}
+
+	/**
+	 * \brief Set the time index of a time-series graph.
+	 * \param index The time index.
+	 */
+	void set_ts_index(std::shared_ptr<ts_index> index) {
+		this->ts_idx = index;
+	}
+
+	/**
+	 * \brief Determine whether a graph engine has preloaded the graph
+	 *        to the page cache. The page cache is shared by all engines,
+	 *        so the graph only needs to be preloaded once.
+	 */
+	bool is_preloaded() const {
+		return preloaded;
+	}
+
+	void set_preloaded() {
+		preloaded = true;
+	}
+
 	/**
 	 * \brief Get the header of the graph that contains basic information of the graph.
 	 * \return The graph header.
@@ -159,6 +293,34 @@ FG_vector<vertex_id_t>::ptr compute_cc(FG_graph::ptr fg);
 */
 FG_vector<vertex_id_t>::ptr compute_wcc(FG_graph::ptr fg);
 
+/**
+  * \brief Compute all weakly connectected components of a graph in
+  *        the edge-centric streaming mode. Vertices propagate the minimal
+  *        component ID through all of their edges, which are streamed from
+  *        the graph file sequentially in each iteration.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \return A vector with a component ID for each vertex in the graph.
+  *
+*/
+FG_vector<vertex_id_t>::ptr compute_wcc_stream(FG_graph::ptr fg);
+
+/**
+  * \brief Compute all weakly connectected components of a graph with
+  *        Afforest. Each vertex first links itself with a few neighbors
+  *        in an in-memory union-find forest; then only the vertices outside
+  *        the largest component read all of their edges. It reads the graph
+  *        at most twice and works on both directed and undirected graphs.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_samples The number of neighbors each vertex links with
+  *        in the first pass.
+  * \return A vector with a component ID for each vertex in the graph.
+  *
+*/
+FG_vector<vertex_id_t>::ptr compute_wcc_afforest(FG_graph::ptr fg,
+		int num_samples = 2);
+
 /**
   * \brief Compute all weakly connectected components of a graph synchronously.
   * The reason of having this implementation is to understand the performance
@@ -215,6 +377,55 @@ FG_vector<size_t>::ptr compute_directed_triangles_fast(FG_graph::ptr fg,
 */
 FG_vector<size_t>::ptr compute_undirected_triangles(FG_graph::ptr fg);
 
+/**
+  * \brief The sampling method used to estimate triangles.
+  *
+  * - WEDGE_SAMPLING samples paths of length two uniformly and checks
+  *         whether they are closed.
+  * - EDGE_SAMPLING samples edges uniformly and counts the common
+  *         neighbors of the two ends of each sampled edge.
+  */
+enum triangle_sampling_method
+{
+	WEDGE_SAMPLING,
+	EDGE_SAMPLING,
+};
+
+/**
+  * \brief The estimated number of triangles and transitivity of a graph
+  *        with their confidence intervals.
+  */
+struct approx_triangle_count
+{
+	double num_triangles;
+	double num_triangles_lower;
+	double num_triangles_upper;
+	double transitivity;
+	double transitivity_lower;
+	double transitivity_upper;
+	size_t num_samples;
+};
+
+/**
+  * \brief Estimate the number of triangles and the transitivity (the global
+  *        clustering coefficient) of an undirected graph by sampling.
+  *        Only the adjacency lists of the vertices that get samples and
+  *        of the neighbors needed to check the samples are read. A vertex
+  *        takes at most 1024 samples, and its samples are weighted if it
+  *        draws more.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param sample_rate The expected fraction of wedges or edges that are
+  *        sampled, in (0, 1].
+  * \param method The sampling method.
+  * \param confidence The confidence level of the confidence intervals.
+  * \return The estimates and their confidence intervals.
+  *
+*/
+approx_triangle_count estimate_triangles(FG_graph::ptr fg, double sample_rate,
+		triangle_sampling_method method = WEDGE_SAMPLING,
+		double confidence = 0.95);
+
 /**
   * \brief Compute the per-vertex local Scan Statistic 
   * \param fg The FlashGraph graph object for which you want to compute.
@@ -239,7 +450,11 @@ FG_vector<std::pair<vertex_id_t, size_t> >::ptr compute_topK_scan(
 
 /**
   * \brief Compute the diameter estimation for a graph. 
+  *        Each sweep runs BFS from up to 256 vertices together, which
+  *        share the reads of adjacency lists.
   * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_bfs The number of BFS in a sweep.
+  * \param directed Whether to follow the direction of edges.
   * \return The diameter estimate value.
   *
 */
@@ -277,6 +492,109 @@ FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr, int num_iters,
 		float damping_factor);
 
+/**
+  * \brief Compute the PageRank of a graph in the edge-centric streaming
+  *       mode. The in-edges of all vertices are streamed from the graph
+  *       file sequentially in each iteration, and vertices pull the PageRank
+  *       of their in-neighbors computed in the previous iteration.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_iters The maximum number of iterations for PageRank.
+  * \param damping_factor The damping factor. Originally .85.
+  *
+  * \return A vector with an entry for each vertex in the graph's
+  *         PageRank value.
+  *
+*/
+FG_vector<float>::ptr compute_pagerank_stream(FG_graph::ptr fg, int num_iters,
+		float damping_factor);
+
+/**
+  * \brief Compute the PageRank of a graph by pushing residuals. Only
+  *       the vertices whose residual is above `epsilon' read their out-edges
+  *       and push the damped residual to their out-neighbors, so the I/O
+  *       shrinks as vertices converge.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_iters The maximum number of iterations for PageRank.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param epsilon The residual threshold.
+  *
+  * \return A vector with an entry for each vertex in the graph's
+  *         PageRank value.
+  *
+*/
+FG_vector<float>::ptr compute_delta_pagerank(FG_graph::ptr fg, int num_iters,
+		float damping_factor, float epsilon = 1.0E-3);
+
+/**
+  * \brief Compute the personalized PageRank of a seed set by pushing
+  *       residuals. The random walk restarts from the seeds uniformly,
+  *       so the PageRank of all vertices sums up to at most 1.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param seeds The seed vertices.
+  * \param num_iters The maximum number of iterations for PageRank.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param epsilon The residual threshold.
+  *
+  * \return A vector with an entry for each vertex in the graph's
+  *         personalized PageRank value.
+  *
+*/
+FG_vector<float>::ptr compute_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int num_iters,
+		float damping_factor, float epsilon = 1.0E-6);
+
+/**
+  * \brief Compute the personalized PageRank of many seed sets. Up to
+  *       8 seed sets are computed in an engine run, and they share
+  *       the reads of adjacency lists.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param seed_sets The seed sets.
+  * \param num_iters The maximum number of iterations for PageRank.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param epsilon The residual threshold.
+  *
+  * \return A PageRank vector for each seed set.
+  *
+*/
+std::vector<FG_vector<float>::ptr> compute_personalized_pagerank(
+		FG_graph::ptr fg, const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		int num_iters, float damping_factor, float epsilon = 1.0E-6);
+
+/**
+  * \brief Compute personalized PageRank with graph engines that stay alive
+  *        across calls. An engine and its vertex state are created on
+  *        the first call that needs them and reused by the later calls.
+  *        The calls can't run concurrently.
+*/
+class ppr_engine
+{
+	FG_graph::ptr fg;
+	// The engines whose vertices hold one and a batch of PageRank vectors.
+	graph_engine::ptr single_graph;
+	graph_engine::ptr batch_graph;
+
+	ppr_engine(FG_graph::ptr fg) {
+		this->fg = fg;
+	}
+public:
+	typedef std::shared_ptr<ppr_engine> ptr;
+
+	static ptr create(FG_graph::ptr fg) {
+		return ptr(new ppr_engine(fg));
+	}
+
+	/**
+	  * \brief The same as compute_personalized_pagerank().
+	*/
+	std::vector<FG_vector<float>::ptr> compute(
+			const std::vector<std::vector<vertex_id_t> > &seed_sets,
+			int num_iters, float damping_factor, float epsilon = 1.0E-6);
+};
+
 FG_vector<float>::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
 		time_t interval, int num_intervals);
 
@@ -305,6 +623,72 @@ in_mem_subgraph::ptr fetch_subgraph(FG_graph::ptr graph,
 FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 		                size_t k, size_t kmax=0);
 
+/**
+ * \brief Compute the shortest distances from a vertex to all other
+ *        vertices with delta-stepping. It follows out-edges in
+ *        a directed graph.
+ *
+ * The edge weight is the edge data of the graph: 4-byte edge data is
+ * read as an integer and 8-byte edge data as a double. All edges weigh 1
+ * if the graph has no edge data. The weights must be non-negative.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param source The vertex where the paths start.
+ * \param delta The width of the distance buckets. The edges heavier than
+ *        `delta' are relaxed once when their bucket is done.
+ * \return A vector with the distance of each vertex from `source'.
+ *         The vertices unreachable from `source' have infinite distance.
+ */
+FG_vector<double>::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t source,
+		double delta);
+
+/**
+ * \brief The transition of random walks.
+ */
+enum walk_transition
+{
+	/** A walker moves to a neighbor uniformly at random. */
+	UNIFORM_WALK,
+	/** A walker moves to a neighbor with probability proportional to
+	 *  the edge weight. */
+	WEIGHTED_WALK,
+	/** The second-order transition of node2vec. */
+	NODE2VEC_WALK,
+};
+
+/**
+ * \brief A step of a random walk in the output file of
+ *        `generate_random_walks'.
+ */
+struct walk_step
+{
+	uint64_t walk_id;
+	uint32_t step;
+	vertex_id_t vertex;
+};
+
+/**
+ * \brief Generate random walks from every vertex and write them to a file.
+ *        It follows out-edges in a directed graph.
+ *
+ * The walks are written as `walk_step' records in no particular order.
+ * Walk `i * n + v' is the i-th walk from vertex `v' in a graph with
+ * n vertices; its steps are numbered from 0, the start vertex. A walk
+ * ends early at a vertex without edges. The edge weights follow
+ * `compute_sssp'.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param out_file The file where the walks are written.
+ * \param num_walks The number of walks from each vertex.
+ * \param walk_length The number of steps in a walk.
+ * \param transition The transition of the walks. node2vec walks use
+ *        the edge weights if the graph has them.
+ * \param p The return parameter of node2vec.
+ * \param q The in-out parameter of node2vec.
+ * \return The number of steps written to the file.
+ */
+size_t generate_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		int num_walks, int walk_length,
+		walk_transition transition = UNIFORM_WALK, double p = 1, double q = 1);
+
 /**
  * \brief Get the degree of all vertices in the graph.
  * \param fg The FlashGraph graph object for which you want to compute.
@@ -333,6 +717,82 @@ FG_vector<float>::ptr compute_transitivity(FG_graph::ptr fg);
 FG_vector<float>::ptr compute_betweenness_centrality(FG_graph::ptr fg,
 		const std::vector<vertex_id_t>& vids);
 
+/**
+  * \brief Compute the closeness centrality of vertices in a graph.
+  *        The closeness of a vertex is the number of vertices it reaches
+  *        divided by the sum of their distances to the vertex.
+  *        BFS from up to 256 vertices run together and share the reads
+  *        of adjacency lists.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param vids The vertex IDs for which closeness should be computed.
+  * \param traverse_edge The type of edges to follow in a directed graph.
+  * \return A vector with the closeness of each vertex in `vids'.
+*/
+FG_vector<float>::ptr compute_closeness(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &vids,
+		edge_type traverse_edge = edge_type::OUT_EDGE);
+
+/**
+  * \brief Count the vertices that can be reached from each of the given
+  *        vertices within k hops. BFS from up to 256 vertices run together
+  *        and share the reads of adjacency lists.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param vids The vertex IDs from which BFS starts.
+  * \param k The maximal number of hops.
+  * \param traverse_edge The type of edges to follow in a directed graph.
+  * \return A vector with the number of vertices reachable within k hops
+  *         from each vertex in `vids', excluding the vertex itself.
+*/
+FG_vector<size_t>::ptr compute_khop_reach(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &vids, int k,
+		edge_type traverse_edge = edge_type::OUT_EDGE);
+
+/**
+  * \brief Compute k-hop reachability with graph engines that stay alive
+  *        across calls. An engine and its vertex state are created on
+  *        the first call that needs them and reused by the later calls,
+  *        so a service that answers many small batches doesn't allocate
+  *        the state of all vertices for each batch. The calls can't run
+  *        concurrently.
+*/
+class khop_reach_engine
+{
+	FG_graph::ptr fg;
+	// The engines whose vertices can run BFS from 64 and 256 vertices.
+	graph_engine::ptr small_graph;
+	graph_engine::ptr large_graph;
+
+	khop_reach_engine(FG_graph::ptr fg) {
+		this->fg = fg;
+	}
+public:
+	typedef std::shared_ptr<khop_reach_engine> ptr;
+
+	static ptr create(FG_graph::ptr fg) {
+		return ptr(new khop_reach_engine(fg));
+	}
+
+	/**
+	  * \brief Run BFS from all vertices in `vids' and get the number of
+	  *        vertices reached by each of them and the sum of their
+	  *        distances. The sources themselves are included with
+	  *        the distance of 0.
+	  * \param max_level The maximal number of hops. If it's negative,
+	  *        BFS traverses all reachable vertices.
+	*/
+	void get_dist_sums(const std::vector<vertex_id_t> &vids,
+			edge_type traverse_edge, int max_level,
+			std::vector<size_t> &num_reached, std::vector<size_t> &dist_sums);
+
+	/**
+	  * \brief The same as compute_khop_reach().
+	*/
+	FG_vector<size_t>::ptr compute(const std::vector<vertex_id_t> &vids,
+			int k, edge_type traverse_edge = edge_type::OUT_EDGE);
+};
+
 /**
  * \brief Get the degree of all vertices in a specified time interval in
  *        a time-series graph.
@@ -370,10 +830,18 @@ void compute_overlap(FG_graph::ptr fg, const std::vector<vertex_id_t> &vids,
 FG_vector<float>::ptr compute_transitivity(FG_graph::ptr fg);
 
 /**
- * \brief Compute louvain clustering for a graph.
+ * \brief Compute louvain clustering for a graph. Directed graphs are
+ *        treated as undirected and the edge data of the graph, if it
+ *        exists, is used as the edge weight.
  * \param fg The FlashGraph graph object for which you want to compute.
- * \param levels The number of levels of the hierarchy to do.
+ * \param levels The maximal number of levels of the hierarchy to do.
+ *        If it's 0, it runs until the modularity converges.
+ * \param modularity The modularity of the clusters in each level.
+ * \return A vector with the cluster ID of each vertex in the last level.
  */
-void compute_louvain(FG_graph::ptr fg, const uint32_t levels);
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg,
+		uint32_t levels, std::vector<double> &modularity);
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg,
+		uint32_t levels = 0);
 }
 #endif
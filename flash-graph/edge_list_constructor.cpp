@@ -0,0 +1,785 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <queue>
+#include <mutex>
+#include <limits>
+
+#include <boost/format.hpp>
+
+#include "native_file.h"
+#include "comm_exception.h"
+
+#include "edge_list_constructor.h"
+#include "vertex.h"
+#include "vertex_index.h"
+#include "graph_file_header.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+typedef std::pair<vertex_id_t, vertex_id_t> edge_t;
+
+/*
+ * The size of a range of an edge list parsed by a thread.
+ */
+static const size_t PARSE_RANGE_SIZE = 64 * 1024 * 1024;
+/*
+ * The minimal size of the buffer used to read a run in the merge stage.
+ */
+static const size_t MIN_RUN_BUF_SIZE = 64 * 1024;
+/*
+ * The maximal number of runs that a thread merges at once.
+ */
+static const size_t MAX_MERGE_FAN_IN = 64;
+/*
+ * The number of vertex ranges merged by a thread.
+ */
+static const int RANGES_PER_THREAD = 8;
+
+edge_list_constructor::edge_list_constructor(bool directed,
+		const std::string &work_dir)
+{
+	this->directed = directed;
+	this->work_dir = work_dir;
+	dedup = false;
+	remove_self_loops = false;
+	sort_buf_size = 256 * 1024 * 1024;
+	merge_buf_size = 256 * 1024 * 1024;
+	num_threads = omp_get_max_threads();
+}
+
+namespace
+{
+
+/*
+ * A sorted run of edges written to a file in the parse stage.
+ */
+struct edge_run
+{
+	std::string file;
+	size_t num_edges;
+
+	edge_run(const std::string &file, size_t num_edges) {
+		this->file = file;
+		this->num_edges = num_edges;
+	}
+};
+
+/*
+ * A range of an edge list parsed by a thread.
+ */
+struct parse_range
+{
+	std::string file;
+	off_t start;
+	off_t end;
+
+	parse_range(const std::string &file, off_t start, off_t end) {
+		this->file = file;
+		this->start = start;
+		this->end = end;
+	}
+};
+
+static FILE *open_file(const std::string &file, const char *mode)
+{
+	FILE *f = fopen(file.c_str(), mode);
+	if (f == NULL) {
+		perror(("fopen " + file).c_str());
+		abort();
+	}
+	return f;
+}
+
+}
+
+/*
+ * This keeps the runs created in the parse stage. A run contains either
+ * out-edges or in-edges of vertices, sorted on the first vertex of
+ * the edges.
+ */
+class run_writer
+{
+	std::string work_dir;
+	bool dedup;
+	std::mutex lock;
+	size_t run_id;
+	std::vector<edge_run> runs[2];
+public:
+	run_writer(const std::string &work_dir, bool dedup) {
+		this->work_dir = work_dir;
+		this->dedup = dedup;
+		run_id = 0;
+	}
+
+	/*
+	 * Sort the edges and write them to a new run. The buffer is cleared
+	 * afterwards.
+	 */
+	void write(std::vector<edge_t> &edges, int type);
+
+	/*
+	 * Get the name of a new run file.
+	 */
+	std::string get_run_file();
+
+	const std::vector<edge_run> &get_runs(int type) const {
+		return runs[type];
+	}
+
+	/*
+	 * Replace the runs of a type, e.g., after they are merged into
+	 * fewer runs. The files of the old runs aren't deleted.
+	 */
+	void set_runs(int type, const std::vector<edge_run> &runs) {
+		this->runs[type] = runs;
+	}
+
+	void delete_runs() {
+		for (int i = 0; i < 2; i++) {
+			for (size_t j = 0; j < runs[i].size(); j++)
+				native_file(runs[i][j].file).delete_file();
+			runs[i].clear();
+		}
+	}
+};
+
+std::string run_writer::get_run_file()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return work_dir + "/" + (boost::format("fg-run-%1%-%2%.bin")
+			% getpid() % run_id++).str();
+}
+
+void run_writer::write(std::vector<edge_t> &edges, int type)
+{
+	if (edges.empty())
+		return;
+
+	std::sort(edges.begin(), edges.end());
+	if (dedup)
+		edges.resize(std::unique(edges.begin(), edges.end()) - edges.begin());
+
+	std::string file = get_run_file();
+	FILE *f = open_file(file, "w");
+	BOOST_VERIFY(fwrite(edges.data(), sizeof(edges[0]), edges.size(), f)
+			== edges.size());
+	fclose(f);
+
+	lock.lock();
+	runs[type].push_back(edge_run(file, edges.size()));
+	lock.unlock();
+	edges.clear();
+}
+
+namespace
+{
+
+/*
+ * Parse a line of an edge list. It returns false if the line isn't
+ * an edge.
+ */
+static bool parse_edge(const char *line, edge_t &e, bool &malformed)
+{
+	malformed = false;
+	while (isspace(*line))
+		line++;
+	if (*line == 0 || *line == '#' || *line == '%')
+		return false;
+
+	char *end;
+	unsigned long long from = strtoull(line, &end, 10);
+	if (end == line) {
+		malformed = true;
+		return false;
+	}
+	line = end;
+	unsigned long long to = strtoull(line, &end, 10);
+	if (end == line || from >= (unsigned long long) INVALID_VERTEX_ID
+			|| to >= (unsigned long long) INVALID_VERTEX_ID) {
+		malformed = true;
+		return false;
+	}
+	e.first = from;
+	e.second = to;
+	return true;
+}
+
+/*
+ * The edges parsed by a thread. They are written to a run when
+ * the buffer is full.
+ */
+struct parse_buffer
+{
+	std::vector<edge_t> out_edges;
+	std::vector<edge_t> in_edges;
+	vertex_id_t max_id;
+	size_t num_edges;
+	size_t num_malformed;
+
+	parse_buffer() {
+		max_id = 0;
+		num_edges = 0;
+		num_malformed = 0;
+	}
+
+	void add_edge(const edge_t &e, bool directed, bool remove_self_loops,
+			size_t buf_capacity, run_writer &writer) {
+		if (remove_self_loops && e.first == e.second)
+			return;
+
+		num_edges++;
+		max_id = std::max(max_id, std::max(e.first, e.second));
+		out_edges.push_back(e);
+		if (directed)
+			in_edges.push_back(edge_t(e.second, e.first));
+		else if (e.first != e.second)
+			out_edges.push_back(edge_t(e.second, e.first));
+		if (out_edges.size() >= buf_capacity)
+			writer.write(out_edges, 0);
+		if (in_edges.size() >= buf_capacity)
+			writer.write(in_edges, 1);
+	}
+};
+
+/*
+ * Write the edges left in the buffers of the threads to runs.
+ * It returns the number of vertices in the edges.
+ */
+static size_t flush_parse_buffers(std::vector<parse_buffer> &bufs,
+		run_writer &writer, size_t &num_edges)
+{
+	size_t num_vertices = 0;
+	num_edges = 0;
+	for (size_t i = 0; i < bufs.size(); i++) {
+		writer.write(bufs[i].out_edges, 0);
+		writer.write(bufs[i].in_edges, 1);
+		if (bufs[i].num_edges > 0)
+			num_vertices = std::max(num_vertices, (size_t) bufs[i].max_id + 1);
+		num_edges += bufs[i].num_edges;
+	}
+	return num_vertices;
+}
+
+/*
+ * This reads the edges in a run within a vertex range. The edges are read
+ * with a small buffer.
+ */
+class run_reader
+{
+	int fd;
+	// The range of edges in the run we read.
+	size_t curr;
+	size_t end;
+	std::vector<edge_t> buf;
+	size_t buf_idx;
+	size_t buf_capacity;
+
+	edge_t read_edge(size_t idx) const {
+		edge_t e;
+		BOOST_VERIFY(pread(fd, &e, sizeof(e), idx * sizeof(e))
+				== sizeof(e));
+		return e;
+	}
+
+	/*
+	 * Find the first edge whose source vertex isn't smaller than the vertex.
+	 */
+	size_t lower_bound(vertex_id_t id, size_t num_edges) const {
+		size_t lo = 0;
+		size_t hi = num_edges;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (read_edge(mid).first < id)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	void fill() {
+		size_t num = std::min(buf_capacity, end - curr);
+		buf.resize(num);
+		BOOST_VERIFY(pread(fd, buf.data(), num * sizeof(edge_t),
+					curr * sizeof(edge_t)) == (ssize_t) (num * sizeof(edge_t)));
+		curr += num;
+		buf_idx = 0;
+	}
+public:
+	run_reader(const edge_run &run, vertex_id_t start_id, vertex_id_t end_id,
+			size_t buf_size) {
+		fd = open(run.file.c_str(), O_RDONLY);
+		if (fd < 0) {
+			perror(("open " + run.file).c_str());
+			abort();
+		}
+		curr = lower_bound(start_id, run.num_edges);
+		end = lower_bound(end_id, run.num_edges);
+		buf_capacity = std::max(buf_size / sizeof(edge_t), 1UL);
+		buf_idx = 0;
+	}
+
+	~run_reader() {
+		close(fd);
+	}
+
+	bool has_next() const {
+		return buf_idx < buf.size() || curr < end;
+	}
+
+	edge_t next() {
+		if (buf_idx == buf.size())
+			fill();
+		return buf[buf_idx++];
+	}
+};
+
+/*
+ * This merges the edges of multiple runs within a vertex range.
+ */
+class run_merger
+{
+	typedef std::pair<edge_t, size_t> merge_entry;
+
+	std::vector<std::unique_ptr<run_reader> > readers;
+	std::priority_queue<merge_entry, std::vector<merge_entry>,
+		std::greater<merge_entry> > queue;
+public:
+	run_merger(const edge_run runs[], size_t num_runs, vertex_id_t start_id,
+			vertex_id_t end_id, size_t run_buf_size) {
+		for (size_t i = 0; i < num_runs; i++) {
+			readers.emplace_back(new run_reader(runs[i], start_id, end_id,
+						run_buf_size));
+			if (readers[i]->has_next())
+				queue.push(merge_entry(readers[i]->next(), i));
+		}
+	}
+
+	bool has_next() const {
+		return !queue.empty();
+	}
+
+	const edge_t &peek() const {
+		return queue.top().first;
+	}
+
+	edge_t next() {
+		merge_entry entry = queue.top();
+		queue.pop();
+		if (readers[entry.second]->has_next())
+			queue.push(merge_entry(readers[entry.second]->next(),
+						entry.second));
+		return entry.first;
+	}
+};
+
+/*
+ * This writes adjacency lists to a part file with a large buffer.
+ */
+class adj_list_writer
+{
+	FILE *f;
+	std::vector<char> buf;
+public:
+	adj_list_writer(const std::string &file) {
+		f = open_file(file, "w");
+	}
+
+	~adj_list_writer() {
+		flush();
+		fclose(f);
+	}
+
+	void flush() {
+		if (!buf.empty())
+			BOOST_VERIFY(fwrite(buf.data(), buf.size(), 1, f) == 1);
+		buf.clear();
+	}
+
+	void write(vertex_id_t id, const std::vector<vertex_id_t> &neighs) {
+		size_t size = ext_mem_undirected_vertex::num_edges2vsize(neighs.size(), 0);
+		size_t off = buf.size();
+		buf.resize(off + size);
+		ext_mem_undirected_vertex *v = new (buf.data() + off)
+			ext_mem_undirected_vertex(id, neighs.size(), 0);
+		for (size_t i = 0; i < neighs.size(); i++)
+			v->set_neighbor(i, neighs[i]);
+		if (buf.size() >= PARSE_RANGE_SIZE)
+			flush();
+	}
+};
+
+}
+
+/*
+ * Split the edge lists into ranges and parse them in parallel.
+ * It returns the number of vertices in the graph.
+ */
+static size_t parse_edge_lists(const std::vector<std::string> &edge_files,
+		run_writer &writer, bool directed, bool remove_self_loops,
+		size_t sort_buf_size, int num_threads, size_t &num_edges)
+{
+	std::vector<parse_range> ranges;
+	for (size_t i = 0; i < edge_files.size(); i++) {
+		native_file f(edge_files[i]);
+		if (!f.exist())
+			throw invalid_arg_exception(edge_files[i] + " doesn't exist");
+		off_t size = f.get_size();
+		for (off_t off = 0; off < size; off += PARSE_RANGE_SIZE)
+			ranges.push_back(parse_range(edge_files[i], off,
+						std::min(off + (off_t) PARSE_RANGE_SIZE, size)));
+	}
+
+	// In a directed graph, each edge is buffered twice.
+	size_t buf_capacity = std::max(sort_buf_size / sizeof(edge_t)
+			/ (directed ? 2 : 1), 1UL);
+	std::vector<parse_buffer> bufs(num_threads);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for (size_t i = 0; i < ranges.size(); i++) {
+		parse_buffer &buf = bufs[omp_get_thread_num()];
+		const parse_range &range = ranges[i];
+		FILE *f = open_file(range.file, "r");
+		char *line = NULL;
+		size_t line_size = 0;
+		ssize_t len;
+		off_t pos = range.start;
+		// A line that crosses the boundary of two ranges belongs to
+		// the first range. We read from the byte before the range, so
+		// we can tell if the range starts with a new line.
+		if (range.start > 0) {
+			fseek(f, range.start - 1, SEEK_SET);
+			len = getline(&line, &line_size, f);
+			pos += len > 0 ? len - 1 : 0;
+		}
+		while (pos < range.end && (len = getline(&line, &line_size, f)) > 0) {
+			pos += len;
+			edge_t e;
+			bool malformed;
+			if (!parse_edge(line, e, malformed)) {
+				buf.num_malformed += malformed;
+				continue;
+			}
+			buf.add_edge(e, directed, remove_self_loops, buf_capacity, writer);
+		}
+		free(line);
+		fclose(f);
+	}
+
+	size_t num_vertices = flush_parse_buffers(bufs, writer, num_edges);
+	size_t num_malformed = 0;
+	for (int i = 0; i < num_threads; i++)
+		num_malformed += bufs[i].num_malformed;
+	if (num_malformed > 0)
+		BOOST_LOG_TRIVIAL(warning)
+			<< boost::format("%1% lines in the edge lists aren't edges")
+			% num_malformed;
+	return num_vertices;
+}
+
+/*
+ * Generate the blocks of edges in parallel and write them to runs.
+ * It returns the number of vertices in the graph.
+ */
+static size_t gen_edge_lists(const edge_generator &gen, run_writer &writer,
+		bool directed, bool remove_self_loops, size_t sort_buf_size,
+		int num_threads, size_t &num_edges)
+{
+	size_t buf_capacity = std::max(sort_buf_size / sizeof(edge_t)
+			/ (directed ? 2 : 1), 1UL);
+	std::vector<parse_buffer> bufs(num_threads);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for (size_t i = 0; i < gen.get_num_blocks(); i++) {
+		parse_buffer &buf = bufs[omp_get_thread_num()];
+		std::vector<edge_t> edges;
+		gen.gen_block(i, edges);
+		for (size_t j = 0; j < edges.size(); j++)
+			buf.add_edge(edges[j], directed, remove_self_loops, buf_capacity,
+					writer);
+	}
+
+	size_t num_vertices = flush_parse_buffers(bufs, writer, num_edges);
+	// The generator may create vertices without edges.
+	return num_edges > 0 ? std::max(num_vertices, gen.get_num_vertices()) : 0;
+}
+
+/*
+ * The number of runs that a thread merges at once. It's bounded, so
+ * the merge buffers of a thread don't shrink below the minimal size and
+ * the threads don't run out of file descriptors.
+ */
+static size_t get_merge_fan_in(size_t merge_buf_size, int num_threads)
+{
+	size_t fan_in = std::min(MAX_MERGE_FAN_IN,
+			merge_buf_size / num_threads / MIN_RUN_BUF_SIZE);
+	struct rlimit limit;
+	// Leave half of the file descriptors to the rest of the process.
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+			&& limit.rlim_cur != RLIM_INFINITY)
+		fan_in = std::min(fan_in, (size_t) limit.rlim_cur / 2 / num_threads);
+	return std::max(fan_in, 2UL);
+}
+
+/*
+ * Merge groups of runs of a type into longer runs until there are at most
+ * `fan_in' runs. Each pass merges the groups in parallel.
+ */
+static void reduce_runs(run_writer &writer, int type, size_t fan_in,
+		bool dedup, size_t merge_buf_size, int num_threads)
+{
+	size_t run_buf_size = std::max(merge_buf_size / num_threads / fan_in,
+			MIN_RUN_BUF_SIZE);
+	while (writer.get_runs(type).size() > fan_in) {
+		const std::vector<edge_run> runs = writer.get_runs(type);
+		size_t num_groups = (runs.size() + fan_in - 1) / fan_in;
+		std::vector<edge_run> merged(num_groups, edge_run("", 0));
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+		for (size_t i = 0; i < num_groups; i++) {
+			size_t start = i * fan_in;
+			size_t num_runs = std::min(fan_in, runs.size() - start);
+			if (num_runs == 1) {
+				merged[i] = runs[start];
+				continue;
+			}
+
+			run_merger merger(&runs[start], num_runs, 0, INVALID_VERTEX_ID,
+					run_buf_size);
+			std::string file = writer.get_run_file();
+			FILE *f = open_file(file, "w");
+			std::vector<edge_t> buf;
+			buf.reserve(run_buf_size / sizeof(edge_t));
+			size_t num_edges = 0;
+			edge_t last;
+			while (merger.has_next()) {
+				edge_t e = merger.next();
+				if (dedup && num_edges > 0 && e == last)
+					continue;
+				last = e;
+				num_edges++;
+				buf.push_back(e);
+				if (buf.size() == buf.capacity()) {
+					BOOST_VERIFY(fwrite(buf.data(), sizeof(buf[0]), buf.size(),
+								f) == buf.size());
+					buf.clear();
+				}
+			}
+			BOOST_VERIFY(fwrite(buf.data(), sizeof(buf[0]), buf.size(), f)
+					== buf.size());
+			fclose(f);
+			merged[i] = edge_run(file, num_edges);
+			for (size_t j = start; j < start + num_runs; j++)
+				native_file(runs[j].file).delete_file();
+		}
+		writer.set_runs(type, merged);
+	}
+}
+
+/*
+ * Merge the runs of a type and write the adjacency lists to part files,
+ * one for each vertex range. It returns the number of edges in
+ * the adjacency lists. The self-loops in the adjacency lists are also
+ * counted in `num_self_loops'.
+ */
+static size_t merge_runs(const std::vector<edge_run> &runs, size_t num_vertices,
+		bool dedup, size_t merge_buf_size, int num_threads,
+		const std::vector<std::string> &part_files, vsize_t degrees[],
+		size_t &num_self_loops)
+{
+	int num_ranges = part_files.size();
+	size_t run_buf_size = std::max(merge_buf_size / num_threads
+			/ std::max(runs.size(), 1UL), MIN_RUN_BUF_SIZE);
+	size_t num_edges = 0;
+	size_t num_loops = 0;
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic) \
+	reduction(+:num_edges, num_loops)
+	for (int i = 0; i < num_ranges; i++) {
+		vertex_id_t start_id = num_vertices * i / num_ranges;
+		vertex_id_t end_id = num_vertices * (i + 1) / num_ranges;
+		run_merger merger(runs.data(), runs.size(), start_id, end_id,
+				run_buf_size);
+
+		adj_list_writer writer(part_files[i]);
+		std::vector<vertex_id_t> neighs;
+		for (vertex_id_t id = start_id; id < end_id; id++) {
+			neighs.clear();
+			while (merger.has_next() && merger.peek().first == id) {
+				vertex_id_t neigh = merger.next().second;
+				if (!dedup || neighs.empty() || neighs.back() != neigh) {
+					neighs.push_back(neigh);
+					num_loops += neigh == id;
+				}
+			}
+			// We can't throw exceptions in an OpenMP region.
+			if (neighs.size() > (size_t) std::numeric_limits<vsize_t>::max())
+				ABORT_MSG("the degree of a vertex is too large");
+			degrees[id] = neighs.size();
+			num_edges += neighs.size();
+			writer.write(id, neighs);
+		}
+		assert(!merger.has_next());
+	}
+	num_self_loops = num_loops;
+	return num_edges;
+}
+
+/*
+ * Append the part files to the adjacency file and delete them.
+ */
+static void append_parts(FILE *out, const std::vector<std::string> &part_files)
+{
+	std::vector<char> buf(PARSE_RANGE_SIZE);
+	for (size_t i = 0; i < part_files.size(); i++) {
+		FILE *in = open_file(part_files[i], "r");
+		size_t ret;
+		while ((ret = fread(buf.data(), 1, buf.size(), in)) > 0)
+			BOOST_VERIFY(fwrite(buf.data(), ret, 1, out) == 1);
+		fclose(in);
+		native_file(part_files[i]).delete_file();
+	}
+}
+
+void edge_list_constructor::construct(const std::vector<std::string> &edge_files,
+		const std::string &adj_file, const std::string &index_file)
+{
+	native_file dir(work_dir);
+	if (!dir.exist() || !dir.is_dir())
+		throw invalid_arg_exception(work_dir + " isn't a directory");
+
+	stats.clear();
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	run_writer runs(work_dir, dedup);
+	size_t num_input_edges = 0;
+	size_t num_vertices = parse_edge_lists(edge_files, runs, directed,
+			remove_self_loops, sort_buf_size, num_threads, num_input_edges);
+	gettimeofday(&end, NULL);
+	stats.push_back(construct_stage_stat("parse", num_input_edges,
+				time_diff(start, end)));
+	if (num_vertices == 0) {
+		runs.delete_runs();
+		throw invalid_arg_exception("the edge lists don't have edges");
+	}
+	merge_and_write(runs, num_vertices, num_input_edges, adj_file, index_file);
+}
+
+void edge_list_constructor::construct(const edge_generator &gen,
+		const std::string &adj_file, const std::string &index_file)
+{
+	native_file dir(work_dir);
+	if (!dir.exist() || !dir.is_dir())
+		throw invalid_arg_exception(work_dir + " isn't a directory");
+	if (gen.get_num_vertices() > (size_t) INVALID_VERTEX_ID)
+		throw invalid_arg_exception("too many vertices in the generator");
+
+	stats.clear();
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	run_writer runs(work_dir, dedup);
+	size_t num_input_edges = 0;
+	size_t num_vertices = gen_edge_lists(gen, runs, directed,
+			remove_self_loops, sort_buf_size, num_threads, num_input_edges);
+	gettimeofday(&end, NULL);
+	stats.push_back(construct_stage_stat("generate", num_input_edges,
+				time_diff(start, end)));
+	if (num_vertices == 0) {
+		runs.delete_runs();
+		throw invalid_arg_exception("the generator doesn't generate edges");
+	}
+	merge_and_write(runs, num_vertices, num_input_edges, adj_file, index_file);
+}
+
+void edge_list_constructor::merge_and_write(run_writer &runs,
+		size_t num_vertices, size_t num_input_edges,
+		const std::string &adj_file, const std::string &index_file)
+{
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	int num_ranges = std::min((size_t) num_threads * RANGES_PER_THREAD,
+			num_vertices);
+	// The part files of out-edges (or all edges in an undirected graph)
+	// and in-edges.
+	std::vector<std::string> part_files[2];
+	for (int type = 0; type < (directed ? 2 : 1); type++)
+		for (int i = 0; i < num_ranges; i++)
+			part_files[type].push_back(work_dir + "/" + (boost::format(
+							"fg-part-%1%-%2%-%3%.bin") % getpid() % type % i).str());
+	size_t fan_in = get_merge_fan_in(merge_buf_size, num_threads);
+	for (int type = 0; type < (directed ? 2 : 1); type++)
+		reduce_runs(runs, type, fan_in, dedup, merge_buf_size, num_threads);
+	std::vector<vsize_t> out_degrees(num_vertices);
+	std::vector<vsize_t> in_degrees(directed ? num_vertices : 0);
+	size_t num_self_loops = 0;
+	size_t num_edges = merge_runs(runs.get_runs(0), num_vertices, dedup,
+			merge_buf_size, num_threads, part_files[0], out_degrees.data(),
+			num_self_loops);
+	if (directed)
+		merge_runs(runs.get_runs(1), num_vertices, dedup, merge_buf_size,
+				num_threads, part_files[1], in_degrees.data(), num_self_loops);
+	runs.delete_runs();
+	gettimeofday(&end, NULL);
+	stats.push_back(construct_stage_stat("merge", num_input_edges,
+				time_diff(start, end)));
+
+	start = end;
+	// Each edge in an undirected graph is stored in the adjacency lists
+	// of both vertices, except self-loops, which are stored once.
+	if (!directed)
+		num_edges = (num_edges - num_self_loops) / 2 + num_self_loops;
+	graph_header header(directed ? graph_type::DIRECTED : graph_type::UNDIRECTED,
+			num_vertices, num_edges, 0);
+	FILE *f = open_file(adj_file, "w");
+	BOOST_VERIFY(fwrite(&header, sizeof(header), 1, f) == 1);
+	// The in-part is stored before the out-part in a directed graph.
+	if (directed)
+		append_parts(f, part_files[1]);
+	append_parts(f, part_files[0]);
+	fclose(f);
+
+	if (directed)
+		cdirected_vertex_index::construct(num_vertices, in_degrees.data(),
+				out_degrees.data(), header)->dump(index_file);
+	else
+		cundirected_vertex_index::construct(num_vertices, out_degrees.data(),
+				header)->dump(index_file);
+	gettimeofday(&end, NULL);
+	stats.push_back(construct_stage_stat("write", num_edges,
+				time_diff(start, end)));
+
+	for (size_t i = 0; i < stats.size(); i++)
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("%1%: %2% edges in %3% seconds (%4% edges/s)")
+			% stats[i].name % stats[i].num_edges % stats[i].seconds
+			% (size_t) stats[i].get_edges_per_sec();
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("The graph has %1% vertices and %2% edges")
+		% num_vertices % num_edges;
+}
+
+}
@@ -0,0 +1,185 @@
+#ifndef __EDGE_LIST_CONSTRUCTOR_H__
+#define __EDGE_LIST_CONSTRUCTOR_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "FG_basic_types.h"
+
+namespace fg
+{
+
+/*
+ * The throughput of a stage in the graph construction.
+ */
+struct construct_stage_stat
+{
+	std::string name;
+	size_t num_edges;
+	double seconds;
+
+	construct_stage_stat(const std::string &name, size_t num_edges,
+			double seconds) {
+		this->name = name;
+		this->num_edges = num_edges;
+		this->seconds = seconds;
+	}
+
+	double get_edges_per_sec() const {
+		return seconds > 0 ? num_edges / seconds : 0;
+	}
+};
+
+/*
+ * This generates the edges of a graph in blocks, so a generated graph can
+ * be constructed without writing a text edge list first. The blocks are
+ * generated by multiple threads in parallel, so the edges in a block should
+ * only depend on the block ID.
+ */
+class edge_generator
+{
+public:
+	typedef std::pair<vertex_id_t, vertex_id_t> edge_t;
+
+	virtual ~edge_generator() {
+	}
+
+	/*
+	 * All vertex IDs of the generated edges are smaller than this.
+	 */
+	virtual size_t get_num_vertices() const = 0;
+	virtual size_t get_num_blocks() const = 0;
+	/*
+	 * Append the edges in the block to the vector.
+	 */
+	virtual void gen_block(size_t block_id, std::vector<edge_t> &edges) const = 0;
+};
+
+class run_writer;
+
+/*
+ * This constructs the FlashGraph image of a graph from text edge lists
+ * with bounded memory. Each line of an edge list contains the source and
+ * the destination vertex of an edge; lines that start with '#' or '%'
+ * are comments.
+ *
+ * The construction has three stages:
+ *	parse: the edge lists are split into ranges that are parsed in parallel
+ *		(or the blocks of an edge generator are generated in parallel).
+ *		Each thread buffers edges, sorts them when the buffer is full and
+ *		writes them to a sorted run file. In a directed graph, an edge is
+ *		written to the run of out-edges and the reversed edge is written to
+ *		the run of in-edges; in an undirected graph, both are written to
+ *		the same run.
+ *	merge: if there are too many runs to merge at once, groups of runs are
+ *		merged into longer runs first, so a thread never opens more than
+ *		a bounded number of runs. Then the vertex ID space is split into
+ *		ranges and the runs are merged with multiway merge in each range
+ *		in parallel. The merged edges are written as adjacency lists to
+ *		a part file of the range.
+ *	write: the graph header and the part files are written to the adjacency
+ *		file sequentially and the vertex index is constructed from
+ *		the degrees collected in the merge stage.
+ *
+ * The memory used by the construction is bounded by the sort buffers
+ * of the threads, the merge buffers and the degrees of the vertices.
+ */
+class edge_list_constructor
+{
+	bool directed;
+	bool dedup;
+	bool remove_self_loops;
+	size_t sort_buf_size;
+	size_t merge_buf_size;
+	int num_threads;
+	// The directory where the run files and the part files are written.
+	std::string work_dir;
+	std::vector<construct_stage_stat> stats;
+
+	edge_list_constructor(bool directed, const std::string &work_dir);
+
+	/*
+	 * Merge the runs created in the parse stage and write the graph.
+	 */
+	void merge_and_write(run_writer &runs, size_t num_vertices,
+			size_t num_input_edges, const std::string &adj_file,
+			const std::string &index_file);
+public:
+	typedef std::shared_ptr<edge_list_constructor> ptr;
+
+	static ptr create(bool directed, const std::string &work_dir) {
+		return ptr(new edge_list_constructor(directed, work_dir));
+	}
+
+	/*
+	 * Remove duplicated edges.
+	 */
+	void set_dedup(bool dedup) {
+		this->dedup = dedup;
+	}
+
+	void set_remove_self_loops(bool remove) {
+		this->remove_self_loops = remove;
+	}
+
+	/*
+	 * The size of the buffer each thread uses to sort edges in the parse
+	 * stage.
+	 */
+	void set_sort_buf_size(size_t size) {
+		this->sort_buf_size = size;
+	}
+
+	/*
+	 * The total size of the buffers used to read runs in the merge stage.
+	 */
+	void set_merge_buf_size(size_t size) {
+		this->merge_buf_size = size;
+	}
+
+	void set_num_threads(int num_threads) {
+		this->num_threads = num_threads;
+	}
+
+	/*
+	 * Construct the graph from the edge lists and write the adjacency lists
+	 * and the vertex index to the given files.
+	 */
+	void construct(const std::vector<std::string> &edge_files,
+			const std::string &adj_file, const std::string &index_file);
+
+	/*
+	 * Construct the graph from the edges of the generator.
+	 */
+	void construct(const edge_generator &gen, const std::string &adj_file,
+			const std::string &index_file);
+
+	const std::vector<construct_stage_stat> &get_stats() const {
+		return stats;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <atomic>
+
+#include <boost/format.hpp>
+
+#include "io_interface.h"
+#include "thread.h"
+
+#include "edge_stream.h"
+#include "graph_delta.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+/*
+ * The size of a chunk read from the graph file with a single I/O request.
+ * A chunk can be larger if it contains a single large vertex.
+ */
+static const size_t STREAM_CHUNK_SIZE = 32 * 1024 * 1024;
+
+edge_stream_engine::edge_stream_engine(FG_graph::ptr fg, graph_index::ptr index)
+{
+	graph = fg->create_engine(index);
+	// The adjacency lists are read sequentially and only once in
+	// an iteration, so we bypass the page cache.
+	factory = fg->get_graph_io_factory(REMOTE_ACCESS);
+	header = fg->get_graph_header();
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	if (header.is_directed_graph())
+		init_chunks(edge_type::IN_EDGE, in_chunks);
+	init_chunks(edge_type::OUT_EDGE, out_chunks);
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("It takes %1% seconds to split the graph into %2% chunks")
+		% time_diff(start, end) % (in_chunks.size() + out_chunks.size());
+}
+
+/*
+ * Get the location of a vertex in the graph file. If the vertex ID is
+ * the number of vertices, it returns the end of the part of the edge type.
+ */
+off_t edge_stream_engine::get_vertex_off(vertex_id_t id, edge_type type) const
+{
+	in_mem_query_vertex_index::ptr vindex = graph->get_in_mem_index();
+	assert(vindex->is_compressed());
+	size_t num_vertices = header.get_num_vertices();
+	if (header.is_directed_graph()) {
+		in_mem_cdirected_vertex_index::ptr index
+			= in_mem_cdirected_vertex_index::cast(vindex);
+		if (id == num_vertices) {
+			directed_vertex_entry e = index->get_vertex(id - 1);
+			if (type == edge_type::IN_EDGE)
+				return e.get_in_off() + index->get_in_size(id - 1);
+			else
+				return e.get_out_off() + index->get_out_size(id - 1);
+		}
+		directed_vertex_entry e = index->get_vertex(id);
+		return type == edge_type::IN_EDGE ? e.get_in_off() : e.get_out_off();
+	}
+	else {
+		in_mem_cundirected_vertex_index::ptr index
+			= in_mem_cundirected_vertex_index::cast(vindex);
+		if (id == num_vertices)
+			return index->get_vertex(id - 1).get_off() + index->get_size(id - 1);
+		return index->get_vertex(id).get_off();
+	}
+}
+
+/*
+ * Split the part of the graph file with the edge type into chunks of
+ * contiguous vertices. The vertex index is only queried when we search
+ * for the chunk boundaries.
+ */
+void edge_stream_engine::init_chunks(edge_type type,
+		std::vector<stream_chunk> &chunks)
+{
+	size_t num_vertices = header.get_num_vertices();
+	vertex_id_t start = 0;
+	while (start < num_vertices) {
+		off_t start_off = get_vertex_off(start, type);
+		// Search for the last vertex that the chunk can end at.
+		vertex_id_t lo = start + 1;
+		vertex_id_t hi = num_vertices;
+		while (lo < hi) {
+			vertex_id_t mid = lo + (hi - lo + 1) / 2;
+			if (get_vertex_off(mid, type) - start_off
+					<= (off_t) STREAM_CHUNK_SIZE)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		chunks.push_back(stream_chunk(start, lo, start_off,
+					get_vertex_off(lo, type)));
+		start = lo;
+	}
+}
+
+/*
+ * A buffer that holds a chunk read from the graph file.
+ */
+struct chunk_buf
+{
+	char *buf;
+	size_t capacity;
+	off_t read_start;
+	// The read of the chunk has completed.
+	bool ready;
+
+	chunk_buf() {
+		buf = NULL;
+		capacity = 0;
+		read_start = 0;
+		ready = false;
+	}
+
+	~chunk_buf() {
+		free(buf);
+	}
+
+	void reserve(size_t size) {
+		if (size <= capacity)
+			return;
+		free(buf);
+		capacity = ROUNDUP_PAGE(size);
+		BOOST_VERIFY(posix_memalign((void **) &buf, PAGE_SIZE, capacity) == 0);
+	}
+};
+
+/*
+ * A worker thread of the streaming engine. It runs the tasks of all phases
+ * in all iterations. Each worker has two chunk buffers, so it can read
+ * the next chunk while it processes the current one.
+ */
+class stream_worker: public task_thread
+{
+	static const int NUM_BUFS = 2;
+
+	class read_callback: public callback
+	{
+		chunk_buf *bufs;
+	public:
+		read_callback(chunk_buf *bufs) {
+			this->bufs = bufs;
+		}
+
+		virtual int invoke(io_request *reqs[], int num) {
+			for (int i = 0; i < num; i++)
+				for (int j = 0; j < NUM_BUFS; j++)
+					if (reqs[i]->get_buf() == bufs[j].buf)
+						bufs[j].ready = true;
+			return 0;
+		}
+	};
+
+	file_io_factory::shared_ptr factory;
+	// The I/O instance has to be created in the worker thread, so it's
+	// created by the first stream task.
+	io_interface::ptr io;
+	chunk_buf bufs[NUM_BUFS];
+
+	void read_chunk(const stream_chunk &chunk, chunk_buf &buf);
+	void run_on_vertex(graph_engine &graph, stream_program &prog,
+			const page_vertex &vertex);
+public:
+	stream_worker(file_io_factory::shared_ptr factory,
+			int node_id): task_thread("stream_worker", node_id) {
+		this->factory = factory;
+	}
+
+	~stream_worker() {
+		stop();
+		join();
+	}
+
+	void stream(graph_engine &graph, stream_program &prog,
+			const std::vector<stream_chunk> &chunks,
+			std::atomic<size_t> &next_chunk, edge_type type);
+};
+
+/*
+ * Issue an asynchronous read of the chunk to the buffer.
+ */
+void stream_worker::read_chunk(const stream_chunk &chunk, chunk_buf &buf)
+{
+	off_t read_start = ROUND_PAGE(chunk.start_off);
+	off_t read_end = std::min((size_t) ROUNDUP_PAGE(chunk.end_off),
+			(size_t) factory->get_file_size());
+	size_t size = read_end - read_start;
+	buf.reserve(size);
+	buf.read_start = read_start;
+	buf.ready = false;
+	data_loc_t loc(factory->get_file_id(), read_start);
+	io_request req(buf.buf, loc, size, READ);
+	io->access(&req, 1);
+	io->flush_requests();
+}
+
+void stream_worker::run_on_vertex(graph_engine &graph, stream_program &prog,
+		const page_vertex &vertex)
+{
+	compute_vertex &v = graph.get_vertex(vertex.get_id());
+	const graph_delta::ptr &delta = graph.get_delta();
+	if (delta && delta->has_updates(vertex.get_id())) {
+		std::unique_ptr<merged_page_vertex> merged = delta->merge(vertex);
+		prog.run_on_edges(v, merged->get_vertex());
+	}
+	else
+		prog.run_on_edges(v, vertex);
+}
+
+void stream_worker::stream(graph_engine &graph, stream_program &prog,
+		const std::vector<stream_chunk> &chunks,
+		std::atomic<size_t> &next_chunk, edge_type type)
+{
+	if (io == NULL) {
+		io = create_io(factory, this);
+		io->set_callback(callback::ptr(new read_callback(bufs)));
+	}
+
+	bool directed = graph.is_directed();
+	int curr = 0;
+	size_t idx = next_chunk.fetch_add(1);
+	if (idx < chunks.size())
+		read_chunk(chunks[idx], bufs[curr]);
+	while (idx < chunks.size()) {
+		// Read the next chunk before we process the current one.
+		size_t next_idx = next_chunk.fetch_add(1);
+		if (next_idx < chunks.size())
+			read_chunk(chunks[next_idx], bufs[1 - curr]);
+		while (!bufs[curr].ready)
+			io->wait4complete(1);
+
+		const stream_chunk &chunk = chunks[idx];
+		const char *buf = bufs[curr].buf;
+		const char *p = buf + (chunk.start_off - bufs[curr].read_start);
+		for (vertex_id_t id = chunk.start_id; id < chunk.end_id; id++) {
+			const ext_mem_undirected_vertex *v
+				= (const ext_mem_undirected_vertex *) p;
+			assert(v->get_id() == id);
+			size_t vsize = v->get_size();
+			mem_byte_array arr(p, vsize);
+			if (directed)
+				run_on_vertex(graph, prog, page_directed_vertex(arr,
+							type == edge_type::IN_EDGE));
+			else
+				run_on_vertex(graph, prog, page_undirected_vertex(arr));
+			p += vsize;
+		}
+		assert(p == buf + (chunk.end_off - bufs[curr].read_start));
+		idx = next_idx;
+		curr = 1 - curr;
+	}
+}
+
+namespace
+{
+
+class stream_task: public thread_task
+{
+	stream_worker &worker;
+	graph_engine &graph;
+	stream_program &prog;
+	const std::vector<stream_chunk> &chunks;
+	std::atomic<size_t> &next_chunk;
+	edge_type type;
+public:
+	stream_task(stream_worker &_worker, graph_engine &_graph,
+			stream_program &_prog, const std::vector<stream_chunk> &_chunks,
+			std::atomic<size_t> &_next_chunk, edge_type type): worker(_worker),
+			graph(_graph), prog(_prog), chunks(_chunks), next_chunk(_next_chunk) {
+		this->type = type;
+	}
+
+	void run() {
+		worker.stream(graph, prog, chunks, next_chunk, type);
+	}
+};
+
+class apply_task: public thread_task
+{
+	graph_engine &graph;
+	stream_program &prog;
+	int part_id;
+	bool engine_start;
+public:
+	apply_task(graph_engine &_graph, stream_program &_prog, int part_id,
+			bool engine_start): graph(_graph), prog(_prog) {
+		this->part_id = part_id;
+		this->engine_start = engine_start;
+	}
+
+	void run();
+};
+
+void apply_task::run()
+{
+	const graph_partitioner *partitioner = graph.get_partitioner();
+	size_t part_size = partitioner->get_part_size(part_id,
+			graph.get_num_vertices());
+	// We only iterate over the vertices in the local partition.
+	for (size_t i = 0; i < part_size; i++) {
+		vertex_id_t id;
+		partitioner->loc2map(part_id, i, id);
+		compute_vertex &v = graph.get_vertex(part_id, local_vid_t(i));
+		if (engine_start)
+			prog.run_on_engine_start(v, id);
+		else
+			prog.run_on_iteration_end(v, id);
+	}
+}
+
+}
+
+void edge_stream_engine::stream(const std::vector<stream_chunk> &chunks,
+		edge_type type, std::vector<stream_program::ptr> &progs,
+		std::vector<stream_worker *> &workers)
+{
+	std::atomic<size_t> next_chunk(0);
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i]->add_task(new stream_task(*workers[i], *graph, *progs[i],
+					chunks, next_chunk, type));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i]->wait4complete();
+}
+
+/*
+ * Run the apply phase on all vertices. Each thread runs on the vertices
+ * in its own partition. It returns the number of vertices that have
+ * changed their state in the iteration.
+ */
+size_t edge_stream_engine::apply(std::vector<stream_program::ptr> &progs,
+		std::vector<stream_worker *> &workers, bool start)
+{
+	for (size_t i = 0; i < workers.size(); i++) {
+		progs[i]->num_changes = 0;
+		workers[i]->add_task(new apply_task(*graph, *progs[i], i, start));
+	}
+	size_t num_changes = 0;
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i]->wait4complete();
+		num_changes += progs[i]->num_changes;
+	}
+	return num_changes;
+}
+
+int edge_stream_engine::start(edge_type type, int max_iters,
+		stream_program_creater::ptr creater)
+{
+	std::vector<stream_program::ptr> progs(graph->get_num_threads());
+	std::vector<stream_worker *> workers(progs.size());
+	for (size_t i = 0; i < progs.size(); i++) {
+		progs[i] = creater->create();
+		progs[i]->graph = graph.get();
+		workers[i] = new stream_worker(factory, i % graph->get_num_nodes());
+		workers[i]->start();
+	}
+
+	struct timeval start, end, iter_start;
+	gettimeofday(&start, NULL);
+	apply(progs, workers, true);
+	int level = 0;
+	while (level < max_iters) {
+		gettimeofday(&iter_start, NULL);
+		for (size_t i = 0; i < progs.size(); i++)
+			progs[i]->level = level;
+		if (!header.is_directed_graph())
+			stream(out_chunks, edge_type::OUT_EDGE, progs, workers);
+		else {
+			if (type == edge_type::IN_EDGE || type == edge_type::BOTH_EDGES)
+				stream(in_chunks, edge_type::IN_EDGE, progs, workers);
+			if (type == edge_type::OUT_EDGE || type == edge_type::BOTH_EDGES)
+				stream(out_chunks, edge_type::OUT_EDGE, progs, workers);
+		}
+		size_t num_changes = apply(progs, workers, false);
+		level++;
+
+		gettimeofday(&end, NULL);
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("Iter %1% takes %2% seconds, and %3% vertices change")
+			% (level - 1) % time_diff(iter_start, end) % num_changes;
+		if (num_changes == 0)
+			break;
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		delete workers[i];
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("The stream engine takes %1% seconds to complete %2% iterations")
+		% time_diff(start, end) % level;
+	return level;
+}
+
+}
@@ -0,0 +1,274 @@
+#ifndef __EDGE_STREAM_H__
+#define __EDGE_STREAM_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "graph_engine.h"
+#include "FGlib.h"
+
+namespace safs
+{
+	class file_io_factory;
+}
+
+namespace fg
+{
+
+class edge_stream_engine;
+class stream_worker;
+
+/**
+ * \brief The program that runs on vertices in the edge-centric streaming
+ *        mode. The engine creates a stream program for each thread.
+ *
+ * In each iteration, the engine streams the adjacency lists of all vertices
+ * from the graph file sequentially and invokes `run_on_edges' on each of
+ * them (the scatter/gather phase). After all adjacency lists are streamed,
+ * it invokes `run_on_iteration_end' on every vertex (the apply phase).
+ * A vertex can only modify its own state in the scatter/gather phase and
+ * read the state of other vertices, so the state read from other vertices
+ * should be double buffered and updated in the apply phase.
+ */
+class stream_program
+{
+	graph_engine *graph;
+	int level;
+	size_t num_changes;
+
+	friend class edge_stream_engine;
+public:
+	typedef std::shared_ptr<stream_program> ptr;
+
+	stream_program() {
+		graph = NULL;
+		level = 0;
+		num_changes = 0;
+	}
+
+	virtual ~stream_program() {
+	}
+
+	/**
+	 * \brief Get the graph engine that holds the vertex state.
+	 */
+	graph_engine &get_graph() {
+		return *graph;
+	}
+
+	/**
+	 * \brief Get the current iteration.
+	 */
+	int get_curr_level() const {
+		return level;
+	}
+
+	/**
+	 * \brief A vertex notifies the engine that its state has changed in
+	 *        the current iteration. The engine stops when no vertices
+	 *        change their state in an iteration.
+	 */
+	void notify_change() {
+		num_changes++;
+	}
+
+	/**
+	 * \brief This is invoked on every vertex before the first iteration.
+	 * \param v The vertex state.
+	 * \param id The vertex ID.
+	 */
+	virtual void run_on_engine_start(compute_vertex &v, vertex_id_t id) = 0;
+
+	/**
+	 * \brief This is invoked on a vertex when its adjacency list is streamed
+	 *        from the graph file. In a directed graph, the vertex only
+	 *        contains the edges of the streamed type.
+	 * \param v The vertex state.
+	 * \param vertex The adjacency list of the vertex.
+	 */
+	virtual void run_on_edges(compute_vertex &v, const page_vertex &vertex) = 0;
+
+	/**
+	 * \brief This is invoked on every vertex at the end of an iteration.
+	 * \param v The vertex state.
+	 * \param id The vertex ID.
+	 */
+	virtual void run_on_iteration_end(compute_vertex &v, vertex_id_t id) = 0;
+};
+
+/**
+ * \brief The default implementation of a stream program. It invokes
+ *        `run_on_engine_start', `run_on_edges' and `run_on_iteration_end'
+ *        of the vertex type with the stream program as the first argument.
+ */
+template<class vertex_type>
+class stream_program_impl: public stream_program
+{
+public:
+	virtual void run_on_engine_start(compute_vertex &v, vertex_id_t id) {
+		((vertex_type &) v).run_on_engine_start(*this, id);
+	}
+
+	virtual void run_on_edges(compute_vertex &v, const page_vertex &vertex) {
+		((vertex_type &) v).run_on_edges(*this, vertex);
+	}
+
+	virtual void run_on_iteration_end(compute_vertex &v, vertex_id_t id) {
+		((vertex_type &) v).run_on_iteration_end(*this, id);
+	}
+};
+
+/**
+ * \brief The base class of the vertex state in the streaming mode.
+ *        The vertex state is stored in a graph index, which also requires
+ *        the hooks of the vertex-centric engine, so this class provides
+ *        them. They are never invoked by the streaming engine.
+ */
+class stream_compute_vertex: public compute_vertex
+{
+public:
+	stream_compute_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &) {
+		ABORT_MSG("the vertex only runs in the streaming mode");
+	}
+
+	void run(vertex_program &, const page_vertex &) {
+		ABORT_MSG("the vertex only runs in the streaming mode");
+	}
+};
+
+/**
+ * \brief The engine uses this to construct stream programs for each thread.
+ */
+class stream_program_creater
+{
+public:
+	typedef std::unique_ptr<stream_program_creater> ptr;
+
+	virtual stream_program::ptr create() const = 0;
+};
+
+template<class vertex_type>
+class def_stream_program_creater: public stream_program_creater
+{
+public:
+	virtual stream_program::ptr create() const {
+		return stream_program::ptr(new stream_program_impl<vertex_type>());
+	}
+};
+
+/*
+ * A contiguous range of adjacency lists in the graph file. The engine
+ * reads a chunk with a single I/O request.
+ */
+struct stream_chunk
+{
+	vertex_id_t start_id;
+	vertex_id_t end_id;
+	off_t start_off;
+	off_t end_off;
+
+	stream_chunk(vertex_id_t start_id, vertex_id_t end_id, off_t start_off,
+			off_t end_off) {
+		this->start_id = start_id;
+		this->end_id = end_id;
+		this->start_off = start_off;
+		this->end_off = end_off;
+	}
+};
+
+/**
+ * \brief This engine runs full-graph iterative algorithms in the edge-centric
+ *        streaming mode.
+ *
+ * Instead of issuing a request for each vertex through the vertex index,
+ * the engine splits the adjacency lists in the graph file into large chunks
+ * of contiguous vertices when it's created and the worker threads read
+ * the chunks sequentially with large I/O requests, bypassing the page cache.
+ * A thread reads its next chunk asynchronously while it processes
+ * the current one, and the same threads run all phases of all iterations.
+ * The vertex state is kept in the same graph index as the vertex-centric
+ * engine, so algorithms can save their results with vertex queries.
+ */
+class edge_stream_engine
+{
+	graph_engine::ptr graph;
+	std::shared_ptr<safs::file_io_factory> factory;
+	graph_header header;
+	// The chunks of the in-part and out-part of a directed graph.
+	// An undirected graph only has out-chunks.
+	std::vector<stream_chunk> in_chunks;
+	std::vector<stream_chunk> out_chunks;
+
+	edge_stream_engine(FG_graph::ptr fg, graph_index::ptr index);
+
+	off_t get_vertex_off(vertex_id_t id, edge_type type) const;
+	void init_chunks(edge_type type, std::vector<stream_chunk> &chunks);
+	void stream(const std::vector<stream_chunk> &chunks, edge_type type,
+			std::vector<stream_program::ptr> &progs,
+			std::vector<stream_worker *> &workers);
+	size_t apply(std::vector<stream_program::ptr> &progs,
+			std::vector<stream_worker *> &workers, bool start);
+public:
+	typedef std::shared_ptr<edge_stream_engine> ptr;
+
+	/**
+	 * \brief Create an edge-centric streaming engine.
+	 * \param fg The graph.
+	 * \param index The graph index that contains the vertex state.
+	 */
+	static ptr create(FG_graph::ptr fg, graph_index::ptr index) {
+		return ptr(new edge_stream_engine(fg, index));
+	}
+
+	/**
+	 * \brief Run iterations until no vertices change their state or
+	 *        the maximal number of iterations is reached.
+	 * \param type The type of edges streamed in each iteration. It's
+	 *        ignored in an undirected graph.
+	 * \param max_iters The maximal number of iterations.
+	 * \param creater The creator of stream programs.
+	 * \return The number of iterations.
+	 */
+	int start(edge_type type, int max_iters,
+			stream_program_creater::ptr creater);
+
+	/**
+	 * \brief Get the graph engine that holds the vertex state.
+	 */
+	graph_engine::ptr get_graph() const {
+		return graph;
+	}
+
+	/**
+	 * \brief Run a query on the state of all vertices.
+	 */
+	void query_on_all(vertex_query::ptr query) {
+		graph->query_on_all(query);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "safs_file.h"
+#include "safs_exception.h"
+#include "common.h"
+
+#include "ext_vertex_state.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+ext_state_file::ext_state_file(const std::string &file_name)
+{
+	this->file_name = file_name;
+	factory = create_io_factory(file_name, REMOTE_ACCESS);
+	pthread_spin_init(&io_lock, PTHREAD_PROCESS_PRIVATE);
+}
+
+ext_state_file::ptr ext_state_file::create(const std::string &name,
+		size_t size)
+{
+	const size_t MAX_TRIES = 10;
+	size_t i;
+	std::string tmp_name;
+	for (i = 0; i < MAX_TRIES; i++) {
+		tmp_name = name + gen_rand_name(8);
+		safs_file f(get_sys_RAID_conf(), tmp_name);
+		if (!f.exist())
+			break;
+	}
+	if (i == MAX_TRIES) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "Can't create a file for vertex state because max tries are reached";
+		return ptr();
+	}
+
+	safs_file f(get_sys_RAID_conf(), tmp_name);
+	if (!f.create_file(size)) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("Can't create file %1% for vertex state") % tmp_name;
+		return ptr();
+	}
+	return ptr(new ext_state_file(tmp_name));
+}
+
+ext_state_file::~ext_state_file()
+{
+	thread_ios.clear();
+	factory.reset();
+	pthread_spin_destroy(&io_lock);
+	safs_file f(get_sys_RAID_conf(), file_name);
+	if (f.exist())
+		f.delete_file();
+}
+
+io_interface &ext_state_file::get_curr_io()
+{
+	thread *t = thread::get_curr_thread();
+	assert(t);
+	pthread_spin_lock(&io_lock);
+	auto it = thread_ios.find(t);
+	if (it != thread_ios.end()) {
+		io_interface &io = *it->second;
+		pthread_spin_unlock(&io_lock);
+		return io;
+	}
+	pthread_spin_unlock(&io_lock);
+
+	io_interface::ptr io = create_io(factory, t);
+	pthread_spin_lock(&io_lock);
+	thread_ios.insert(std::pair<thread *, io_interface::ptr>(t, io));
+	pthread_spin_unlock(&io_lock);
+	return *io;
+}
+
+void ext_state_file::access(char *buf, off_t off, size_t size,
+		int access_method)
+{
+	assert(off % PAGE_SIZE == 0);
+	assert(size % PAGE_SIZE == 0);
+	io_interface &io = get_curr_io();
+	data_loc_t loc(factory->get_file_id(), off);
+	io_request req(buf, loc, size, access_method);
+	io.access(&req, 1);
+	io.wait4complete(1);
+}
+
+spill_file::spill_file()
+{
+	f = tmpfile();
+	if (f == NULL)
+		throw io_exception("can't create a file to spill vertex state updates");
+	size = 0;
+}
+
+spill_file::~spill_file()
+{
+	fclose(f);
+}
+
+off_t spill_file::append(const void *buf, size_t size)
+{
+	off_t off = this->size;
+	ssize_t ret = pwrite(fileno(f), buf, size, off);
+	if (ret < 0 || (size_t) ret != size)
+		throw io_exception("can't spill vertex state updates");
+	this->size += size;
+	return off;
+}
+
+void spill_file::read(void *buf, off_t off, size_t size)
+{
+	ssize_t ret = pread(fileno(f), buf, size, off);
+	if (ret < 0 || (size_t) ret != size)
+		throw io_exception("can't read the spilled vertex state updates");
+}
+
+}
@@ -0,0 +1,546 @@
+#ifndef __EXT_VERTEX_STATE_H__
+#define __EXT_VERTEX_STATE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <numa.h>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "thread.h"
+#include "io_interface.h"
+#include "comm_exception.h"
+#include "log.h"
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+
+namespace fg
+{
+
+/*
+ * A SAFS file that stores vertex state. Each thread that accesses
+ * the file gets its own I/O instance.
+ */
+class ext_state_file
+{
+	std::string file_name;
+	safs::file_io_factory::shared_ptr factory;
+	// This keeps an I/O instance for each thread.
+	std::unordered_map<thread *, safs::io_interface::ptr> thread_ios;
+	pthread_spinlock_t io_lock;
+
+	ext_state_file(const std::string &file_name);
+	safs::io_interface &get_curr_io();
+	void access(char *buf, off_t off, size_t size, int access_method);
+public:
+	typedef std::shared_ptr<ext_state_file> ptr;
+
+	/*
+	 * Create a temporary SAFS file. The file is deleted when the object
+	 * is destroyed.
+	 */
+	static ptr create(const std::string &name, size_t size);
+
+	~ext_state_file();
+
+	/*
+	 * The buffer and the range in the file have to be aligned to pages.
+	 */
+	void read(char *buf, off_t off, size_t size) {
+		access(buf, off, size, READ);
+	}
+
+	void write(char *buf, off_t off, size_t size) {
+		access(buf, off, size, WRITE);
+	}
+};
+
+/*
+ * A file in the local filesystem that stores the updates spilled from
+ * memory. It's only appended to and read back.
+ */
+class spill_file
+{
+	FILE *f;
+	size_t size;
+public:
+	spill_file();
+	~spill_file();
+
+	off_t append(const void *buf, size_t size);
+	void read(void *buf, off_t off, size_t size);
+
+	size_t get_size() const {
+		return size;
+	}
+};
+
+/**
+ * \brief This stores a field of the vertex state of all vertices in SAFS,
+ *        for the graphs whose vertex state doesn't fit in memory.
+ *
+ * The state is partitioned in the same way as the vertices in the graph
+ * engine and each partition is split into windows of contiguous vertices.
+ * A partition keeps a small number of windows in memory on the NUMA node
+ * of its worker thread. A window is read from SAFS when a vertex in it
+ * is accessed, and the least recently used window is written back if
+ * it's modified. A worker thread scans its active vertices in the order
+ * of their locations in the partition, so it works on a window at a time.
+ *
+ * The vertices usually update their state when they receive messages,
+ * which come in a random order. An update to a window that isn't in memory
+ * is buffered and applied when the window is loaded. When the buffered
+ * updates of a partition use as much memory as its windows, they are
+ * sorted on the location of the vertices and spilled to a file, one
+ * bucket per window.
+ *
+ * The state has to be a plain data type. `Apply' combines an update with
+ * the state of a vertex, e.g., adding messages to the state.
+ * The state can only be accessed from FlashGraph threads (e.g., the worker
+ * threads), because every thread uses its own I/O instance.
+ */
+template<class T, class Apply>
+class ext_vertex_state
+{
+	struct update_entry
+	{
+		// The location of the vertex in the window.
+		size_t off;
+		T val;
+
+		bool operator<(const update_entry &e) const {
+			return off < e.off;
+		}
+	};
+
+	struct spill_run
+	{
+		off_t off;
+		size_t num;
+	};
+
+	struct window_slot
+	{
+		T *data;
+		ssize_t window_id;
+		bool dirty;
+		size_t last_access;
+	};
+
+	struct state_part
+	{
+		pthread_mutex_t lock;
+		int part_id;
+		int node_id;
+		size_t num_vertices;
+		// The location of the first window of the partition in the file.
+		size_t first_window;
+		std::vector<window_slot> slots;
+		// The slot of each window if the window is in memory, or -1.
+		std::vector<int> resident;
+		// Whether a window has been written to SAFS. A window that has
+		// never been written has the initial value.
+		std::vector<bool> written;
+		std::vector<std::vector<update_entry> > pending;
+		size_t num_pending;
+		std::vector<std::vector<spill_run> > spilled;
+		std::unique_ptr<spill_file> spill;
+		size_t clock;
+
+		size_t num_loads;
+		size_t num_writebacks;
+		size_t num_spilled;
+
+		state_part() {
+			pthread_mutex_init(&lock, NULL);
+			part_id = 0;
+			node_id = 0;
+			num_vertices = 0;
+			first_window = 0;
+			num_pending = 0;
+			clock = 0;
+			num_loads = 0;
+			num_writebacks = 0;
+			num_spilled = 0;
+		}
+
+		~state_part() {
+			pthread_mutex_destroy(&lock);
+		}
+	};
+
+	/*
+	 * Run a task on a partition in a thread on the partition's NUMA node.
+	 */
+	class part_thread: public ::thread
+	{
+		std::function<void ()> task;
+	public:
+		part_thread(int node_id,
+				std::function<void ()> task): ::thread("ext-vstate-thread",
+					node_id) {
+			this->task = task;
+		}
+
+		virtual void run() {
+			task();
+			this->stop();
+		}
+	};
+
+	const graph_partitioner &partitioner;
+	ext_state_file::ptr file;
+	T init_val;
+	Apply apply;
+	size_t window_bytes;
+	// The number of vertices in a window.
+	size_t window_size;
+	size_t max_pending;
+	std::vector<std::unique_ptr<state_part> > parts;
+
+	ext_vertex_state(const graph_partitioner &_partitioner, const T &init_val,
+			Apply apply): partitioner(_partitioner) {
+		this->init_val = init_val;
+		this->apply = apply;
+		window_bytes = 0;
+		window_size = 0;
+		max_pending = 0;
+	}
+
+	void write_back(state_part &part, window_slot &slot) {
+		if (slot.dirty) {
+			file->write((char *) slot.data,
+					(part.first_window + slot.window_id) * window_bytes,
+					window_bytes);
+			part.written[slot.window_id] = true;
+			part.num_writebacks++;
+		}
+		slot.dirty = false;
+	}
+
+	void load(state_part &part, window_slot &slot, size_t window_id) {
+		if (part.written[window_id])
+			file->read((char *) slot.data,
+					(part.first_window + window_id) * window_bytes,
+					window_bytes);
+		else
+			std::fill(slot.data, slot.data + window_size, init_val);
+		slot.window_id = window_id;
+		slot.dirty = false;
+		part.resident[window_id] = &slot - part.slots.data();
+		part.num_loads++;
+
+		// Apply the updates spilled to the file first, so the updates
+		// are applied in the order they were issued.
+		std::vector<spill_run> &runs = part.spilled[window_id];
+		for (size_t i = 0; i < runs.size(); i++) {
+			std::vector<update_entry> entries(runs[i].num);
+			part.spill->read(entries.data(), runs[i].off,
+					sizeof(update_entry) * entries.size());
+			for (size_t j = 0; j < entries.size(); j++)
+				apply(slot.data[entries[j].off], entries[j].val);
+			slot.dirty = true;
+		}
+		std::vector<spill_run>().swap(runs);
+
+		std::vector<update_entry> &updates = part.pending[window_id];
+		for (size_t i = 0; i < updates.size(); i++)
+			apply(slot.data[updates[i].off], updates[i].val);
+		if (!updates.empty())
+			slot.dirty = true;
+		part.num_pending -= updates.size();
+		std::vector<update_entry>().swap(updates);
+	}
+
+	window_slot &get_window(state_part &part, size_t window_id) {
+		part.clock++;
+		int slot_idx = part.resident[window_id];
+		if (slot_idx >= 0) {
+			part.slots[slot_idx].last_access = part.clock;
+			return part.slots[slot_idx];
+		}
+
+		// Evict the least recently used window.
+		window_slot *victim = &part.slots[0];
+		for (size_t i = 0; i < part.slots.size(); i++) {
+			if (part.slots[i].window_id < 0) {
+				victim = &part.slots[i];
+				break;
+			}
+			if (part.slots[i].last_access < victim->last_access)
+				victim = &part.slots[i];
+		}
+		if (victim->data == NULL) {
+			victim->data = (T *) numa_alloc_onnode(window_bytes, part.node_id);
+			if (victim->data == NULL)
+				throw oom_exception("can't allocate a window of vertex state");
+		}
+		if (victim->window_id >= 0) {
+			write_back(part, *victim);
+			part.resident[victim->window_id] = -1;
+		}
+		load(part, *victim, window_id);
+		victim->last_access = part.clock;
+		return *victim;
+	}
+
+	void spill(state_part &part) {
+		if (part.spill == NULL)
+			part.spill = std::unique_ptr<spill_file>(new spill_file());
+		for (size_t i = 0; i < part.pending.size(); i++) {
+			std::vector<update_entry> &updates = part.pending[i];
+			if (updates.empty())
+				continue;
+			// The updates of the same vertex must stay in the order they
+			// were issued, since apply isn't required to be commutative.
+			std::stable_sort(updates.begin(), updates.end());
+			spill_run run;
+			run.num = updates.size();
+			run.off = part.spill->append(updates.data(),
+					sizeof(update_entry) * updates.size());
+			part.spilled[i].push_back(run);
+			part.num_spilled += updates.size();
+			std::vector<update_entry>().swap(updates);
+		}
+		part.num_pending = 0;
+	}
+
+	void run_on_parts(std::function<void (state_part &)> task) {
+		std::vector<part_thread *> threads;
+		for (size_t i = 0; i < parts.size(); i++) {
+			state_part *part = parts[i].get();
+			threads.push_back(new part_thread(part->node_id,
+						[task, part]() {
+							task(*part);
+						}));
+			threads.back()->start();
+		}
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i]->join();
+			delete threads[i];
+		}
+	}
+
+	void flush_part(state_part &part) {
+		pthread_mutex_lock(&part.lock);
+		for (size_t i = 0; i < part.resident.size(); i++) {
+			if (!part.pending[i].empty() || !part.spilled[i].empty())
+				get_window(part, i);
+		}
+		for (size_t i = 0; i < part.slots.size(); i++) {
+			if (part.slots[i].window_id >= 0)
+				write_back(part, part.slots[i]);
+		}
+		pthread_mutex_unlock(&part.lock);
+	}
+public:
+	typedef std::shared_ptr<ext_vertex_state<T, Apply> > ptr;
+
+	/**
+	 * \brief Create the state of all vertices in a graph engine in SAFS.
+	 * \param graph The graph engine that runs the vertex program.
+	 * \param name The name prefix of the SAFS file that stores the state.
+	 * \param init_val The initial value of the state of every vertex.
+	 * \param mem_size The memory size for the windows in memory.
+	 * \param window_bytes The size of a window in bytes.
+	 */
+	static ptr create(graph_engine &graph, const std::string &name,
+			const T &init_val, size_t mem_size, size_t window_bytes,
+			Apply apply = Apply()) {
+		const graph_partitioner &partitioner
+			= graph.get_graph_index().get_partitioner();
+		ptr state(new ext_vertex_state<T, Apply>(partitioner, init_val,
+					apply));
+		state->window_bytes = ROUNDUP_PAGE(std::max(window_bytes, sizeof(T)));
+		state->window_size = state->window_bytes / sizeof(T);
+
+		int num_parts = partitioner.get_num_partitions();
+		size_t num_slots = std::max(mem_size / num_parts / state->window_bytes,
+				(size_t) 1);
+		state->max_pending = std::max(state->window_size,
+				num_slots * state->window_bytes / sizeof(update_entry));
+		size_t num_vertices = graph.get_num_vertices();
+		size_t tot_num_windows = 0;
+		for (int i = 0; i < num_parts; i++) {
+			state->parts.emplace_back(new state_part());
+			state_part &part = *state->parts.back();
+			part.part_id = i;
+			part.node_id = i % graph.get_num_nodes();
+			part.num_vertices = partitioner.get_part_size(i, num_vertices);
+			part.first_window = tot_num_windows;
+			size_t num_windows = (part.num_vertices + state->window_size - 1)
+				/ state->window_size;
+			tot_num_windows += num_windows;
+
+			window_slot slot;
+			slot.data = NULL;
+			slot.window_id = -1;
+			slot.dirty = false;
+			slot.last_access = 0;
+			part.slots.resize(std::min(num_slots, num_windows), slot);
+			part.resident.resize(num_windows, -1);
+			part.written.resize(num_windows, false);
+			part.pending.resize(num_windows);
+			part.spilled.resize(num_windows);
+		}
+		state->file = ext_state_file::create(name,
+				std::max(tot_num_windows, (size_t) 1) * state->window_bytes);
+		if (state->file == NULL)
+			return ptr();
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("The vertex state %1% has %2% windows in SAFS and keeps %3% windows per partition in memory")
+			% name % tot_num_windows % num_slots;
+		return state;
+	}
+
+	~ext_vertex_state() {
+		for (size_t i = 0; i < parts.size(); i++) {
+			for (size_t j = 0; j < parts[i]->slots.size(); j++) {
+				if (parts[i]->slots[j].data)
+					numa_free(parts[i]->slots[j].data, window_bytes);
+			}
+		}
+	}
+
+	T get(const vertex_loc_t &loc) {
+		state_part &part = *parts[loc.first];
+		pthread_mutex_lock(&part.lock);
+		window_slot &slot = get_window(part, loc.second.id / window_size);
+		T ret = slot.data[loc.second.id % window_size];
+		pthread_mutex_unlock(&part.lock);
+		return ret;
+	}
+
+	void set(const vertex_loc_t &loc, const T &val) {
+		state_part &part = *parts[loc.first];
+		pthread_mutex_lock(&part.lock);
+		window_slot &slot = get_window(part, loc.second.id / window_size);
+		slot.data[loc.second.id % window_size] = val;
+		slot.dirty = true;
+		pthread_mutex_unlock(&part.lock);
+	}
+
+	/**
+	 * \brief Apply an update to the state of a vertex. The update is
+	 *        buffered if the window of the vertex isn't in memory.
+	 */
+	void update(const vertex_loc_t &loc, const T &val) {
+		state_part &part = *parts[loc.first];
+		size_t window_id = loc.second.id / window_size;
+		size_t off = loc.second.id % window_size;
+		pthread_mutex_lock(&part.lock);
+		int slot_idx = part.resident[window_id];
+		if (slot_idx >= 0) {
+			window_slot &slot = part.slots[slot_idx];
+			apply(slot.data[off], val);
+			slot.dirty = true;
+		}
+		else {
+			update_entry e;
+			e.off = off;
+			e.val = val;
+			part.pending[window_id].push_back(e);
+			part.num_pending++;
+			if (part.num_pending >= max_pending)
+				spill(part);
+		}
+		pthread_mutex_unlock(&part.lock);
+	}
+
+	vertex_loc_t get_loc(vertex_id_t id) const {
+		int part_id;
+		off_t off;
+		partitioner.map2loc(id, part_id, off);
+		return vertex_loc_t(part_id, local_vid_t(off));
+	}
+
+	T get(vertex_id_t id) {
+		return get(get_loc(id));
+	}
+
+	void set(vertex_id_t id, const T &val) {
+		set(get_loc(id), val);
+	}
+
+	void update(vertex_id_t id, const T &val) {
+		update(get_loc(id), val);
+	}
+
+	/**
+	 * \brief Apply all buffered updates and write all modified windows
+	 *        back to SAFS.
+	 */
+	void flush() {
+		run_on_parts([this](state_part &part) {
+					flush_part(part);
+				});
+	}
+
+	/**
+	 * \brief Copy the state of all vertices to a vector indexed by
+	 *        the vertex ID. All buffered updates are applied first.
+	 */
+	void copy_to(FG_vector<T> &vec) {
+		run_on_parts([this, &vec](state_part &part) {
+					pthread_mutex_lock(&part.lock);
+					for (size_t i = 0; i < part.resident.size(); i++) {
+						window_slot &slot = get_window(part, i);
+						size_t start = i * window_size;
+						size_t end = std::min(start + window_size,
+								part.num_vertices);
+						for (size_t off = start; off < end; off++) {
+							vertex_id_t id;
+							partitioner.loc2map(part.part_id, off, id);
+							if (id < vec.get_size())
+								vec.set(id, slot.data[off - start]);
+						}
+					}
+					pthread_mutex_unlock(&part.lock);
+				});
+	}
+
+	void print_statistics() const {
+		size_t num_loads = 0;
+		size_t num_writebacks = 0;
+		size_t num_spilled = 0;
+		for (size_t i = 0; i < parts.size(); i++) {
+			num_loads += parts[i]->num_loads;
+			num_writebacks += parts[i]->num_writebacks;
+			num_spilled += parts[i]->num_spilled;
+		}
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("The vertex state loads %1% windows, writes back %2% windows and spills %3% updates")
+			% num_loads % num_writebacks % num_spilled;
+	}
+};
+
+}
+
+#endif
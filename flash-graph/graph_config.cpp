@@ -34,19 +34,28 @@ namespace fg
 void graph_config::print_help()
 {
 	printf("Configuration parameters in graph algorithm.\n");
-	printf("\tthreads: the number of threads processing the graph\n");
+	printf("\tthreads: the number of threads processing the graph (2^n unless part_balance_edges is set)\n");
 	printf("\tprof_file: the output file containing CPU profiling\n");
 	printf("\ttrace_file: log IO requests\n");
+	printf("\tprof_levels: collect the profiling counters of each level\n");
+	printf("\tlevel_prof_file: append the profiling counters of each level in JSON\n");
 	printf("\tmax_processing_vertices: the max number of vertices being processed\n");
 	printf("\tenable_elevator: enable the elevator algorithm for scheduling vertices\n");
 	printf("\tpart_range_size_log: the log2 of the range size in range partitioning\n");
 	printf("\tpreload: preload the graph data to the page cache\n");
+	printf("\tpreload_cache_percent: the percentage of the page cache filled by preload\n");
 	printf("\tindex_file_weight: the weight for the graph index file\n");
 	printf("\tin_mem_graph: indicate whether to load the entire graph to memory in advance\n");
 	printf("\tnum_vparts: the number of vertical partitions\n");
 	printf("\tmin_vpart_degree: the min degree of a vertex to perform vertical partitioning\n");
 	printf("\tserial_run: run the user code on a vertex in serial\n");
 	printf("\tvertex_merge_gap: the gap size allowed when merging two vertex requests\n");
+	printf("\thot_vertex_mem: the memory size (MB) for the adjacency lists of high-degree vertices\n");
+	printf("\treplicate_hot_vertices: keep a copy of the high-degree vertices on every NUMA node\n");
+	printf("\text_vertex_state_mem: the memory size (MB) for the vertex state stored in SAFS\n");
+	printf("\text_vertex_state_window: the size (KB) of a window of the vertex state in SAFS\n");
+	printf("\tsched_window_size: the number of vertices admitted together in a sparse level\n");
+	printf("\tpart_balance_edges: partition vertices into ranges with the same number of edges\n");
 }
 
 void graph_config::print()
@@ -55,45 +64,70 @@ void graph_config::print()
 	BOOST_LOG_TRIVIAL(info) << "\tthreads: " << num_threads;
 	BOOST_LOG_TRIVIAL(info) << "\tprof_file: " << prof_file;
 	BOOST_LOG_TRIVIAL(info) << "\ttrace_file: " << trace_file;
+	BOOST_LOG_TRIVIAL(info) << "\tprof_levels: " << _prof_levels;
+	BOOST_LOG_TRIVIAL(info) << "\tlevel_prof_file: " << level_prof_file;
 	BOOST_LOG_TRIVIAL(info) << "\tmax_processing_vertices: " << max_processing_vertices;
 	BOOST_LOG_TRIVIAL(info) << "\tenable_elevator: " << enable_elevator;
 	BOOST_LOG_TRIVIAL(info) << "\tpart_range_size_log: " << part_range_size_log;
 	BOOST_LOG_TRIVIAL(info) << "\tpreload: " << _preload;
+	BOOST_LOG_TRIVIAL(info) << "\tpreload_cache_percent: " << preload_cache_percent;
 	BOOST_LOG_TRIVIAL(info) << "\tindex_file_weight: " << index_file_weight;
 	BOOST_LOG_TRIVIAL(info) << "\tin_mem_graph: " << _in_mem_graph;
 	BOOST_LOG_TRIVIAL(info) << "\tnum_vparts: " << num_vparts;
 	BOOST_LOG_TRIVIAL(info) << "\tmin_vpart_degree: " << min_vpart_degree;
 	BOOST_LOG_TRIVIAL(info) << "\tserial_run: " << serial_run;
 	BOOST_LOG_TRIVIAL(info) << "\tvertex_merge_gap: " << vertex_merge_gap;
+	BOOST_LOG_TRIVIAL(info) << "\thot_vertex_mem: " << hot_vertex_mem;
+	BOOST_LOG_TRIVIAL(info) << "\treplicate_hot_vertices: " << replicate_hot_vertices;
+	BOOST_LOG_TRIVIAL(info) << "\text_vertex_state_mem: " << ext_vertex_state_mem;
+	BOOST_LOG_TRIVIAL(info) << "\text_vertex_state_window: " << ext_vertex_state_window;
+	BOOST_LOG_TRIVIAL(info) << "\tsched_window_size: " << sched_window_size;
+	BOOST_LOG_TRIVIAL(info) << "\tpart_balance_edges: " << part_balance_edges;
 }
 
 void graph_config::init(config_map::ptr map)
 {
+	// The edge-balanced partitioner works with any number of partitions,
+	// so only the range partitioner needs 2^n worker threads.
+	map->read_option_bool("part_balance_edges", part_balance_edges);
 	if (map->has_option("threads"))
 		map->read_option_int("threads", num_threads);
 #ifdef USE_HWLOC
 	else {
 		num_threads = cpus.get_num_cores();
-		num_threads = 1 << (int) ceil(log2(num_threads));
+		if (!part_balance_edges)
+			num_threads = 1 << (int) ceil(log2(num_threads));
 	}
 #endif
 	BOOST_LOG_TRIVIAL(info) << boost::format(
 			"FlashGraph runs on %1% threads and %2% nodes")
 		% num_threads % safs::params.get_num_nodes();
-	if (!power2(num_threads))
-		throw conf_exception("The number of worker threads has to be 2^n");
+	if (!part_balance_edges && !power2(num_threads))
+		throw conf_exception(
+				"The number of worker threads has to be 2^n unless part_balance_edges is set");
+	if (num_threads <= 0 || num_threads % safs::params.get_num_nodes() != 0)
+		throw conf_exception(
+				"The number of worker threads has to be a multiple of the number of nodes");
 	map->read_option("prof_file", prof_file);
 	map->read_option("trace_file", trace_file);
+	map->read_option_bool("prof_levels", _prof_levels);
+	map->read_option("level_prof_file", level_prof_file);
 	map->read_option_int("max_processing_vertices", max_processing_vertices);
 	map->read_option_bool("enable_elevator", enable_elevator);
 	map->read_option_int("part_range_size_log", part_range_size_log);
 	map->read_option_bool("preload", _preload);
+	map->read_option_int("preload_cache_percent", preload_cache_percent);
 	map->read_option_int("index_file_weight", index_file_weight);
 	map->read_option_bool("in_mem_graph", _in_mem_graph);
 	map->read_option_int("num_vparts", num_vparts);
 	map->read_option_int("min_vpart_degree", min_vpart_degree);
 	map->read_option_bool("serial_run", serial_run);
 	map->read_option_int("vertex_merge_gap", vertex_merge_gap);
+	map->read_option_int("hot_vertex_mem", hot_vertex_mem);
+	map->read_option_bool("replicate_hot_vertices", replicate_hot_vertices);
+	map->read_option_int("ext_vertex_state_mem", ext_vertex_state_mem);
+	map->read_option_int("ext_vertex_state_window", ext_vertex_state_window);
+	map->read_option_int("sched_window_size", sched_window_size);
 }
 
 }
@@ -37,6 +37,8 @@ class graph_config
 	int num_threads;
 	std::string prof_file;
 	std::string trace_file;
+	bool _prof_levels;
+	std::string level_prof_file;
 	int max_processing_vertices;
 	bool enable_elevator;
 	int part_range_size_log;
@@ -48,6 +50,16 @@ class graph_config
 	bool serial_run;
 	// in pages.
 	int vertex_merge_gap;
+	// in megabytes.
+	int hot_vertex_mem;
+	bool replicate_hot_vertices;
+	int preload_cache_percent;
+	// in megabytes.
+	int ext_vertex_state_mem;
+	// in kilobytes.
+	int ext_vertex_state_window;
+	int sched_window_size;
+	bool part_balance_edges;
 public:
 	/**
 	 * \brief The default constructor that set all configurations to
@@ -55,6 +67,7 @@ public:
 	 */
 	graph_config() {
 		num_threads = 4;
+		_prof_levels = false;
 		max_processing_vertices = 2000;
 		enable_elevator = false;
 		part_range_size_log = 10;
@@ -67,6 +80,13 @@ public:
 		// When the gap is 0, it means two vertices either in the same page
 		// or two adjacent pages.
 		vertex_merge_gap = 0;
+		hot_vertex_mem = 0;
+		replicate_hot_vertices = false;
+		preload_cache_percent = 100;
+		ext_vertex_state_mem = 0;
+		ext_vertex_state_window = 1024;
+		sched_window_size = 0;
+		part_balance_edges = false;
 	}
 
 	/**
@@ -117,6 +137,24 @@ public:
 		return trace_file;
 	}
 
+	/**
+	 * \brief Determine whether the worker threads collect the per-level
+	 * profiling counters.
+	 * \return true if the levels are profiled.
+	 */
+	bool prof_levels() const {
+		return _prof_levels || !level_prof_file.empty();
+	}
+
+	/**
+	 * \brief Get the file where the per-level profiling counters are
+	 * appended in JSON.
+	 * \return the file name.
+	 */
+	const std::string &get_level_prof_file() const {
+		return level_prof_file;
+	}
+
 	/**
 	 * \brief Get the maximal number of vertices being processed by
 	 * a worker thread.
@@ -142,6 +180,15 @@ public:
 		return _preload;
 	}
 
+	/**
+	 * \brief Get the percentage of the page cache that can be filled by
+	 *        preloading the graph.
+	 * \return the percentage of the page cache.
+	 */
+	int get_preload_cache_percent() const {
+		return preload_cache_percent;
+	}
+
 	/**
 	 * \brief Get the weight for graph index file.
 	 * A SAFS file has weight that is used in the page cache. The pages of
@@ -196,6 +243,64 @@ public:
 	int get_vertex_merge_gap() const {
 		return vertex_merge_gap;
 	}
+
+	/**
+	 * \brief Get the memory size of the store that keeps the adjacency
+	 * lists of the vertices with the largest degrees in memory.
+	 * The store is disabled if the size is 0.
+	 * \return the memory size in bytes.
+	 */
+	size_t get_hot_vertex_mem() const {
+		return ((size_t) hot_vertex_mem) * 1024 * 1024;
+	}
+
+	/**
+	 * \brief Determine whether to keep a copy of the hot vertex store
+	 * on every NUMA node.
+	 * \return true if the store is replicated on every NUMA node.
+	 */
+	bool replicate_hot_vertex_store() const {
+		return replicate_hot_vertices;
+	}
+
+	/**
+	 * \brief Get the memory size for the vertex state that is stored
+	 * in SAFS. The algorithms that support out-of-core vertex state keep
+	 * their vertex state in memory if the size is 0.
+	 * \return the memory size in bytes.
+	 */
+	size_t get_ext_vertex_state_mem() const {
+		return ((size_t) ext_vertex_state_mem) * 1024 * 1024;
+	}
+
+	/**
+	 * \brief Get the size of a window of the vertex state stored in SAFS.
+	 * The vertex state is read from and written to SAFS in windows.
+	 * \return the window size in bytes.
+	 */
+	size_t get_ext_vertex_state_window() const {
+		return ((size_t) ext_vertex_state_window) * 1024;
+	}
+
+	/**
+	 * \brief Get the number of vertices that a worker thread admits
+	 * together in a sparse level, so that the requests for their
+	 * adjacency lists can be merged. It's disabled if it's 0.
+	 * \return the number of vertices in a window.
+	 */
+	int get_sched_window_size() const {
+		return sched_window_size;
+	}
+
+	/**
+	 * \brief Determine whether to split vertices into contiguous ranges
+	 * with roughly the same number of edges. Otherwise, vertices are
+	 * assigned to partitions in ranges of the same size.
+	 * \return true if partitions are balanced on the number of edges.
+	 */
+	bool balance_part_edges() const {
+		return part_balance_edges;
+	}
 };
 
 extern graph_config graph_conf;
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "comm_exception.h"
+
+#include "graph_delta.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+/*
+ * Insert a value to a sorted vector if it doesn't exist.
+ */
+static void insert_sorted(std::vector<vertex_id_t> &vec, vertex_id_t val)
+{
+	std::vector<vertex_id_t>::iterator it = std::lower_bound(vec.begin(),
+			vec.end(), val);
+	if (it == vec.end() || *it != val)
+		vec.insert(it, val);
+}
+
+/*
+ * Remove a value from a sorted vector.
+ * It returns true if the value exists in the vector.
+ */
+static bool erase_sorted(std::vector<vertex_id_t> &vec, vertex_id_t val)
+{
+	std::vector<vertex_id_t>::iterator it = std::lower_bound(vec.begin(),
+			vec.end(), val);
+	if (it != vec.end() && *it == val) {
+		vec.erase(it);
+		return true;
+	}
+	return false;
+}
+
+graph_delta::graph_delta(const graph_header &header,
+		int num_parts): partitioner(1 << (int) ceil(log2(num_parts))), update_map(
+			header.get_num_vertices(), 0)
+{
+	if (header.has_edge_data())
+		throw unsupported_exception(
+				"the delta store doesn't support graphs with edge data");
+	if (header.get_graph_type() != graph_type::DIRECTED
+			&& header.get_graph_type() != graph_type::UNDIRECTED)
+		throw unsupported_exception(
+				"the delta store doesn't support time-series graphs");
+	this->header = header;
+	for (int i = 0; i < partitioner.get_num_partitions(); i++)
+		parts.emplace_back(new delta_partition());
+	num_updates = 0;
+}
+
+void graph_delta::add_half_edge(vertex_id_t id, vertex_id_t neigh,
+		edge_type type)
+{
+	if (id >= header.get_num_vertices())
+		throw invalid_arg_exception("the vertex doesn't exist in the graph");
+
+	delta_partition &part = *parts[partitioner.map(id)];
+	pthread_spin_lock(&part.lock);
+	vertex_delta &delta = part.vertices[id];
+	// If the edge was deleted, we keep the deletion because it removes
+	// all duplicated edges in the graph image, and the edge added back
+	// is only kept in the added list.
+	delta.get_added(type).insert(std::upper_bound(delta.get_added(type).begin(),
+				delta.get_added(type).end(), neigh), neigh);
+	pthread_spin_unlock(&part.lock);
+	update_map.set(id);
+}
+
+void graph_delta::delete_half_edge(vertex_id_t id, vertex_id_t neigh,
+		edge_type type)
+{
+	if (id >= header.get_num_vertices())
+		throw invalid_arg_exception("the vertex doesn't exist in the graph");
+
+	delta_partition &part = *parts[partitioner.map(id)];
+	pthread_spin_lock(&part.lock);
+	vertex_delta &delta = part.vertices[id];
+	while (erase_sorted(delta.get_added(type), neigh));
+	insert_sorted(delta.get_deleted(type), neigh);
+	pthread_spin_unlock(&part.lock);
+	update_map.set(id);
+}
+
+void graph_delta::add_edge(vertex_id_t from, vertex_id_t to)
+{
+	if (header.is_directed_graph()) {
+		add_half_edge(from, to, edge_type::OUT_EDGE);
+		add_half_edge(to, from, edge_type::IN_EDGE);
+	}
+	else {
+		// An undirected vertex only has one adjacency list, which we
+		// keep in the out-edge list.
+		add_half_edge(from, to, edge_type::OUT_EDGE);
+		if (from != to)
+			add_half_edge(to, from, edge_type::OUT_EDGE);
+	}
+	num_updates++;
+}
+
+void graph_delta::delete_edge(vertex_id_t from, vertex_id_t to)
+{
+	if (header.is_directed_graph()) {
+		delete_half_edge(from, to, edge_type::OUT_EDGE);
+		delete_half_edge(to, from, edge_type::IN_EDGE);
+	}
+	else {
+		delete_half_edge(from, to, edge_type::OUT_EDGE);
+		if (from != to)
+			delete_half_edge(to, from, edge_type::OUT_EDGE);
+	}
+	num_updates++;
+}
+
+bool graph_delta::get_updates(vertex_id_t id, vertex_delta &delta) const
+{
+	if (!has_updates(id))
+		return false;
+
+	delta_partition &part = *parts[partitioner.map(id)];
+	bool found = false;
+	pthread_spin_lock(&part.lock);
+	std::unordered_map<vertex_id_t, vertex_delta>::const_iterator it
+		= part.vertices.find(id);
+	if (it != part.vertices.end()) {
+		delta = it->second;
+		found = true;
+	}
+	pthread_spin_unlock(&part.lock);
+	return found;
+}
+
+std::unique_ptr<merged_page_vertex> graph_delta::merge(
+		const page_vertex &v) const
+{
+	vertex_delta delta;
+	if (!get_updates(v.get_id(), delta))
+		return std::unique_ptr<merged_page_vertex>();
+	return std::unique_ptr<merged_page_vertex>(new merged_page_vertex(v,
+				delta));
+}
+
+void graph_delta::clear()
+{
+	for (size_t i = 0; i < parts.size(); i++) {
+		pthread_spin_lock(&parts[i]->lock);
+		parts[i]->vertices.clear();
+		pthread_spin_unlock(&parts[i]->lock);
+	}
+	update_map.clear();
+	num_updates = 0;
+}
+
+/*
+ * Merge the edges read from the graph image with the updates.
+ * The edges in the graph image and the updates are sorted, and so is
+ * the merged edge list.
+ */
+static void merge_edges(const page_vertex &v, edge_type type,
+		const vertex_delta &delta, std::vector<vertex_id_t> &merged)
+{
+	std::vector<vertex_id_t> orig(v.get_num_edges(type));
+	if (!orig.empty())
+		v.read_edges(type, orig.data(), orig.size());
+
+	const std::vector<vertex_id_t> &deleted = delta.get_deleted(type);
+	std::vector<vertex_id_t> kept;
+	kept.reserve(orig.size());
+	for (size_t i = 0; i < orig.size(); i++) {
+		if (!std::binary_search(deleted.begin(), deleted.end(), orig[i]))
+			kept.push_back(orig[i]);
+	}
+
+	const std::vector<vertex_id_t> &added = delta.get_added(type);
+	merged.resize(kept.size() + added.size());
+	std::merge(kept.begin(), kept.end(), added.begin(), added.end(),
+			merged.begin());
+}
+
+std::unique_ptr<char[]> merged_page_vertex::create_adj_list(vertex_id_t id,
+		const std::vector<vertex_id_t> &edges, size_t &size)
+{
+	size = ext_mem_undirected_vertex::num_edges2vsize(edges.size(), 0);
+	std::unique_ptr<char[]> buf(new char[size]);
+	ext_mem_undirected_vertex *v = new (buf.get()) ext_mem_undirected_vertex(
+			id, edges.size(), 0);
+	for (size_t i = 0; i < edges.size(); i++)
+		v->set_neighbor(i, edges[i]);
+	return buf;
+}
+
+merged_page_vertex::merged_page_vertex(const page_vertex &orig,
+		const vertex_delta &delta)
+{
+	std::vector<vertex_id_t> edges;
+	size_t size;
+	if (!orig.is_directed()) {
+		merge_edges(orig, edge_type::OUT_EDGE, delta, edges);
+		out_buf = create_adj_list(orig.get_id(), edges, size);
+		out_arr = std::unique_ptr<mem_byte_array>(new mem_byte_array(
+					out_buf.get(), size));
+		v = std::unique_ptr<page_vertex>(new page_undirected_vertex(*out_arr));
+		return;
+	}
+
+	const page_directed_vertex &dv = (const page_directed_vertex &) orig;
+	if (dv.has_in_part()) {
+		merge_edges(orig, edge_type::IN_EDGE, delta, edges);
+		in_buf = create_adj_list(orig.get_id(), edges, size);
+		in_arr = std::unique_ptr<mem_byte_array>(new mem_byte_array(
+					in_buf.get(), size));
+	}
+	if (dv.has_out_part()) {
+		merge_edges(orig, edge_type::OUT_EDGE, delta, edges);
+		out_buf = create_adj_list(orig.get_id(), edges, size);
+		out_arr = std::unique_ptr<mem_byte_array>(new mem_byte_array(
+					out_buf.get(), size));
+	}
+	if (in_arr && out_arr)
+		v = std::unique_ptr<page_vertex>(new page_directed_vertex(*in_arr,
+					*out_arr));
+	else if (in_arr)
+		v = std::unique_ptr<page_vertex>(new page_directed_vertex(*in_arr,
+					true));
+	else
+		v = std::unique_ptr<page_vertex>(new page_directed_vertex(*out_arr,
+					false));
+}
+
+}
@@ -0,0 +1,236 @@
+#ifndef __GRAPH_DELTA_H__
+#define __GRAPH_DELTA_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+
+#include "cache.h"
+
+#include "FG_basic_types.h"
+#include "graph_file_header.h"
+#include "partitioner.h"
+#include "vertex.h"
+#include "bitmap.h"
+
+namespace fg
+{
+
+/*
+ * The edge updates of a vertex that haven't been merged to the graph image.
+ * All vectors are sorted.
+ */
+struct vertex_delta
+{
+	std::vector<vertex_id_t> added_in;
+	std::vector<vertex_id_t> deleted_in;
+	std::vector<vertex_id_t> added_out;
+	std::vector<vertex_id_t> deleted_out;
+
+	std::vector<vertex_id_t> &get_added(edge_type type) {
+		return type == edge_type::IN_EDGE ? added_in : added_out;
+	}
+
+	std::vector<vertex_id_t> &get_deleted(edge_type type) {
+		return type == edge_type::IN_EDGE ? deleted_in : deleted_out;
+	}
+
+	const std::vector<vertex_id_t> &get_added(edge_type type) const {
+		return type == edge_type::IN_EDGE ? added_in : added_out;
+	}
+
+	const std::vector<vertex_id_t> &get_deleted(edge_type type) const {
+		return type == edge_type::IN_EDGE ? deleted_in : deleted_out;
+	}
+};
+
+/*
+ * This byte array wraps a contiguous memory buffer, so an adjacency list
+ * constructed in memory can be accessed in the same way as the adjacency
+ * lists in the page cache.
+ */
+class mem_byte_array: public safs::page_byte_array
+{
+	const char *buf;
+	size_t size;
+public:
+	mem_byte_array(const char *buf, size_t size) {
+		this->buf = buf;
+		this->size = size;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	virtual safs::page_byte_array *clone() {
+		return NULL;
+	}
+
+	virtual off_t get_offset() const {
+		return 0;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return 0;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + idx * safs::PAGE_SIZE;
+	}
+};
+
+/*
+ * This is a page vertex whose adjacency lists are merged with the edge
+ * updates in the delta store. It owns the memory of the merged adjacency
+ * lists.
+ */
+class merged_page_vertex
+{
+	std::unique_ptr<char[]> in_buf;
+	std::unique_ptr<char[]> out_buf;
+	std::unique_ptr<mem_byte_array> in_arr;
+	std::unique_ptr<mem_byte_array> out_arr;
+	std::unique_ptr<page_vertex> v;
+
+	static std::unique_ptr<char[]> create_adj_list(vertex_id_t id,
+			const std::vector<vertex_id_t> &edges, size_t &size);
+public:
+	merged_page_vertex(const page_vertex &orig, const vertex_delta &delta);
+
+	const page_vertex &get_vertex() const {
+		return *v;
+	}
+};
+
+/*
+ * This is an in-memory store that buffers edge insertions and deletions
+ * of a graph. The updates are merged to the adjacency lists read from
+ * the graph image when vertex programs run on the adjacency lists, so
+ * algorithms see the up-to-date graph without rebuilding the image.
+ *
+ * The store is partitioned in vertex ranges with the range partitioner,
+ * so the updates on different partitions don't contend for the same lock.
+ * The partitions are allocated from the ordinary heap, so they aren't
+ * local to the NUMA nodes of the threads that read them.
+ * The delta store is shared by all engines created from the same graph.
+ */
+class graph_delta
+{
+	struct delta_partition
+	{
+		pthread_spinlock_t lock;
+		std::unordered_map<vertex_id_t, vertex_delta> vertices;
+
+		delta_partition() {
+			pthread_spin_init(&lock, PTHREAD_PROCESS_PRIVATE);
+		}
+	};
+
+	graph_header header;
+	range_graph_partitioner partitioner;
+	std::vector<std::unique_ptr<delta_partition> > parts;
+	// This indicates the vertices with updates. It's used to avoid locking
+	// the partitions when we read the adjacency lists of vertices without
+	// updates.
+	thread_safe_bitmap update_map;
+	std::atomic<size_t> num_updates;
+
+	graph_delta(const graph_header &header, int num_parts);
+
+	void add_half_edge(vertex_id_t id, vertex_id_t neigh, edge_type type);
+	void delete_half_edge(vertex_id_t id, vertex_id_t neigh, edge_type type);
+public:
+	typedef std::shared_ptr<graph_delta> ptr;
+
+	/*
+	 * The number of partitions is rounded up to a power of two, so it can
+	 * be the number of worker threads when it isn't 2^n.
+	 */
+	static ptr create(const graph_header &header, int num_parts) {
+		return ptr(new graph_delta(header, num_parts));
+	}
+
+	/*
+	 * Insert an edge. In an undirected graph, the edge is inserted to
+	 * the adjacency lists of both vertices.
+	 */
+	void add_edge(vertex_id_t from, vertex_id_t to);
+	/*
+	 * Delete an edge. It deletes all duplicated edges between the two
+	 * vertices. In an undirected graph, the edge is deleted from
+	 * the adjacency lists of both vertices.
+	 */
+	void delete_edge(vertex_id_t from, vertex_id_t to);
+
+	void add_edges(const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges) {
+		for (size_t i = 0; i < edges.size(); i++)
+			add_edge(edges[i].first, edges[i].second);
+	}
+
+	void delete_edges(const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges) {
+		for (size_t i = 0; i < edges.size(); i++)
+			delete_edge(edges[i].first, edges[i].second);
+	}
+
+	bool has_updates(vertex_id_t id) const {
+		return num_updates.load(std::memory_order_relaxed) > 0
+			&& update_map.get(id);
+	}
+
+	/*
+	 * The number of edge updates buffered in the store.
+	 */
+	size_t get_num_updates() const {
+		return num_updates.load(std::memory_order_relaxed);
+	}
+
+	/*
+	 * Get the updates of a vertex. It returns false if the vertex
+	 * doesn't have updates.
+	 */
+	bool get_updates(vertex_id_t id, vertex_delta &delta) const;
+
+	/*
+	 * Merge the updates of the vertex to its adjacency lists read from
+	 * the graph image. It returns NULL if the vertex doesn't have updates.
+	 */
+	std::unique_ptr<merged_page_vertex> merge(const page_vertex &v) const;
+
+	/*
+	 * Drop all updates, e.g., after they are written to a new graph image.
+	 */
+	void clear();
+};
+
+}
+
+#endif
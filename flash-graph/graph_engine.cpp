@@ -223,6 +223,12 @@ bool request_self(directed_vertex_request reqs[], size_t num, vertex_id_t self)
 		return false;
 }
 
+static inline bool is_hot_vertex(graph_engine &graph, vertex_id_t id)
+{
+	const hot_vertex_store::ptr &hot_store = graph.get_hot_store();
+	return hot_store && hot_store->is_hot(id);
+}
+
 void compute_vertex::request_vertices(vertex_id_t ids[], size_t num)
 {
 	if (num == 0)
@@ -231,7 +237,9 @@ void compute_vertex::request_vertices(vertex_id_t ids[], size_t num)
 	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
 	vertex_id_t id = curr->get_vertex_program(false).get_vertex_id(*this);
 	curr->request_on_vertex(id);
-	if (request_self(ids, num, id)) {
+	// A vertex in the hot vertex store doesn't need to read its own
+	// adjacency list from SAFS.
+	if (request_self(ids, num, id) && !is_hot_vertex(curr->get_graph(), id)) {
 		if (curr->get_graph().is_directed()) {
 			directed_vertex_request req(ids[0], BOTH_EDGES);
 			curr->get_index_reader().request_vertex(req);
@@ -266,7 +274,7 @@ void compute_directed_vertex::request_partial_vertices(
 	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
 	vertex_id_t id = curr->get_vertex_program(false).get_vertex_id(*this);
 	curr->request_on_vertex(id);
-	if (request_self(reqs, num, id)) {
+	if (request_self(reqs, num, id) && !is_hot_vertex(curr->get_graph(), id)) {
 		for (size_t i = 0; i < num; i++)
 			curr->get_index_reader().request_vertex(reqs[i]);
 	}
@@ -544,8 +552,21 @@ void graph_engine::init(graph_index::ptr index)
 	int num_threads = graph_conf.get_num_threads();
 	this->num_nodes = params.get_num_nodes();
 
+	std::unique_ptr<graph_partitioner> partitioner;
+	if (graph_conf.balance_part_edges()) {
+		const in_mem_query_vertex_index &qindex = *vindex;
+		partitioner = edge_balanced_partitioner::create(
+				header.get_num_vertices(), num_threads,
+				[&qindex](vertex_id_t id) {
+					return qindex.get_num_edges(id, edge_type::BOTH_EDGES);
+				});
+	}
+	else
+		partitioner = std::unique_ptr<graph_partitioner>(
+				new range_graph_partitioner(num_threads));
+
 	// Construct the vertex states.
-	index->init(num_threads, num_nodes);
+	index->init(num_threads, num_nodes, std::move(partitioner));
 
 	max_processing_vertices = graph_conf.get_max_processing_vertices();
 	is_complete = false;
@@ -595,11 +616,36 @@ graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 
 	// Init graph data.
 	graph_factory = graph.get_graph_io_factory(GLOBAL_CACHE_ACCESS);
-	// Construct the in-memory compressed vertex index.
-	vindex = in_mem_query_vertex_index::create(graph.get_index_data(), true);
+	// Construct the in-memory compressed vertex index. It's immutable,
+	// so all engines on the same graph share it.
+	vindex = graph.get_in_mem_index();
+	if (vindex == NULL) {
+		vindex = in_mem_query_vertex_index::create(graph.get_index_data(), true);
+		graph.set_in_mem_index(vindex);
+	}
 
 	header = graph.get_graph_header();
 	header.verify();
+	delta = graph.get_delta();
+	graph_data = graph.get_graph_data();
+	hot_store = graph.get_hot_store();
+	// The hot vertex store only helps when adjacency lists are read from SSDs.
+	if (hot_store == NULL && graph_conf.get_hot_vertex_mem() > 0
+			&& !graph.is_in_mem()) {
+		hot_store = hot_vertex_store::create(header, *vindex,
+				graph.get_graph_io_factory(REMOTE_ACCESS),
+				graph_conf.get_hot_vertex_mem(),
+				graph_conf.replicate_hot_vertex_store());
+		graph.set_hot_store(hot_store);
+	}
+	// The page cache is shared by all engines, so only the first engine
+	// on the graph preloads it.
+	need_preload = graph_conf.preload() && !graph.is_in_mem()
+		&& !graph.is_preloaded();
+	if (need_preload)
+		graph.set_preloaded();
+	preload_canceled = false;
+	next_preload_block = 0;
 	out_part_off = 0;
 	if (header.is_directed_graph()) {
 		assert(sizeof(vertex_index) == sizeof(header));
@@ -617,9 +663,22 @@ graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 
 graph_engine::~graph_engine()
 {
-	graph_factory->print_statistics();
-	for (unsigned i = 0; i < worker_threads.size(); i++)
+	// The preload doesn't need to complete if the engine is destroyed.
+	preload_canceled = true;
+	wait4preload();
+	// The factory collects the statistics of an I/O instance only when
+	// the instance is destroyed, so the worker threads that haven't been
+	// waited for have to release their I/O instances first.
+	for (unsigned i = 0; i < worker_threads.size(); i++) {
 		delete worker_threads[i];
+		worker_threads[i] = NULL;
+	}
+	graph_factory->print_statistics();
+	stats_lock.lock();
+	graph_factory->get_statistics(stats.io);
+	stats_lock.unlock();
+	if (hot_store)
+		hot_store->print_statistics();
 	graph_factory = file_io_factory::shared_ptr();
 }
 
@@ -677,6 +736,10 @@ void graph_engine::start(const vertex_id_t ids[], int num,
 {
 	level = 0; // We always reset the level
 	gettimeofday(&start_time, NULL);
+	if (need_preload) {
+		need_preload = false;
+		preload_graph();
+	}
 	init_threads(std::move(creater));
 	int num_threads = get_num_threads();
 	std::vector<std::vector<vertex_id_t> > start_vertices(num_threads);
@@ -698,6 +761,10 @@ void graph_engine::start(std::shared_ptr<vertex_filter> filter,
 {
 	level = 0; // We always reset the level
 	gettimeofday(&start_time, NULL);
+	if (need_preload) {
+		need_preload = false;
+		preload_graph();
+	}
 	init_threads(std::move(creater));
 	// Let's assume all vertices will be activated first.
 	BOOST_FOREACH(worker_thread *t, worker_threads) {
@@ -712,6 +779,10 @@ void graph_engine::start_all(vertex_initializer::ptr init,
 {
 	level = 0; // We always reset the level
 	gettimeofday(&start_time, NULL);
+	if (need_preload) {
+		need_preload = false;
+		preload_graph();
+	}
 	init_threads(std::move(creater));
 	BOOST_FOREACH(worker_thread *t, worker_threads) {
 		t->start_all_vertices(init);
@@ -775,6 +846,7 @@ bool graph_engine::progress_next_level()
 			<< boost::format("Iter %1% takes %2% seconds, and %3% vertices are in iter %4%")
 				% (level.get() - 1) % time_diff(iter_start, curr)
 				% tot_num_activates.get() % level.get();
+		level_seconds.push_back(time_diff(iter_start, curr));
 		iter_start = curr;
 		assert(num_remaining_vertices_in_level.get() == 0);
 		num_remaining_vertices_in_level = atomic_number<size_t>(
@@ -798,8 +870,16 @@ bool graph_engine::progress_next_level()
 
 void graph_engine::wait4complete()
 {
+	size_t num_adj_reqs = 0;
+	size_t num_adj_bytes = 0;
+	level_profs.clear();
 	for (unsigned i = 0; i < worker_threads.size(); i++) {
 		worker_threads[i]->join();
+		num_adj_reqs += worker_threads[i]->get_num_adj_reqs();
+		num_adj_bytes += worker_threads[i]->get_num_adj_bytes();
+		const std::vector<level_profile> &profs
+			= worker_threads[i]->get_level_profiles();
+		level_profs.insert(level_profs.end(), profs.begin(), profs.end());
 		delete worker_threads[i];
 		worker_threads[i] = NULL;
 	}
@@ -808,6 +888,46 @@ void graph_engine::wait4complete()
 	BOOST_LOG_TRIVIAL(info)
 		<< boost::format("The graph engine takes %1% seconds to complete")
 		% time_diff(start_time, curr);
+	stats_lock.lock();
+	stats.num_runs++;
+	stats.run_seconds += time_diff(start_time, curr);
+	stats.level_seconds.insert(stats.level_seconds.end(),
+			level_seconds.begin(), level_seconds.end());
+	stats.num_adj_reqs += num_adj_reqs;
+	stats.num_adj_bytes += num_adj_bytes;
+	stats_lock.unlock();
+	level_seconds.clear();
+
+	std::sort(level_profs.begin(), level_profs.end());
+	if (!graph_conf.get_level_prof_file().empty())
+		dump_level_profiles(graph_conf.get_level_prof_file());
+	if (num_adj_reqs > 0)
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("The workers issue %1% adjacency list requests of %2% bytes on average")
+			% num_adj_reqs % (num_adj_bytes / num_adj_reqs);
+}
+
+/*
+ * Append the profiling counters of the run to the file as a line of JSON.
+ */
+void graph_engine::dump_level_profiles(const std::string &file) const
+{
+	// Multiple engines may complete at the same time.
+	std::lock_guard<std::mutex> guard(stats_lock);
+	FILE *f = fopen(file.c_str(), "a");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("can't open %1%: %2%") % file % strerror(errno);
+		return;
+	}
+	fprintf(f, "{\"threads\": %d, \"levels\": [", get_num_threads());
+	for (size_t i = 0; i < level_profs.size(); i++) {
+		if (i > 0)
+			fprintf(f, ", ");
+		level_profs[i].print_json(f);
+	}
+	fprintf(f, "]}\n");
+	fclose(f);
 }
 
 void graph_engine::set_vertex_scheduler(vertex_scheduler::ptr scheduler)
@@ -815,33 +935,121 @@ void graph_engine::set_vertex_scheduler(vertex_scheduler::ptr scheduler)
 	this->scheduler = scheduler;
 }
 
-#if 0
+namespace {
+
+/*
+ * The size of a read issued by a preload thread and the number of reads
+ * that a preload thread keeps in flight.
+ */
+const size_t PRELOAD_BLOCK_SIZE = 4 * 1024 * 1024;
+const int PRELOAD_DEPTH = 8;
+
+/*
+ * A preload thread reads blocks of the graph file through the page cache.
+ * All preload threads get blocks from a shared counter, so adjacent blocks
+ * are read by different threads and all SSDs are busy.
+ */
+class preload_thread: public thread
+{
+	file_io_factory::shared_ptr factory;
+	size_t preload_size;
+	std::atomic<size_t> &next_block;
+	const std::atomic<bool> &canceled;
+public:
+	preload_thread(file_io_factory::shared_ptr factory, size_t preload_size,
+			std::atomic<size_t> &_next_block, const std::atomic<bool> &_canceled,
+			int node_id): thread("preload_thread", node_id),
+			next_block(_next_block), canceled(_canceled) {
+		this->factory = factory;
+		this->preload_size = preload_size;
+	}
+
+	void run();
+};
+
+void preload_thread::run()
+{
+	io_interface::ptr io = create_io(factory, this);
+	char *buf = NULL;
+	BOOST_VERIFY(posix_memalign((void **) &buf, PAGE_SIZE,
+				PRELOAD_BLOCK_SIZE * PRELOAD_DEPTH) == 0);
+	std::vector<io_request> reqs;
+	reqs.reserve(PRELOAD_DEPTH);
+	while (!canceled.load()) {
+		reqs.clear();
+		while (reqs.size() < (size_t) PRELOAD_DEPTH) {
+			size_t off = next_block.fetch_add(1) * PRELOAD_BLOCK_SIZE;
+			if (off >= preload_size)
+				break;
+			size_t size = std::min(PRELOAD_BLOCK_SIZE, preload_size - off);
+			data_loc_t loc(factory->get_file_id(), off);
+			reqs.push_back(io_request(buf + reqs.size() * PRELOAD_BLOCK_SIZE,
+						loc, size, READ));
+		}
+		if (reqs.empty())
+			break;
+		io->access(reqs.data(), reqs.size());
+		io->wait4complete(reqs.size());
+	}
+	free(buf);
+	stop();
+}
+
+}
+
 void graph_engine::preload_graph()
 {
-	const int BLOCK_SIZE = 1024 * 1024 * 32;
-	std::unique_ptr<char[]> buf = std::unique_ptr<char[]>(new char[BLOCK_SIZE]);
+	// The graph is already in memory.
+	if (graph_data)
+		return;
+	// The preload threads of the previous call share the block counter,
+	// so we can't restart it under them. The blocks they read stay in
+	// the page cache, so there is nothing to do until they're joined.
+	if (!preload_threads.empty()) {
+		BOOST_LOG_TRIVIAL(warning)
+			<< "the graph is already being preloaded";
+		return;
+	}
+	// The vertex index has been loaded to memory when the graph is loaded,
+	// so we only need to preload the adjacency lists.
+	size_t cache_size = params.get_cache_size()
+		/ 100 * graph_conf.get_preload_cache_percent();
+	size_t preload_size = std::min(cache_size,
+			(size_t) graph_factory->get_file_size());
+	if (preload_size == 0)
+		return;
 
-	size_t cache_size = params.get_cache_size();
-	io_interface::ptr io = index_factory->create_io(thread::get_curr_thread());
-	size_t preload_size = min(cache_size,
-			index_factory->get_file_size());
-	cache_size -= preload_size;
 	BOOST_LOG_TRIVIAL(info)
-		<< boost::format("preload %1% bytes of the index file")
+		<< boost::format("preload %1% bytes of the graph file in the background")
 		% preload_size;
-	for (size_t i = 0; i < preload_size; i += BLOCK_SIZE)
-		io->access(buf.get(), i, BLOCK_SIZE, READ);
+	gettimeofday(&preload_start, NULL);
+	preload_canceled = false;
+	next_preload_block = 0;
+	for (int i = 0; i < num_nodes; i++) {
+		thread *t = new preload_thread(graph_factory, preload_size,
+				next_preload_block, preload_canceled, i);
+		t->start();
+		preload_threads.push_back(t);
+	}
+}
 
-	io = graph_factory->create_io(thread::get_curr_thread());
-	preload_size = min(cache_size, graph_factory->get_file_size());
+void graph_engine::wait4preload()
+{
+	if (preload_threads.empty())
+		return;
+
+	for (size_t i = 0; i < preload_threads.size(); i++) {
+		preload_threads[i]->join();
+		delete preload_threads[i];
+	}
+	preload_threads.clear();
+	struct timeval curr;
+	gettimeofday(&curr, NULL);
 	BOOST_LOG_TRIVIAL(info)
-		<< boost::format("preload %1% bytes of the graph file")
-		% preload_size;
-	for (size_t i = 0; i < preload_size; i += BLOCK_SIZE)
-		io->access(buf.get(), i, BLOCK_SIZE, READ);
-	BOOST_LOG_TRIVIAL(info) << "successfully preload";
+		<< boost::format("It takes %1% seconds to preload the graph%2%")
+		% time_diff(preload_start, curr)
+		% (preload_canceled.load() ? " (canceled)" : "");
 }
-#endif
 
 void graph_engine::init_vertices(vertex_id_t ids[], int num,
 		vertex_initializer::ptr init)
@@ -915,6 +1123,20 @@ size_t graph_get_vertices(graph_engine &graph, const worker_thread &t,
 }
 
 std::atomic<long> graph_engine::init_count;
+std::mutex graph_engine::stats_lock;
+engine_stats graph_engine::stats;
+
+engine_stats graph_engine::get_stats()
+{
+	std::lock_guard<std::mutex> guard(stats_lock);
+	return stats;
+}
+
+void graph_engine::reset_stats()
+{
+	std::lock_guard<std::mutex> guard(stats_lock);
+	stats = engine_stats();
+}
 
 void graph_engine::init_flash_graph(config_map::ptr configs)
 {
@@ -21,6 +21,7 @@
  */
 
 #include <atomic>
+#include <mutex>
 
 #include "vertex.h"
 #include "vertex_index.h"
@@ -31,6 +32,8 @@
 #include "graph_config.h"
 #include "vertex_request.h"
 #include "vertex_program.h"
+#include "hot_vertex_store.h"
+#include "level_profile.h"
 
 namespace safs
 {
@@ -324,6 +327,33 @@ class worker_thread;
 class in_mem_graph;
 class FG_graph;
 
+/**
+ * \brief The statistics of the graph engines that have completed in
+ *        the process. An algorithm may run multiple engines, so a benchmark
+ *        resets the statistics before running an algorithm and reads them
+ *        afterwards.
+ */
+struct engine_stats
+{
+	// The number of engine runs.
+	size_t num_runs;
+	// The time of the engine runs.
+	double run_seconds;
+	// The time of each level in all engine runs.
+	std::vector<double> level_seconds;
+	size_t num_adj_reqs;
+	size_t num_adj_bytes;
+	// The I/O statistics of the graph file.
+	safs::io_stats io;
+
+	engine_stats() {
+		num_runs = 0;
+		run_seconds = 0;
+		num_adj_reqs = 0;
+		num_adj_bytes = 0;
+	}
+};
+
 /**
  * \brief This is the class that coordinates how & where algorithms are run.
  *          It can be seen as the central organ of FlashGraph.
@@ -340,6 +370,10 @@ class graph_engine
 	graph_index::ptr vertices;
 	in_mem_query_vertex_index::ptr vindex;
 	std::shared_ptr<in_mem_graph> graph_data;
+	// The edge updates that haven't been merged to the graph image.
+	graph_delta::ptr delta;
+	// The adjacency lists of high-degree vertices kept in memory.
+	hot_vertex_store::ptr hot_store;
 	vertex_scheduler::ptr scheduler;
 
 	// The number of activated vertices that haven't been processed
@@ -361,10 +395,26 @@ class graph_engine
 	std::shared_ptr<safs::file_io_factory> graph_factory;
 	int max_processing_vertices;
 
+	// The threads that preload the graph to the page cache.
+	std::vector<thread *> preload_threads;
+	// Indicate whether the graph should be preloaded when the engine starts.
+	bool need_preload;
+	std::atomic<bool> preload_canceled;
+	std::atomic<size_t> next_preload_block;
+	struct timeval preload_start;
+
 	// The time when the current iteration starts.
 	struct timeval start_time, iter_start;
+	// The time of the levels in the current run.
+	std::vector<double> level_seconds;
+	// The profiling counters of the worker threads in the last run.
+	std::vector<level_profile> level_profs;
+
+	static std::mutex stats_lock;
+	static engine_stats stats;
 
 	void init_threads(vertex_program_creater::ptr creater);
+	void dump_level_profiles(const std::string &file) const;
 protected:
 	graph_engine(FG_graph &graph, graph_index::ptr index);
 	void init(graph_index::ptr index);
@@ -373,6 +423,23 @@ public:
 
 	static void init_flash_graph(config_map::ptr configs);
 	static void destroy_flash_graph();
+
+	/**
+	 * \brief Get the profiling counters of each worker thread in each level
+	 *        of the last run, ordered by level and then by worker.
+	 *        It's empty unless `prof_levels' or `level_prof_file' is set.
+	 *        It's valid after `wait4complete' returns.
+	 */
+	const std::vector<level_profile> &get_level_profiles() const {
+		return level_profs;
+	}
+
+	/**
+	 * \brief Get the statistics of the engines that have completed since
+	 *        the last reset.
+	 */
+	static engine_stats get_stats();
+	static void reset_stats();
     
     /**
      * \brief Constructor usable by inheriting classes.
@@ -512,15 +579,25 @@ public:
      */
 	void wait4complete();
 
-#if 0
 	/**
-	 * \brief This method preloads the entire graph to the page cache.
+	 * \brief This method preloads the graph to the page cache in
+	 *        the background and returns immediately. A thread on each NUMA
+	 *        node keeps multiple large reads in flight, so the preload
+	 *        saturates all SSDs while the graph algorithm runs.
 	 *        If the page cache is smaller than the graph, only the first part
-	 *        of the graph image (the same size as the page cache) is preloaded
-	 *        to the page cache.
+	 *        of the graph image is preloaded. The size is limited by
+	 *        the `preload_cache_percent' option.
+	 *        The engine calls this method when it starts if the `preload'
+	 *        option is set.
+	 *        It does nothing if a preload started by a previous call hasn't
+	 *        been waited for with wait4preload().
 	 */
 	void preload_graph();
-#endif
+
+	/**
+	 * \brief Wait for the graph to be preloaded to the page cache.
+	 */
+	void wait4preload();
 
 	/**
 	 * \brief Allows users to initialize vertices to certain state.
@@ -595,6 +672,21 @@ public:
 	int get_num_threads() const {
 		return worker_threads.size();
 	}
+
+    /**\internal */
+	const graph_delta::ptr &get_delta() const {
+		return delta;
+	}
+
+    /**\internal */
+	const hot_vertex_store::ptr &get_hot_store() const {
+		return hot_store;
+	}
+
+    /**\internal */
+	int get_num_nodes() const {
+		return num_nodes;
+	}
     
     /**\internal */
 	worker_thread *get_thread(int idx) const {
@@ -25,6 +25,7 @@
 
 #include "common.h"
 #include "parameters.h"
+#include "FG_basic_types.h"
 
 namespace fg
 {
@@ -59,9 +60,21 @@ class graph_header
 {
 public:
 	static const int HEADER_SIZE = 4096;
+	/*
+	 * The number of bytes of a vertex ID is stored in the last int of
+	 * the header page instead of graph_header_struct, so neither the fields
+	 * of the struct nor the fields that the vertex index stores after it
+	 * move. The images created before it was recorded have 0 there and use
+	 * 4-byte vertex IDs.
+	 */
+	static const int VERTEX_ID_SIZE_OFF = HEADER_SIZE - sizeof(int);
 private:
 	union {
 		struct graph_header_struct data;
+		struct {
+			char pad[VERTEX_ID_SIZE_OFF];
+			int vertex_id_size;
+		} tail;
 		char page[HEADER_SIZE];
 	} h;
 public:
@@ -79,10 +92,20 @@ public:
 		data.max_num_timestamps = 0;
 	}
 
+	/*
+	 * Record the size of vertex IDs in a header page that starts with
+	 * graph_header_struct, e.g., the header of the vertex index.
+	 */
+	static void init_vertex_id_size(char *page) {
+		int size = sizeof(vertex_id_t);
+		memcpy(page + VERTEX_ID_SIZE_OFF, &size, sizeof(size));
+	}
+
 	graph_header() {
 		assert(sizeof(*this) == HEADER_SIZE);
 		memset(this, 0, sizeof(*this));
 		init(h.data);
+		h.tail.vertex_id_size = sizeof(vertex_id_t);
 	}
 
 	graph_header(graph_type type, size_t num_vertices, size_t num_edges,
@@ -96,6 +119,7 @@ public:
 		h.data.num_edges = num_edges;
 		h.data.edge_data_size = edge_data_size;
 		h.data.max_num_timestamps = max_num_timestamps;
+		h.tail.vertex_id_size = sizeof(vertex_id_t);
 	}
 
 	bool is_graph_file() const {
@@ -135,6 +159,17 @@ public:
 		return h.data.max_num_timestamps;
 	}
 
+	int get_vertex_id_size() const {
+		if (h.tail.vertex_id_size == 0)
+			return sizeof(unsigned int);
+		else
+			return h.tail.vertex_id_size;
+	}
+
+	bool is_right_vertex_id_size() const {
+		return get_vertex_id_size() == sizeof(vertex_id_t);
+	}
+
 	void verify() const {
 		if (!is_graph_file()) {
 			fprintf(stderr, "wrong magic number: %ld\n", h.data.magic_number);
@@ -142,8 +177,14 @@ public:
 		if (!is_right_version()) {
 			fprintf(stderr, "wrong version number: %d\n", h.data.version_number);
 		}
+		if (!is_right_vertex_id_size()) {
+			fprintf(stderr,
+					"the graph uses %d-byte vertex IDs, but FlashGraph is built with %ld-byte vertex IDs\n",
+					get_vertex_id_size(), sizeof(vertex_id_t));
+		}
 		assert(is_graph_file());
 		assert(is_right_version());
+		assert(is_right_vertex_id_size());
 	}
 };
 
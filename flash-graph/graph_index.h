@@ -86,7 +86,13 @@ public:
 	virtual ~graph_index() {
 	}
 
-	virtual void init(int num_threads, int num_nodes) {
+	/*
+	 * Initialize the vertices of the graph in partitions. The partitioner
+	 * assigns vertices to partitions and each partition is processed by
+	 * a worker thread.
+	 */
+	virtual void init(int num_threads, int num_nodes,
+			std::unique_ptr<graph_partitioner> partitioner) {
 	}
 	virtual void init_vparts(int hpart_id, int num_vparts,
 			std::vector<vertex_id_t> &ids) = 0;
@@ -318,7 +324,7 @@ class NUMA_graph_index: public graph_index
 	graph_header header;
 	vertex_id_t max_vertex_id;
 	vertex_id_t min_vertex_id;
-	std::unique_ptr<range_graph_partitioner> partitioner;
+	std::unique_ptr<graph_partitioner> partitioner;
 	// A graph index per thread
 	std::vector<std::unique_ptr<graph_local_partition<vertex_type, part_vertex_type> > > index_arr;
 
@@ -344,9 +350,10 @@ public:
 		return graph_index::ptr(index);
 	}
 
-	void init(int num_threads, int num_nodes) {
-		partitioner = std::unique_ptr<range_graph_partitioner>(
-				new range_graph_partitioner(num_threads));
+	void init(int num_threads, int num_nodes,
+			std::unique_ptr<graph_partitioner> partitioner) {
+		assert(partitioner->get_num_partitions() == num_threads);
+		this->partitioner = std::move(partitioner);
 
 		// Construct the indices.
 		for (int i = 0; i < num_threads; i++) {
@@ -354,7 +361,7 @@ public:
 						// The partitions are assigned to worker threads.
 						// The memory used to store the partitions should
 						// be on the same NUMA as the worker threads.
-						*partitioner, i, i % num_nodes,
+						*this->partitioner, i, i % num_nodes,
 						header.get_num_vertices()));
 		}
 
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <numa.h>
+#include <string.h>
+
+#include <queue>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "parameters.h"
+#include "comm_exception.h"
+
+#include "hot_vertex_store.h"
+#include "vertex_index.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+hot_vertex_store::hot_vertex_store(const graph_header &header,
+		size_t num_vertices): hot_map(num_vertices, 0)
+{
+	this->directed = header.is_directed_graph();
+	this->data_size = 0;
+}
+
+hot_vertex_store::~hot_vertex_store()
+{
+	for (size_t i = 0; i < replicas.size(); i++) {
+		if (replicas[i]->data)
+			numa_free(replicas[i]->data, data_size);
+	}
+}
+
+/*
+ * The size of the adjacency lists of a vertex that are kept in the store.
+ */
+typedef std::pair<size_t, vertex_id_t> vertex_size_t;
+
+struct vertex_size_greater
+{
+	bool operator()(const vertex_size_t &v1, const vertex_size_t &v2) const {
+		return v1.first > v2.first;
+	}
+};
+
+void hot_vertex_store::select_vertices(const in_mem_query_vertex_index &index,
+		size_t num_vertices, size_t mem_budget)
+{
+	// We keep the largest vertices that fit in the memory budget in
+	// a min-heap, so the smallest of them is evicted first.
+	std::priority_queue<vertex_size_t, std::vector<vertex_size_t>,
+		vertex_size_greater> heap;
+	size_t tot_size = 0;
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		size_t size;
+		if (directed) {
+			const in_mem_cdirected_vertex_index &dindex
+				= (const in_mem_cdirected_vertex_index &) index;
+			size = dindex.get_in_size(id) + dindex.get_out_size(id);
+		}
+		else {
+			const in_mem_cundirected_vertex_index &uindex
+				= (const in_mem_cundirected_vertex_index &) index;
+			size = uindex.get_size(id);
+		}
+		if (index.get_num_edges(id, edge_type::BOTH_EDGES) == 0
+				|| size > mem_budget)
+			continue;
+		// The vertex is smaller than all vertices in the store and
+		// the store is full.
+		if (!heap.empty() && tot_size + size > mem_budget
+				&& size <= heap.top().first)
+			continue;
+
+		heap.push(vertex_size_t(size, id));
+		tot_size += size;
+		while (tot_size > mem_budget) {
+			tot_size -= heap.top().first;
+			heap.pop();
+		}
+	}
+
+	std::vector<vertex_id_t> ids;
+	ids.reserve(heap.size());
+	while (!heap.empty()) {
+		ids.push_back(heap.top().second);
+		heap.pop();
+	}
+	// We lay out the adjacency lists in the store in the same order as
+	// the graph file, so the store is loaded with sequential I/O.
+	std::sort(ids.begin(), ids.end());
+
+	size_t loc = 0;
+	for (size_t i = 0; i < ids.size(); i++) {
+		vertex_id_t id = ids[i];
+		hot_vertex_entry e;
+		if (directed) {
+			const in_mem_cdirected_vertex_index &dindex
+				= (const in_mem_cdirected_vertex_index &) index;
+			directed_vertex_entry dentry = dindex.get_vertex(id);
+			e.in_off = dentry.get_in_off();
+			e.in_size = dindex.get_in_size(id);
+			e.out_off = dentry.get_out_off();
+			e.out_size = dindex.get_out_size(id);
+		}
+		else {
+			const in_mem_cundirected_vertex_index &uindex
+				= (const in_mem_cundirected_vertex_index &) index;
+			e.in_off = uindex.get_vertex(id).get_off();
+			e.in_size = uindex.get_size(id);
+			e.out_off = 0;
+			e.out_size = 0;
+		}
+		e.in_loc = loc;
+		loc += e.in_size;
+		e.out_loc = loc;
+		loc += e.out_size;
+		vertices.insert(std::pair<vertex_id_t, hot_vertex_entry>(id, e));
+		hot_map.set(id);
+	}
+	data_size = loc;
+}
+
+/*
+ * Read a range of the graph file to the buffer. SAFS reads data in pages,
+ * so the range is read to a page-aligned buffer first.
+ */
+static void read_range(io_interface &io, int file_id, off_t off, size_t size,
+		char *page_buf, size_t page_buf_size, char *out)
+{
+	while (size > 0) {
+		off_t page_off = ROUND_PAGE(off);
+		size_t read_size = std::min(page_buf_size,
+				(size_t) ROUNDUP_PAGE(off + size) - page_off);
+		data_loc_t loc(file_id, page_off);
+		io_request req(page_buf, loc, read_size, READ);
+		io.access(&req, 1);
+		io.wait4complete(1);
+
+		size_t copy_size = std::min(size, read_size - (off - page_off));
+		memcpy(out, page_buf + (off - page_off), copy_size);
+		out += copy_size;
+		off += copy_size;
+		size -= copy_size;
+	}
+}
+
+struct entry_loc_less
+{
+	template<class EntryType>
+	bool operator()(const EntryType *e1, const EntryType *e2) const {
+		return e1->in_loc < e2->in_loc;
+	}
+};
+
+void hot_vertex_store::load(file_io_factory::shared_ptr factory, bool replicate)
+{
+	int num_replicas = replicate ? params.get_num_nodes() : 1;
+	for (int i = 0; i < num_replicas; i++)
+		replicas.emplace_back(new replica());
+	if (data_size == 0)
+		return;
+
+	for (int i = 0; i < num_replicas; i++) {
+		if (replicate)
+			replicas[i]->data = (char *) numa_alloc_onnode(data_size, i);
+		else
+			// A single copy is interleaved on all nodes, so all worker
+			// threads get the same memory bandwidth.
+			replicas[i]->data = (char *) numa_alloc_interleaved(data_size);
+		if (replicas[i]->data == NULL)
+			throw oom_exception("can't allocate memory for the hot vertex store");
+	}
+
+	const size_t MAX_IO_SIZE = 64 * 1024 * 1024;
+	char *page_buf = (char *) numa_alloc_local(MAX_IO_SIZE);
+	io_interface::ptr io = create_io(factory, thread::get_curr_thread());
+	char *data = replicas[0]->data;
+	std::vector<const hot_vertex_entry *> entries;
+	entries.reserve(vertices.size());
+	for (auto it = vertices.begin(); it != vertices.end(); it++)
+		entries.push_back(&it->second);
+	std::sort(entries.begin(), entries.end(), entry_loc_less());
+	for (size_t i = 0; i < entries.size(); i++) {
+		const hot_vertex_entry &e = *entries[i];
+		read_range(*io, factory->get_file_id(), e.in_off, e.in_size,
+				page_buf, MAX_IO_SIZE, data + e.in_loc);
+		if (e.out_size > 0)
+			read_range(*io, factory->get_file_id(), e.out_off, e.out_size,
+					page_buf, MAX_IO_SIZE, data + e.out_loc);
+	}
+	io->cleanup();
+	numa_free(page_buf, MAX_IO_SIZE);
+
+	for (int i = 1; i < num_replicas; i++)
+		memcpy(replicas[i]->data, data, data_size);
+}
+
+hot_vertex_store::ptr hot_vertex_store::create(const graph_header &header,
+		const in_mem_query_vertex_index &index,
+		file_io_factory::shared_ptr factory, size_t mem_budget, bool replicate)
+{
+	if (!index.is_compressed()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "The hot vertex store needs a compressed vertex index";
+		return ptr();
+	}
+
+	size_t num_vertices = header.get_num_vertices();
+	ptr store(new hot_vertex_store(header, num_vertices));
+	store->select_vertices(index, num_vertices, mem_budget);
+	store->load(factory, replicate);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("The hot vertex store keeps %1% vertices in %2% bytes (%3% copies)")
+		% store->get_num_vertices() % store->get_data_size()
+		% store->replicas.size();
+	return store;
+}
+
+hot_adj_list hot_vertex_store::get_adj_list(vertex_id_t id, edge_type type,
+		int node_id)
+{
+	std::unordered_map<vertex_id_t, hot_vertex_entry>::const_iterator it
+		= vertices.find(id);
+	assert(it != vertices.end());
+	const hot_vertex_entry &e = it->second;
+	replica &r = *replicas[node_id % replicas.size()];
+	hot_adj_list ret;
+	if (type == edge_type::OUT_EDGE && directed) {
+		ret.buf = r.data + e.out_loc;
+		ret.off = e.out_off;
+		ret.size = e.out_size;
+	}
+	else {
+		assert(type == edge_type::IN_EDGE);
+		ret.buf = r.data + e.in_loc;
+		ret.off = e.in_off;
+		ret.size = e.in_size;
+	}
+	r.num_hits.fetch_add(1, std::memory_order_relaxed);
+	r.num_hit_bytes.fetch_add(ret.size, std::memory_order_relaxed);
+	return ret;
+}
+
+size_t hot_vertex_store::get_num_hits() const
+{
+	size_t num_hits = 0;
+	for (size_t i = 0; i < replicas.size(); i++)
+		num_hits += replicas[i]->num_hits.load();
+	return num_hits;
+}
+
+size_t hot_vertex_store::get_num_hit_bytes() const
+{
+	size_t num_bytes = 0;
+	for (size_t i = 0; i < replicas.size(); i++)
+		num_bytes += replicas[i]->num_hit_bytes.load();
+	return num_bytes;
+}
+
+void hot_vertex_store::print_statistics() const
+{
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("The hot vertex store serves %1% adjacency lists (%2% bytes)")
+		% get_num_hits() % get_num_hit_bytes();
+	for (size_t i = 0; i < replicas.size(); i++)
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("\tcopy %1%: %2% hits")
+			% i % replicas[i]->num_hits.load();
+}
+
+}
@@ -0,0 +1,224 @@
+#ifndef __HOT_VERTEX_STORE_H__
+#define __HOT_VERTEX_STORE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+
+#include "cache.h"
+#include "io_interface.h"
+
+#include "FG_basic_types.h"
+#include "graph_file_header.h"
+#include "vertex.h"
+#include "bitmap.h"
+
+namespace fg
+{
+
+class in_mem_query_vertex_index;
+
+/*
+ * This byte array wraps the in-memory copy of an adjacency list in
+ * the hot vertex store. It reports the location of the adjacency list
+ * in the graph file, so it's processed in the same way as the byte arrays
+ * read from SAFS.
+ */
+class hot_byte_array: public safs::page_byte_array
+{
+	const char *buf;
+	off_t off;
+	size_t size;
+public:
+	hot_byte_array(safs::byte_array_allocator &alloc): page_byte_array(alloc) {
+		this->buf = NULL;
+		this->off = 0;
+		this->size = 0;
+	}
+
+	hot_byte_array(const char *buf, off_t off, size_t size,
+			safs::byte_array_allocator &alloc): page_byte_array(alloc) {
+		this->buf = buf;
+		this->off = off;
+		this->size = size;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	virtual safs::page_byte_array *clone() {
+		hot_byte_array *arr = (hot_byte_array *) get_allocator().alloc();
+		arr->buf = buf;
+		arr->off = off;
+		arr->size = size;
+		return arr;
+	}
+
+	virtual off_t get_offset() const {
+		return off;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return 0;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + idx * safs::PAGE_SIZE;
+	}
+};
+
+/*
+ * The location of an adjacency list in the hot vertex store.
+ */
+struct hot_adj_list
+{
+	const char *buf;
+	// The location of the adjacency list in the graph file.
+	off_t off;
+	size_t size;
+};
+
+/*
+ * This is an in-memory store of the adjacency lists of the vertices with
+ * the largest degrees. In a power-law graph, a small number of hub vertices
+ * account for a large fraction of all adjacency list requests, and their
+ * adjacency lists span many pages, which are evicted and read from SSDs
+ * repeatedly by the page cache. The store is built when the graph is loaded
+ * and keeps as many of the largest adjacency lists as fit in a memory budget.
+ * The requests for these adjacency lists are served from the store directly
+ * without issuing I/O to SAFS.
+ *
+ * The store can be replicated on each NUMA node, so that worker threads
+ * always read the adjacency lists from the local memory.
+ * The store is immutable once it's built, so it's shared by all engines
+ * created from the same graph.
+ */
+class hot_vertex_store
+{
+	struct hot_vertex_entry
+	{
+		// The location of the adjacency lists in the graph file.
+		off_t in_off;
+		off_t out_off;
+		size_t in_size;
+		size_t out_size;
+		// The location of the adjacency lists in the store.
+		size_t in_loc;
+		size_t out_loc;
+	};
+
+	/*
+	 * A copy of the store on a NUMA node and its statistics.
+	 */
+	struct replica
+	{
+		char *data;
+		std::atomic<size_t> num_hits;
+		std::atomic<size_t> num_hit_bytes;
+		// Avoid false sharing between the counters of different nodes.
+		char pad[64];
+
+		replica() {
+			data = NULL;
+			num_hits = 0;
+			num_hit_bytes = 0;
+		}
+	};
+
+	class array_allocator: public safs::byte_array_allocator
+	{
+	public:
+		virtual safs::page_byte_array *alloc() {
+			return new hot_byte_array(*this);
+		}
+
+		virtual void free(safs::page_byte_array *arr) {
+			delete (hot_byte_array *) arr;
+		}
+	};
+
+	bool directed;
+	size_t data_size;
+	bitmap hot_map;
+	std::unordered_map<vertex_id_t, hot_vertex_entry> vertices;
+	std::vector<std::unique_ptr<replica> > replicas;
+	array_allocator byte_arr_alloc;
+
+	hot_vertex_store(const graph_header &header, size_t num_vertices);
+
+	void select_vertices(const in_mem_query_vertex_index &index,
+			size_t num_vertices, size_t mem_budget);
+	void load(safs::file_io_factory::shared_ptr factory, bool replicate);
+public:
+	typedef std::shared_ptr<hot_vertex_store> ptr;
+
+	~hot_vertex_store();
+
+	/*
+	 * Build the store with the largest adjacency lists of the graph.
+	 * `mem_budget' is the memory size of a copy of the store in bytes.
+	 * If `replicate' is true, the store is copied to every NUMA node.
+	 */
+	static ptr create(const graph_header &header,
+			const in_mem_query_vertex_index &index,
+			safs::file_io_factory::shared_ptr factory, size_t mem_budget,
+			bool replicate);
+
+	bool is_hot(vertex_id_t id) const {
+		return id < hot_map.get_num_bits() && hot_map.get(id);
+	}
+
+	/*
+	 * Get the adjacency list of a hot vertex. For undirected vertices,
+	 * the edge type is always IN_EDGE.
+	 * The request is counted as a hit in the store.
+	 */
+	hot_adj_list get_adj_list(vertex_id_t id, edge_type type, int node_id);
+
+	safs::byte_array_allocator &get_array_allocator() {
+		return byte_arr_alloc;
+	}
+
+	size_t get_num_vertices() const {
+		return vertices.size();
+	}
+
+	size_t get_data_size() const {
+		return data_size;
+	}
+
+	size_t get_num_hits() const;
+	size_t get_num_hit_bytes() const;
+	void print_statistics() const;
+};
+
+}
+
+#endif
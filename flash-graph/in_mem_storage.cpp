@@ -75,6 +75,8 @@ in_mem_graph::ptr in_mem_graph::load_graph(const std::string &file_name)
 	graph_header *header = (graph_header *) data.first;
 	if (!header->is_graph_file() || !header->is_right_version())
 		throw wrong_format("wrong graph file or format version");
+	if (!header->is_right_vertex_id_size())
+		throw wrong_format("wrong vertex ID size in the graph file");
 	return graph;
 }
 
@@ -99,6 +101,8 @@ in_mem_graph::ptr in_mem_graph::load_safs_graph(const std::string &file_name)
 	graph_header *header = (graph_header *) data.first;
 	if (!header->is_graph_file() || !header->is_right_version())
 		throw wrong_format("wrong graph file or format version");
+	if (!header->is_right_vertex_id_size())
+		throw wrong_format("wrong vertex ID size in the graph file");
 	return graph;
 }
 
@@ -113,4 +117,9 @@ void in_mem_graph::dump(const std::string &file) const
 	graph_data->dump(file);
 }
 
+void in_mem_graph::dump_safs(const std::string &file) const
+{
+	graph_data->dump_safs(file);
+}
+
 }
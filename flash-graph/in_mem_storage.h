@@ -64,10 +64,15 @@ public:
 		return ptr(g);
 	}
 
+	size_t get_size() const {
+		return graph_size;
+	}
+
 	static ptr load_graph(const std::string &graph_file);
 	static ptr load_safs_graph(const std::string &graph_file);
 
 	void dump(const std::string &file) const;
+	void dump_safs(const std::string &file) const;
 
 	std::shared_ptr<safs::file_io_factory> create_io_factory() const;
 };
@@ -0,0 +1,136 @@
+#ifndef __LEVEL_PROFILE_H__
+#define __LEVEL_PROFILE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+
+namespace fg
+{
+
+/**
+ * \brief The counters of a worker thread in a level. They are collected
+ *        only if the levels are profiled.
+ *
+ * The time of a level is split into the time of running user code on
+ * vertices, the time of issuing and waiting for I/O, the time of processing
+ * messages, the time of stealing vertices from other threads and the time
+ * of waiting for other threads at the end of the level. The rest of the time
+ * is spent in scheduling vertices and waiting for the vertices of other
+ * threads to complete.
+ */
+struct level_profile
+{
+	int level;
+	int worker_id;
+	double seconds;
+	// The time of running vertices, on their adjacency lists or without.
+	double compute_seconds;
+	// The vertices run on adjacency lists when their I/O completes, so
+	// this excludes the time of running vertices.
+	double io_seconds;
+	double msg_seconds;
+	double steal_seconds;
+	double barrier_seconds;
+	// The number of activated vertices processed by the thread.
+	size_t num_vertices;
+	size_t num_stolen;
+	// The adjacency list requests issued to SAFS.
+	size_t num_reqs;
+	size_t num_bytes;
+	// The number of messages sent by the vertices.
+	size_t num_msgs;
+
+	level_profile() {
+		level = 0;
+		worker_id = 0;
+		seconds = 0;
+		compute_seconds = 0;
+		io_seconds = 0;
+		msg_seconds = 0;
+		steal_seconds = 0;
+		barrier_seconds = 0;
+		num_vertices = 0;
+		num_stolen = 0;
+		num_reqs = 0;
+		num_bytes = 0;
+		num_msgs = 0;
+	}
+
+	bool operator<(const level_profile &prof) const {
+		if (level != prof.level)
+			return level < prof.level;
+		return worker_id < prof.worker_id;
+	}
+
+	void print_json(FILE *f) const {
+		fprintf(f, "{\"level\": %d, \"worker\": %d, \"seconds\": %f, ",
+				level, worker_id, seconds);
+		fprintf(f, "\"compute\": %f, \"io\": %f, \"msg\": %f, \"steal\": %f, ",
+				compute_seconds, io_seconds, msg_seconds, steal_seconds);
+		fprintf(f, "\"barrier\": %f, \"vertices\": %ld, \"stolen\": %ld, ",
+				barrier_seconds, num_vertices, num_stolen);
+		fprintf(f, "\"reqs\": %ld, \"bytes\": %ld, \"msgs\": %ld}",
+				num_reqs, num_bytes, num_msgs);
+	}
+};
+
+static inline double get_prof_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This adds the time of a scope to a counter. It doesn't do anything if
+ * the counter is NULL, i.e., the levels aren't profiled. The time of
+ * running vertices in the scope, which is accumulated in `nested', is
+ * excluded.
+ */
+class prof_timer
+{
+	double *seconds;
+	const double *nested;
+	double nested_start;
+	double start;
+public:
+	prof_timer(double *seconds, const double *nested = NULL) {
+		this->seconds = seconds;
+		this->nested = nested;
+		if (seconds) {
+			nested_start = nested ? *nested : 0;
+			start = get_prof_time();
+		}
+	}
+
+	~prof_timer() {
+		if (seconds) {
+			*seconds += get_prof_time() - start;
+			if (nested)
+				*seconds -= *nested - nested_start;
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file computes weakly connected components with Afforest.
+ * Instead of propagating component IDs through messages, which takes as
+ * many iterations as the diameter of a component, we keep a parent array
+ * in memory and link vertices with a lock-free union-find.
+ *
+ * In the first pass, each vertex links itself with a few of its neighbors.
+ * This is usually enough to put most of the vertices in the giant component.
+ * In the second pass, only the vertices outside the giant component read
+ * their edge lists and link with all of their neighbors. An edge between
+ * two vertices in the giant component can't change anything, so every
+ * remaining edge is seen by at least one of its endpoints.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+
+using namespace fg;
+
+namespace {
+
+/*
+ * The number of vertices we sample to find the giant component.
+ */
+const int NUM_GIANT_SAMPLES = 1024;
+
+enum afforest_phase
+{
+	SAMPLE,
+	FINISH,
+};
+
+/*
+ * The union-find forest shared by all worker threads.
+ * A root always has the smallest vertex ID in its tree, so the component ID
+ * of a vertex is the smallest vertex ID in its component, the same as
+ * the one computed by the label propagation.
+ */
+class afforest_forest
+{
+	std::vector<vertex_id_t> parents;
+public:
+	afforest_forest(size_t num_vertices): parents(num_vertices) {
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			parents[i] = i;
+	}
+
+	vertex_id_t get_parent(vertex_id_t id) const {
+		return parents[id];
+	}
+
+	/*
+	 * Hook the root with the larger ID to the root with the smaller ID.
+	 * If another thread changes a root under us, the CAS fails and we
+	 * climb up again.
+	 */
+	void link(vertex_id_t u, vertex_id_t v) {
+		vertex_id_t p1 = parents[u];
+		vertex_id_t p2 = parents[v];
+		while (p1 != p2) {
+			vertex_id_t high = std::max(p1, p2);
+			vertex_id_t low = std::min(p1, p2);
+			vertex_id_t p_high = parents[high];
+			if (p_high == low || (p_high == high
+						&& __sync_bool_compare_and_swap(&parents[high],
+							high, low)))
+				break;
+			p1 = parents[parents[high]];
+			p2 = parents[low];
+		}
+	}
+
+	/*
+	 * Point every vertex to the root of its tree. It's only called
+	 * when no thread is linking.
+	 */
+	void compress() {
+#pragma omp parallel for
+		for (size_t i = 0; i < parents.size(); i++) {
+			while (parents[i] != parents[parents[i]])
+				parents[i] = parents[parents[i]];
+		}
+	}
+
+	/*
+	 * Find the component with the most vertices among some random vertices.
+	 * It should be called after `compress'.
+	 */
+	vertex_id_t sample_giant() const {
+		std::unordered_map<vertex_id_t, size_t> counts;
+		vertex_id_t giant = 0;
+		size_t max_count = 0;
+		for (int i = 0; i < NUM_GIANT_SAMPLES; i++) {
+			vertex_id_t comp = parents[random() % parents.size()];
+			size_t count = ++counts[comp];
+			if (count > max_count) {
+				max_count = count;
+				giant = comp;
+			}
+		}
+		return giant;
+	}
+};
+
+class afforest_vertex: public compute_directed_vertex
+{
+public:
+	afforest_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg) {
+	}
+};
+
+class afforest_vertex_program: public vertex_program_impl<afforest_vertex>
+{
+	afforest_forest &forest;
+	afforest_phase phase;
+	int num_samples;
+public:
+	afforest_vertex_program(afforest_forest &_forest, afforest_phase phase,
+			int num_samples): forest(_forest) {
+		this->phase = phase;
+		this->num_samples = num_samples;
+	}
+
+	afforest_forest &get_forest() {
+		return forest;
+	}
+
+	afforest_phase get_phase() const {
+		return phase;
+	}
+
+	int get_num_samples() const {
+		return num_samples;
+	}
+};
+
+class afforest_vertex_program_creater: public vertex_program_creater
+{
+	afforest_forest &forest;
+	afforest_phase phase;
+	int num_samples;
+public:
+	afforest_vertex_program_creater(afforest_forest &_forest,
+			afforest_phase phase, int num_samples): forest(_forest) {
+		this->phase = phase;
+		this->num_samples = num_samples;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new afforest_vertex_program(forest,
+					phase, num_samples));
+	}
+};
+
+void afforest_vertex::run(vertex_program &prog)
+{
+	afforest_vertex_program &aprog = (afforest_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	graph_engine &graph = prog.get_graph();
+	// Sampling only needs the beginning of the out-edge list. Every edge
+	// shows up in an out-edge list, so it doesn't need the in-edges.
+	if (aprog.get_phase() == SAMPLE) {
+		if (graph.get_num_edges(id, OUT_EDGE) == 0)
+			return;
+		if (graph.is_directed()) {
+			directed_vertex_request req(id, OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
+void afforest_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	afforest_vertex_program &aprog = (afforest_vertex_program &) prog;
+	afforest_forest &forest = aprog.get_forest();
+	vertex_id_t id = vertex.get_id();
+	size_t num_samples = aprog.get_num_samples();
+	if (aprog.get_phase() == SAMPLE) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0,
+				num_samples);
+		while (it.has_next())
+			forest.link(id, it.next());
+		return;
+	}
+
+	// The sampled out-edges have been linked in the first pass.
+	size_t num_out = vertex.get_num_edges(OUT_EDGE);
+	edge_seq_iterator out_it = vertex.get_neigh_seq_it(OUT_EDGE,
+			std::min(num_samples, num_out), num_out);
+	while (out_it.has_next())
+		forest.link(id, out_it.next());
+	// The in-edges of a vertex may come from the giant component, whose
+	// vertices don't read their edge lists in this pass.
+	if (prog.get_graph().is_directed()) {
+		edge_seq_iterator in_it = vertex.get_neigh_seq_it(IN_EDGE);
+		while (in_it.has_next())
+			forest.link(id, in_it.next());
+	}
+}
+
+/*
+ * Only the vertices outside the giant component need to see all of
+ * their edges.
+ */
+class non_giant_filter: public vertex_filter
+{
+	afforest_forest &forest;
+	vertex_id_t giant;
+public:
+	non_giant_filter(afforest_forest &_forest,
+			vertex_id_t giant): forest(_forest) {
+		this->giant = giant;
+	}
+
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vertex_id_t id = prog.get_vertex_id(v);
+		return forest.get_parent(id) != giant
+			&& prog.get_graph().get_num_edges(id) > 0;
+	}
+};
+
+}
+
+namespace fg
+{
+
+FG_vector<vertex_id_t>::ptr compute_wcc_afforest(FG_graph::ptr fg,
+		int num_samples)
+{
+	graph_index::ptr index = NUMA_graph_index<afforest_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << "Afforest weakly connected components starts";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	afforest_forest forest(graph->get_num_vertices());
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new afforest_vertex_program_creater(forest, SAMPLE,
+					num_samples)));
+	graph->wait4complete();
+	forest.compress();
+	vertex_id_t giant = forest.sample_giant();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("sampling %1% neighbors takes %2% seconds, giant component: %3%")
+		% num_samples % time_diff(start, end) % giant;
+
+	graph->start(std::shared_ptr<vertex_filter>(
+				new non_giant_filter(forest, giant)),
+			vertex_program_creater::ptr(new afforest_vertex_program_creater(
+					forest, FINISH, num_samples)));
+	graph->wait4complete();
+	forest.compress();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("WCC takes %1% seconds in total")
+		% time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	// Empty vertices don't belong to any component, as in `compute_wcc'.
+	FG_vector<vertex_id_t>::ptr vec = FG_vector<vertex_id_t>::create(graph);
+#pragma omp parallel for
+	for (size_t i = 0; i < vec->get_size(); i++) {
+		if (graph->get_num_edges(i) == 0)
+			vec->set(i, INVALID_VERTEX_ID);
+		else
+			vec->set(i, forest.get_parent(i));
+	}
+	return vec;
+}
+
+}
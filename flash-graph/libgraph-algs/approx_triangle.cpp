@@ -0,0 +1,567 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file estimates the number of triangles and the transitivity
+ * (the global clustering coefficient) of an undirected graph by sampling.
+ *
+ * Both estimators decide the number of samples on each vertex from
+ * the degrees in the in-memory vertex index, so only the vertices that
+ * get samples and the neighbors needed to check the samples are read
+ * from the graph. The engine reads whole adjacency lists, so the I/O is
+ * the size of the adjacency lists of these vertices. A vertex takes at
+ * most MAX_SAMPLES_PER_VERTEX samples, which bounds the memory and
+ * the number of neighbors read for a high-degree vertex. If a vertex
+ * draws more samples, each of the samples it takes stands for several
+ * ones, and the estimators weight the samples accordingly.
+ *
+ * Wedge sampling: a wedge is a path of length two. A vertex of degree d
+ * is the center of d(d-1)/2 wedges. Each wedge is sampled uniformly and
+ * we check whether the edge between its two ends exists. The fraction of
+ * closed wedges is the transitivity, and the number of triangles is
+ * the transitivity * the number of wedges / 3.
+ *
+ * Edge sampling: each edge (u, v) is sampled uniformly and we count
+ * the common neighbors of u and v, which is the number of triangles on
+ * the edge. Each triangle appears on six edge slots (an undirected edge
+ * appears in the adjacency lists of both of its ends), so the number of
+ * triangles is the mean count * the number of edge slots / 6.
+ */
+
+#include <random>
+
+#include <boost/math/distributions/normal.hpp>
+
+#include "FGlib.h"
+#include "graph_engine.h"
+#include "sorted_intersect.h"
+
+using namespace fg;
+
+namespace {
+
+triangle_sampling_method sampling_method;
+double sample_rate;
+uint64_t sample_seed;
+
+const size_t MAX_SAMPLES_PER_VERTEX = 1024;
+
+/*
+ * A small random number generator whose state is created from a vertex ID.
+ * It allows us to generate the same samples for a vertex regardless of
+ * the thread that runs the vertex, and it's cheap to create one for
+ * every vertex. This is splitmix64.
+ */
+class sample_rng
+{
+	uint64_t state;
+public:
+	typedef uint64_t result_type;
+
+	sample_rng(uint64_t seed, vertex_id_t id, uint64_t stream) {
+		state = seed ^ (((uint64_t) id) * 0x9E3779B97F4A7C15UL) ^ (stream << 56);
+	}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return UINT64_MAX;
+	}
+
+	result_type operator()() {
+		uint64_t z = (state += 0x9E3779B97F4A7C15UL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+		return z ^ (z >> 31);
+	}
+
+	/*
+	 * Get a random number in [0, range).
+	 */
+	size_t get(size_t range) {
+		return (*this)() % range;
+	}
+};
+
+/*
+ * The samples of a vertex that wait for the adjacency lists of
+ * its neighbors.
+ */
+struct sample_data_t
+{
+	// Wedge sampling: the first vertex is the end of a wedge to read and
+	// the second one is the other end to search for.
+	// Edge sampling: the first vertex is the sampled neighbor to read.
+	std::vector<std::pair<vertex_id_t, vertex_id_t> > checks;
+	// The unique neighbors of the vertex, used in edge sampling.
+	std::vector<vertex_id_t> edges;
+	// The weight of each sample of the vertex.
+	double weight;
+	size_t num_pending;
+};
+
+class approx_triangle_vertex: public compute_vertex
+{
+	vsize_t num_samples;
+	sample_data_t *data;
+public:
+	approx_triangle_vertex(vertex_id_t id): compute_vertex(id) {
+		num_samples = 0;
+		data = NULL;
+	}
+
+	void set_num_samples(vsize_t num_samples) {
+		this->num_samples = num_samples;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (vertex.get_id() == prog.get_vertex_id(*this)) {
+			if (sampling_method == triangle_sampling_method::WEDGE_SAMPLING)
+				sample_wedges(prog, vertex);
+			else
+				sample_edges(prog, vertex);
+		}
+		else {
+			if (sampling_method == triangle_sampling_method::WEDGE_SAMPLING)
+				check_wedges(prog, vertex);
+			else
+				check_edges(prog, vertex);
+		}
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &msg) {
+	}
+
+	void sample_wedges(vertex_program &prog, const page_vertex &vertex);
+	void sample_edges(vertex_program &prog, const page_vertex &vertex);
+	void check_wedges(vertex_program &prog, const page_vertex &vertex);
+	void check_edges(vertex_program &prog, const page_vertex &vertex);
+	void request_checks(vertex_program &prog);
+	void complete_check();
+};
+
+class approx_triangle_vertex_program: public vertex_program_impl<approx_triangle_vertex>
+{
+	// The population the samples are drawn from.
+	double num_wedges;
+	double num_edge_slots;
+	// The statistics of the weighted samples.
+	size_t num_samples;
+	double sum_weight;
+	double sum_weight_sq;
+	double sum;
+	double sum_sq;
+	// The buffer for the adjacency list of a neighbor.
+	std::vector<vertex_id_t> neigh_edges;
+public:
+	typedef std::shared_ptr<approx_triangle_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<approx_triangle_vertex_program,
+			   vertex_program>(prog);
+	}
+
+	approx_triangle_vertex_program() {
+		num_wedges = 0;
+		num_edge_slots = 0;
+		num_samples = 0;
+		sum_weight = 0;
+		sum_weight_sq = 0;
+		sum = 0;
+		sum_sq = 0;
+	}
+
+	void add_vertex(vsize_t degree) {
+		num_wedges += ((double) degree) * (degree - 1) / 2;
+		num_edge_slots += degree;
+	}
+
+	void add_sample(double val, double weight) {
+		num_samples++;
+		sum_weight += weight;
+		sum_weight_sq += weight * weight;
+		sum += val * weight;
+		sum_sq += val * val * weight;
+	}
+
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neigh_edges;
+	}
+
+	double get_num_wedges() const {
+		return num_wedges;
+	}
+
+	double get_num_edge_slots() const {
+		return num_edge_slots;
+	}
+
+	size_t get_num_samples() const {
+		return num_samples;
+	}
+
+	double get_sum_weight() const {
+		return sum_weight;
+	}
+
+	double get_sum_weight_sq() const {
+		return sum_weight_sq;
+	}
+
+	double get_sum() const {
+		return sum;
+	}
+
+	double get_sum_sq() const {
+		return sum_sq;
+	}
+};
+
+class approx_triangle_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new approx_triangle_vertex_program());
+	}
+};
+
+/*
+ * Draw the number of samples on a vertex. The number follows the Poisson
+ * distribution whose mean is the sample rate * the number of wedges (or
+ * edges) on the vertex, so every wedge (or edge) in the graph is sampled
+ * independently with the same rate. The number only depends on the vertex,
+ * so we can draw it again when the vertex takes the samples.
+ */
+static size_t draw_num_samples(vertex_id_t id, size_t degree)
+{
+	double population;
+	if (sampling_method == triangle_sampling_method::WEDGE_SAMPLING)
+		population = ((double) degree) * (degree - 1) / 2;
+	else
+		population = degree;
+	if (population == 0)
+		return 0;
+
+	sample_rng rng(sample_seed, id, 0);
+	std::poisson_distribution<size_t> dist(population * sample_rate);
+	return dist(rng);
+}
+
+/*
+ * This filter draws the number of samples on each vertex and activates
+ * the vertices with samples.
+ */
+class sample_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		approx_triangle_vertex_program &tprog
+			= (approx_triangle_vertex_program &) prog;
+		vertex_id_t id = prog.get_vertex_id(v);
+		vsize_t degree = prog.get_num_edges(id);
+		tprog.add_vertex(degree);
+
+		size_t num_samples = std::min(draw_num_samples(id, degree),
+				MAX_SAMPLES_PER_VERTEX);
+		((approx_triangle_vertex &) v).set_num_samples(num_samples);
+		return num_samples > 0;
+	}
+};
+
+/*
+ * Get the weight of each sample the vertex takes.
+ */
+static double get_sample_weight(vertex_id_t id, size_t degree,
+		size_t num_samples)
+{
+	return ((double) draw_num_samples(id, degree)) / num_samples;
+}
+
+void approx_triangle_vertex::request_checks(vertex_program &prog)
+{
+	if (data->checks.empty()) {
+		delete data;
+		data = NULL;
+		return;
+	}
+
+	std::sort(data->checks.begin(), data->checks.end());
+	std::vector<vertex_id_t> ids;
+	for (size_t i = 0; i < data->checks.size(); i++) {
+		if (ids.empty() || ids.back() != data->checks[i].first)
+			ids.push_back(data->checks[i].first);
+	}
+	data->num_pending = ids.size();
+	request_vertices(ids.data(), ids.size());
+}
+
+void approx_triangle_vertex::complete_check()
+{
+	assert(data->num_pending > 0);
+	data->num_pending--;
+	if (data->num_pending == 0) {
+		delete data;
+		data = NULL;
+	}
+}
+
+void approx_triangle_vertex::sample_wedges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	approx_triangle_vertex_program &tprog
+		= (approx_triangle_vertex_program &) prog;
+	vertex_id_t id = vertex.get_id();
+	size_t degree = vertex.get_num_edges(edge_type::OUT_EDGE);
+	assert(degree >= 2);
+	assert(data == NULL);
+	data = new sample_data_t();
+
+	double weight = get_sample_weight(id, degree, num_samples);
+	data->weight = weight;
+	data->checks.reserve(num_samples);
+	sample_rng rng(sample_seed, id, 1);
+	edge_iterator begin = vertex.get_neigh_begin(edge_type::OUT_EDGE);
+	for (vsize_t i = 0; i < num_samples; i++) {
+		// Pick two different edges of the vertex.
+		size_t idx1 = rng.get(degree);
+		size_t idx2 = rng.get(degree - 1);
+		if (idx2 >= idx1)
+			idx2++;
+		vertex_id_t end1 = *(begin + idx1);
+		vertex_id_t end2 = *(begin + idx2);
+		// The wedges formed by loops and duplicated edges can't be closed.
+		if (end1 == end2 || end1 == id || end2 == id) {
+			tprog.add_sample(0, weight);
+			continue;
+		}
+		// We search in the adjacency list of the end with fewer edges.
+		if (prog.get_num_edges(end1) > prog.get_num_edges(end2))
+			std::swap(end1, end2);
+		data->checks.push_back(std::pair<vertex_id_t, vertex_id_t>(end1, end2));
+	}
+	num_samples = 0;
+	request_checks(prog);
+}
+
+void approx_triangle_vertex::check_wedges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	approx_triangle_vertex_program &tprog
+		= (approx_triangle_vertex_program &) prog;
+	assert(data);
+	std::vector<std::pair<vertex_id_t, vertex_id_t> >::const_iterator it
+		= std::lower_bound(data->checks.begin(), data->checks.end(),
+				std::pair<vertex_id_t, vertex_id_t>(vertex.get_id(), 0));
+	edge_iterator begin = vertex.get_neigh_begin(edge_type::OUT_EDGE);
+	edge_iterator end = vertex.get_neigh_end(edge_type::OUT_EDGE);
+	// The other ends are sorted, so we can narrow the search range.
+	for (; it != data->checks.end() && it->first == vertex.get_id(); it++) {
+		begin = std::lower_bound(begin, end, it->second);
+		tprog.add_sample(begin != end && *begin == it->second, data->weight);
+	}
+	complete_check();
+}
+
+void approx_triangle_vertex::sample_edges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	approx_triangle_vertex_program &tprog
+		= (approx_triangle_vertex_program &) prog;
+	vertex_id_t id = vertex.get_id();
+	size_t degree = vertex.get_num_edges(edge_type::OUT_EDGE);
+	assert(degree >= 1);
+	assert(data == NULL);
+	data = new sample_data_t();
+
+	double weight = get_sample_weight(id, degree, num_samples);
+	data->weight = weight;
+	data->checks.reserve(num_samples);
+	sample_rng rng(sample_seed, id, 1);
+	edge_iterator begin = vertex.get_neigh_begin(edge_type::OUT_EDGE);
+	for (vsize_t i = 0; i < num_samples; i++) {
+		vertex_id_t neigh = *(begin + rng.get(degree));
+		// A loop isn't in any triangle.
+		if (neigh == id)
+			tprog.add_sample(0, weight);
+		else
+			data->checks.push_back(std::pair<vertex_id_t, vertex_id_t>(neigh, 0));
+	}
+	num_samples = 0;
+
+	// We need the unique neighbors of the vertex to count the common
+	// neighbors with the sampled neighbors. The vertex itself isn't
+	// its own neighbor.
+	if (!data->checks.empty()) {
+		data->edges.resize(degree);
+		vertex.read_edges(edge_type::OUT_EDGE, data->edges.data(), degree);
+		data->edges.resize(std::unique(data->edges.begin(),
+					data->edges.end()) - data->edges.begin());
+		std::vector<vertex_id_t>::iterator self = std::lower_bound(
+				data->edges.begin(), data->edges.end(), id);
+		if (self != data->edges.end() && *self == id)
+			data->edges.erase(self);
+	}
+	request_checks(prog);
+}
+
+void approx_triangle_vertex::check_edges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	approx_triangle_vertex_program &tprog
+		= (approx_triangle_vertex_program &) prog;
+	assert(data);
+	vertex_id_t neigh_id = vertex.get_id();
+	std::vector<vertex_id_t> &neigh_edges = tprog.get_neigh_buf();
+	neigh_edges.resize(vertex.get_num_edges(edge_type::OUT_EDGE));
+	vertex.read_edges(edge_type::OUT_EDGE, neigh_edges.data(),
+			neigh_edges.size());
+	size_t num_common = sorted_intersect_count(data->edges.data(),
+			data->edges.size(), neigh_edges.data(), neigh_edges.size());
+	// The loops on the neighbor don't form triangles.
+	num_common -= std::upper_bound(neigh_edges.begin(), neigh_edges.end(),
+			neigh_id) - std::lower_bound(neigh_edges.begin(),
+			neigh_edges.end(), neigh_id);
+
+	std::pair<std::vector<std::pair<vertex_id_t, vertex_id_t> >::const_iterator,
+		std::vector<std::pair<vertex_id_t, vertex_id_t> >::const_iterator> range
+			= std::equal_range(data->checks.begin(), data->checks.end(),
+					std::pair<vertex_id_t, vertex_id_t>(neigh_id, 0));
+	for (; range.first != range.second; range.first++)
+		tprog.add_sample(num_common, data->weight);
+	complete_check();
+}
+
+}
+
+namespace fg
+{
+
+approx_triangle_count estimate_triangles(FG_graph::ptr fg, double rate,
+		triangle_sampling_method method, double confidence)
+{
+	if (fg->get_graph_header().is_directed_graph())
+		throw unsupported_exception(
+				"triangle estimation only works on undirected graphs");
+	if (rate <= 0 || rate > 1)
+		throw invalid_arg_exception("the sample rate has to be in (0, 1]");
+	if (confidence <= 0 || confidence >= 1)
+		throw invalid_arg_exception("the confidence level has to be in (0, 1)");
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"triangle estimation with %1% sampling starts, sample rate: %2%")
+		% (method == triangle_sampling_method::WEDGE_SAMPLING ? "wedge" : "edge")
+		% rate;
+	graph_index::ptr index = NUMA_graph_index<approx_triangle_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	sampling_method = method;
+	sample_rate = rate;
+	sample_seed = (((uint64_t) random()) << 32) | random();
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start(std::shared_ptr<vertex_filter>(new sample_filter()),
+			vertex_program_creater::ptr(
+				new approx_triangle_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+
+	double num_wedges = 0;
+	double num_edge_slots = 0;
+	size_t num_samples = 0;
+	double sum_weight = 0;
+	double sum_weight_sq = 0;
+	double sum = 0;
+	double sum_sq = 0;
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		approx_triangle_vertex_program::ptr tprog
+			= approx_triangle_vertex_program::cast2(vprog);
+		num_wedges += tprog->get_num_wedges();
+		num_edge_slots += tprog->get_num_edge_slots();
+		num_samples += tprog->get_num_samples();
+		sum_weight += tprog->get_sum_weight();
+		sum_weight_sq += tprog->get_sum_weight_sq();
+		sum += tprog->get_sum();
+		sum_sq += tprog->get_sum_sq();
+	}
+
+	approx_triangle_count res;
+	memset(&res, 0, sizeof(res));
+	res.num_samples = num_samples;
+	if (num_samples == 0 || num_wedges == 0) {
+		BOOST_LOG_TRIVIAL(info) << "triangle estimation doesn't get any samples";
+		return res;
+	}
+
+	double z = boost::math::quantile(boost::math::normal(),
+			1 - (1 - confidence) / 2);
+	double mean = sum / sum_weight;
+	// The effective number of samples. It's the number of samples if
+	// no vertex draws more than MAX_SAMPLES_PER_VERTEX samples.
+	double n = sum_weight * sum_weight / sum_weight_sq;
+	// The estimated transitivity and its confidence interval.
+	double trans, trans_lower, trans_upper;
+	if (method == triangle_sampling_method::WEDGE_SAMPLING) {
+		// Each sample is a Bernoulli trial, so we use the Wilson score
+		// interval, which is still valid when few wedges are closed.
+		double denom = 1 + z * z / n;
+		double center = (mean + z * z / (2 * n)) / denom;
+		double half = z * sqrt(mean * (1 - mean) / n + z * z / (4 * n * n))
+			/ denom;
+		trans = mean;
+		trans_lower = std::max(center - half, 0.0);
+		trans_upper = std::min(center + half, 1.0);
+	}
+	else {
+		// The number of triangles on an edge isn't bounded, so we use
+		// the normal approximation of the sample mean.
+		double var = 0;
+		if (n > 1)
+			var = std::max(sum_sq / sum_weight - mean * mean, 0.0) * n / (n - 1);
+		double half = z * sqrt(var / n);
+		double scale = num_edge_slots / 2 / num_wedges;
+		trans = mean * scale;
+		trans_lower = std::max(mean - half, 0.0) * scale;
+		trans_upper = std::min((mean + half) * scale, 1.0);
+	}
+	res.transitivity = trans;
+	res.transitivity_lower = trans_lower;
+	res.transitivity_upper = trans_upper;
+	res.num_triangles = trans * num_wedges / 3;
+	res.num_triangles_lower = trans_lower * num_wedges / 3;
+	res.num_triangles_upper = trans_upper * num_wedges / 3;
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"triangle estimation takes %1% seconds with %2% samples: %3% triangles in [%4%, %5%], transitivity %6% in [%7%, %8%]")
+		% time_diff(start, end) % num_samples % res.num_triangles
+		% res.num_triangles_lower % res.num_triangles_upper
+		% res.transitivity % res.transitivity_lower % res.transitivity_upper;
+	return res;
+}
+
+}
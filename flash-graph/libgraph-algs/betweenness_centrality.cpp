@@ -33,14 +33,26 @@
 #include "FGlib.h"
 #include "FG_vector.h"
 #include "save_result.h"
+#include "ms_bfs.h"
 
 using namespace fg;
 
+/*
+ * This computes betweenness centrality with Brandes' algorithm. It runs
+ * the BFS and the back propagation of a batch of source vertices together
+ * in the style of multi-source BFS: each vertex keeps a bitmap of the
+ * sources that have reached it, and a vertex reads its adjacency list
+ * once in a level for all sources in the batch whose frontier (or whose
+ * back propagation) is at the vertex.
+ */
+
 namespace {
+typedef source_set<1> bc_source_set;
+
 short bfs_max_dist;
 
-/* `update` phase is where BC is updated */ 
-vertex_id_t g_source_vertex;
+/* The source vertices in the current batch. */
+std::vector<vertex_id_t> g_sources;
 enum btwn_phase_t
 {
 	bfs,
@@ -50,28 +62,59 @@ enum btwn_phase_t
 
 btwn_phase_t g_alg_phase = bfs;
 
-class betweenness_vertex: public compute_directed_vertex
+/*
+ * The state of a vertex in the BFS from a source.
+ */
+struct source_state
 {
-	float btwn_cent; // per-vertex btwn_cent
-	float delta;
 	int sigma;
+	float delta;
 	short dist;
-	bool bfs_visited;
+};
 
+class betweenness_vertex: public compute_directed_vertex
+{
+	float btwn_cent; // per-vertex btwn_cent
+	// The sources that have reached the vertex before the current level.
+	bc_source_set seen;
+	// The sources whose messages the vertex sends in the current level.
+	bc_source_set frontier;
+	// The sources that reach the vertex in the current level.
+	bc_source_set next;
+	// The states for the sources in the batch. They're allocated when
+	// the vertex is reached by any source and freed after the batch.
+	source_state *states;
+
+	void alloc_states() {
+		if (states == NULL)
+			states = new source_state[bc_source_set::MAX_SOURCES];
+	}
+
+	void request_edges(vertex_program &prog, edge_type type) {
+		directed_vertex_request req(prog.get_vertex_id(*this), type);
+		request_partial_vertices(&req, 1);
+	}
+
+	void run_on_bfs_message(vertex_program &prog, const vertex_message &msg1);
+	void run_on_bp_message(vertex_program &prog, const vertex_message &msg1);
 	public:
 	betweenness_vertex(vertex_id_t id): compute_directed_vertex(id) {
 		btwn_cent = 0;
-		delta = 0; 
-		sigma = 0 ;
-		dist = -1; 
-		bfs_visited = false;
-	}
-
-	void init(int sigma, short dist) {
-		this->sigma = sigma;
-		this->dist = dist;	
-		this->delta = 0;
-		this->bfs_visited = false;
+		states = NULL;
+	}
+
+	void init(const bc_source_set &sources) {
+		alloc_states();
+		seen = sources;
+		frontier = sources;
+		next.clear();
+		for (size_t i = 0; i < g_sources.size(); i++) {
+			if (sources.test(i)) {
+				states[i].sigma = 1;
+				states[i].delta = 0;
+				states[i].dist = 0;
+			}
+		}
 	}
 
 	// Used for save_query join
@@ -79,28 +122,28 @@ class betweenness_vertex: public compute_directed_vertex
 		return btwn_cent;
 	}
 
-	short get_dist() const {
-		return dist;
-	}
-
-	void set_dist(short dist) {
-		this->dist = dist;
+	const source_state &get_state(int idx) const {
+		assert(seen.test(idx));
+		return states[idx];
 	}
 
-	void set_sigma(int sigma) {
-		this->sigma = sigma;
-	}
-
-	bool is_bfs_visited() const {
-		return bfs_visited;
-	} 
-	void set_visited(bool visited) {
-		this->bfs_visited = visited;
+	/*
+	 * Get the sources whose distance to the vertex is `dist'.
+	 */
+	bc_source_set get_sources_at(short dist) const {
+		bc_source_set ret;
+		if (states == NULL)
+			return ret;
+		for (size_t i = 0; i < g_sources.size(); i++)
+			if (seen.test(i) && states[i].dist == dist)
+				ret.set(i);
+		return ret;
 	}
 
 	void run(vertex_program &prog);
 	void run(vertex_program &prog, const page_vertex &vertex);
 	void run_on_message(vertex_program &, const vertex_message &msg1);
+	void notify_iteration_end(vertex_program &prog);
 };
 
 typedef std::shared_ptr<std::vector<vertex_id_t> > vertex_set_ptr;
@@ -212,58 +255,29 @@ class bp_vertex_program_creater: public vertex_program_creater
 	}
 };
 
-class bfs_message: public vertex_message
+/*
+ * The message of both phases. The receiver reads the state of the sender
+ * for the sources in the message directly, because the state of these
+ * sources in the sender doesn't change in the level.
+ */
+class btwn_message: public vertex_message
 {
+	bc_source_set sources;
 	vertex_id_t sender_id;
-	short parent_dist;
-	int parent_sigma;
 
 	public:
-	bfs_message(vertex_id_t id, short sender_dist, int sigma): 
-		vertex_message(sizeof(bfs_message), true) {
-			sender_id = id;
-			parent_dist = sender_dist;
-			parent_sigma = sigma;
-		}
-
-	const vertex_id_t get_sender_id() const {
-		return sender_id;
+	btwn_message(const bc_source_set &sources, vertex_id_t id,
+			bool activate): vertex_message(sizeof(btwn_message), activate) {
+		this->sources = sources;
+		this->sender_id = id;
 	}
 
-	const short get_parent_dist() const {
-		return parent_dist;
-	} 
-
-	const int get_parent_sigma() const {
-		return parent_sigma;
-	}
-};
-
-/** Back propagate message */
-class bp_message: public vertex_message
-{
-	float delta;
-	int sigma;
-	short dist;
-
-	public:
-	bp_message(short dist, float delta, int sigma): 
-		vertex_message(sizeof(bp_message), false) {
-			this->delta = delta;
-			this->sigma = sigma;
-			this->dist = dist;
-		}
-
-	const float get_sender_delta() const {
-		return delta;
-	} 
-
-	const int get_sender_sigma() const {
-		return sigma;
+	const bc_source_set &get_sources() const {
+		return sources;
 	}
 
-	const short get_sender_dist() const {
-		return dist;
+	vertex_id_t get_sender_id() const {
+		return sender_id;
 	}
 };
 
@@ -271,24 +285,38 @@ void betweenness_vertex::run(vertex_program &prog) {
 	switch (g_alg_phase) {
 		case btwn_phase_t::bfs:  
 			{
-				if (is_bfs_visited()) 
+				if (!frontier.any())
 					return; 
-				directed_vertex_request req(prog.get_vertex_id(*this), edge_type::OUT_EDGE);
-				request_partial_vertices(&req, 1);
+				request_edges(prog, edge_type::OUT_EDGE);
 				((bfs_vertex_program&)prog).
 					add_visited_bfs(prog.get_vertex_id(*this));
 				break;
 			}
 		case btwn_phase_t::back_prop: 
 			{
-				directed_vertex_request req(prog.get_vertex_id(*this), edge_type::IN_EDGE);
-				request_partial_vertices(&req, 1);
+				// The sources whose back propagation is at the vertex
+				// in this level.
+				short dist = bfs_max_dist - prog.get_graph().get_curr_level();
+				if (dist == 0)
+					return;
+				frontier = get_sources_at(dist);
+				if (frontier.any())
+					request_edges(prog, edge_type::IN_EDGE);
 				break;
 			}
 		case btwn_phase_t::bc_summation:
 			{
-				if (prog.get_vertex_id(*this) != g_source_vertex)
-					btwn_cent += delta;	
+				if (states == NULL)
+					return;
+				vertex_id_t id = prog.get_vertex_id(*this);
+				for (size_t i = 0; i < g_sources.size(); i++)
+					if (seen.test(i) && g_sources[i] != id)
+						btwn_cent += states[i].delta;	
+				delete [] states;
+				states = NULL;
+				seen.clear();
+				frontier.clear();
+				next.clear();
 				break;
 			}
 		default:
@@ -301,21 +329,22 @@ void betweenness_vertex::run(vertex_program &prog, const page_vertex &vertex)
 	switch (g_alg_phase) {
 		case btwn_phase_t::bfs :
 			{
-				bfs_visited = true;
+				btwn_message msg(frontier, vertex.get_id(), true);
+				frontier.clear();
 				int num_dests = vertex.get_num_edges(OUT_EDGE);
 				if (num_dests == 0) return;
 
 				edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0, num_dests);
-				bfs_message msg(vertex.get_id(), this->dist, this->sigma);
 				prog.multicast_msg(it, msg);
 				break;
 			}
 		case btwn_phase_t::back_prop :
 			{
 				/* NOTE: Sending to all in_neighs instead of only P's ... */
+				btwn_message msg(frontier, vertex.get_id(), false);
+				frontier.clear();
 				int num_dests = vertex.get_num_edges(IN_EDGE); 
 				edge_seq_iterator it = vertex.get_neigh_seq_it(IN_EDGE, 0, num_dests);
-				bp_message msg(this->dist, this->delta, this->sigma);
 				prog.multicast_msg(it, msg);
 				break;
 			}
@@ -327,53 +356,94 @@ void betweenness_vertex::run(vertex_program &prog, const page_vertex &vertex)
 void betweenness_vertex::run_on_message(vertex_program &prog, const vertex_message &msg1) {
 	switch (g_alg_phase) {
 		case btwn_phase_t::bfs:
-			{
-				const bfs_message &msg = (const bfs_message &) msg1;
-				if (this->dist < 0) { 
-					this->dist = msg.get_parent_dist() + 1;
-				}
-				if (this->dist == msg.get_parent_dist() + 1) {
-					this->sigma = this->sigma + msg.get_parent_sigma();
-				}
-				break;
-			}
+			run_on_bfs_message(prog, msg1);
+			break;
 		case btwn_phase_t::back_prop:
-			{
-				const bp_message &msg = (const bp_message &) msg1;
-				// Ignore this message if you're not a parent on the path
-				if (this->dist != msg.get_sender_dist() - 1) {
-					return;
-				}
-
-				// Now we know it's only parents
-				if (msg.get_sender_sigma() != 0) { // If msg.get_sender_sigma() == 0 do nothing
-					delta = delta + (((float)sigma/msg.get_sender_sigma()) 
-							* (1 + msg.get_sender_delta()));
-				} 
-				break;
-			}
+			run_on_bp_message(prog, msg1);
+			break;
 		default:
 			assert(0);
 	}
 }
 
+void betweenness_vertex::run_on_bfs_message(vertex_program &prog,
+		const vertex_message &msg1)
+{
+	const btwn_message &msg = (const btwn_message &) msg1;
+	bc_source_set added = msg.get_sources().minus(seen);
+	if (!added.any())
+		return;
+
+	const betweenness_vertex &sender = (const betweenness_vertex &)
+		prog.get_graph().get_vertex(msg.get_sender_id());
+	short dist = prog.get_graph().get_curr_level() + 1;
+	alloc_states();
+	for (size_t i = 0; i < g_sources.size(); i++) {
+		if (!added.test(i))
+			continue;
+		if (!next.test(i)) {
+			states[i].dist = dist;
+			states[i].sigma = 0;
+			states[i].delta = 0;
+		}
+		states[i].sigma += sender.get_state(i).sigma;
+	}
+	// The sources that reach the vertex in this level take effect after
+	// the level ends.
+	if (!next.any())
+		prog.request_notify_iter_end(*this);
+	next |= added;
+}
+
+void betweenness_vertex::run_on_bp_message(vertex_program &prog,
+		const vertex_message &msg1)
+{
+	const btwn_message &msg = (const btwn_message &) msg1;
+	const betweenness_vertex &sender = (const betweenness_vertex &)
+		prog.get_graph().get_vertex(msg.get_sender_id());
+	for (size_t i = 0; i < g_sources.size(); i++) {
+		if (!msg.get_sources().test(i) || !seen.test(i))
+			continue;
+		const source_state &child = sender.get_state(i);
+		// Ignore this message if you're not a parent on the path
+		if (states[i].dist != child.dist - 1)
+			continue;
+		// Now we know it's only parents
+		if (child.sigma != 0) {
+			states[i].delta = states[i].delta + (((float) states[i].sigma
+						/ child.sigma) * (1 + child.delta));
+		}
+	}
+}
+
+void betweenness_vertex::notify_iteration_end(vertex_program &prog)
+{
+	seen |= next;
+	frontier = next;
+	next.clear();
+}
+
 class btwn_initializer: public vertex_initializer
 {
-	compute_vertex* source_vertex;
+	std::unordered_map<vertex_id_t, bc_source_set> start_vertices;
+	graph_engine &graph;
 	public:
-	btwn_initializer(compute_vertex *v) {
-		source_vertex = v;
+	btwn_initializer(const std::unordered_map<vertex_id_t,
+			bc_source_set> &vertices, graph_engine &_graph): graph(_graph) {
+		start_vertices = vertices;
 	}
 
 	virtual void init(compute_vertex &v) {
 		betweenness_vertex &bv = (betweenness_vertex &) v;
-		&v == source_vertex ? bv.init(1,0) : bv.init(0,-1); // sigma, dist
+		std::unordered_map<vertex_id_t, bc_source_set>::const_iterator it
+			= start_vertices.find(graph.get_graph_index().get_vertex_id(v));
+		assert(it != start_vertices.end());
+		bv.init(it->second);
 	}
 };
 
 /** For back prop phase where we activate vertices 
-  with only dist = max_dist. Also resets the bfs bit
-  to unvisited.
+  with only dist = max_dist.
   */
 class activate_by_dist_filter: public vertex_filter {
 	short dist;
@@ -384,9 +454,7 @@ class activate_by_dist_filter: public vertex_filter {
 	} 
 	bool keep(vertex_program &prog, compute_vertex &v) {
 		betweenness_vertex &bv = (betweenness_vertex &) v;
-		bool is_max_v = bv.get_dist() == dist;
-
-		return is_max_v;
+		return bv.get_sources_at(dist).any();
 	}
 };
 }
@@ -416,18 +484,32 @@ FG_vector<float>::ptr compute_betweenness_centrality(FG_graph::ptr fg, const std
 	struct timeval start, end;
 	gettimeofday(&start, NULL);
 
+	std::vector<vertex_id_t> sources;
 	BOOST_FOREACH (vertex_id_t id , ids) {
-		if (!graph->get_num_edges(id))
-		   continue;	
-
-		g_source_vertex = id;
-		bfs_max_dist = 0; // Must reset bfs dist for each vertex
+		if (graph->get_num_edges(id))
+			sources.push_back(id);
+	}
+
+	for (size_t off = 0; off < sources.size();
+			off += bc_source_set::MAX_SOURCES) {
+		g_sources.assign(sources.begin() + off, sources.begin()
+				+ std::min(off + bc_source_set::MAX_SOURCES, sources.size()));
+		std::unordered_map<vertex_id_t, bc_source_set> start_map;
+		for (size_t i = 0; i < g_sources.size(); i++)
+			start_map[g_sources[i]].set(i);
+		std::vector<vertex_id_t> start_vertices;
+		for (std::unordered_map<vertex_id_t, bc_source_set>::const_iterator it
+				= start_map.begin(); it != start_map.end(); it++)
+			start_vertices.push_back(it->first);
+
+		bfs_max_dist = 0; // Must reset bfs dist for each batch
 		// BFS phase. Inintialize start vert(ex)(ices)
 		g_alg_phase = btwn_phase_t::bfs;
-		BOOST_LOG_TRIVIAL(info) << "Starting BFS for vertex: " << g_source_vertex;
-		graph->init_all_vertices(vertex_initializer::ptr(
-					new btwn_initializer(&(graph->get_vertex(g_source_vertex)))));
-		graph->start(&g_source_vertex, 1, vertex_initializer::ptr(),
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("Starting BFS for %1% vertices from vertex %2%")
+			% g_sources.size() % g_sources.front();
+		graph->start(start_vertices.data(), start_vertices.size(),
+				vertex_initializer::ptr(new btwn_initializer(start_map, *graph)),
 				vertex_program_creater::ptr(new bfs_vertex_program_creater()));
 		graph->wait4complete();
 
@@ -448,8 +530,7 @@ FG_vector<float>::ptr compute_betweenness_centrality(FG_graph::ptr fg, const std
 
 		if (bfs_max_dist > 0) {
 			// Back propagation phase
-			BOOST_LOG_TRIVIAL(info) << "Starting back_prop phase for vertex: " 
-					<< g_source_vertex << "...";
+			BOOST_LOG_TRIVIAL(info) << "Starting back_prop phase ...";
 			g_alg_phase = btwn_phase_t::back_prop;
 
 			std::shared_ptr<vertex_filter> filter =
@@ -457,11 +538,12 @@ FG_vector<float>::ptr compute_betweenness_centrality(FG_graph::ptr fg, const std
 
 			graph->start(filter, std::move(bp_prog_creater));
 			graph->wait4complete();
-			BOOST_LOG_TRIVIAL(info) << "BC summation step";
-			g_alg_phase = bc_summation;
-			graph->start_all();
-			graph->wait4complete();
 		}
+		// The summation also releases the per-source states of the batch.
+		BOOST_LOG_TRIVIAL(info) << "BC summation step";
+		g_alg_phase = bc_summation;
+		graph->start_all();
+		graph->wait4complete();
 	}
 
 	gettimeofday(&end, NULL);
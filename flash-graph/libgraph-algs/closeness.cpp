@@ -0,0 +1,216 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file computes closeness centrality and k-hop reachability of
+ * a set of vertices. Both of them need BFS from each of the vertices,
+ * so we run BFS from a batch of vertices together with MS-BFS.
+ */
+
+#include "FGlib.h"
+#include "ms_bfs.h"
+
+using namespace fg;
+
+namespace {
+
+/*
+ * This counts the vertices reached by each source and sums their distances
+ * to the source in a worker thread.
+ */
+template<int NUM_WORDS>
+class dist_sum_visitor: public ms_bfs_visitor<NUM_WORDS>
+{
+	std::vector<size_t> num_reached;
+	std::vector<size_t> dist_sums;
+
+	struct add_dist {
+		dist_sum_visitor<NUM_WORDS> &visitor;
+		int level;
+
+		add_dist(dist_sum_visitor<NUM_WORDS> &_visitor,
+				int level): visitor(_visitor) {
+			this->level = level;
+		}
+
+		void operator()(int idx) {
+			visitor.num_reached[idx]++;
+			visitor.dist_sums[idx] += level;
+		}
+	};
+public:
+	dist_sum_visitor(size_t num_sources): num_reached(num_sources),
+			dist_sums(num_sources) {
+	}
+
+	void visit(vertex_id_t id, const source_set<NUM_WORDS> &sources,
+			int level) {
+		add_dist func(*this, level);
+		sources.for_each(func);
+	}
+
+	size_t get_num_reached(int idx) const {
+		return num_reached[idx];
+	}
+
+	size_t get_dist_sum(int idx) const {
+		return dist_sums[idx];
+	}
+};
+
+template<int NUM_WORDS>
+class dist_sum_visitor_creater: public ms_bfs_visitor_creater<NUM_WORDS>
+{
+	size_t num_sources;
+public:
+	dist_sum_visitor_creater(size_t num_sources) {
+		this->num_sources = num_sources;
+	}
+
+	typename ms_bfs_visitor<NUM_WORDS>::ptr create() const {
+		return typename ms_bfs_visitor<NUM_WORDS>::ptr(
+				new dist_sum_visitor<NUM_WORDS>(num_sources));
+	}
+};
+
+/*
+ * Run BFS from all vertices in `vids' in batches on the engine and add
+ * the number of vertices reached by each of them and the sum of their
+ * distances to `num_reached' and `dist_sums'.
+ */
+template<int NUM_WORDS>
+void bfs_dist_sums(graph_engine::ptr graph,
+		const std::vector<vertex_id_t> &vids, edge_type traverse_edge,
+		int max_level,
+		std::vector<size_t> &num_reached, std::vector<size_t> &dist_sums)
+{
+	const size_t batch_size = source_set<NUM_WORDS>::MAX_SOURCES;
+	for (size_t off = 0; off < vids.size(); off += batch_size) {
+		std::vector<vertex_id_t> sources(vids.begin() + off,
+				vids.begin() + std::min(off + batch_size, vids.size()));
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("BFS from %1% vertices starting from vertex %2%")
+			% sources.size() % off;
+		std::vector<typename ms_bfs_visitor<NUM_WORDS>::ptr> visitors
+			= ms_bfs<NUM_WORDS>(graph, sources, traverse_edge, max_level,
+					dist_sum_visitor_creater<NUM_WORDS>(sources.size()));
+		for (size_t i = 0; i < visitors.size(); i++) {
+			dist_sum_visitor<NUM_WORDS> &visitor
+				= (dist_sum_visitor<NUM_WORDS> &) *visitors[i];
+			for (size_t j = 0; j < sources.size(); j++) {
+				num_reached[off + j] += visitor.get_num_reached(j);
+				dist_sums[off + j] += visitor.get_dist_sum(j);
+			}
+		}
+	}
+}
+
+template<int NUM_WORDS>
+graph_engine::ptr create_bfs_engine(FG_graph::ptr fg)
+{
+	graph_index::ptr index = NUMA_graph_index<ms_bfs_vertex<NUM_WORDS> >::create(
+			fg->get_graph_header());
+	return fg->create_engine(index);
+}
+
+}
+
+namespace fg
+{
+
+void khop_reach_engine::get_dist_sums(const std::vector<vertex_id_t> &vids,
+		edge_type traverse_edge, int max_level,
+		std::vector<size_t> &num_reached, std::vector<size_t> &dist_sums)
+{
+	if (!fg->get_graph_header().is_directed_graph())
+		traverse_edge = edge_type::BOTH_EDGES;
+	num_reached.clear();
+	num_reached.resize(vids.size());
+	dist_sums.clear();
+	dist_sums.resize(vids.size());
+	// A small batch only needs a small source bitmap in each vertex.
+	if (vids.size() <= (size_t) source_set<1>::MAX_SOURCES) {
+		if (small_graph == NULL)
+			small_graph = create_bfs_engine<1>(fg);
+		bfs_dist_sums<1>(small_graph, vids, traverse_edge, max_level,
+				num_reached, dist_sums);
+	}
+	else {
+		if (large_graph == NULL)
+			large_graph = create_bfs_engine<4>(fg);
+		bfs_dist_sums<4>(large_graph, vids, traverse_edge, max_level,
+				num_reached, dist_sums);
+	}
+}
+
+FG_vector<size_t>::ptr khop_reach_engine::compute(
+		const std::vector<vertex_id_t> &vids, int k, edge_type traverse_edge)
+{
+	BOOST_LOG_TRIVIAL(info) << boost::format("%1%-hop reachability starts") % k;
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	std::vector<size_t> num_reached;
+	std::vector<size_t> dist_sums;
+	get_dist_sums(vids, traverse_edge, k, num_reached, dist_sums);
+	FG_vector<size_t>::ptr ret = FG_vector<size_t>::create(vids.size());
+	// We don't count the source itself.
+	for (size_t i = 0; i < vids.size(); i++)
+		ret->set(i, num_reached[i] - 1);
+
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("%1%-hop reachability takes %2% seconds")
+		% k % time_diff(start, end);
+	return ret;
+}
+
+FG_vector<float>::ptr compute_closeness(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &vids, edge_type traverse_edge)
+{
+	BOOST_LOG_TRIVIAL(info) << "closeness centrality starts";
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	std::vector<size_t> num_reached;
+	std::vector<size_t> dist_sums;
+	khop_reach_engine::create(fg)->get_dist_sums(vids, traverse_edge, -1,
+			num_reached, dist_sums);
+	FG_vector<float>::ptr ret = FG_vector<float>::create(vids.size());
+	for (size_t i = 0; i < vids.size(); i++) {
+		if (dist_sums[i] > 0)
+			ret->set(i, ((float) num_reached[i] - 1) / dist_sums[i]);
+		else
+			ret->set(i, 0);
+	}
+
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("closeness centrality takes %1% seconds")
+		% time_diff(start, end);
+	return ret;
+}
+
+FG_vector<size_t>::ptr compute_khop_reach(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &vids, int k, edge_type traverse_edge)
+{
+	return khop_reach_engine::create(fg)->compute(vids, k, traverse_edge);
+}
+
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "common.h"
+#include "comm_exception.h"
+
+#include "graph_service.h"
+
+namespace fg
+{
+
+service_query::service_query()
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&cond, NULL);
+	completed = false;
+	failed = false;
+	memset(&submit_time, 0, sizeof(submit_time));
+	memset(&complete_time, 0, sizeof(complete_time));
+}
+
+service_query::~service_query()
+{
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&cond);
+}
+
+void service_query::set_submitted()
+{
+	gettimeofday(&submit_time, NULL);
+}
+
+void service_query::set_completed()
+{
+	pthread_mutex_lock(&lock);
+	gettimeofday(&complete_time, NULL);
+	completed = true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+void service_query::set_failed(const std::string &error)
+{
+	this->error = error;
+	failed = true;
+	set_completed();
+}
+
+bool service_query::is_completed()
+{
+	pthread_mutex_lock(&lock);
+	bool ret = completed;
+	pthread_mutex_unlock(&lock);
+	return ret;
+}
+
+void service_query::wait4complete()
+{
+	pthread_mutex_lock(&lock);
+	while (!completed)
+		pthread_cond_wait(&cond, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+double service_query::get_latency() const
+{
+	return time_diff(submit_time, complete_time);
+}
+
+graph_service::graph_service(FG_graph::ptr fg, size_t max_batch_size)
+{
+	this->fg = fg;
+	this->max_batch_size = std::max(max_batch_size, (size_t) 1);
+	khop_engine = khop_reach_engine::create(fg);
+	pagerank_engine = ppr_engine::create(fg);
+	pthread_spin_init(&lock, PTHREAD_PROCESS_PRIVATE);
+	stopped = false;
+	num_queries = 0;
+	num_runs = 0;
+}
+
+graph_service::ptr graph_service::create(FG_graph::ptr fg,
+		size_t max_batch_size)
+{
+	ptr service(new graph_service(fg, max_batch_size));
+	service->dispatch_thread = std::unique_ptr<dispatcher>(
+			new dispatcher(*service));
+	service->dispatch_thread->start();
+	return service;
+}
+
+graph_service::~graph_service()
+{
+	if (dispatch_thread)
+		stop();
+	pthread_spin_destroy(&lock);
+}
+
+void graph_service::submit(service_query::ptr query)
+{
+	query->set_submitted();
+	pthread_spin_lock(&lock);
+	if (stopped) {
+		pthread_spin_unlock(&lock);
+		query->set_failed("the graph service has stopped");
+		return;
+	}
+	queue.push_back(query);
+	// We activate the dispatcher with the lock held, so stop() can't
+	// delete it in the meanwhile.
+	dispatch_thread->activate();
+	pthread_spin_unlock(&lock);
+}
+
+void graph_service::stop()
+{
+	// The dispatcher may exit without processing the queries that are
+	// still in the queue, so we wait for them first.
+	pthread_spin_lock(&lock);
+	if (stopped) {
+		pthread_spin_unlock(&lock);
+		return;
+	}
+	stopped = true;
+	std::vector<service_query::ptr> pending(queue.begin(), queue.end());
+	pthread_spin_unlock(&lock);
+	for (size_t i = 0; i < pending.size(); i++)
+		pending[i]->wait4complete();
+
+	dispatch_thread->stop();
+	dispatch_thread->join();
+	dispatch_thread.reset();
+	print_statistics();
+}
+
+/*
+ * The query at the head of the queue always runs next, so a query can't
+ * be starved by a stream of queries of another type. The queued queries
+ * that can share the engine run with it are moved to the same batch.
+ */
+std::vector<service_query::ptr> graph_service::fetch_batch()
+{
+	std::vector<service_query::ptr> batch;
+	pthread_spin_lock(&lock);
+	if (!queue.empty()) {
+		service_query::ptr head = queue.front();
+		queue.pop_front();
+		batch.push_back(head);
+		std::deque<service_query::ptr>::iterator it = queue.begin();
+		while (it != queue.end() && batch.size() < max_batch_size) {
+			if ((*it)->get_type() == head->get_type() && head->can_batch(**it)) {
+				batch.push_back(*it);
+				it = queue.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+	pthread_spin_unlock(&lock);
+	return batch;
+}
+
+void graph_service::run_batch(const std::vector<service_query::ptr> &batch)
+{
+	switch (batch.front()->get_type()) {
+		case service_query::KHOP: {
+			const khop_query &head = (const khop_query &) *batch.front();
+			std::vector<vertex_id_t> vids(batch.size());
+			for (size_t i = 0; i < batch.size(); i++)
+				vids[i] = ((const khop_query &) *batch[i]).get_vertex();
+			FG_vector<size_t>::ptr res = khop_engine->compute(vids,
+					head.get_k(), head.get_traverse_edge());
+			for (size_t i = 0; i < batch.size(); i++)
+				((khop_query &) *batch[i]).set_result(res->get(i));
+			break;
+		}
+		case service_query::SUBGRAPH: {
+			assert(batch.size() == 1);
+			subgraph_query &query = (subgraph_query &) *batch.front();
+			query.set_result(fetch_subgraph(fg, query.get_vertices()));
+			break;
+		}
+		case service_query::PAGERANK: {
+			const pagerank_query &head = (const pagerank_query &) *batch.front();
+			FG_vector<float>::ptr ranks = compute_pagerank(fg,
+					head.get_num_iters(), head.get_damping_factor());
+			for (size_t i = 0; i < batch.size(); i++)
+				((pagerank_query &) *batch[i]).set_result(ranks);
+			break;
+		}
+		case service_query::PERSONALIZED_PAGERANK: {
+			const ppr_query &head = (const ppr_query &) *batch.front();
+			std::vector<std::vector<vertex_id_t> > seed_sets(batch.size());
+			for (size_t i = 0; i < batch.size(); i++)
+				seed_sets[i] = ((const ppr_query &) *batch[i]).get_seeds();
+			std::vector<FG_vector<float>::ptr> ranks
+				= pagerank_engine->compute(seed_sets, head.get_num_iters(),
+						head.get_damping_factor(), head.get_epsilon());
+			// It doesn't return results on undirected graphs.
+			if (ranks.size() != batch.size())
+				throw unsupported_exception(
+						"personalized PageRank only runs on directed graphs");
+			for (size_t i = 0; i < batch.size(); i++)
+				((ppr_query &) *batch[i]).set_result(ranks[i]);
+			break;
+		}
+		default:
+			assert(0);
+	}
+}
+
+void graph_service::process_queries()
+{
+	while (true) {
+		std::vector<service_query::ptr> batch = fetch_batch();
+		if (batch.empty())
+			break;
+
+		bool success = true;
+		std::string error;
+		try {
+			run_batch(batch);
+		} catch (std::exception &e) {
+			success = false;
+			error = e.what();
+			BOOST_LOG_TRIVIAL(error)
+				<< boost::format("graph service fails %1% queries: %2%")
+				% batch.size() % error;
+		}
+		num_queries += batch.size();
+		num_runs++;
+		for (size_t i = 0; i < batch.size(); i++) {
+			if (success)
+				batch[i]->set_completed();
+			else
+				batch[i]->set_failed(error);
+		}
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("graph service completes %1% queries in a run, the first query takes %2% seconds")
+			% batch.size() % batch.front()->get_latency();
+	}
+}
+
+void graph_service::print_statistics() const
+{
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("graph service answers %1% queries in %2% engine runs")
+		% num_queries % num_runs;
+}
+
+}
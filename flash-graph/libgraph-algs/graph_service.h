@@ -0,0 +1,384 @@
+#ifndef __GRAPH_SERVICE_H__
+#define __GRAPH_SERVICE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "thread.h"
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/**
+ * \brief A query submitted to the graph service. Users wait for
+ *        the completion of the query and read its result from
+ *        the subclass of the query.
+ */
+class service_query
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool completed;
+	bool failed;
+	std::string error;
+	struct timeval submit_time;
+	struct timeval complete_time;
+public:
+	typedef std::shared_ptr<service_query> ptr;
+
+	enum query_type {
+		KHOP,
+		SUBGRAPH,
+		PAGERANK,
+		PERSONALIZED_PAGERANK,
+	};
+
+	service_query();
+	virtual ~service_query();
+
+	virtual query_type get_type() const = 0;
+
+	/**
+	 * \brief Determine whether the query can run in the same engine run
+	 *        as another query of the same type.
+	 */
+	virtual bool can_batch(const service_query &q) const {
+		return false;
+	}
+
+	/**
+	 * \internal
+	 * The graph service invokes these when the query enters the service
+	 * and when its result is ready.
+	 */
+	void set_submitted();
+	void set_completed();
+	/**
+	 * \internal
+	 * The query completes without a result, e.g., it's submitted after
+	 * the service stops or the algorithm can't run on the graph.
+	 */
+	void set_failed(const std::string &error);
+
+	bool is_completed();
+	void wait4complete();
+
+	/**
+	 * \brief Determine whether the query failed. It's valid only after
+	 *        the query completes.
+	 */
+	bool has_failed() const {
+		return failed;
+	}
+
+	/**
+	 * \brief The reason why the query failed.
+	 */
+	const std::string &get_error() const {
+		return error;
+	}
+
+	/**
+	 * \brief The time in seconds from the submission of the query to its
+	 *        completion. It's valid only after the query completes.
+	 */
+	double get_latency() const;
+};
+
+/**
+ * \brief Count the vertices reachable from a vertex within k hops.
+ *        If k is negative, it counts all vertices reachable from the vertex.
+ */
+class khop_query: public service_query
+{
+	vertex_id_t vid;
+	int k;
+	edge_type traverse_edge;
+	size_t num_reached;
+public:
+	khop_query(vertex_id_t vid, int k, edge_type traverse_edge) {
+		this->vid = vid;
+		this->k = k;
+		this->traverse_edge = traverse_edge;
+		this->num_reached = 0;
+	}
+
+	virtual query_type get_type() const {
+		return KHOP;
+	}
+
+	virtual bool can_batch(const service_query &q) const {
+		const khop_query &kq = (const khop_query &) q;
+		return kq.k == k && kq.traverse_edge == traverse_edge;
+	}
+
+	vertex_id_t get_vertex() const {
+		return vid;
+	}
+
+	int get_k() const {
+		return k;
+	}
+
+	edge_type get_traverse_edge() const {
+		return traverse_edge;
+	}
+
+	void set_result(size_t num_reached) {
+		this->num_reached = num_reached;
+	}
+
+	/**
+	 * \brief The number of reachable vertices, excluding the vertex itself.
+	 */
+	size_t get_num_reached() const {
+		return num_reached;
+	}
+};
+
+/**
+ * \brief Fetch the subgraph induced by a set of vertices.
+ */
+class subgraph_query: public service_query
+{
+	std::vector<vertex_id_t> vertices;
+	in_mem_subgraph::ptr subgraph;
+public:
+	subgraph_query(const std::vector<vertex_id_t> &vertices) {
+		this->vertices = vertices;
+	}
+
+	virtual query_type get_type() const {
+		return SUBGRAPH;
+	}
+
+	const std::vector<vertex_id_t> &get_vertices() const {
+		return vertices;
+	}
+
+	void set_result(in_mem_subgraph::ptr subgraph) {
+		this->subgraph = subgraph;
+	}
+
+	in_mem_subgraph::ptr get_subgraph() const {
+		return subgraph;
+	}
+};
+
+/**
+ * \brief Compute PageRank on the whole graph. Identical PageRank queries
+ *        in the queue share the same run and the same result vector.
+ */
+class pagerank_query: public service_query
+{
+	int num_iters;
+	float damping_factor;
+	FG_vector<float>::ptr ranks;
+public:
+	pagerank_query(int num_iters, float damping_factor) {
+		this->num_iters = num_iters;
+		this->damping_factor = damping_factor;
+	}
+
+	virtual query_type get_type() const {
+		return PAGERANK;
+	}
+
+	virtual bool can_batch(const service_query &q) const {
+		const pagerank_query &pq = (const pagerank_query &) q;
+		return pq.num_iters == num_iters && pq.damping_factor == damping_factor;
+	}
+
+	int get_num_iters() const {
+		return num_iters;
+	}
+
+	float get_damping_factor() const {
+		return damping_factor;
+	}
+
+	void set_result(FG_vector<float>::ptr ranks) {
+		this->ranks = ranks;
+	}
+
+	FG_vector<float>::ptr get_ranks() const {
+		return ranks;
+	}
+};
+
+/**
+ * \brief Compute personalized PageRank for a seed set.
+ */
+class ppr_query: public service_query
+{
+	std::vector<vertex_id_t> seeds;
+	int num_iters;
+	float damping_factor;
+	float epsilon;
+	FG_vector<float>::ptr ranks;
+public:
+	ppr_query(const std::vector<vertex_id_t> &seeds, int num_iters,
+			float damping_factor, float epsilon) {
+		this->seeds = seeds;
+		this->num_iters = num_iters;
+		this->damping_factor = damping_factor;
+		this->epsilon = epsilon;
+	}
+
+	virtual query_type get_type() const {
+		return PERSONALIZED_PAGERANK;
+	}
+
+	virtual bool can_batch(const service_query &q) const {
+		const ppr_query &pq = (const ppr_query &) q;
+		return pq.num_iters == num_iters && pq.damping_factor == damping_factor
+			&& pq.epsilon == epsilon;
+	}
+
+	const std::vector<vertex_id_t> &get_seeds() const {
+		return seeds;
+	}
+
+	int get_num_iters() const {
+		return num_iters;
+	}
+
+	float get_damping_factor() const {
+		return damping_factor;
+	}
+
+	float get_epsilon() const {
+		return epsilon;
+	}
+
+	void set_result(FG_vector<float>::ptr ranks) {
+		this->ranks = ranks;
+	}
+
+	FG_vector<float>::ptr get_ranks() const {
+		return ranks;
+	}
+};
+
+/**
+ * \brief A long-running service that answers queries on a graph.
+ *
+ * The graph, its compressed vertex index, the hot vertex store and
+ * the SAFS page cache are loaded once and stay resident. Queries can be
+ * submitted from multiple threads. A dispatcher thread runs them in
+ * the order of submission; when it picks a query, all queued queries that
+ * can run together with it are batched into the same engine run (e.g.,
+ * k-hop queries run as one multi-source BFS), so they share the reads of
+ * adjacency lists. The k-hop and personalized PageRank queries run on
+ * engines that stay alive across batches, one for each vertex type, so
+ * a batch doesn't allocate the O(V) vertex state again; only the worker
+ * threads are started for each engine run. PageRank on the whole graph
+ * and subgraph queries still create an engine for each run.
+ *
+ * The service answers queries from the threads of the same process;
+ * there isn't a network front end.
+ */
+class graph_service
+{
+	class dispatcher: public ::thread
+	{
+		graph_service &service;
+	public:
+		dispatcher(graph_service &service): thread("graph-service", -1),
+				service(service) {
+		}
+
+		virtual void run() {
+			service.process_queries();
+		}
+	};
+
+	FG_graph::ptr fg;
+	size_t max_batch_size;
+	// Only the dispatcher thread runs queries on the engines.
+	khop_reach_engine::ptr khop_engine;
+	ppr_engine::ptr pagerank_engine;
+
+	pthread_spinlock_t lock;
+	std::deque<service_query::ptr> queue;
+	std::unique_ptr<dispatcher> dispatch_thread;
+	// The service doesn't accept queries after it stops.
+	bool stopped;
+
+	size_t num_queries;
+	size_t num_runs;
+
+	graph_service(FG_graph::ptr fg, size_t max_batch_size);
+
+	std::vector<service_query::ptr> fetch_batch();
+	void run_batch(const std::vector<service_query::ptr> &batch);
+	void process_queries();
+public:
+	typedef std::shared_ptr<graph_service> ptr;
+
+	/**
+	 * \brief Create a graph service and start its dispatcher thread.
+	 * \param fg The graph that the service answers queries on.
+	 * \param max_batch_size The maximal number of queries that run
+	 *        in a single engine run.
+	 */
+	static ptr create(FG_graph::ptr fg, size_t max_batch_size = 256);
+
+	~graph_service();
+
+	/**
+	 * \brief Submit a query to the service. The call returns immediately
+	 *        and users wait for the completion on the query.
+	 *        A query submitted after the service stops fails.
+	 */
+	void submit(service_query::ptr query);
+
+	/**
+	 * \brief Submit a query and wait for its completion.
+	 */
+	void run(service_query::ptr query) {
+		submit(query);
+		query->wait4complete();
+	}
+
+	/**
+	 * \brief Stop the service after all submitted queries complete.
+	 */
+	void stop();
+
+	FG_graph::ptr get_graph() const {
+		return fg;
+	}
+
+	void print_statistics() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __ITER_STATS_H__
+#define __ITER_STATS_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "concurrency.h"
+
+namespace fg
+{
+
+/*
+ * The statistics of an iteration that all threads need to decide what to
+ * do in the next iteration: a count summed over the threads and a value
+ * minimized over the threads. Each thread publishes its part at the end
+ * of an iteration, and the threads read the statistics of an iteration
+ * after it completes, so every thread derives the same decision from
+ * them without extra synchronization.
+ *
+ * A thread may still read the statistics of the previous iteration while
+ * others publish the current one, so we keep three iterations in a ring.
+ * At the end of iteration i, a thread resets the slot of iteration i + 1:
+ * the iteration i - 2 that used the slot is read by all threads before
+ * iteration i, and iteration i + 1 isn't published until every thread
+ * finishes iteration i.
+ */
+template<class T>
+class iter_stats_ring
+{
+	static const int NUM_SLOTS = 3;
+	atomic_number<size_t> counts[NUM_SLOTS];
+	atomic_number<T> mins[NUM_SLOTS];
+	T none;
+public:
+	/*
+	 * `none' is the minimal value of an iteration if no thread publishes
+	 * a smaller one.
+	 */
+	iter_stats_ring(T none) {
+		this->none = none;
+		for (int i = 0; i < NUM_SLOTS; i++)
+			reset(i);
+	}
+
+	void reset(int level) {
+		counts[level % NUM_SLOTS] = atomic_number<size_t>(0);
+		mins[level % NUM_SLOTS] = atomic_number<T>(none);
+	}
+
+	void publish(int level, size_t count, T val) {
+		counts[level % NUM_SLOTS].inc(count);
+		atomic_number<T> &min = mins[level % NUM_SLOTS];
+		T curr = min.get();
+		while (val < curr && !min.CAS(curr, val))
+			curr = min.get();
+	}
+
+	size_t get_count(int level) const {
+		return counts[level % NUM_SLOTS].get();
+	}
+
+	T get_min(int level) const {
+		return mins[level % NUM_SLOTS].get();
+	}
+};
+
+}
+
+#endif
@@ -17,37 +17,69 @@
  * limitations under the License.
  */
 
+/*
+ * This computes the coreness of all vertices by peeling vertices in
+ * the order of their degree in a single run of the graph engine.
+ *
+ * Each worker thread keeps the vertices in buckets of their remaining
+ * degree. In every iteration, the vertices in the current minimal bucket
+ * `k' are removed and get core `k', and the decrements of the degree of
+ * their neighbors are combined in the thread and sent at the end of
+ * the iteration. The buckets are lazy: when the degree of a vertex drops,
+ * the vertex is added to the new bucket and its old entry is discarded
+ * when the old bucket is visited. As long as vertices are removed,
+ * `k' stays the same; once an iteration removes nothing, all threads move
+ * to the minimal remaining degree. As a result, a vertex reads its edge
+ * list only once and each edge is processed only once.
+ */
+
 #include <signal.h>
 #ifdef PROFILER
 #include <gperftools/profiler.h>
 #endif
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <algorithm>
+#include <limits>
 
 #include "graph_engine.h"
 #include "graph_config.h"
 #include "FGlib.h"
 #include "save_result.h"
+#include "iter_stats.h"
 
 using namespace fg;
 
-vsize_t CURRENT_K; // Min degree necessary to be part of the k-core graph
-vsize_t PREVIOUS_K; 
-bool all_greater_than_core = true;
+namespace {
 
-enum kcore_stage_t
+const vsize_t NO_DEGREE = std::numeric_limits<vsize_t>::max();
+
+/*
+ * The number of vertices removed in an iteration and the minimal degree
+ * of the vertices left in the buckets of the threads.
+ */
+class kcore_iter_stats: public iter_stats_ring<vsize_t>
 {
-	INIT_DEGREE,
-	KCORE,
+public:
+	kcore_iter_stats(): iter_stats_ring<vsize_t>(NO_DEGREE) {
+	}
+
+	size_t get_num_removed(int level) const {
+		return get_count(level);
+	}
+
+	vsize_t get_min_degree(int level) const {
+		return get_min(level);
+	}
 };
-kcore_stage_t stage;
 
 class kcore_vertex: public compute_vertex
 {
 	bool deleted;
 	vsize_t core;
-	vsize_t degree; 
+	vsize_t degree;
 
 	public:
 	kcore_vertex(vertex_id_t id): compute_vertex(id) {
@@ -60,22 +92,14 @@ class kcore_vertex: public compute_vertex
 		return deleted;
 	}
 
-	void _delete() {
-		this->deleted = true;
-	}
-
-	void set_core(vsize_t core) {
-		this->core = core;
+	vsize_t get_degree() const {
+		return degree;
 	}
 
 	const vsize_t get_core() const {
 		return this->core;
 	}
 
-	vsize_t get_degree() {
-		return degree;
-	}
-
 	size_t get_result() const {
 		return get_core();
 	}
@@ -84,204 +108,223 @@ class kcore_vertex: public compute_vertex
 
 	void run(vertex_program &prog, const page_vertex &vertex);
 
-	void run_on_message(vertex_program &prog, const vertex_message &msg); 
-
-	void run_on_vertex_header(vertex_program &prog, const vertex_header &header) {
-		degree = header.get_num_edges();
-		this->core = degree == 0 ? 0 :
-			degree == 1 ? 1 : -1; // Everyone between kmin < core > kmax will get this core
-		this->deleted = degree == 0 ? true : false; // If your degree you're already deleted
-	}
+	void run_on_message(vertex_program &prog, const vertex_message &msg);
 };
 
-// If I am to be deleted, multicast this message to all my neighbors
-// and activate them
+/*
+ * The decrements of the degree of a vertex caused by the vertices removed
+ * in an iteration. A thread sends one message to each of the neighbors
+ * of its removed vertices.
+ */
 class deleted_message: public vertex_message
 {
+	vsize_t num;
 	public:
-		deleted_message(): vertex_message(sizeof(deleted_message), true) {
+		deleted_message(vsize_t num): vertex_message(sizeof(deleted_message),
+				false) {
+			this->num = num;
+		}
+
+		vsize_t get_num() const {
+			return num;
 		}
 };
 
-void multicast_delete_msg(vertex_program &prog, 
-		const page_vertex &vertex, edge_type E)
+class kcore_vertex_program: public vertex_program_impl<kcore_vertex>
 {
-	int num_dests = vertex.get_num_edges(E);
-	edge_seq_iterator it = vertex.get_neigh_seq_it(E, 0, num_dests);
-
-	// Doesn't matter who sent it, just --degree on reception 
-	deleted_message msg;
-	prog.multicast_msg(it, msg);
-}
-
-void kcore_vertex::run(vertex_program &prog) {
-	vertex_id_t id = prog.get_vertex_id(*this);
-	if (stage == INIT_DEGREE) {
-		request_vertex_headers(&id, 1);
-		return;
-	}
-
-	if ( degree > CURRENT_K ) { 
-		return; 
-	}
-
-	if (!is_deleted()) {
-		request_vertices(&id, 1); // put my edgelist in page cache
-
-		if (all_greater_than_core) {
-			all_greater_than_core = false;
+	kcore_iter_stats &stats;
+	size_t kmax;
+	edge_type degree_edge;
+
+	// The core of the current iteration.
+	int k_level;
+	vsize_t k;
+	bool stopped;
+
+	// The vertices in the thread that may have the degree of the key.
+	std::map<vsize_t, std::vector<vertex_id_t> > buckets;
+	// The combined degree decrements of the neighbors of the vertices
+	// removed in the thread in this iteration.
+	std::unordered_map<vertex_id_t, vsize_t> decs;
+	size_t num_removed;
+
+	bool is_valid(vertex_id_t id, vsize_t degree) {
+		kcore_vertex &v = (kcore_vertex &) get_graph().get_vertex(id);
+		return !v.is_deleted() && v.get_degree() == degree;
+	}
+public:
+	typedef std::shared_ptr<kcore_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<kcore_vertex_program, vertex_program>(
+				prog);
+	}
+
+	kcore_vertex_program(kcore_iter_stats &_stats, size_t kmax,
+			edge_type degree_edge): stats(_stats) {
+		this->kmax = kmax;
+		this->degree_edge = degree_edge;
+		this->k_level = 0;
+		this->k = 0;
+		this->stopped = false;
+		this->num_removed = 0;
+	}
+
+	edge_type get_degree_edge() const {
+		return degree_edge;
+	}
+
+	/*
+	 * Get the core of the current iteration. Every thread derives it from
+	 * the statistics of the previous iterations in the same way, so all
+	 * threads agree on it without extra synchronization.
+	 */
+	vsize_t get_k() {
+		int level = get_graph().get_curr_level();
+		for (; k_level < level; k_level++) {
+			if (stats.get_num_removed(k_level) > 0
+					|| stats.get_min_degree(k_level) == NO_DEGREE)
+				continue;
+			k = std::max(k, stats.get_min_degree(k_level));
+			if (kmax > 0 && k > kmax)
+				stopped = true;
 		}
+		return k;
 	}
-}
-
-void kcore_vertex::run(vertex_program &prog, const page_vertex &vertex) {
-	if (is_deleted()) {
-		return; // Nothing to be done here
-	}
-
-	if ( get_degree() < CURRENT_K ) {
-		set_core(CURRENT_K - 1); // This is true because you must make it past CURRENT_K-1 to be here
-		_delete();
 
-		// Send two multicast messages - [IN_EDGE, OUT_EDGE] 
-		multicast_delete_msg(prog, vertex, IN_EDGE);
-		multicast_delete_msg(prog, vertex, OUT_EDGE);
-	}
-}
-
-void kcore_vertex::run_on_message(vertex_program &prog, const vertex_message &msg) {
-	if (is_deleted()) {
-		return; // nothing to be done here
-	}
-	// else
-	degree--;
-}
-
-class count_vertex_query: public vertex_query
-{
-	size_t num;
-	public:
-	count_vertex_query() {
-		num = 0;
+	bool is_stopped() {
+		get_k();
+		return stopped;
 	}
 
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex &kcore_v = (kcore_vertex &) v;
-		if (!kcore_v.is_deleted())
-			num++;
+	void add(vertex_id_t id, vsize_t degree) {
+		buckets[degree].push_back(id);
 	}
 
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		count_vertex_query *cvq = (count_vertex_query *) q.get();
-		num += cvq->num;
+	void remove(const page_vertex &vertex, edge_type type) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+		while (it.has_next())
+			decs[it.next()]++;
 	}
 
-	virtual ptr clone() {
-		return vertex_query::ptr(new count_vertex_query());
+	void inc_removed() {
+		num_removed++;
 	}
 
-	size_t get_num() const {
-		return num;
-	}
+	virtual void run_on_iteration_end();
 };
 
-// Max degree corresponds to the highest core
-class max_degree_query: public vertex_query
+void kcore_vertex_program::run_on_iteration_end()
 {
-	vsize_t max_degree;
-	public:
-	max_degree_query() {
-		max_degree = 0;
-	}
-
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex& kv = (kcore_vertex&) v;
-		if ((kv.get_degree()) > max_degree) {
-			max_degree = kv.get_degree();
+	int level = get_graph().get_curr_level();
+	vsize_t curr_k = get_k();
+	stats.reset(level + 1);
+
+	for (std::unordered_map<vertex_id_t, vsize_t>::const_iterator it
+			= decs.begin(); it != decs.end(); it++) {
+		deleted_message msg(it->second);
+		send_msg(it->first, msg);
+	}
+	decs.clear();
+
+	// Activate the vertices in the buckets of the current core.
+	// They are removed in the next iteration.
+	std::vector<vertex_id_t> active;
+	vsize_t min_degree = NO_DEGREE;
+	while (!stopped && !buckets.empty() && buckets.begin()->first <= curr_k) {
+		vsize_t degree = buckets.begin()->first;
+		const std::vector<vertex_id_t> &ids = buckets.begin()->second;
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (is_valid(ids[i], degree)) {
+				active.push_back(ids[i]);
+				min_degree = std::min(min_degree, degree);
+			}
 		}
-	}
-
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		max_degree_query *mdq = (max_degree_query *) q.get();
-		if (max_degree < mdq->max_degree) {
-			max_degree = mdq->max_degree;
+		buckets.erase(buckets.begin());
+	}
+	// Discard the invalid entries in the minimal bucket, so we know
+	// the minimal degree of the remaining vertices in the thread.
+	while (!stopped && !buckets.empty() && min_degree == NO_DEGREE) {
+		vsize_t degree = buckets.begin()->first;
+		std::vector<vertex_id_t> &ids = buckets.begin()->second;
+		while (!ids.empty() && !is_valid(ids.back(), degree))
+			ids.pop_back();
+		if (ids.empty())
+			buckets.erase(buckets.begin());
+		else {
+			min_degree = degree;
+			// The engine stops if no vertices are activated, so we always
+			// keep one vertex running while the vertices wait for `k' to
+			// reach their bucket.
+			if (active.empty())
+				active.push_back(ids.back());
 		}
 	}
+	activate_vertices(active.data(), active.size());
+	stats.publish(level, num_removed, min_degree);
+	num_removed = 0;
+}
 
-	virtual ptr clone() {
-		return vertex_query::ptr(new max_degree_query());
+class kcore_vertex_program_creater: public vertex_program_creater
+{
+	kcore_iter_stats &stats;
+	size_t kmax;
+	edge_type degree_edge;
+public:
+	kcore_vertex_program_creater(kcore_iter_stats &_stats, size_t kmax,
+			edge_type degree_edge): stats(_stats) {
+		this->kmax = kmax;
+		this->degree_edge = degree_edge;
 	}
 
-	vsize_t get_max_degree() const {
-		return max_degree;
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new kcore_vertex_program(stats, kmax,
+					degree_edge));
 	}
 };
 
-// Figure out the lowest REMAINING degree in the graph
-class min_degree_query: public vertex_query
-{
-	vsize_t min_degree;
-	public:
-	min_degree_query() {
-		min_degree = std::numeric_limits<vsize_t>::max();
+void kcore_vertex::run(vertex_program &prog) {
+	kcore_vertex_program &kprog = (kcore_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	// All vertices run in the first iteration. The degree comes from
+	// the in-memory vertex index.
+	if (prog.get_graph().get_curr_level() == 0) {
+		degree = prog.get_graph().get_num_edges(id, kprog.get_degree_edge());
+		if (degree > 0)
+			kprog.add(id, degree);
 	}
 
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex kcore_v = (kcore_vertex&) v;
-		if (!kcore_v.is_deleted()) {
-			if (kcore_v.get_degree() < min_degree) {
-				min_degree = kcore_v.get_degree();
-			}
-		}
-	}
+	if (is_deleted() || kprog.is_stopped() || degree > kprog.get_k())
+		return;
 
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		min_degree_query *mdq = (min_degree_query *) q.get();
-		if (min_degree > mdq->min_degree) {
-			min_degree = mdq->min_degree;
-		}
-	}
+	core = kprog.get_k();
+	deleted = true;
+	kprog.inc_removed();
+	// All neighbors have been removed, so no one needs to be notified.
+	if (degree > 0)
+		request_vertices(&id, 1);
+}
 
-	virtual ptr clone() {
-		return vertex_query::ptr(new min_degree_query());
+void kcore_vertex::run(vertex_program &prog, const page_vertex &vertex) {
+	kcore_vertex_program &kprog = (kcore_vertex_program &) prog;
+	if (kprog.get_degree_edge() == edge_type::BOTH_EDGES) {
+		kprog.remove(vertex, edge_type::IN_EDGE);
+		kprog.remove(vertex, edge_type::OUT_EDGE);
 	}
+	else
+		kprog.remove(vertex, kprog.get_degree_edge());
+}
 
-	vsize_t get_min_degree() const {
-		return min_degree;
+void kcore_vertex::run_on_message(vertex_program &prog, const vertex_message &msg) {
+	if (is_deleted()) {
+		return; // nothing to be done here
 	}
-};
-
-// Helpers
-void print_func(vertex_id_t i) {
-	std::cout << " " << i;
-}
-void print_active(std::vector<vertex_id_t> v) {
-	std::cout << "[";
-	for_each (v.begin(), v.end(), print_func);
-	std::cout <<  " ]\n";
+	degree -= ((const deleted_message &) msg).get_num();
+	((kcore_vertex_program &) prog).add(prog.get_vertex_id(*this), degree);
 }
-// End Helpers
 
-void set_kmax(graph_engine::ptr graph, size_t& kmax)
-{
-	BOOST_LOG_TRIVIAL(info) << "Computing kmax as max_degree ...";
-	vertex_query::ptr mdq(new max_degree_query());
-	graph->query_on_all(mdq); 
-	kmax = ((max_degree_query *) mdq.get())->get_max_degree();
 }
 
-class activate_k_filter: public vertex_filter {
-	vsize_t min;
-	public:
-	activate_k_filter (vsize_t min) {
-		this->min = min;
-	}
-	bool keep(vertex_program &prog, compute_vertex &v) {
-		kcore_vertex &kcore_v = (kcore_vertex &) v;
-		return kcore_v.get_degree() < min;
-	}
-};
-
 namespace fg
 {
 
@@ -297,63 +340,22 @@ FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 			<< "'k' must be between 2 and the number of nodes in the graph";
 		exit(-1);
 	}
+	if (kmax > 0 && kmax < k) {
+		BOOST_LOG_TRIVIAL(error) << "'kmax' must be no smaller than 'k'";
+		return FG_vector<size_t>::ptr();
+	}
 
 	struct timeval start, end;
 	gettimeofday(&start, NULL);
 
-	CURRENT_K = k;
-	BOOST_LOG_TRIVIAL(info) << "Running the init degree stage ...";
-	stage = INIT_DEGREE;
-	graph->start_all(); 
+	// The degree of a vertex in a directed graph includes both in-edges
+	// and out-edges.
+	edge_type degree_edge = graph->is_directed()
+		? edge_type::BOTH_EDGES : edge_type::OUT_EDGE;
+	kcore_iter_stats stats;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new kcore_vertex_program_creater(stats, kmax, degree_edge)));
 	graph->wait4complete();
-	stage = KCORE;
-
-	if (kmax == 0 && k != 0) {
-		set_kmax(graph, kmax);
-	}
-	BOOST_LOG_TRIVIAL(info) << "Setting kmax as " << kmax;
-
-
-	for (; CURRENT_K <= kmax; CURRENT_K++) {
-
-		std::shared_ptr<vertex_filter> filter
-			= std::shared_ptr<vertex_filter>(new activate_k_filter(CURRENT_K));
-
-		graph->start(filter, vertex_program_creater::ptr()); 
-		graph->wait4complete();
-
-		if (all_greater_than_core) { // There's a chance we can hop forward
-			vertex_query::ptr mdq(new min_degree_query());
-			graph->query_on_all(mdq);
-			vsize_t min_degree_remaining = ((min_degree_query *) mdq.get())->get_min_degree();
-
-			if (min_degree_remaining == std::numeric_limits<vsize_t>::max()) {
-				BOOST_LOG_TRIVIAL(info) << "No more active vertices left!";
-				break;
-			}
-
-			BOOST_LOG_TRIVIAL(info)
-				<< "The graphs minimum degree remaining is " << min_degree_remaining;
-			// Effectively jumps us to the CURRENT_K + 1th core
-			CURRENT_K = min_degree_remaining; // NOTE: Careful - messing with the loop variable :/
-
-			if (CURRENT_K > kmax) {
-				BOOST_LOG_TRIVIAL(info) << "Terminating computation at kmax";
-				break;
-			}
-		}
-		all_greater_than_core = true;
-
-#if 1
-		vertex_query::ptr cvq(new count_vertex_query());
-		graph->query_on_all(cvq);
-		size_t in_k_core = ((count_vertex_query *) cvq.get())->get_num();
-		BOOST_LOG_TRIVIAL(info)
-			<< boost::format("%1%-core shows %2% vertices > %3% degree")
-			% CURRENT_K % in_k_core % CURRENT_K;
-#endif
-		PREVIOUS_K = CURRENT_K;
-	}
 
 	gettimeofday(&end, NULL);
 	BOOST_LOG_TRIVIAL(info)
@@ -364,6 +366,12 @@ FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 
 	graph->query_on_all(vertex_query::ptr(
 				new save_query<size_t, kcore_vertex>(ret)));
+	// We only report the cores between `k' and `kmax'. The vertices in
+	// the cores higher than `kmax' were never removed and keep -1.
+	for (size_t i = 0; i < ret->get_size(); i++) {
+		if (ret->get(i) < k)
+			ret->set(i, 0);
+	}
 
 	return ret;
 }
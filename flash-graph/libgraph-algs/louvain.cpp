@@ -16,434 +16,710 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+
+/*
+ * This implements Louvain community detection on the semi-external graph
+ * engine. Each level of the hierarchy has two phases:
+ *	local moving: vertices move to the neighboring cluster that gives
+ *		the largest modularity gain. The cluster of every vertex and
+ *		the total degree of every cluster are kept in memory, so a vertex
+ *		only needs to read its own edge list to evaluate all moves.
+ *		A sweep is split into sub-rounds and a vertex is assigned to
+ *		a sub-round by a hash of its ID that changes in every sweep.
+ *		The moves decided in a sub-round are collected by the worker
+ *		threads and applied together at the end of the sub-round, so
+ *		the vertices in a sub-round see the same clusters. To break
+ *		the symmetry of two singleton vertices swapping their clusters,
+ *		a singleton vertex only joins another singleton cluster with
+ *		a smaller ID. After the first sweep, only
+ *		the neighbors of the moved vertices are evaluated again.
+ *	contraction: the clusters become the vertices of the graph in the next
+ *		level and the edges between two clusters are merged into one
+ *		weighted edge. The edges are combined in each worker thread and
+ *		the combined edges are merged in parallel. The contracted graph is
+ *		kept in memory if it fits in the SAFS page cache and is written to
+ *		SAFS otherwise, so the next level runs in the semi-external mode.
+ *		However, the contracted graph is always built in memory before
+ *		it's written to SAFS, so the edges between the clusters of
+ *		a level have to fit in memory. This is usually much smaller than
+ *		the input graph, but it isn't bounded like the vertex state.
+ *
+ * A directed graph is treated as an undirected graph by merging its in-edges
+ * and out-edges. If the graph has edge data, it's used as the edge weight.
+ */
+
 #ifdef PROFILER
 #include <gperftools/profiler.h>
 #endif
+#include <unistd.h>
 
 #include <limits>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <algorithm>
-#include <atomic>
 
 #include "thread.h"
 #include "io_interface.h"
+#include "safs_file.h"
 #include "container.h"
 #include "concurrency.h"
 
 #include "vertex_index.h"
 #include "graph_engine.h"
 #include "graph_config.h"
+#include "in_mem_storage.h"
+#include "utils.h"
 #include "FGlib.h"
 #include "FG_vector.h"
-#include "save_result.h"
 
 using namespace fg;
 
-// NOTE: This routine is only meant for undirected graphs!!!
 namespace {
-	// INIT lets us accumulate
-	enum stage_t
-	{
-		INIT,
-		RUN,
-		REBUILD,
-	};
-
-	template <typename T>
-		class atomicwrapper
-		{
-			private:
-				std::atomic<T> _a;
-
-			public:
-				atomicwrapper() :_a() {}
-
-				atomicwrapper(const std::atomic<T> &a) :_a(a.load()) {}
-
-				atomicwrapper(const atomicwrapper &other) :_a(other._a.load()) {}
-
-				atomicwrapper &operator=(const atomicwrapper &other) {
-					_a.store(other._a.load());
-					return *this;
-				}
-
-				T get() {
-					return _a;
-				}
-
-				void assign(T val) {
-					_a = val;
-				}
-
-				void minus_eq(T val) {
-					_a -= val;
-				}
-
-				void plus_eq(T val) {
-					_a += val;
-				}
-		};
-
-	template <typename T>
-		static void print_atomicwrapper_v(std::vector<atomicwrapper<T>>& v ) {
-
-			std::cout << "[ ";
-			for (typename std::vector<atomicwrapper<T>>::iterator it = v.begin(); it != v.end(); ++it)  {
-				std::cout << it->get() << " ";
-			}
-			std::cout << "]\n";
-		}
 
-	// Global map from cluster_id : cluster(volume, weight)
-	std::vector<atomicwrapper<uint32_t>> g_weight_vec;
-	std::vector<atomicwrapper<uint32_t>> g_volume_vec;
+typedef vertex_id_t cluster_id_t;
+typedef safs::page_byte_array::seq_const_iterator<edge_count> data_seq_iterator;
 
-	typedef safs::page_byte_array::seq_const_iterator<edge_count> data_seq_iterator;
-	typedef vertex_id_t cluster_id_t;
+// The number of sub-rounds in a sweep of local moving.
+const int NUM_COLORS = 4;
+const int MAX_SWEEPS = 32;
+// A sweep or a level with a smaller modularity gain than this is considered
+// converged.
+const double MIN_MODULARITY_GAIN = 1e-6;
 
+enum louvain_stage_t
+{
+	INIT_DEGREE,
+	MOVE,
+	CONTRACT,
+};
+
+/*
+ * The in-memory state of all vertices and clusters in a level.
+ * A cluster is identified by the ID of a vertex in the level.
+ */
+class louvain_level
+{
+public:
+	louvain_stage_t stage;
+	bool directed;
+	bool weighted;
+	size_t num_vertices;
+	// The sum of the edge weights of each vertex.
+	std::vector<uint64_t> degrees;
+	// The sum of the degrees of all vertices.
+	double two_m;
+	std::vector<cluster_id_t> clusters;
+	std::vector<atomic_number<long> > cluster_tots;
+	std::vector<atomic_number<long> > cluster_sizes;
+	// The vertices evaluated in the current sweep and the next sweep.
+	std::vector<char> active;
+	std::vector<char> next_active;
+	int sweep;
+	int color;
+	// The ID of a cluster in the contracted graph.
+	std::vector<cluster_id_t> new_ids;
+	size_t num_clusters;
+	// The number of partitions of the contracted edges.
+	int num_parts;
+
+	louvain_level(size_t num_vertices, bool directed, bool weighted,
+			int num_parts): degrees(num_vertices), clusters(num_vertices),
+			cluster_tots(num_vertices), cluster_sizes(num_vertices),
+			active(num_vertices), next_active(num_vertices) {
+		this->stage = MOVE;
+		this->directed = directed;
+		this->weighted = weighted;
+		this->num_vertices = num_vertices;
+		this->two_m = 0;
+		this->sweep = 0;
+		this->color = 0;
+		this->num_clusters = 0;
+		this->num_parts = num_parts;
+	}
 
-	uint64_t g_edge_weight = 0;
-	bool g_changed = false;
-	stage_t louvain_stage = INIT; // Init the stage
-
-	// If anything changes cluster we cannot converge
-	static void set_changed(bool changed) {
-		if (!changed) // Only once per iter so no prob with this
-			g_changed = changed;
-		if (changed && (!g_changed))
-			g_changed = changed;
+	int get_color(vertex_id_t id) const {
+		uint64_t h = ((uint64_t) id + 1) * 0x9E3779B97F4A7C15ULL
+			+ sweep * 0xBF58476D1CE4E5B9ULL;
+		h ^= h >> 31;
+		h *= 0x94D049BB133111EBULL;
+		return (h >> 32) % NUM_COLORS;
 	}
+};
 
-	// Easy printer for cluster
-	template<typename T>
-		static void print_vector(typename std::vector<T>& v) {
-			std::cout << "[ ";
-			for (typename std::vector<T>::iterator it = v.begin(); it != v.end(); ++it) {
-				std::cout << *it << " ";
-			}
-			std::cout << "]\n";
-		}
+/*
+ * Invoke `func' on every edge of a vertex with the edge weight.
+ */
+template<class func_t>
+void for_each_edge(const page_vertex &vertex, edge_type type,
+		const louvain_level &level, func_t &func)
+{
+	edge_seq_iterator id_it = vertex.get_neigh_seq_it(type);
+	if (!level.weighted) {
+		while (id_it.has_next())
+			func(id_it.next(), 1);
+		return;
+	}
 
-	class louvain_vertex: public compute_vertex
-	{
-		cluster_id_t cluster_id; // current cluster
-		cluster_id_t next_cluster_id; // current cluster
-		float max_modularity; // max modularity to any cluster
-		uint32_t weight;
-		uint32_t volume;
-		bool update_globals;
-
-		public:
-		louvain_vertex(vertex_id_t id): compute_vertex(id) {
-			cluster_id = id;
-			next_cluster_id = id;
-			max_modularity = 0;
-			weight = 0;
-			volume = 0;
-			update_globals = false;
-		}
+	data_seq_iterator weight_it = level.directed
+		? ((const page_directed_vertex &) vertex).get_data_seq_it<edge_count>(type)
+		: ((const page_undirected_vertex &) vertex).get_data_seq_it<edge_count>();
+	while (id_it.has_next())
+		func(id_it.next(), weight_it.next().get_count());
+}
 
-		void run(vertex_program &prog) {
-			if (update_globals) {
-				if (cluster_id != next_cluster_id)
-					switch_clusters();
-				else
-					BOOST_LOG_TRIVIAL(info) << "ignoring ...";
-				update_globals = false;
-			} else {
-				vertex_id_t id = prog.get_vertex_id(*this);
-				request_vertices(&id, 1);
-			}
-		}
+template<class func_t>
+void for_each_edge(const page_vertex &vertex, const louvain_level &level,
+		func_t &func)
+{
+	if (level.directed) {
+		for_each_edge(vertex, edge_type::IN_EDGE, level, func);
+		for_each_edge(vertex, edge_type::OUT_EDGE, level, func);
+	}
+	else
+		for_each_edge(vertex, edge_type::OUT_EDGE, level, func);
+}
 
-		void run(vertex_program &prog, const page_vertex &vertex);
-		void run_on_message(vertex_program &prog, const vertex_message &msg1);
+class louvain_vertex: public compute_vertex
+{
+public:
+	louvain_vertex(vertex_id_t id): compute_vertex(id) {
+	}
 
-		void compute_modularity(cluster_id_t neigh_cluster_id, vertex_id_t my_id, vertex_program& prog);
-		void compute_per_vertex_vol_weight(data_seq_iterator& weight_it, edge_seq_iterator& id_it, 
-				vertex_program &prog);
-		void compute_per_cluster_vol_weight(vertex_program &prog);
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
 
-		// Used for save_query join
-		const cluster_id_t get_result() const {
-			return cluster_id;
-		}
+	void run(vertex_program &prog, const page_vertex &vertex);
 
-		// Remove vertex from old cluster 
-		void switch_clusters () {
-			BOOST_LOG_TRIVIAL(info) << " Switching! Moving from c" << cluster_id << " to c" << next_cluster_id;
-			g_weight_vec[cluster_id].minus_eq(weight);
-			g_volume_vec[cluster_id].minus_eq(volume);
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
 
-			cluster_id = next_cluster_id;
-			g_weight_vec[cluster_id].plus_eq(weight);
-			g_volume_vec[cluster_id].plus_eq(volume);
-		}
+	void move(vertex_program &prog, const page_vertex &vertex);
+	void contract(vertex_program &prog, const page_vertex &vertex);
+};
 
-		//void notify_iteration_end(vertex_program &vprog);
+/*
+ * The contracted edges are keyed by (from * num_clusters + to) and are
+ * partitioned by their source so that the partitions can be merged
+ * in parallel.
+ */
+typedef std::unordered_map<uint64_t, uint64_t> edge_map_t;
 
-	};
+class louvain_vertex_program: public vertex_program_impl<louvain_vertex>
+{
+	louvain_level &level;
+	// The weights of the edges from the current vertex to each cluster.
+	std::unordered_map<cluster_id_t, uint64_t> neigh_weights;
+	// The vertices that move in the sub-round and their new clusters.
+	// A vertex may run in a thread that doesn't own it, so the moves are
+	// applied after the sub-round instead of in the owner threads.
+	std::vector<std::pair<vertex_id_t, cluster_id_t> > moves;
+	double gain;
+	std::vector<edge_map_t> edge_parts;
+public:
+	typedef std::shared_ptr<louvain_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<louvain_vertex_program, vertex_program>(
+				prog);
+	}
 
-	/* We need this to get the total edge_weight of the graph */
-	class init_vertex_program: public vertex_program_impl<louvain_vertex>
-	{
-		// Thread local
-		edge_count th_local_edge_count; // For the global edge count
+	louvain_vertex_program(louvain_level &_level): level(_level), edge_parts(
+			_level.num_parts) {
+		gain = 0;
+	}
 
-		public:
-		init_vertex_program() {
-			th_local_edge_count = 0;
-		}
+	louvain_level &get_level() {
+		return level;
+	}
 
-		typedef std::shared_ptr<init_vertex_program> ptr;
+	std::unordered_map<cluster_id_t, uint64_t> &get_neigh_weights() {
+		return neigh_weights;
+	}
 
-		static ptr cast2(vertex_program::ptr prog) {
-			return std::static_pointer_cast<init_vertex_program, vertex_program>(prog);
-		}
+	void add_move(vertex_id_t id, cluster_id_t cluster, double gain) {
+		moves.push_back(std::pair<vertex_id_t, cluster_id_t>(id, cluster));
+		this->gain += gain;
+	}
 
-		void pp_ec(edge_count weight) {
-			this->th_local_edge_count += weight;
-		}
+	const std::vector<std::pair<vertex_id_t, cluster_id_t> > &get_moves() const {
+		return moves;
+	}
 
-		const uint32_t get_local_ec() const {
-			return th_local_edge_count.get_count();
-		}
-	};
-
-	/* We need this to do the INIT phase and pass vertex_program_impl to the start method */
-	class init_vertex_program_creater: public vertex_program_creater
-	{
-		public:
-			vertex_program::ptr create() const {
-				return vertex_program::ptr(new init_vertex_program());
-			}
-	};
+	double get_gain() const {
+		return gain;
+	}
 
-	class cluster_message: public vertex_message
-	{
-		cluster_id_t sender_cluster_id;
+	void add_edge(cluster_id_t from, cluster_id_t to, uint64_t weight) {
+		edge_parts[from % edge_parts.size()][((uint64_t) from)
+			* level.num_clusters + to] += weight;
+	}
 
-		public:
-		cluster_message(cluster_id_t cluster_id):
-			vertex_message(sizeof(cluster_message), true)	{
-				this->sender_cluster_id = cluster_id;
-			}
+	edge_map_t &get_edge_part(int idx) {
+		return edge_parts[idx];
+	}
+};
 
-		const cluster_id_t get_sender_cluster_id() const {
-			return sender_cluster_id;
-		}
-	};
-
-	void louvain_vertex::run(vertex_program &prog, const page_vertex &vertex) {
-		switch (louvain_stage) {
-			case INIT: /* INIT just accums the global edge_count */
-				{
-					// Out edges
-					data_seq_iterator weight_it = 
-						((const page_directed_vertex&)vertex).get_data_seq_it<edge_count>(OUT_EDGE);
-					edge_seq_iterator id_it = vertex.get_neigh_seq_it(OUT_EDGE);
-					compute_per_vertex_vol_weight(weight_it, id_it, prog);
-
-					// In edges
-					weight_it = ((const page_directed_vertex&)vertex).
-						get_data_seq_it<edge_count>(IN_EDGE);
-					id_it = vertex.get_neigh_seq_it(IN_EDGE);
-					compute_per_vertex_vol_weight(weight_it, id_it, prog);
-				}
-				break;
-			case RUN:
-				{
-					// Broadcast cluster_id to all my neighbors then rely on run_on_message
-					// Out edges
-					edge_seq_iterator id_it = vertex.get_neigh_seq_it(OUT_EDGE);
-					cluster_message out_msg(this->cluster_id);
-					prog.multicast_msg(id_it, out_msg);
-
-					// In edges
-					id_it = vertex.get_neigh_seq_it(IN_EDGE);
-					cluster_message in_msg(this->cluster_id);
-					prog.multicast_msg(id_it, in_msg);
-				}
-				break;
-			default:
-				assert(0);
-		}
+class louvain_vertex_program_creater: public vertex_program_creater
+{
+	louvain_level &level;
+public:
+	louvain_vertex_program_creater(louvain_level &_level): level(_level) {
 	}
 
-	void louvain_vertex::run_on_message(vertex_program &prog, const vertex_message &msg1) {
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new louvain_vertex_program(level));
+	}
+};
 
-		if (!update_globals) 
-			update_globals = true;
+struct degree_adder
+{
+	uint64_t degree;
 
-		const cluster_message& msg = (const cluster_message& ) msg1;
-		if (msg.get_sender_cluster_id() == next_cluster_id) { 
-			return; // Ignore since my cluster will not change
-		} else {
-			// This may update the next_cluster_id and max_modularity values
-			compute_modularity(msg.get_sender_cluster_id(), prog.get_vertex_id(*this), prog);
+	degree_adder() {
+		degree = 0;
+	}
 
-		}
+	void operator()(vertex_id_t id, uint64_t weight) {
+		degree += weight;
 	}
+};
 
-	// Tradeoff by iterating through neighbors, instead of the min computation which is every cluster.
-	void louvain_vertex::compute_modularity(cluster_id_t neigh_cluster_id, vertex_id_t my_id, vertex_program& prog) {
+struct neigh_weight_adder
+{
+	const louvain_level &level;
+	vertex_id_t self;
+	std::unordered_map<cluster_id_t, uint64_t> &weights;
+
+	neigh_weight_adder(const louvain_level &_level, vertex_id_t self,
+			std::unordered_map<cluster_id_t, uint64_t> &_weights): level(
+				_level), weights(_weights) {
+		this->self = self;
+	}
 
-		// TODO: Remove divisions & hope for no overflow
-		float delta_mod = ((int)(g_weight_vec[neigh_cluster_id].get() - 
-					(g_weight_vec[this->next_cluster_id].get() - this->weight)) / (float) g_edge_weight) +
-			(((int)((g_volume_vec[this->next_cluster_id].get() - this->volume) - g_volume_vec[neigh_cluster_id].get()) 
-			  * (int)this->volume) / (float)(2*(g_edge_weight*g_edge_weight)));
+	void operator()(vertex_id_t id, uint64_t weight) {
+		// A self-loop doesn't connect the vertex to any cluster.
+		if (id != self)
+			weights[level.clusters[id]] += weight;
+	}
+};
 
-		if (delta_mod > this->max_modularity) {
-#if 1
-			/** DEBUG **/
-			BOOST_LOG_TRIVIAL(info) << "v" << my_id << " tentative move from c" <<  cluster_id << " to c"
-				<< neigh_cluster_id << ", delta_mod="<< delta_mod << " > max_mod=" << max_modularity << "\n";
-			/** GUBED **/
-#endif
-			max_modularity = delta_mod;
-			this->next_cluster_id = neigh_cluster_id;
-			//BOOST_LOG_TRIVIAL(info) << "Activating v" << my_id << " for the switch iteration";
-			set_changed(true); // Global notification of cluster change
+struct neigh_activator
+{
+	louvain_level &level;
 
-			//prog.request_notify_iter_end(*this);
-			//prog.activate_vertices(&my_id,1); // Activate myself so I can change my clusters metadata
-		}
+	neigh_activator(louvain_level &_level): level(_level) {
 	}
 
-#if 0
-	void louvain_vertex::notify_iteration_end(vertex_program &prog) {
-		assert (next_cluster_id != cluster_id);
-		vertex_id_t my_id = prog.get_vertex_id(*this);
-		prog.activate_vertices(&my_id,1); // Activate myself so I can change my clusters metadata in NEXT iteration
+	void operator()(vertex_id_t id, uint64_t weight) {
+		level.next_active[id] = 1;
 	}
+};
 
-#endif
+struct edge_contractor
+{
+	louvain_vertex_program &prog;
+	const louvain_level &level;
+	cluster_id_t from;
 
-	// Only need to do this once per vertex ever
-	void louvain_vertex::compute_per_vertex_vol_weight(data_seq_iterator& weight_it, edge_seq_iterator& id_it, 
-			vertex_program &prog) {
-		edge_count local_edge_weight = 0;
-		uint32_t self_edge_weight = 0;
+	edge_contractor(louvain_vertex_program &_prog,
+			cluster_id_t from): prog(_prog), level(_prog.get_level()) {
+		this->from = from;
+	}
 
-		while (weight_it.has_next()) {
-			edge_count e = weight_it.next();
-			vertex_id_t nid = id_it.next();
+	void operator()(vertex_id_t id, uint64_t weight) {
+		prog.add_edge(from, level.new_ids[level.clusters[id]], weight);
+	}
+};
 
-			local_edge_weight += e.get_count();
-			if (nid == prog.get_vertex_id(*this)) {
-				self_edge_weight += e.get_count();
-			}
+void louvain_vertex::move(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	louvain_level &level = lprog.get_level();
+	vertex_id_t id = prog.get_vertex_id(*this);
+	std::unordered_map<cluster_id_t, uint64_t> &weights
+		= lprog.get_neigh_weights();
+	weights.clear();
+	neigh_weight_adder adder(level, id, weights);
+	for_each_edge(vertex, level, adder);
+
+	// The gain of joining a cluster is proportional to
+	// w(v, C) - k(v) * tot(C) / 2m, where tot(C) excludes the vertex.
+	cluster_id_t own = level.clusters[id];
+	double k = level.degrees[id];
+	std::unordered_map<cluster_id_t, uint64_t>::const_iterator it
+		= weights.find(own);
+	double own_score = (it == weights.end() ? 0 : it->second)
+		- k * (level.cluster_tots[own].get() - k) / level.two_m;
+	bool singleton = level.cluster_sizes[own].get() == 1;
+	cluster_id_t best = own;
+	double best_score = own_score;
+	for (it = weights.begin(); it != weights.end(); it++) {
+		cluster_id_t c = it->first;
+		if (c == own)
+			continue;
+		if (singleton && level.cluster_sizes[c].get() == 1 && c > own)
+			continue;
+		double score = it->second - k * level.cluster_tots[c].get()
+			/ level.two_m;
+		if (score > best_score || (score == best_score && best != own
+					&& c < best)) {
+			best = c;
+			best_score = score;
 		}
+	}
+	if (best == own)
+		return;
 
-		((init_vertex_program&)prog).
-			pp_ec(local_edge_weight);
-		this->volume += local_edge_weight.get_count() + (2*self_edge_weight);
-		this->weight += local_edge_weight.get_count() + self_edge_weight;
+	lprog.add_move(id, best, 2 * (best_score - own_score) / level.two_m);
+	// The moves of the neighbors may change after the vertex moves.
+	level.next_active[id] = 1;
+	neigh_activator activator(level);
+	for_each_edge(vertex, level, activator);
+}
+
+void louvain_vertex::contract(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	louvain_level &level = lprog.get_level();
+	vertex_id_t id = prog.get_vertex_id(*this);
+	edge_contractor contractor(lprog, level.new_ids[level.clusters[id]]);
+	for_each_edge(vertex, level, contractor);
+}
 
-		// Aggregate for the cluster INIT
-		g_weight_vec[cluster_id].plus_eq(local_edge_weight.get_count() + self_edge_weight);
-		g_volume_vec[cluster_id].plus_eq(local_edge_weight.get_count() + (2*self_edge_weight));
+void louvain_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_level &level = ((louvain_vertex_program &) prog).get_level();
+	switch (level.stage) {
+		case INIT_DEGREE:
+			{
+				degree_adder adder;
+				for_each_edge(vertex, level, adder);
+				level.degrees[prog.get_vertex_id(*this)] = adder.degree;
+			}
+			break;
+		case MOVE:
+			move(prog, vertex);
+			break;
+		case CONTRACT:
+			contract(prog, vertex);
+			break;
+		default:
+			assert(0);
 	}
 }
 
-namespace fg 
+/*
+ * The moves decided in a sub-round are applied here after all vertices
+ * in the sub-round have been evaluated.
+ */
+void apply_moves(louvain_level &level,
+		const std::vector<std::pair<vertex_id_t, cluster_id_t> > &moves)
 {
-	void compute_louvain(FG_graph::ptr fg, const uint32_t levels)
-	{
-		graph_index::ptr index = NUMA_graph_index<louvain_vertex>::create(
-				fg->get_graph_header());
-		graph_engine::ptr graph = fg->create_engine(index);
+	for (size_t i = 0; i < moves.size(); i++) {
+		vertex_id_t id = moves[i].first;
+		cluster_id_t own = level.clusters[id];
+		cluster_id_t next = moves[i].second;
+		long k = level.degrees[id];
+		level.cluster_tots[own].dec(k);
+		level.cluster_sizes[own].dec(1);
+		level.cluster_tots[next].inc(k);
+		level.cluster_sizes[next].inc(1);
+		level.clusters[id] = next;
+	}
+}
 
-		BOOST_LOG_TRIVIAL(info) << "Starting Louvain with " << levels << " levels";
-		BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file().c_str();
-#ifdef PROFILER
-		if (!graph_conf.get_prof_file().empty())
-			ProfilerStart(graph_conf.get_prof_file().c_str());
-#endif
+class move_filter: public vertex_filter
+{
+	const louvain_level &level;
+public:
+	move_filter(const louvain_level &_level): level(_level) {
+	}
+
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vertex_id_t id = prog.get_vertex_id(v);
+		return level.active[id] && level.get_color(id) == level.color;
+	}
+};
+
+/*
+ * Move vertices among clusters until the modularity gain of a sweep
+ * is too small.
+ */
+void move_vertices(graph_engine::ptr graph, louvain_level &level)
+{
+	std::fill(level.active.begin(), level.active.end(), 1);
+	level.stage = MOVE;
+	for (level.sweep = 0; level.sweep < MAX_SWEEPS; level.sweep++) {
+		std::fill(level.next_active.begin(), level.next_active.end(), 0);
+		size_t num_moves = 0;
+		double gain = 0;
+		for (level.color = 0; level.color < NUM_COLORS; level.color++) {
+			graph->start(std::shared_ptr<vertex_filter>(
+						new move_filter(level)), vertex_program_creater::ptr(
+						new louvain_vertex_program_creater(level)));
+			graph->wait4complete();
 
-		struct timeval start, end;
-		gettimeofday(&start, NULL);
-		// Resize weight and volume vectors
-		BOOST_LOG_TRIVIAL(info) << "Resizing vectors to " << graph->get_num_vertices() << "\n";
-		g_weight_vec.resize(graph->get_num_vertices(), atomicwrapper<uint32_t>(0));
-		g_volume_vec.resize(graph->get_num_vertices(), atomicwrapper<uint32_t>(0));
-
-		/*~~~~~~~~~~~~~~~~~~~~~~~~~~ Compute Vol & Weight ~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-		graph->start_all(vertex_initializer::ptr(), 
-				vertex_program_creater::ptr(new init_vertex_program_creater()));
-		graph->wait4complete();
-
-		// Aggregate the global edge-weight
-		std::vector<vertex_program::ptr> ec_progs;
-		graph->get_vertex_programs(ec_progs);
-		BOOST_FOREACH(vertex_program::ptr vprog, ec_progs) {
-			init_vertex_program::ptr lvp = init_vertex_program::cast2(vprog);
-			g_edge_weight += lvp->get_local_ec(); 
+			std::vector<vertex_program::ptr> vprogs;
+			graph->get_vertex_programs(vprogs);
+			BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+				louvain_vertex_program::ptr lprog
+					= louvain_vertex_program::cast2(vprog);
+				apply_moves(level, lprog->get_moves());
+				num_moves += lprog->get_moves().size();
+				gain += lprog->get_gain();
+			}
 		}
-		BOOST_LOG_TRIVIAL(info) << "The graph's total edge weight is " << g_edge_weight << "\n";
+		level.active.swap(level.next_active);
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("sweep %1%: %2% vertices move, modularity gain: %3%")
+			% level.sweep % num_moves % gain;
+		if (num_moves == 0 || gain < MIN_MODULARITY_GAIN)
+			break;
+	}
+}
 
-		int iter = 0;
-		do {
-			set_changed(false);
-			/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Compute modularity ~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-			louvain_stage = RUN;
-			BOOST_LOG_TRIVIAL(info) << "\n\n\x1B[31m****************** LEVEL ITERATION: " << iter++ 
-				<< " ********************************\x1B[0m\n\n";
+/*
+ * The contracted graph of a level.
+ */
+struct contracted_graph
+{
+	FG_graph::ptr graph;
+	// The degree of each vertex in the contracted graph.
+	std::vector<uint64_t> degrees;
+	double modularity;
+	// The name of the graph file in SAFS if the graph is stored in SAFS.
+	std::string safs_file;
+};
+
+/*
+ * Build the graph whose vertices are the clusters of the level.
+ * The merged edges and the serialized graph are all in memory.
+ */
+contracted_graph contract(graph_engine::ptr graph, louvain_level &level,
+		config_map::ptr configs, const std::string &name)
+{
+	level.stage = CONTRACT;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new louvain_vertex_program_creater(level)));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	// Merge the edges combined by the worker threads. Each partition
+	// contains the edges of different source vertices.
+	size_t num_clusters = level.num_clusters;
+	std::vector<std::vector<std::pair<cluster_id_t, uint64_t> > > adjs(
+			num_clusters);
+#pragma omp parallel for
+	for (int i = 0; i < level.num_parts; i++) {
+		edge_map_t merged;
+		for (size_t j = 0; j < vprogs.size(); j++) {
+			edge_map_t &part = louvain_vertex_program::cast2(
+					vprogs[j])->get_edge_part(i);
+			for (edge_map_t::const_iterator it = part.begin();
+					it != part.end(); it++)
+				merged[it->first] += it->second;
+			edge_map_t().swap(part);
+		}
+		for (edge_map_t::const_iterator it = merged.begin();
+				it != merged.end(); it++)
+			adjs[it->first / num_clusters].push_back(
+					std::pair<cluster_id_t, uint64_t>(
+						it->first % num_clusters, it->second));
+	}
 
-			graph->start_all();
-			graph->wait4complete();
+	contracted_graph ret;
+	ret.degrees.resize(num_clusters);
+	double internal = 0;
+	double tot_sq = 0;
+	utils::mem_serial_graph::ptr serial_g = utils::mem_serial_graph::create(
+			false, sizeof(edge_count));
+	bool overflow = false;
+	for (size_t i = 0; i < num_clusters; i++) {
+		std::sort(adjs[i].begin(), adjs[i].end());
+		in_mem_undirected_vertex<edge_count> v(i, true);
+		uint64_t degree = 0;
+		for (size_t j = 0; j < adjs[i].size(); j++) {
+			uint64_t weight = adjs[i][j].second;
+			degree += weight;
+			if (adjs[i][j].first == i)
+				internal += weight;
+			if (weight > std::numeric_limits<uint32_t>::max()) {
+				overflow = true;
+				weight = std::numeric_limits<uint32_t>::max();
+			}
+			v.add_edge(edge<edge_count>(i, adjs[i][j].first,
+						edge_count(weight)));
+		}
+		std::vector<std::pair<cluster_id_t, uint64_t> >().swap(adjs[i]);
+		serial_g->add_vertex(v);
+		ret.degrees[i] = degree;
+		tot_sq += ((double) degree / level.two_m) * ((double) degree / level.two_m);
+	}
+	if (overflow)
+		BOOST_LOG_TRIVIAL(warning)
+			<< "the weights of some contracted edges are truncated to 32 bits";
+	ret.modularity = internal / level.two_m - tot_sq;
+
+	in_mem_graph::ptr graph_data = serial_g->dump_graph(name);
+	vertex_index::ptr index_data = serial_g->dump_index(true);
+	serial_g.reset();
+	// The contracted graph is kept in memory if it fits in the page cache.
+	// Otherwise, it's written to SAFS and accessed like the original graph.
+	size_t graph_size = graph_data->get_size();
+	if (graph_conf.use_in_mem_graph() || !safs::is_safs_init()
+			|| !safs::params.is_writable()
+			|| graph_size <= (size_t) safs::params.get_cache_size())
+		ret.graph = FG_graph::create(graph_data, index_data, name, configs);
+	else {
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("write the contracted graph of %1% bytes to SAFS")
+			% graph_size;
+		graph_data->dump_safs(name);
+		graph_data.reset();
+		ret.graph = FG_graph::create(name, index_data, configs);
+		ret.safs_file = name;
+	}
+	return ret;
+}
 
-#if 1
-			/** DEBUG **/
-			FG_vector<cluster_id_t>::ptr ret = FG_vector<cluster_id_t>::create(
-					graph->get_num_vertices());
-			graph->query_on_all(vertex_query::ptr(new save_query<cluster_id_t, louvain_vertex>(ret)));
-			BOOST_LOG_TRIVIAL(info) << "Printing vertex clusters:";
-			ret->print(); 
-			/** GUBED **/
-#endif
-#if 1
-			/** DEBUG **/
-			BOOST_LOG_TRIVIAL(info) << "\x1B[31m===========================================\x1B[0m\n";
-			BOOST_LOG_TRIVIAL(info) << "Global volume vector:";
-			print_atomicwrapper_v(g_volume_vec);
-
-			BOOST_LOG_TRIVIAL(info) << "Global weight vector:";
-			print_atomicwrapper_v(g_weight_vec);
-			BOOST_LOG_TRIVIAL(info) << "\x1B[31m===========================================\x1B[0m\n";
-			/** GUBED **/
-			if (g_changed) BOOST_LOG_TRIVIAL(info) << "Loop continues!";
-			else BOOST_LOG_TRIVIAL(info) << "Loop ending!";
-
-			//if (iter > 2) { fprintf(stderr, "Premature kill"); exit(-1); } 
-			/** GUBED **/
-#endif
-		} while (g_changed);
-
-#if 1
-		/** DEBUG **/
-		FG_vector<cluster_id_t>::ptr ret = FG_vector<cluster_id_t>::create(
-				graph->get_num_vertices());
-		graph->query_on_all(vertex_query::ptr(new save_query<cluster_id_t, louvain_vertex>(ret)));
-		BOOST_LOG_TRIVIAL(info) << "\nVertex clusters @ end of Level1:";
-		ret->print(); 
-		/** GUBED **/
+void delete_safs_file(const std::string &name)
+{
+	if (name.empty())
+		return;
+	safs::safs_file f(safs::get_sys_RAID_conf(), name);
+	if (!f.delete_file())
+		BOOST_LOG_TRIVIAL(error) << "can't delete SAFS file " << name;
+}
+
+}
+
+namespace fg
+{
+
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg,
+		uint32_t levels, std::vector<double> &modularity)
+{
+	BOOST_LOG_TRIVIAL(info) << "Starting Louvain with " << levels << " levels";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
 #endif
 
-		louvain_stage = REBUILD; // TODO: Do something here
-		BOOST_LOG_TRIVIAL(info) << "\n Reached rebuild graph stage\n"; 
-		gettimeofday(&end, NULL);
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	size_t num_vertices = fg->get_graph_header().get_num_vertices();
+	std::vector<vertex_id_t> membership(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		membership[i] = i;
+
+	int num_parts = graph_conf.get_num_threads();
+	FG_graph::ptr curr_fg = fg;
+	std::vector<uint64_t> degrees;
+	std::string safs_file;
+	modularity.clear();
+	for (uint32_t lvl = 0; levels == 0 || lvl < levels; lvl++) {
+		// The input graph can be directed or unweighted, but the contracted
+		// graphs are undirected and weighted.
+		const graph_header &header = curr_fg->get_graph_header();
+		bool directed = header.is_directed_graph();
+		bool weighted = header.has_edge_data()
+			&& header.get_edge_data_size() == sizeof(edge_count);
+		graph_index::ptr index = NUMA_graph_index<louvain_vertex>::create(
+				curr_fg->get_graph_header());
+		graph_engine::ptr graph = curr_fg->create_engine(index);
+		louvain_level level(graph->get_num_vertices(), directed, weighted,
+				num_parts);
+
+		// The degrees of the contracted graph are known when it's built.
+		if (!degrees.empty())
+			level.degrees.swap(degrees);
+		else if (weighted) {
+			level.stage = INIT_DEGREE;
+			graph->start_all(vertex_initializer::ptr(),
+					vertex_program_creater::ptr(
+						new louvain_vertex_program_creater(level)));
+			graph->wait4complete();
+		}
+		else {
+			edge_type type = directed ? edge_type::BOTH_EDGES
+				: edge_type::OUT_EDGE;
+			for (size_t i = 0; i < level.num_vertices; i++)
+				level.degrees[i] = graph->get_num_edges(i, type);
+		}
+		for (size_t i = 0; i < level.num_vertices; i++) {
+			level.clusters[i] = i;
+			level.cluster_tots[i] = atomic_number<long>(level.degrees[i]);
+			level.cluster_sizes[i] = atomic_number<long>(1);
+			level.two_m += level.degrees[i];
+		}
+		if (level.two_m == 0)
+			break;
+
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("level %1% has %2% vertices")
+			% lvl % level.num_vertices;
+		move_vertices(graph, level);
+
+		// Number the clusters contiguously.
+		level.new_ids.resize(level.num_vertices,
+				std::numeric_limits<cluster_id_t>::max());
+		for (size_t i = 0; i < level.num_vertices; i++) {
+			cluster_id_t c = level.clusters[i];
+			if (level.new_ids[c] == std::numeric_limits<cluster_id_t>::max())
+				level.new_ids[c] = level.num_clusters++;
+		}
+		if (level.num_clusters == level.num_vertices)
+			break;
+
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			membership[i] = level.new_ids[level.clusters[membership[i]]];
+
+		std::string name = boost::str(boost::format("louvain-%1%-level%2%")
+				% getpid() % (lvl + 1));
+		contracted_graph contracted = contract(graph, level,
+				fg->get_configs(), name);
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("level %1% has %2% clusters with modularity %3%")
+			% lvl % level.num_clusters % contracted.modularity;
+
+		graph.reset();
+		delete_safs_file(safs_file);
+		curr_fg = contracted.graph;
+		degrees.swap(contracted.degrees);
+		safs_file = contracted.safs_file;
+
+		double prev = modularity.empty() ? -1 : modularity.back();
+		modularity.push_back(contracted.modularity);
+		if (contracted.modularity - prev < MIN_MODULARITY_GAIN)
+			break;
+	}
+	curr_fg.reset();
+	delete_safs_file(safs_file);
 
+	gettimeofday(&end, NULL);
 #ifdef PROFILER
-		if (!graph_conf.get_prof_file().empty())
-			ProfilerStop();
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
 #endif
+	BOOST_LOG_TRIVIAL(info) << boost::format("Louvain takes %1% seconds")
+		% time_diff(start, end);
+
+	FG_vector<vertex_id_t>::ptr ret = FG_vector<vertex_id_t>::create(
+			num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		ret->set(i, membership[i]);
+	return ret;
+}
 
-		BOOST_LOG_TRIVIAL(info) << boost::format("It takes %1% seconds")
-			% time_diff(start, end);
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg, uint32_t levels)
+{
+	std::vector<double> modularity;
+	return compute_louvain(fg, levels, modularity);
+}
 
-		return;
-	}
 }
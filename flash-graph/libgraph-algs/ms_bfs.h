@@ -0,0 +1,395 @@
+#ifndef __MS_BFS_H__
+#define __MS_BFS_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+
+/*
+ * This is the multi-source BFS (MS-BFS). It runs BFS from many sources
+ * together. Each vertex keeps a bitmap of the sources that have reached
+ * it, and a vertex in the frontier of any source reads its adjacency list
+ * once and sends the bitmap of the sources in its frontier to all of its
+ * neighbors. As a result, all sources are advanced by one level with
+ * a single read of each adjacency list, instead of one read per source.
+ */
+
+namespace fg
+{
+
+/*
+ * A bitmap of BFS sources. It has NUM_WORDS * 64 bits.
+ */
+template<int NUM_WORDS>
+class source_set
+{
+	uint64_t words[NUM_WORDS];
+public:
+	static const int MAX_SOURCES = NUM_WORDS * 64;
+
+	source_set() {
+		clear();
+	}
+
+	void clear() {
+		memset(words, 0, sizeof(words));
+	}
+
+	void set(int idx) {
+		assert(idx < MAX_SOURCES);
+		words[idx / 64] |= 1UL << (idx % 64);
+	}
+
+	bool test(int idx) const {
+		assert(idx < MAX_SOURCES);
+		return words[idx / 64] & (1UL << (idx % 64));
+	}
+
+	bool any() const {
+		for (int i = 0; i < NUM_WORDS; i++)
+			if (words[i])
+				return true;
+		return false;
+	}
+
+	size_t count() const {
+		size_t ret = 0;
+		for (int i = 0; i < NUM_WORDS; i++)
+			ret += __builtin_popcountl(words[i]);
+		return ret;
+	}
+
+	source_set<NUM_WORDS> &operator|=(const source_set<NUM_WORDS> &set) {
+		for (int i = 0; i < NUM_WORDS; i++)
+			words[i] |= set.words[i];
+		return *this;
+	}
+
+	/*
+	 * Get the sources in this set but not in the other set.
+	 */
+	source_set<NUM_WORDS> minus(const source_set<NUM_WORDS> &set) const {
+		source_set<NUM_WORDS> ret;
+		for (int i = 0; i < NUM_WORDS; i++)
+			ret.words[i] = words[i] & ~set.words[i];
+		return ret;
+	}
+
+	/*
+	 * Invoke `func' on the index of each source in the set.
+	 */
+	template<class Func>
+	void for_each(Func &func) const {
+		for (int i = 0; i < NUM_WORDS; i++) {
+			uint64_t word = words[i];
+			while (word) {
+				int idx = __builtin_ctzl(word);
+				func(i * 64 + idx);
+				word &= word - 1;
+			}
+		}
+	}
+};
+
+/*
+ * A user of MS-BFS gets notified by a visitor when a vertex is reached by
+ * sources for the first time. The engine creates a visitor for each
+ * worker thread, so a visitor can keep its own statistics without locking.
+ */
+template<int NUM_WORDS>
+class ms_bfs_visitor
+{
+public:
+	typedef std::shared_ptr<ms_bfs_visitor<NUM_WORDS> > ptr;
+
+	virtual ~ms_bfs_visitor() {
+	}
+
+	/*
+	 * `sources' contains the sources that reach the vertex at the level
+	 * for the first time. The level of the sources themselves is 0.
+	 */
+	virtual void visit(vertex_id_t id, const source_set<NUM_WORDS> &sources,
+			int level) = 0;
+};
+
+template<int NUM_WORDS>
+class ms_bfs_visitor_creater
+{
+public:
+	virtual typename ms_bfs_visitor<NUM_WORDS>::ptr create() const = 0;
+};
+
+template<int NUM_WORDS>
+class ms_bfs_message: public vertex_message
+{
+	source_set<NUM_WORDS> sources;
+public:
+	ms_bfs_message(const source_set<NUM_WORDS> &sources): vertex_message(
+			sizeof(ms_bfs_message<NUM_WORDS>), true) {
+		this->sources = sources;
+	}
+
+	const source_set<NUM_WORDS> &get_sources() const {
+		return sources;
+	}
+};
+
+template<int NUM_WORDS>
+class ms_bfs_vertex;
+
+template<int NUM_WORDS>
+class ms_bfs_vertex_program: public vertex_program_impl<ms_bfs_vertex<NUM_WORDS> >
+{
+	edge_type traverse_edge;
+	int max_level;
+	typename ms_bfs_visitor<NUM_WORDS>::ptr visitor;
+public:
+	typedef std::shared_ptr<ms_bfs_vertex_program<NUM_WORDS> > ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<ms_bfs_vertex_program<NUM_WORDS>,
+			   vertex_program>(prog);
+	}
+
+	ms_bfs_vertex_program(edge_type traverse_edge, int max_level,
+			typename ms_bfs_visitor<NUM_WORDS>::ptr visitor) {
+		this->traverse_edge = traverse_edge;
+		this->max_level = max_level;
+		this->visitor = visitor;
+	}
+
+	edge_type get_traverse_edge() const {
+		return traverse_edge;
+	}
+
+	int get_max_level() const {
+		return max_level;
+	}
+
+	ms_bfs_visitor<NUM_WORDS> &get_visitor() {
+		return *visitor;
+	}
+
+	typename ms_bfs_visitor<NUM_WORDS>::ptr get_visitor_ptr() const {
+		return visitor;
+	}
+};
+
+template<int NUM_WORDS>
+class ms_bfs_vertex_program_creater: public vertex_program_creater
+{
+	edge_type traverse_edge;
+	int max_level;
+	const ms_bfs_visitor_creater<NUM_WORDS> &creater;
+public:
+	ms_bfs_vertex_program_creater(edge_type traverse_edge, int max_level,
+			const ms_bfs_visitor_creater<NUM_WORDS> &_creater): creater(_creater) {
+		this->traverse_edge = traverse_edge;
+		this->max_level = max_level;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new ms_bfs_vertex_program<NUM_WORDS>(
+					traverse_edge, max_level, creater.create()));
+	}
+};
+
+template<int NUM_WORDS>
+class ms_bfs_vertex: public compute_directed_vertex
+{
+	// The sources that have reached the vertex before the current level.
+	source_set<NUM_WORDS> seen;
+	// The sources in whose frontier the vertex is.
+	source_set<NUM_WORDS> frontier;
+	// The sources that reach the vertex in the current level.
+	source_set<NUM_WORDS> next;
+public:
+	ms_bfs_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void reset() {
+		seen.clear();
+		frontier.clear();
+		next.clear();
+	}
+
+	void init(const source_set<NUM_WORDS> &sources) {
+		seen = sources;
+		frontier = sources;
+		next.clear();
+	}
+
+	const source_set<NUM_WORDS> &get_seen() const {
+		return seen;
+	}
+
+	void run(vertex_program &prog) {
+		if (!frontier.any())
+			return;
+
+		ms_bfs_vertex_program<NUM_WORDS> &bfs_prog
+			= (ms_bfs_vertex_program<NUM_WORDS> &) prog;
+		int level = prog.get_graph().get_curr_level();
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (level == 0)
+			bfs_prog.get_visitor().visit(id, frontier, 0);
+		if (bfs_prog.get_max_level() >= 0 && level >= bfs_prog.get_max_level()) {
+			frontier.clear();
+			return;
+		}
+
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, bfs_prog.get_traverse_edge());
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		ms_bfs_vertex_program<NUM_WORDS> &bfs_prog
+			= (ms_bfs_vertex_program<NUM_WORDS> &) prog;
+		ms_bfs_message<NUM_WORDS> msg(frontier);
+		frontier.clear();
+		edge_type traverse_edge = bfs_prog.get_traverse_edge();
+		// An undirected vertex has only one adjacency list.
+		if (!prog.get_graph().is_directed())
+			traverse_edge = edge_type::OUT_EDGE;
+		if (traverse_edge == edge_type::BOTH_EDGES) {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+			prog.multicast_msg(it, msg);
+			it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+			prog.multicast_msg(it, msg);
+		}
+		else {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(traverse_edge);
+			prog.multicast_msg(it, msg);
+		}
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		const ms_bfs_message<NUM_WORDS> &bfs_msg
+			= (const ms_bfs_message<NUM_WORDS> &) msg;
+		source_set<NUM_WORDS> added = bfs_msg.get_sources().minus(seen);
+		added = added.minus(next);
+		if (!added.any())
+			return;
+		// The sources that reach the vertex in this level take effect
+		// after the level ends, so the sources in the frontier of
+		// the current level aren't mixed with the ones of the next level.
+		if (!next.any())
+			prog.request_notify_iter_end(*this);
+		next |= added;
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		ms_bfs_vertex_program<NUM_WORDS> &bfs_prog
+			= (ms_bfs_vertex_program<NUM_WORDS> &) prog;
+		int level = prog.get_graph().get_curr_level() + 1;
+		bfs_prog.get_visitor().visit(prog.get_vertex_id(*this), next, level);
+		seen |= next;
+		frontier = next;
+		next.clear();
+	}
+};
+
+template<int NUM_WORDS>
+class ms_bfs_reset: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((ms_bfs_vertex<NUM_WORDS> &) v).reset();
+	}
+};
+
+template<int NUM_WORDS>
+class ms_bfs_initializer: public vertex_initializer
+{
+	std::unordered_map<vertex_id_t, source_set<NUM_WORDS> > start_vertices;
+	graph_engine &graph;
+public:
+	ms_bfs_initializer(const std::unordered_map<vertex_id_t,
+			source_set<NUM_WORDS> > &vertices, graph_engine &_graph): graph(
+				_graph) {
+		start_vertices = vertices;
+	}
+
+	void init(compute_vertex &v) {
+		typename std::unordered_map<vertex_id_t,
+				 source_set<NUM_WORDS> >::const_iterator it
+			= start_vertices.find(graph.get_graph_index().get_vertex_id(v));
+		assert(it != start_vertices.end());
+		((ms_bfs_vertex<NUM_WORDS> &) v).init(it->second);
+	}
+};
+
+/*
+ * Run BFS from all sources together.
+ * The graph engine has to be created with the index of ms_bfs_vertex.
+ * `sources' can have at most 64 * NUM_WORDS vertices, and source i in
+ * the vector is identified by bit i in the source sets given to
+ * the visitors. The BFS stops after `max_level' levels if `max_level'
+ * isn't negative. It returns the visitors of all worker threads.
+ */
+template<int NUM_WORDS>
+std::vector<typename ms_bfs_visitor<NUM_WORDS>::ptr> ms_bfs(
+		graph_engine::ptr graph, const std::vector<vertex_id_t> &sources,
+		edge_type traverse_edge, int max_level,
+		const ms_bfs_visitor_creater<NUM_WORDS> &creater)
+{
+	assert(sources.size() <= (size_t) source_set<NUM_WORDS>::MAX_SOURCES);
+	std::unordered_map<vertex_id_t, source_set<NUM_WORDS> > start_map;
+	for (size_t i = 0; i < sources.size(); i++)
+		start_map[sources[i]].set(i);
+	std::vector<vertex_id_t> start_vertices;
+	for (typename std::unordered_map<vertex_id_t,
+			source_set<NUM_WORDS> >::const_iterator it = start_map.begin();
+			it != start_map.end(); it++)
+		start_vertices.push_back(it->first);
+
+	graph->init_all_vertices(vertex_initializer::ptr(
+				new ms_bfs_reset<NUM_WORDS>()));
+	graph->start(start_vertices.data(), start_vertices.size(),
+			vertex_initializer::ptr(new ms_bfs_initializer<NUM_WORDS>(
+					start_map, *graph)),
+			vertex_program_creater::ptr(new ms_bfs_vertex_program_creater<
+				NUM_WORDS>(traverse_edge, max_level, creater)));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	std::vector<typename ms_bfs_visitor<NUM_WORDS>::ptr> visitors;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		visitors.push_back(ms_bfs_vertex_program<NUM_WORDS>::cast2(
+					vprog)->get_visitor_ptr());
+	}
+	return visitors;
+}
+
+}
+
+#endif
@@ -28,6 +28,7 @@
 
 #include "FGlib.h"
 #include "graph_engine.h"
+#include "sorted_intersect.h"
 
 using namespace fg;
 
@@ -150,71 +151,6 @@ size_t get_unique_neighbors(const page_vertex &vertex,
 	return num_neighbors;
 }
 
-size_t get_common_vertices(const std::vector<vertex_id_t> &vertices1,
-		const std::vector<vertex_id_t> &vertices2)
-{
-	size_t common = 0;
-	size_t i, j;
-	// We assume both vectors are sorted in the ascending order.
-	// We only need to scan them together to extract the common elements.
-	for (i = 0, j = 0; i < vertices1.size() && j < vertices2.size();) {
-		if (vertices1[i] == vertices2[j]) {
-			common++;
-			i++;
-			j++;
-		}
-		else if (vertices1[i] > vertices2[j])
-			j++;
-		else
-			i++;
-
-	}
-	return common;
-}
-
-size_t get_union_vertices(const std::vector<vertex_id_t> &vertices1,
-		const std::vector<vertex_id_t> &vertices2)
-{
-	class skip_none {
-	public:
-		bool operator()(vertex_id_t id) {
-			return false;
-		}
-	};
-
-	class null_iterator: public std::iterator<std::random_access_iterator_tag, vertex_id_t> {
-		vertex_id_t id;
-		int idx;
-	public:
-		typedef typename std::iterator<std::random_access_iterator_tag,
-				vertex_id_t>::difference_type difference_type;
-
-		null_iterator() {
-			idx = 0;
-			id = 0;
-		}
-
-		vertex_id_t &operator*() {
-			return id;
-		}
-
-		null_iterator operator++(int) {
-			null_iterator it = *this;
-			idx++;
-			return it;
-		}
-
-		difference_type operator-(const null_iterator &it) {
-			return idx - it.idx;
-		}
-	};
-
-	size_t num_eles = unique_merge(vertices1.begin(), vertices1.end(),
-			vertices2.begin(), vertices2.end(), skip_none(), merge_edge(),
-			null_iterator());
-	return num_eles;
-}
-
 class overlap_vertex: public compute_vertex
 {
 	std::vector<vertex_id_t> *neighborhood;
@@ -307,8 +243,12 @@ void overlap_vertex::run_stage2(vertex_program &prog)
 			continue;
 
 		overlap_vertex &neigh = (overlap_vertex &) prog.get_graph().get_vertex(id);
-		size_t common = get_common_vertices(*neighborhood, *neigh.neighborhood);
-		size_t vunion = get_union_vertices(*neighborhood, *neigh.neighborhood);
+		size_t common = sorted_intersect_count(neighborhood->data(),
+				neighborhood->size(), neigh.neighborhood->data(),
+				neigh.neighborhood->size());
+		// Neither neighborhood has duplicated vertices.
+		size_t vunion = neighborhood->size() + neigh.neighborhood->size()
+			- common;
 		overlaps[i] = ((double) common) / vunion;
 	}
 	overlap_vertex_program &overlap_prog = (overlap_vertex_program &) prog;
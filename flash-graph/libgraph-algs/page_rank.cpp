@@ -22,10 +22,16 @@
 
 #include <limits>
 #include <cmath>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
 
 #include "graph_engine.h"
 #include "graph_config.h"
 #include "FGlib.h"
+#include "edge_stream.h"
+#include "vertex_state.h"
+#include "ext_vertex_state.h"
 
 using namespace fg;
 
@@ -47,26 +53,20 @@ enum pr_stage_t
 };
 pr_stage_t pr_stage;
 
+/*
+ * The state of pgrank_vertex is stored outside the vertices in separate
+ * arrays. A vertex reads the contribution of all of its in-neighbors
+ * in every iteration, so the contribution is kept in its own array and
+ * the gather only brings 4 bytes per in-neighbor to the CPU cache.
+ */
+vertex_state<float>::ptr curr_pr_state; // Current iteration's page rank
+// The PageRank of a vertex divided by its number of out-edges.
+vertex_state<float>::ptr contrib_state;
+
 class pgrank_vertex: public compute_directed_vertex
 {
-  float curr_itr_pr; // Current iteration's page rank
-  vsize_t num_out_edges;
-
 public:
   pgrank_vertex(vertex_id_t id): compute_directed_vertex(id) {
-    this->curr_itr_pr = 1 - DAMPING_FACTOR; // Must be this
-  }
-
-  vsize_t get_num_out_edges() const {
-	  return num_out_edges;
-  }
-
-  float get_curr_itr_pr() const{
-    return curr_itr_pr;
-  }
-
-  float get_result() const {
-	  return get_curr_itr_pr();
   }
 
   void run(vertex_program &prog);
@@ -80,7 +80,10 @@ public:
 	void run_on_vertex_header(vertex_program &prog, const vertex_header &header) {
 		assert(prog.get_vertex_id(*this) == header.get_id());
 		directed_vertex_header &dheader = (directed_vertex_header &) header;
-		this->num_out_edges = dheader.get_num_out_edges();
+		vsize_t num_out_edges = dheader.get_num_out_edges();
+		if (num_out_edges > 0)
+			contrib_state->get(prog, *this)
+				= curr_pr_state->get(prog, *this) / num_out_edges;
 	}
 };
 
@@ -104,23 +107,25 @@ void pgrank_vertex::run(vertex_program &prog, const page_vertex &vertex) {
   edge_iterator end_it = vertex.get_neigh_end(IN_EDGE);
   
   for (edge_iterator it = vertex.get_neigh_begin(IN_EDGE); it != end_it; ++it) {
-    vertex_id_t id = *it;
-    pgrank_vertex& v = (pgrank_vertex&) prog.get_graph().get_vertex(id);
     // Notice I want this iteration's pagerank
-    accum += (v.get_curr_itr_pr()/v.get_num_out_edges()); 
+    accum += contrib_state->get(*it);
   }   
 
   // Apply
   float last_change = 0;
+  int num_dests = vertex.get_num_edges(OUT_EDGE);
   if (vertex.get_num_edges(IN_EDGE) > 0) {
+    vertex_loc_t loc = prog.get_vertex_loc(*this);
+    float &curr_itr_pr = curr_pr_state->get(loc);
     float new_pr = ((1 - DAMPING_FACTOR)) + (DAMPING_FACTOR*(accum));
     last_change = new_pr - curr_itr_pr;
     curr_itr_pr = new_pr;
+    if (num_dests > 0)
+      contrib_state->get(loc) = new_pr / num_dests;
   }   
   
   // Scatter (activate your out-neighbors ... if you have any :) 
   if ( std::fabs( last_change ) > TOLERANCE ) {
-	int num_dests = vertex.get_num_edges(OUT_EDGE);
     if (num_dests > 0) {
 		edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0, num_dests);
 		prog.activate_vertices(it) ;
@@ -190,6 +195,380 @@ void pgrank_vertex2::run(vertex_program &prog, const page_vertex &vertex)
 	}
 }
 
+/*
+ * This vertex runs the same algorithm as pgrank_vertex2, but keeps its
+ * state in SAFS for the graphs whose PageRank doesn't fit in memory.
+ * The PageRank accumulated from the messages and the PageRank that
+ * a vertex has pushed to its neighbors are stored in two arrays, so
+ * the messages only add to the first one.
+ */
+struct add_apply
+{
+	void operator()(float &state, const float &delta) const {
+		state += delta;
+	}
+};
+
+typedef ext_vertex_state<float, add_apply> ext_float_state;
+ext_float_state::ptr ext_new_pr;
+ext_float_state::ptr ext_curr_pr;
+
+class ext_pgrank_vertex: public compute_directed_vertex
+{
+public:
+	ext_pgrank_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) { 
+		// We perform pagerank for at most `max_num_iters' iterations.
+		if (prog.get_graph().get_curr_level() >= max_num_iters)
+			return;
+		directed_vertex_request req(prog.get_vertex_id(*this),
+				edge_type::OUT_EDGE);
+		request_partial_vertices(&req, 1);
+	};
+
+	void run(vertex_program &, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const pr_message &msg = (const pr_message &) msg1;
+		ext_new_pr->update(prog.get_vertex_loc(*this), msg.get_delta());
+	}
+};
+
+void ext_pgrank_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	int num_dests = vertex.get_num_edges(OUT_EDGE);
+	edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0, num_dests);
+	vertex_loc_t loc = prog.get_vertex_loc(*this);
+	float curr_itr_pr = ext_curr_pr->get(loc);
+
+	// If this is the first iteration.
+	if (prog.get_graph().get_curr_level() == 0) {
+		pr_message msg(curr_itr_pr / num_dests * DAMPING_FACTOR);
+		prog.multicast_msg(it, msg);
+		return;
+	}
+
+	float new_pr = ext_new_pr->get(loc);
+	if (std::fabs(new_pr - curr_itr_pr) > TOLERANCE) {
+		pr_message msg((new_pr - curr_itr_pr) / num_dests * DAMPING_FACTOR);
+		prog.multicast_msg(it, msg);
+		ext_curr_pr->set(loc, new_pr);
+	}
+}
+
+/*
+ * This vertex runs PageRank in the edge-centric streaming mode.
+ * It pulls the contributions of its in-neighbors when its in-edges are
+ * streamed and updates its PageRank at the end of an iteration, so all
+ * vertices read the PageRank of the previous iteration.
+ */
+class pgrank_stream_vertex: public stream_compute_vertex
+{
+	float curr_itr_pr; // Current iteration's page rank
+	// The PageRank sent to each of the out-neighbors.
+	float contrib;
+	float accum;
+	vsize_t num_out_edges;
+public:
+	pgrank_stream_vertex(vertex_id_t id): stream_compute_vertex(id) {
+		this->curr_itr_pr = 1 - DAMPING_FACTOR; // Must be this
+		this->contrib = 0;
+		this->accum = 0;
+		this->num_out_edges = 0;
+	}
+
+	float get_result() const {
+		return curr_itr_pr;
+	}
+
+	void run_on_engine_start(stream_program &prog, vertex_id_t id) {
+		num_out_edges = prog.get_graph().get_num_edges(id, OUT_EDGE);
+		if (num_out_edges > 0)
+			contrib = curr_itr_pr / num_out_edges;
+	}
+
+	void run_on_edges(stream_program &prog, const page_vertex &vertex) {
+		// Gather
+		accum = 0;
+		edge_iterator end_it = vertex.get_neigh_end(IN_EDGE);
+		for (edge_iterator it = vertex.get_neigh_begin(IN_EDGE);
+				it != end_it; ++it) {
+			pgrank_stream_vertex &v
+				= (pgrank_stream_vertex &) prog.get_graph().get_vertex(*it);
+			accum += v.contrib;
+		}
+	}
+
+	void run_on_iteration_end(stream_program &prog, vertex_id_t id) {
+		// Apply
+		float new_pr = (1 - DAMPING_FACTOR) + DAMPING_FACTOR * accum;
+		if (std::fabs(new_pr - curr_itr_pr) > TOLERANCE)
+			prog.notify_change();
+		curr_itr_pr = new_pr;
+		if (num_out_edges > 0)
+			contrib = curr_itr_pr / num_out_edges;
+	}
+};
+
+
+/*
+ * The residual threshold of the delta-based PageRank.
+ */
+float RESIDUAL_EPS = 1.0E-3;
+
+/*
+ * This message carries the residuals a vertex pushes to its out-neighbors,
+ * one for each of the PageRank vectors computed together.
+ */
+template<int NUM_TOPICS>
+class residual_message: public vertex_message
+{
+	float deltas[NUM_TOPICS];
+public:
+	residual_message(): vertex_message(sizeof(residual_message<NUM_TOPICS>),
+			true) {
+		for (int i = 0; i < NUM_TOPICS; i++)
+			deltas[i] = 0;
+	}
+
+	void set_delta(int topic, float delta) {
+		deltas[topic] = delta;
+	}
+
+	float get_delta(int topic) const {
+		return deltas[topic];
+	}
+};
+
+/*
+ * This vertex computes PageRank by pushing residuals. A vertex only reads
+ * its out-edges when one of its residuals is above `RESIDUAL_EPS'. It then
+ * moves the residual to its PageRank and pushes the damped residual
+ * to its out-neighbors, which sum up the incoming residuals in
+ * run_on_message(). A vertex whose residuals have all dropped below
+ * the threshold doesn't issue I/O, so the I/O shrinks as vertices converge.
+ *
+ * A vertex keeps NUM_TOPICS PageRank vectors so that personalized PageRank
+ * of many seed sets can share a single read of each adjacency list.
+ */
+template<int NUM_TOPICS>
+class delta_pgrank_vertex: public compute_directed_vertex
+{
+	float curr_itr_pr[NUM_TOPICS];
+	float residual[NUM_TOPICS];
+
+	bool has_residual() const {
+		for (int i = 0; i < NUM_TOPICS; i++)
+			if (residual[i] > RESIDUAL_EPS)
+				return true;
+		return false;
+	}
+public:
+	delta_pgrank_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		reset();
+	}
+
+	void reset() {
+		for (int i = 0; i < NUM_TOPICS; i++) {
+			curr_itr_pr[i] = 0;
+			residual[i] = 0;
+		}
+	}
+
+	void add_residual(int topic, float delta) {
+		residual[topic] += delta;
+	}
+
+	float get_pr(int topic) const {
+		return curr_itr_pr[topic];
+	}
+
+	float get_result() const {
+		return curr_itr_pr[0];
+	}
+
+	void run(vertex_program &prog) {
+		// We perform pagerank for at most `max_num_iters' iterations.
+		if (prog.get_graph().get_curr_level() >= max_num_iters)
+			return;
+		if (!has_residual())
+			return;
+
+		vertex_id_t id = prog.get_vertex_id(*this);
+		// A vertex without out-edges keeps all of its residuals.
+		if (prog.get_graph().get_num_edges(id, OUT_EDGE) == 0) {
+			for (int i = 0; i < NUM_TOPICS; i++) {
+				curr_itr_pr[i] += residual[i];
+				residual[i] = 0;
+			}
+			return;
+		}
+		directed_vertex_request req(id, edge_type::OUT_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg1) {
+		const residual_message<NUM_TOPICS> &msg
+			= (const residual_message<NUM_TOPICS> &) msg1;
+		for (int i = 0; i < NUM_TOPICS; i++)
+			residual[i] += msg.get_delta(i);
+	}
+};
+
+template<int NUM_TOPICS>
+void delta_pgrank_vertex<NUM_TOPICS>::run(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	int num_dests = vertex.get_num_edges(OUT_EDGE);
+	if (num_dests == 0)
+		return;
+
+	// The residuals may have grown since the vertex requested its edges,
+	// so we push whatever the vertex has now.
+	residual_message<NUM_TOPICS> msg;
+	bool has_delta = false;
+	for (int i = 0; i < NUM_TOPICS; i++) {
+		if (residual[i] > RESIDUAL_EPS) {
+			curr_itr_pr[i] += residual[i];
+			msg.set_delta(i, residual[i] / num_dests * DAMPING_FACTOR);
+			residual[i] = 0;
+			has_delta = true;
+		}
+	}
+	if (has_delta) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0, num_dests);
+		prog.multicast_msg(it, msg);
+	}
+}
+
+/*
+ * The number of personalized PageRank vectors computed in an engine run.
+ */
+const int PPR_BATCH_SIZE = 8;
+
+typedef delta_pgrank_vertex<1> delta_pgrank_vertex1;
+typedef delta_pgrank_vertex<PPR_BATCH_SIZE> delta_pgrank_batch_vertex;
+
+/*
+ * Every vertex starts with the residual of 1 - DAMPING_FACTOR, so
+ * the result has the same scale as the other PageRank implementations.
+ */
+class global_residual_initializer: public vertex_initializer
+{
+public:
+	virtual void init(compute_vertex &v) {
+		delta_pgrank_vertex1 &pv = (delta_pgrank_vertex1 &) v;
+		pv.reset();
+		pv.add_residual(0, 1 - DAMPING_FACTOR);
+	}
+};
+
+template<int NUM_TOPICS>
+class reset_pgrank_initializer: public vertex_initializer
+{
+public:
+	virtual void init(compute_vertex &v) {
+		((delta_pgrank_vertex<NUM_TOPICS> &) v).reset();
+	}
+};
+
+/*
+ * Each seed of a seed set gets an equal share of the teleport probability,
+ * so each personalized PageRank vector sums up to at most 1.
+ */
+template<int NUM_TOPICS>
+class seed_residual_initializer: public vertex_initializer
+{
+public:
+	typedef std::unordered_map<vertex_id_t, std::vector<float> > seed_map_t;
+private:
+	const seed_map_t &seeds;
+	graph_engine &graph;
+public:
+	seed_residual_initializer(const seed_map_t &_seeds,
+			graph_engine &_graph): seeds(_seeds), graph(_graph) {
+	}
+
+	virtual void init(compute_vertex &v) {
+		delta_pgrank_vertex<NUM_TOPICS> &pv = (delta_pgrank_vertex<NUM_TOPICS> &) v;
+		seed_map_t::const_iterator it = seeds.find(
+				graph.get_graph_index().get_vertex_id(v));
+		assert(it != seeds.end());
+		for (int i = 0; i < NUM_TOPICS; i++)
+			pv.add_residual(i, it->second[i]);
+	}
+};
+
+template<int NUM_TOPICS>
+class save_topic_query: public vertex_query
+{
+	std::vector<FG_vector<float>::ptr> vecs;
+public:
+	save_topic_query(const std::vector<FG_vector<float>::ptr> &vecs) {
+		assert(vecs.size() <= (size_t) NUM_TOPICS);
+		this->vecs = vecs;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v1) {
+		delta_pgrank_vertex<NUM_TOPICS> &v = (delta_pgrank_vertex<NUM_TOPICS> &) v1;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		for (size_t i = 0; i < vecs.size(); i++)
+			vecs[i]->set(id, v.get_pr(i));
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new save_topic_query<NUM_TOPICS>(vecs));
+	}
+};
+
+/*
+ * Run personalized PageRank on the seed sets, at most NUM_TOPICS of them.
+ */
+template<int NUM_TOPICS>
+void run_ppr(graph_engine::ptr graph,
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		std::vector<FG_vector<float>::ptr> &results)
+{
+	assert(seed_sets.size() <= (size_t) NUM_TOPICS);
+	typename seed_residual_initializer<NUM_TOPICS>::seed_map_t seeds;
+	for (size_t i = 0; i < seed_sets.size(); i++) {
+		if (seed_sets[i].empty())
+			continue;
+		float weight = (1 - DAMPING_FACTOR) / seed_sets[i].size();
+		for (size_t j = 0; j < seed_sets[i].size(); j++) {
+			std::vector<float> &res = seeds[seed_sets[i][j]];
+			if (res.empty())
+				res.resize(NUM_TOPICS);
+			res[i] += weight;
+		}
+	}
+	std::vector<vertex_id_t> start_vertices;
+	for (auto it = seeds.begin(); it != seeds.end(); it++)
+		start_vertices.push_back(it->first);
+
+	graph->init_all_vertices(vertex_initializer::ptr(
+				new reset_pgrank_initializer<NUM_TOPICS>()));
+	if (!start_vertices.empty()) {
+		graph->start(start_vertices.data(), start_vertices.size(),
+				vertex_initializer::ptr(new seed_residual_initializer<NUM_TOPICS>(
+						seeds, *graph)));
+		graph->wait4complete();
+	}
+
+	std::vector<FG_vector<float>::ptr> batch(seed_sets.size());
+	for (size_t i = 0; i < batch.size(); i++)
+		batch[i] = FG_vector<float>::create(graph->get_num_vertices());
+	graph->query_on_all(vertex_query::ptr(
+				new save_topic_query<NUM_TOPICS>(batch)));
+	results.insert(results.end(), batch.begin(), batch.end());
+}
 }
 
 #include "save_result.h"
@@ -217,6 +596,8 @@ FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 	graph_index::ptr index = NUMA_graph_index<pgrank_vertex>::create(
 			fg->get_graph_header());
 	graph_engine::ptr graph = fg->create_engine(index);
+	curr_pr_state = vertex_state<float>::create(*graph, 1 - DAMPING_FACTOR);
+	contrib_state = vertex_state<float>::create(*graph, 0);
 	max_num_iters = num_iters;
 	BOOST_LOG_TRIVIAL(info)
 		<< boost::format("Pagerank (at maximal %1% iterations) starting")
@@ -239,8 +620,9 @@ FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 
 	FG_vector<float>::ptr ret = FG_vector<float>::create(
 			graph->get_num_vertices());
-	graph->query_on_all(vertex_query::ptr(
-				new save_query<float, pgrank_vertex>(ret)));
+	curr_pr_state->copy_to(*ret);
+	curr_pr_state.reset();
+	contrib_state.reset();
 
 #ifdef PROFILER
 	if (!graph_conf.get_prof_file().empty())
@@ -270,9 +652,27 @@ FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 		exit(-1);
 	}
 
-	graph_index::ptr index = NUMA_graph_index<pgrank_vertex2>::create(
-			fg->get_graph_header());
+	// The PageRank is stored in SAFS if it's given a memory budget.
+	bool ext_state = graph_conf.get_ext_vertex_state_mem() > 0;
+	graph_index::ptr index;
+	if (ext_state)
+		index = NUMA_graph_index<ext_pgrank_vertex>::create(
+				fg->get_graph_header());
+	else
+		index = NUMA_graph_index<pgrank_vertex2>::create(
+				fg->get_graph_header());
 	graph_engine::ptr graph = fg->create_engine(index);
+	if (ext_state) {
+		size_t mem_size = graph_conf.get_ext_vertex_state_mem() / 2;
+		ext_new_pr = ext_float_state::create(*graph, "pagerank-new",
+				1 - DAMPING_FACTOR, mem_size,
+				graph_conf.get_ext_vertex_state_window());
+		ext_curr_pr = ext_float_state::create(*graph, "pagerank-curr",
+				1 - DAMPING_FACTOR, mem_size,
+				graph_conf.get_ext_vertex_state_window());
+		if (ext_new_pr == NULL || ext_curr_pr == NULL)
+			return FG_vector<float>::ptr();
+	}
 	max_num_iters = num_iters;
 	BOOST_LOG_TRIVIAL(info)
 		<< boost::format("Pagerank (at maximal %1% iterations) starting")
@@ -289,10 +689,121 @@ FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 	graph->wait4complete();
 	gettimeofday(&end, NULL);
 
+	FG_vector<float>::ptr ret = FG_vector<float>::create(
+			graph->get_num_vertices());
+	if (ext_state) {
+		ext_new_pr->copy_to(*ret);
+		ext_new_pr->print_statistics();
+		ext_curr_pr->print_statistics();
+		ext_new_pr.reset();
+		ext_curr_pr.reset();
+	}
+	else
+		graph->query_on_all(vertex_query::ptr(
+					new save_query<float, pgrank_vertex2>(ret)));
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("It takes %1% seconds in total")
+		% time_diff(start, end);
+	return ret;
+}
+
+FG_vector<float>::ptr compute_pagerank_stream(FG_graph::ptr fg, int num_iters,
+		float damping_factor)
+{
+	bool directed = fg->get_graph_header().is_directed_graph();
+	if (!directed) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "This algorithm works on a directed graph";
+		return FG_vector<float>::ptr();
+	}
+
+	DAMPING_FACTOR = damping_factor;
+	if (DAMPING_FACTOR < 0 || DAMPING_FACTOR > 1) {
+		BOOST_LOG_TRIVIAL(fatal)
+			<< "Damping factor must be between 0 and 1 inclusive";
+		exit(-1);
+	}
+
+	graph_index::ptr index = NUMA_graph_index<pgrank_stream_vertex>::create(
+			fg->get_graph_header());
+	edge_stream_engine::ptr engine = edge_stream_engine::create(fg, index);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Streaming pagerank (at maximal %1% iterations) starting")
+		% num_iters;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	engine->start(IN_EDGE, num_iters, stream_program_creater::ptr(
+				new def_stream_program_creater<pgrank_stream_vertex>()));
+	gettimeofday(&end, NULL);
+
+	FG_vector<float>::ptr ret = FG_vector<float>::create(
+			engine->get_graph()->get_num_vertices());
+	engine->query_on_all(vertex_query::ptr(
+				new save_query<float, pgrank_stream_vertex>(ret)));
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("It takes %1% seconds in total")
+		% time_diff(start, end);
+	return ret;
+}
+
+FG_vector<float>::ptr compute_delta_pagerank(FG_graph::ptr fg, int num_iters,
+		float damping_factor, float epsilon)
+{
+	bool directed = fg->get_graph_header().is_directed_graph();
+	if (!directed) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "This algorithm works on a directed graph";
+		return FG_vector<float>::ptr();
+	}
+
+	DAMPING_FACTOR = damping_factor;
+	if (DAMPING_FACTOR < 0 || DAMPING_FACTOR > 1) {
+		BOOST_LOG_TRIVIAL(fatal)
+			<< "Damping factor must be between 0 and 1 inclusive";
+		exit(-1);
+	}
+	RESIDUAL_EPS = epsilon;
+
+	graph_index::ptr index = NUMA_graph_index<delta_pgrank_vertex1>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	max_num_iters = num_iters;
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Delta pagerank (at maximal %1% iterations) starting")
+		% max_num_iters;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start_all(vertex_initializer::ptr(
+				new global_residual_initializer()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+
 	FG_vector<float>::ptr ret = FG_vector<float>::create(
 			graph->get_num_vertices());
 	graph->query_on_all(vertex_query::ptr(
-				new save_query<float, pgrank_vertex2>(ret)));
+				new save_query<float, delta_pgrank_vertex1>(ret)));
 
 #ifdef PROFILER
 	if (!graph_conf.get_prof_file().empty())
@@ -305,4 +816,83 @@ FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 	return ret;
 }
 
+std::vector<FG_vector<float>::ptr> ppr_engine::compute(
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		int num_iters, float damping_factor, float epsilon)
+{
+	std::vector<FG_vector<float>::ptr> ret;
+	bool directed = fg->get_graph_header().is_directed_graph();
+	if (!directed) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "This algorithm works on a directed graph";
+		return ret;
+	}
+
+	DAMPING_FACTOR = damping_factor;
+	if (DAMPING_FACTOR < 0 || DAMPING_FACTOR > 1) {
+		BOOST_LOG_TRIVIAL(fatal)
+			<< "Damping factor must be between 0 and 1 inclusive";
+		exit(-1);
+	}
+	RESIDUAL_EPS = epsilon;
+	max_num_iters = num_iters;
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Personalized pagerank of %1% seed sets (at maximal %2% iterations) starting")
+		% seed_sets.size() % max_num_iters;
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	// A single seed set doesn't need to pay for the state of a full batch.
+	if (seed_sets.size() == 1) {
+		if (single_graph == NULL) {
+			graph_index::ptr index
+				= NUMA_graph_index<delta_pgrank_vertex1>::create(
+						fg->get_graph_header());
+			single_graph = fg->create_engine(index);
+		}
+		run_ppr<1>(single_graph, seed_sets, ret);
+	}
+	else if (seed_sets.size() > 1) {
+		if (batch_graph == NULL) {
+			graph_index::ptr index
+				= NUMA_graph_index<delta_pgrank_batch_vertex>::create(
+						fg->get_graph_header());
+			batch_graph = fg->create_engine(index);
+		}
+		for (size_t i = 0; i < seed_sets.size(); i += PPR_BATCH_SIZE) {
+			size_t batch_end = std::min(i + PPR_BATCH_SIZE, seed_sets.size());
+			std::vector<std::vector<vertex_id_t> > batch(
+					seed_sets.begin() + i, seed_sets.begin() + batch_end);
+			run_ppr<PPR_BATCH_SIZE>(batch_graph, batch, ret);
+		}
+	}
+	gettimeofday(&end, NULL);
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("It takes %1% seconds in total")
+		% time_diff(start, end);
+	return ret;
+}
+
+std::vector<FG_vector<float>::ptr> compute_personalized_pagerank(
+		FG_graph::ptr fg, const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		int num_iters, float damping_factor, float epsilon)
+{
+	return ppr_engine::create(fg)->compute(seed_sets, num_iters,
+			damping_factor, epsilon);
+}
+
+FG_vector<float>::ptr compute_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &seeds, int num_iters,
+		float damping_factor, float epsilon)
+{
+	std::vector<std::vector<vertex_id_t> > seed_sets(1, seeds);
+	std::vector<FG_vector<float>::ptr> ret = compute_personalized_pagerank(
+			fg, seed_sets, num_iters, damping_factor, epsilon);
+	if (ret.empty())
+		return FG_vector<float>::ptr();
+	else
+		return ret[0];
+}
+
 }
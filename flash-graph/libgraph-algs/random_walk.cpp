@@ -0,0 +1,586 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This generates random walks from every vertex.
+ *
+ * The walkers move one step in an iteration. Instead of a request per
+ * walker, a vertex reads its edge list once in an iteration and moves
+ * all walkers that stand on it, so the I/O is proportional to
+ * the number of distinct vertices that hold walkers. The vertices are
+ * processed in the order of their IDs, so the engine merges the reads of
+ * the vertices on the same pages. Each worker thread groups the walkers
+ * that move to the same vertex into a single message.
+ *
+ * node2vec transitions depend on the previous vertex of a walker, so
+ * they are sampled with rejection: a vertex proposes a neighbor with
+ * the first-order transition and accepts it with the probability of
+ * its bias. Whether the proposed neighbor is also a neighbor of the
+ * previous vertex is checked by the proposed neighbor itself, which
+ * reads its own edge list anyway to move the walker on. If the proposal
+ * is rejected, the walker returns to the vertex to try again.
+ *
+ * Every step is written to the output file as a `walk_step' record as
+ * soon as it's decided, so the walks don't stay in memory.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+using namespace fg;
+
+namespace {
+
+/*
+ * The random number generator of a walker in a step. It generates
+ * the same walk for the same seed regardless of the thread that moves
+ * the walker. This is splitmix64, and the initial state is hashed from
+ * the walker, so the streams of different walkers and steps don't
+ * overlap.
+ */
+class walk_rng
+{
+	uint64_t state;
+
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+		return z ^ (z >> 31);
+	}
+public:
+	/*
+	 * In a node2vec step, the vertex that proposes a move and the proposed
+	 * vertex that accepts or rejects it draw from different streams.
+	 */
+	static const uint64_t PROPOSE_STREAM = 0;
+	static const uint64_t ACCEPT_STREAM = 1;
+
+	walk_rng(uint64_t seed, uint64_t walk_id, uint32_t step, uint32_t tries,
+			uint64_t stream = PROPOSE_STREAM) {
+		state = mix(seed ^ mix(walk_id + 0x9E3779B97F4A7C15UL));
+		state = mix(state ^ ((((uint64_t) step) << 32) | tries));
+		state = mix(state ^ stream);
+	}
+
+	uint64_t operator()() {
+		return mix(state += 0x9E3779B97F4A7C15UL);
+	}
+
+	/*
+	 * Get a random number in [0, range).
+	 */
+	size_t get(size_t range) {
+		return (*this)() % range;
+	}
+
+	/*
+	 * Get a random number in [0, 1).
+	 */
+	double get_real() {
+		return ((*this)() >> 11) * (1.0 / (1UL << 53));
+	}
+};
+
+struct walker
+{
+	uint64_t walk_id;
+	// The step of the walk on the vertex that proposes a move
+	// or holds the walker.
+	uint32_t step;
+	// The number of rejected proposals in this step.
+	uint32_t tries;
+	// The vertex before the one that proposes a move or holds the walker.
+	vertex_id_t prev;
+	// The vertex that proposes a move. It's INVALID_VERTEX_ID if
+	// the walker has moved to the vertex.
+	vertex_id_t from;
+};
+
+/*
+ * A message that carries the walkers that move to the same vertex.
+ */
+class walk_message: public vertex_message
+{
+	uint32_t num_walkers;
+	uint32_t padding;
+public:
+	static const size_t MAX_WALKERS = 128;
+
+	static size_t get_size(size_t num_walkers) {
+		return sizeof(walk_message) + num_walkers * sizeof(walker);
+	}
+
+	walk_message(size_t num_walkers): vertex_message(get_size(num_walkers),
+			true) {
+		this->num_walkers = num_walkers;
+		this->padding = 0;
+	}
+
+	size_t get_num_walkers() const {
+		return num_walkers;
+	}
+
+	walker *get_walkers() {
+		return (walker *) (this + 1);
+	}
+
+	const walker *get_walkers() const {
+		return (const walker *) (this + 1);
+	}
+};
+
+/*
+ * All worker threads write the steps to the same file.
+ */
+class walk_writer
+{
+	FILE *f;
+	pthread_mutex_t lock;
+	size_t num_steps;
+public:
+	walk_writer(FILE *f) {
+		this->f = f;
+		pthread_mutex_init(&lock, NULL);
+		num_steps = 0;
+	}
+
+	~walk_writer() {
+		pthread_mutex_destroy(&lock);
+	}
+
+	void write(const std::vector<walk_step> &steps) {
+		pthread_mutex_lock(&lock);
+		BOOST_VERIFY(fwrite(steps.data(), sizeof(walk_step), steps.size(), f)
+				== steps.size());
+		num_steps += steps.size();
+		pthread_mutex_unlock(&lock);
+	}
+
+	size_t get_num_steps() const {
+		return num_steps;
+	}
+};
+
+struct walk_params
+{
+	walk_transition transition;
+	int walk_length;
+	double p;
+	double q;
+	// The maximal bias of node2vec transitions.
+	double max_bias;
+	int weight_size;
+	uint64_t seed;
+	// The walks that start in the current run of the engine.
+	size_t walk_start;
+	size_t walk_end;
+};
+
+class walk_vertex: public compute_directed_vertex
+{
+	// The walkers that have arrived at the vertex.
+	std::vector<walker> *walkers;
+public:
+	walk_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		walkers = NULL;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const walk_message &msg = (const walk_message &) msg1;
+		if (walkers == NULL)
+			walkers = new std::vector<walker>();
+		walkers->insert(walkers->end(), msg.get_walkers(),
+				msg.get_walkers() + msg.get_num_walkers());
+	}
+};
+
+class walk_vertex_program: public vertex_program_impl<walk_vertex>
+{
+	typedef std::unordered_map<vertex_id_t, std::vector<walker> > walker_map_t;
+	static const size_t STEP_BUF_SIZE = 64 * 1024;
+
+	const walk_params &params;
+	walk_writer &writer;
+
+	// The walkers that move to other vertices in this iteration,
+	// grouped by their destinations.
+	walker_map_t moves;
+	std::vector<walk_step> steps;
+	std::vector<char> msg_buf;
+
+	// The edge list of the vertex that moves walkers.
+	std::vector<vertex_id_t> edges;
+	std::vector<vertex_id_t> in_edges;
+	std::vector<double> weight_sums;
+
+	vertex_id_t sample(walk_rng &rng) const {
+		if (weight_sums.empty())
+			return edges[rng.get(edges.size())];
+		double r = rng.get_real() * weight_sums.back();
+		size_t idx = std::upper_bound(weight_sums.begin(), weight_sums.end(),
+				r) - weight_sums.begin();
+		return edges[std::min(idx, edges.size() - 1)];
+	}
+
+	template<class weight_t>
+	void read_weights(const page_vertex &vertex);
+	void step(vertex_id_t id, walker w);
+	void check(vertex_id_t id, walker w);
+public:
+	walk_vertex_program(const walk_params &_params,
+			walk_writer &_writer): params(_params), writer(_writer) {
+	}
+
+	const walk_params &get_params() const {
+		return params;
+	}
+
+	void add_step(uint64_t walk_id, uint32_t step, vertex_id_t id) {
+		walk_step s;
+		s.walk_id = walk_id;
+		s.step = step;
+		s.vertex = id;
+		steps.push_back(s);
+		if (steps.size() >= STEP_BUF_SIZE)
+			flush_steps();
+	}
+
+	void flush_steps() {
+		if (!steps.empty())
+			writer.write(steps);
+		steps.clear();
+	}
+
+	void move_walkers(const page_vertex &vertex,
+			const std::vector<walker> &walkers);
+
+	virtual void run_on_iteration_end();
+};
+
+template<class weight_t>
+void walk_vertex_program::read_weights(const page_vertex &vertex)
+{
+	safs::page_byte_array::seq_const_iterator<weight_t> it
+		= vertex.is_directed()
+		? ((const page_directed_vertex &) vertex).get_data_seq_it<weight_t>(
+				edge_type::OUT_EDGE)
+		: ((const page_undirected_vertex &) vertex).get_data_seq_it<weight_t>();
+	double sum = 0;
+	while (it.has_next()) {
+		weight_t w = it.next();
+		assert(w >= 0);
+		sum += w;
+		weight_sums.push_back(sum);
+	}
+}
+
+/*
+ * Move a walker that stands on the vertex one step.
+ */
+void walk_vertex_program::step(vertex_id_t id, walker w)
+{
+	if (w.step >= (uint32_t) params.walk_length || edges.empty())
+		return;
+
+	walk_rng rng(params.seed, w.walk_id, w.step, w.tries);
+	bool second_order = params.transition == NODE2VEC_WALK
+		&& w.prev != INVALID_VERTEX_ID;
+	while (true) {
+		vertex_id_t next = sample(rng);
+		if (second_order && next == w.prev) {
+			// We know the bias of returning to the previous vertex here.
+			if (rng.get_real() * params.max_bias >= 1 / params.p)
+				continue;
+		}
+		else if (second_order) {
+			// The proposed vertex decides whether to accept the walker.
+			w.from = id;
+			moves[next].push_back(w);
+			return;
+		}
+		add_step(w.walk_id, w.step + 1, next);
+		if (w.step + 1 < (uint32_t) params.walk_length) {
+			walker nw;
+			nw.walk_id = w.walk_id;
+			nw.step = w.step + 1;
+			nw.tries = 0;
+			nw.prev = id;
+			nw.from = INVALID_VERTEX_ID;
+			moves[next].push_back(nw);
+		}
+		return;
+	}
+}
+
+/*
+ * Decide whether the vertex accepts a walker proposed by its neighbor
+ * in a node2vec walk.
+ */
+void walk_vertex_program::check(vertex_id_t id, walker w)
+{
+	// The proposed vertex is a neighbor of the previous vertex if there is
+	// an edge from the previous vertex to it.
+	const std::vector<vertex_id_t> &prev_edges = get_graph().is_directed()
+		? in_edges : edges;
+	bool is_neigh = std::binary_search(prev_edges.begin(), prev_edges.end(),
+			w.prev);
+	double bias = is_neigh ? 1 : 1 / params.q;
+	walk_rng rng(params.seed, w.walk_id, w.step, w.tries,
+			walk_rng::ACCEPT_STREAM);
+	if (rng.get_real() * params.max_bias < bias) {
+		add_step(w.walk_id, w.step + 1, id);
+		walker nw;
+		nw.walk_id = w.walk_id;
+		nw.step = w.step + 1;
+		nw.tries = 0;
+		nw.prev = w.from;
+		nw.from = INVALID_VERTEX_ID;
+		step(id, nw);
+	}
+	else {
+		vertex_id_t from = w.from;
+		w.from = INVALID_VERTEX_ID;
+		w.tries++;
+		moves[from].push_back(w);
+	}
+}
+
+void walk_vertex_program::move_walkers(const page_vertex &vertex,
+		const std::vector<walker> &walkers)
+{
+	vertex_id_t id = vertex.get_id();
+	edges.resize(vertex.get_num_edges(edge_type::OUT_EDGE));
+	vertex.read_edges(edge_type::OUT_EDGE, edges.data(), edges.size());
+	in_edges.clear();
+	if (params.transition == NODE2VEC_WALK && vertex.is_directed()) {
+		in_edges.resize(vertex.get_num_edges(edge_type::IN_EDGE));
+		vertex.read_edges(edge_type::IN_EDGE, in_edges.data(),
+				in_edges.size());
+	}
+	weight_sums.clear();
+	if (params.transition != UNIFORM_WALK) {
+		if (params.weight_size == sizeof(int32_t))
+			read_weights<int32_t>(vertex);
+		else if (params.weight_size == sizeof(double))
+			read_weights<double>(vertex);
+	}
+
+	for (size_t i = 0; i < walkers.size(); i++) {
+		if (walkers[i].from == INVALID_VERTEX_ID)
+			step(id, walkers[i]);
+		else
+			check(id, walkers[i]);
+	}
+}
+
+void walk_vertex_program::run_on_iteration_end()
+{
+	for (walker_map_t::iterator it = moves.begin(); it != moves.end(); it++) {
+		const std::vector<walker> &walkers = it->second;
+		for (size_t i = 0; i < walkers.size(); i += walk_message::MAX_WALKERS) {
+			size_t num = std::min(walkers.size() - i, walk_message::MAX_WALKERS);
+			msg_buf.resize(walk_message::get_size(num));
+			walk_message *msg = new (msg_buf.data()) walk_message(num);
+			memcpy(msg->get_walkers(), walkers.data() + i, sizeof(walker) * num);
+			send_msg(it->first, *msg);
+		}
+	}
+	moves.clear();
+}
+
+class walk_vertex_program_creater: public vertex_program_creater
+{
+	const walk_params &params;
+	walk_writer &writer;
+public:
+	walk_vertex_program_creater(const walk_params &_params,
+			walk_writer &_writer): params(_params), writer(_writer) {
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new walk_vertex_program(params, writer));
+	}
+};
+
+void walk_vertex::run(vertex_program &prog)
+{
+	walk_vertex_program &wprog = (walk_vertex_program &) prog;
+	const walk_params &params = wprog.get_params();
+	vertex_id_t id = prog.get_vertex_id(*this);
+	// All vertices run in the first iteration and start their walks.
+	if (prog.get_graph().get_curr_level() == 0) {
+		size_t num_vertices = prog.get_graph().get_num_vertices();
+		bool has_edges = prog.get_graph().get_num_edges(id,
+				edge_type::OUT_EDGE) > 0;
+		if (has_edges && walkers == NULL)
+			walkers = new std::vector<walker>();
+		for (size_t i = params.walk_start; i < params.walk_end; i++) {
+			walker w;
+			w.walk_id = i * num_vertices + id;
+			w.step = 0;
+			w.tries = 0;
+			w.prev = INVALID_VERTEX_ID;
+			w.from = INVALID_VERTEX_ID;
+			wprog.add_step(w.walk_id, 0, id);
+			if (has_edges)
+				walkers->push_back(w);
+		}
+	}
+
+	if (walkers == NULL)
+		return;
+	// A node2vec walk on a directed graph needs the in-edges to check
+	// the previous vertex.
+	if (prog.get_graph().is_directed()
+			&& params.transition != NODE2VEC_WALK) {
+		directed_vertex_request req(id, edge_type::OUT_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
+void walk_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	assert(walkers);
+	// The walkers that arrive in this iteration are moved in the next
+	// iteration.
+	std::vector<walker> *curr = walkers;
+	walkers = NULL;
+	((walk_vertex_program &) prog).move_walkers(vertex, *curr);
+	delete curr;
+}
+
+}
+
+namespace fg
+{
+
+size_t generate_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		int num_walks, int walk_length, walk_transition transition,
+		double p, double q)
+{
+	const graph_header &header = fg->get_graph_header();
+	if (num_walks <= 0 || walk_length <= 0) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "The number and the length of walks must be positive";
+		return 0;
+	}
+	if (p <= 0 || q <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "'p' and 'q' must be positive";
+		return 0;
+	}
+	int weight_size = header.has_edge_data() ? header.get_edge_data_size() : 0;
+	if (transition == WEIGHTED_WALK && weight_size == 0) {
+		BOOST_LOG_TRIVIAL(error) << "A weighted walk needs edge weights";
+		return 0;
+	}
+	if (weight_size != 0 && weight_size != sizeof(int32_t)
+			&& weight_size != sizeof(double)) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("Random walks don't support edge weights of %1% bytes")
+			% weight_size;
+		return 0;
+	}
+
+	FILE *f = fopen(out_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("Can't open %1%: %2%") % out_file % strerror(errno);
+		return 0;
+	}
+
+	walk_params params;
+	params.transition = transition;
+	params.walk_length = walk_length;
+	params.p = p;
+	params.q = q;
+	params.max_bias = std::max(std::max(1 / p, 1 / q), 1.0);
+	params.weight_size = weight_size;
+	params.seed = (((uint64_t) random()) << 32) | random();
+	// A node2vec walk with p = q = 1 is a first-order walk.
+	if (transition == NODE2VEC_WALK && p == 1 && q == 1)
+		params.transition = weight_size > 0 ? WEIGHTED_WALK : UNIFORM_WALK;
+
+	graph_index::ptr index = NUMA_graph_index<walk_vertex>::create(header);
+	graph_engine::ptr graph = fg->create_engine(index);
+
+	// The walkers of all walks that run together stay in memory, so we
+	// limit the number of walks in a run.
+	const size_t MAX_WALKER_MEM = 1024L * 1024 * 1024;
+	size_t num_vertices = graph->get_num_vertices();
+	size_t walks_per_run = std::max(MAX_WALKER_MEM / sizeof(walker)
+			/ num_vertices, 1UL);
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Starting %1% random walks of length %2% from each vertex, %3% walks in a run")
+		% num_walks % walk_length % std::min(walks_per_run, (size_t) num_walks);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	walk_writer writer(f);
+	for (size_t i = 0; i < (size_t) num_walks; i += walks_per_run) {
+		params.walk_start = i;
+		params.walk_end = std::min(i + walks_per_run, (size_t) num_walks);
+		graph->start_all(vertex_initializer::ptr(),
+				vertex_program_creater::ptr(new walk_vertex_program_creater(
+						params, writer)));
+		graph->wait4complete();
+
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		for (size_t j = 0; j < vprogs.size(); j++)
+			((walk_vertex_program &) *vprogs[j]).flush_steps();
+	}
+	fclose(f);
+
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	double secs = time_diff(start, end);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Random walks took %1% sec to write %2% steps (%3% steps/sec)")
+		% secs % writer.get_num_steps() % (writer.get_num_steps() / secs);
+	return writer.get_num_steps();
+}
+
+}
@@ -24,36 +24,13 @@
 #include "graph_config.h"
 
 #include "graphlab/cuckoo_set_pow2.hpp"
+#include "sorted_intersect.h"
 #include "scan_graph.h"
 
 using namespace fg;
 
 const double BIN_SEARCH_RATIO = 100;
 
-size_t neighbor_list::count_edges_hash(const page_vertex *v,
-		edge_iterator other_it, edge_iterator other_end,
-		std::vector<vertex_id_t> *common_neighs) const
-{
-	size_t num_local_edges = 0;
-
-	while (other_it != other_end) {
-		vertex_id_t neigh_neighbor = *other_it;
-		if (neigh_neighbor != v->get_id()
-				&& neigh_neighbor != this->get_id()) {
-			if (this->contains(neigh_neighbor)) {
-#if 0
-				num_local_edges += (*other_data_it).get_count();
-#endif
-				num_local_edges++;
-				if (common_neighs)
-					common_neighs->push_back(neigh_neighbor);
-			}
-		}
-		++other_it;
-	}
-	return num_local_edges;
-}
-
 #if 0
 int neighbor_list::count_edges_bin_search_this(const page_vertex *v,
 		std::vector<attributed_neighbor>::const_iterator this_it,
@@ -106,8 +83,11 @@ size_t neighbor_list::count_edges_bin_search_other(const page_vertex *v,
 			continue;
 		}
 
-		edge_iterator first = std::lower_bound(other_it, other_end,
+		// The neighbors are searched in the ascending order, so we only
+		// need to search after the previous location with galloping search.
+		edge_iterator first = gallop_lower_bound(other_it, other_end,
 				this_neighbor);
+		other_it = first;
 		// found it.
 		if (first != other_end && !(this_neighbor < *first)) {
 			int num_dups = 0;
@@ -133,51 +113,27 @@ size_t neighbor_list::count_edges_bin_search_other(const page_vertex *v,
 	return num_local_edges;
 }
 
-size_t neighbor_list::count_edges_scan(const page_vertex *v,
-		neighbor_list::id_iterator this_it,
-		neighbor_list::id_iterator this_end,
-		edge_seq_iterator other_it,
+size_t neighbor_list::count_edges_intersect(size_t this_start,
+		size_t this_end, const vertex_id_t *other_edges, size_t num_other_edges,
 		std::vector<vertex_id_t> *common_neighs) const
 {
-	size_t num_local_edges = 0;
-	while (other_it.has_next() && this_it != this_end) {
-		vertex_id_t this_neighbor = *this_it;
-		vertex_id_t neigh_neighbor = other_it.curr();
-		if (neigh_neighbor == v->get_id()
-				|| neigh_neighbor == this->get_id()) {
-			other_it.next();
-#if 0
-			++other_data_it;
-#endif
-			continue;
-		}
-		if (this_neighbor == neigh_neighbor) {
-			if (common_neighs)
-				common_neighs->push_back(*this_it);
-			do {
-				// Edges in the v's neighbor lists may duplicated.
-				// The duplicated neighbors need to be counted
-				// multiple times.
-#if 0
-				num_local_edges += (*other_data_it).get_count();
-				++other_data_it;
-#endif
-				num_local_edges++;
-				other_it.next();
-			} while (other_it.has_next() && this_neighbor == other_it.curr());
-			++this_it;
-		}
-		else if (this_neighbor < neigh_neighbor) {
-			++this_it;
-		}
-		else {
-			other_it.next();
-#if 0
-			++other_data_it;
-#endif
-		}
-	}
-	return num_local_edges;
+	if (this_start >= this_end)
+		return 0;
+	if (common_neighs == NULL)
+		return sorted_intersect_count(id_list.data() + this_start,
+				this_end - this_start, other_edges, num_other_edges);
+
+	match_idxs.resize(num_other_edges);
+	size_t num_matches = sorted_intersect(id_list.data() + this_start,
+			this_end - this_start, other_edges, num_other_edges,
+			match_idxs.data());
+	// Edges in the v's neighbor lists may duplicated. The duplicated
+	// neighbors need to be counted multiple times, but they are only
+	// common neighbors once.
+	for (size_t i = 0; i < num_matches; i++)
+		if (i == 0 || match_idxs[i] != match_idxs[i - 1])
+			common_neighs->push_back(id_list[this_start + match_idxs[i]]);
+	return num_matches;
 }
 
 size_t neighbor_list::count_edges(const page_vertex *v, edge_type type,
@@ -215,21 +171,28 @@ size_t neighbor_list::count_edges(const page_vertex *v, edge_type type,
 		return count_edges_bin_search_other(v, this_it, this_end,
 				other_it, other_end, common_neighs);
 	}
-	else if (this->size() / num_v_edges > 16) {
-#ifdef PV_STAT
-		scan_bytes += num_v_edges * sizeof(vertex_id_t);
-		rand_jumps += num_v_edges;
-#endif
-		return count_edges_hash(v, other_it, other_end, common_neighs);
-	}
-	else {
+
 #ifdef PV_STAT
-		scan_bytes += num_v_edges * sizeof(vertex_id_t);
-		scan_bytes += this->size() * sizeof(vertex_id_t);
+	scan_bytes += num_v_edges * sizeof(vertex_id_t);
+	scan_bytes += this->size() * sizeof(vertex_id_t);
 #endif
-		return count_edges_scan(v, this_it, this_end,
-				v->get_neigh_seq_it(type, 0, num_v_edges), common_neighs);
-	}
+	// Copy the neighbor's edge list to a contiguous buffer, so we can
+	// intersect the two lists with the intersection kernels.
+	neigh_edges.resize(v->get_num_edges(type));
+	v->read_edges(type, neigh_edges.data(), neigh_edges.size());
+	// We need to skip loops, so we exclude this vertex from its own
+	// neighbor list.
+	size_t this_size = this_end - this_it;
+	size_t loop_idx = std::lower_bound(id_list.begin(),
+			id_list.begin() + this_size, this->get_id()) - id_list.begin();
+	if (loop_idx < this_size && id_list[loop_idx] == this->get_id())
+		return count_edges_intersect(0, loop_idx, neigh_edges.data(),
+				num_v_edges, common_neighs)
+			+ count_edges_intersect(loop_idx + 1, this_size,
+					neigh_edges.data(), num_v_edges, common_neighs);
+	else
+		return count_edges_intersect(0, this_size, neigh_edges.data(),
+				num_v_edges, common_neighs);
 }
 
 size_t neighbor_list::count_edges(const page_vertex *v)
@@ -195,6 +195,11 @@ protected:
 	std::vector<fg::vertex_id_t> id_list;
 	std::vector<int> num_dup_list;
 	edge_set_t *neighbor_set;
+	// The buffers for intersecting the neighbor list with the edge list of
+	// another vertex. The neighbor list is only used by the vertex that
+	// owns it, so the buffers are never accessed by multiple threads.
+	mutable std::vector<fg::vertex_id_t> neigh_edges;
+	mutable std::vector<fg::vsize_t> match_idxs;
 public:
 	class id_iterator: public std::iterator<std::random_access_iterator_tag, fg::vertex_id_t>
 	{
@@ -309,9 +314,6 @@ public:
 	virtual size_t count_edges(const fg::page_vertex *v);
 	virtual size_t count_edges(const fg::page_vertex *v, fg::edge_type type,
 			std::vector<fg::vertex_id_t> *common_neighs) const;
-	virtual size_t count_edges_hash(const fg::page_vertex *v,
-			fg::edge_iterator other_it, fg::edge_iterator other_end,
-			std::vector<fg::vertex_id_t> *common_neighs) const;
 #if 0
 	virtual size_t count_edges_bin_search_this(const fg::page_vertex *v,
 			neighbor_list::id_iterator this_it,
@@ -323,9 +325,12 @@ public:
 			neighbor_list::id_iterator this_end,
 			fg::edge_iterator other_it, fg::edge_iterator other_end,
 			std::vector<fg::vertex_id_t> *common_neighs) const;
-	virtual size_t count_edges_scan(const fg::page_vertex *v,
-			neighbor_list::id_iterator this_it,
-			neighbor_list::id_iterator this_end, fg::edge_seq_iterator other_it,
+	/*
+	 * Intersect part of the neighbor list with the edge list of another
+	 * vertex.
+	 */
+	virtual size_t count_edges_intersect(size_t this_start, size_t this_end,
+			const fg::vertex_id_t *other_edges, size_t num_other_edges,
 			std::vector<fg::vertex_id_t> *common_neighs) const;
 };
 
@@ -38,7 +38,7 @@ namespace {
     static struct timeval start, end;
     static std::map<vertex_id_t, unsigned> g_init_hash; // Used for forgy init
     static unsigned  g_kmspp_cluster_idx; // Used for kmeans++ init
-    static unsigned g_kmspp_next_cluster; // Sample row selected as the next cluster
+    static vertex_id_t g_kmspp_next_cluster; // Sample row selected as the next cluster
     static std::vector<double> g_kmspp_distance; // Used for kmeans++ init
     static unsigned g_iter;
     static bool g_even_iter;
@@ -77,10 +77,10 @@ namespace {
             edge_count e = count_it.next();
             vertex_id_t nid = id_it.next();
             char buffer [50];
-            assert(sprintf(buffer, "%u:%i",nid, e.get_count()));
+            assert(sprintf(buffer, "%ld:%i", (size_t) nid, e.get_count()));
             v.push_back(std::string(buffer));
         }
-        printf("V%u's vector: ", my_id); print_vector<std::string>(v);
+        printf("V%ld's vector: ", (size_t) my_id); print_vector<std::string>(v);
     }
     // End helpers //
 #endif 
@@ -245,7 +245,7 @@ namespace {
                     unsigned new_cluster_id = random() % K;
                     kmeans_vertex_program& vprog = (kmeans_vertex_program&) prog;
 #if KM_TEST
-                    printf("Random init: v%u assigned to cluster: c%x\n", prog.get_vertex_id(*this), new_cluster_id);
+                    printf("Random init: v%ld assigned to cluster: c%x\n", (size_t) prog.get_vertex_id(*this), new_cluster_id);
 #endif
                     this->cluster_id = new_cluster_id;
                     edge_seq_iterator id_it = vertex.get_neigh_seq_it(OUT_EDGE); // TODO: Make sure OUT_EDGE has data
@@ -258,7 +258,7 @@ namespace {
                 {
                     vertex_id_t my_id = prog.get_vertex_id(*this);
 #if KM_TEST
-                    printf("Forgy init: v%u setting cluster: c%x\n", my_id, g_init_hash[my_id]);
+                    printf("Forgy init: v%ld setting cluster: c%x\n", (size_t) my_id, g_init_hash[my_id]);
 #endif
                     set_as_mean(vertex, my_id, g_init_hash[my_id]);
                 }
@@ -272,7 +272,7 @@ namespace {
                     if (g_kmspp_stage == ADDMEAN) {
 #if KM_TEST
                         vertex_id_t my_id = prog.get_vertex_id(*this);
-                        printf("kms++ v%u making itself c%u\n", my_id, g_kmspp_cluster_idx);
+                        printf("kms++ v%ld making itself c%u\n", (size_t) my_id, g_kmspp_cluster_idx);
 #endif
                         g_clusters[g_kmspp_cluster_idx]->add_member(id_it, count_it);
                     } else {
@@ -281,7 +281,7 @@ namespace {
                         double dist = get_distance(g_kmspp_cluster_idx, id_it, count_it);
                         if (dist < g_kmspp_distance[my_id]) {
 #if VERBOSE
-                            printf("kms++ v%u updating dist from: %.3f to %.3f\n", my_id, g_kmspp_distance[my_id], dist);
+                            printf("kms++ v%ld updating dist from: %.3f to %.3f\n", (size_t) my_id, g_kmspp_distance[my_id], dist);
 #endif
                             g_kmspp_distance[my_id] = dist;
                         }
@@ -331,8 +331,8 @@ namespace {
             edge_seq_iterator id_it = vertex.get_neigh_seq_it(OUT_EDGE);
             data_seq_iterator count_it =
                 ((const page_directed_vertex&)vertex).get_data_seq_it<edge_count>(OUT_EDGE);
-            printf("Vertex%u changed membership from c%u to c%u with best-dist: %.4f\n",
-                    my_id, cluster_id, new_cluster_id, best);
+            printf("Vertex%ld changed membership from c%u to c%u with best-dist: %.4f\n",
+                    (size_t) my_id, cluster_id, new_cluster_id, best);
             print_sample(my_id, count_it, id_it);
 #endif
             vprog.pt_changed_pp(); // Add a vertex to the count of changed ones
@@ -0,0 +1,434 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This computes single-source shortest paths on a weighted graph with
+ * delta-stepping in a single run of the graph engine.
+ *
+ * Vertices are kept in buckets of width `delta' by their tentative
+ * distance, and the buckets are processed in increasing order. A bucket
+ * takes one or more iterations: in each iteration, the vertices in
+ * the current bucket whose distance has decreased read their edge lists
+ * and relax the light edges (weight <= delta). Each worker thread combines
+ * the relaxations of the same vertex into the minimal distance and sends
+ * them at the end of the iteration. Relaxing a light edge may put
+ * a vertex back to the current bucket, so the bucket is done only when
+ * an iteration doesn't relax any edge into it. The relaxations of heavy
+ * edges (weight > delta) can never reach the current bucket, so they are
+ * combined in the thread while the bucket is processed and sent once
+ * when the bucket is done.
+ *
+ * Like k-core, each thread keeps the vertices that wait for a later bucket
+ * in its own lazy buckets, and all threads derive the current bucket from
+ * the statistics of the previous iterations, so they agree on it without
+ * extra synchronization. A vertex reads its edge list only when its
+ * distance decreases in the current bucket.
+ */
+
+#include <signal.h>
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "save_result.h"
+#include "iter_stats.h"
+
+using namespace fg;
+
+namespace {
+
+const size_t NO_BUCKET = std::numeric_limits<size_t>::max();
+const double INF_DIST = std::numeric_limits<double>::infinity();
+
+/*
+ * The number of relaxations into the current bucket in an iteration and
+ * the minimal bucket that has vertices waiting in it.
+ */
+class sssp_iter_stats: public iter_stats_ring<size_t>
+{
+public:
+	atomic_number<size_t> num_relaxes;
+
+	sssp_iter_stats(): iter_stats_ring<size_t>(NO_BUCKET) {
+	}
+
+	size_t get_num_in_bucket(int level) const {
+		return get_count(level);
+	}
+
+	size_t get_min_bucket(int level) const {
+		return get_min(level);
+	}
+};
+
+class dist_message: public vertex_message
+{
+	double dist;
+public:
+	dist_message(double dist): vertex_message(sizeof(dist_message), true) {
+		this->dist = dist;
+	}
+
+	double get_dist() const {
+		return dist;
+	}
+};
+
+class sssp_vertex: public compute_directed_vertex
+{
+	double dist;
+	// The distance has decreased since the vertex relaxed its edges.
+	bool updated;
+	// The vertex is in the bucket of its current distance.
+	bool queued;
+public:
+	sssp_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		dist = INF_DIST;
+		updated = false;
+		queued = false;
+	}
+
+	void set_source() {
+		dist = 0;
+		updated = true;
+	}
+
+	double get_dist() const {
+		return dist;
+	}
+
+	bool is_updated() const {
+		return updated;
+	}
+
+	void dequeue() {
+		queued = false;
+	}
+
+	double get_result() const {
+		return dist;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const dist_message &msg = (const dist_message &) msg1;
+		if (msg.get_dist() < dist) {
+			dist = msg.get_dist();
+			updated = true;
+			queued = false;
+		}
+	}
+};
+
+class sssp_vertex_program: public vertex_program_impl<sssp_vertex>
+{
+	typedef std::unordered_map<vertex_id_t, double> relax_map_t;
+
+	sssp_iter_stats &stats;
+	double delta;
+	int weight_size;
+
+	// The bucket of the current iteration and whether the current
+	// iteration closes the bucket.
+	int bucket_level;
+	size_t bucket;
+	bool closing;
+
+	// The vertices in the thread that may wait in the bucket of the key.
+	std::map<size_t, std::vector<vertex_id_t> > buckets;
+	// The combined relaxations of light edges in this iteration and of
+	// heavy edges in the current bucket.
+	relax_map_t light;
+	relax_map_t heavy;
+	size_t num_in_bucket;
+
+	bool is_valid(vertex_id_t id, size_t bucket) {
+		sssp_vertex &v = (sssp_vertex &) get_graph().get_vertex(id);
+		return v.is_updated() && get_bucket(v.get_dist()) == bucket;
+	}
+
+	void send_relaxes(relax_map_t &map, size_t &min_bucket);
+public:
+	sssp_vertex_program(sssp_iter_stats &_stats, double delta,
+			int weight_size): stats(_stats) {
+		this->delta = delta;
+		this->weight_size = weight_size;
+		this->bucket_level = 0;
+		this->bucket = 0;
+		this->closing = false;
+		this->num_in_bucket = 0;
+	}
+
+	int get_weight_size() const {
+		return weight_size;
+	}
+
+	size_t get_bucket(double dist) const {
+		return dist / delta;
+	}
+
+	/*
+	 * Get the bucket of the current iteration. A bucket is done after
+	 * an iteration that relaxes no edges into it, and the next iteration
+	 * closes the bucket by sending the relaxations of heavy edges. After
+	 * that, the minimal bucket with waiting vertices becomes current.
+	 */
+	size_t get_curr_bucket() {
+		int level = get_graph().get_curr_level();
+		for (; bucket_level < level; bucket_level++) {
+			if (closing) {
+				bucket = stats.get_min_bucket(bucket_level);
+				closing = false;
+			}
+			else if (stats.get_num_in_bucket(bucket_level) == 0)
+				closing = true;
+		}
+		return bucket;
+	}
+
+	void add(vertex_id_t id, size_t bucket) {
+		buckets[bucket].push_back(id);
+	}
+
+	void relax(vertex_id_t id, double dist, double weight) {
+		assert(weight >= 0);
+		relax_map_t &map = weight <= delta ? light : heavy;
+		double new_dist = dist + weight;
+		std::pair<relax_map_t::iterator, bool> ret = map.insert(
+				relax_map_t::value_type(id, new_dist));
+		if (!ret.second && new_dist < ret.first->second)
+			ret.first->second = new_dist;
+	}
+
+	virtual void run_on_iteration_end();
+};
+
+void sssp_vertex_program::send_relaxes(relax_map_t &map, size_t &min_bucket)
+{
+	stats.num_relaxes.inc(map.size());
+	for (relax_map_t::const_iterator it = map.begin(); it != map.end(); it++) {
+		size_t new_bucket = get_bucket(it->second);
+		if (new_bucket == bucket)
+			num_in_bucket++;
+		min_bucket = std::min(min_bucket, new_bucket);
+		dist_message msg(it->second);
+		send_msg(it->first, msg);
+	}
+	map.clear();
+}
+
+void sssp_vertex_program::run_on_iteration_end()
+{
+	int level = get_graph().get_curr_level();
+	get_curr_bucket();
+	stats.reset(level + 1);
+
+	size_t min_bucket = NO_BUCKET;
+	send_relaxes(light, min_bucket);
+	std::vector<vertex_id_t> active;
+	if (closing) {
+		send_relaxes(heavy, min_bucket);
+		// Activate the vertices in the minimal bucket of the thread.
+		// The minimal bucket of all threads is only known in the next
+		// iteration, so the vertices that don't belong to it go back to
+		// their buckets when they run.
+		while (!buckets.empty() && active.empty()) {
+			size_t b = buckets.begin()->first;
+			const std::vector<vertex_id_t> &ids = buckets.begin()->second;
+			for (size_t i = 0; i < ids.size(); i++) {
+				if (is_valid(ids[i], b)) {
+					((sssp_vertex &) get_graph().get_vertex(ids[i])).dequeue();
+					active.push_back(ids[i]);
+				}
+			}
+			buckets.erase(buckets.begin());
+			if (!active.empty())
+				min_bucket = std::min(min_bucket, b);
+		}
+	}
+	else if (!buckets.empty())
+		min_bucket = std::min(min_bucket, buckets.begin()->first);
+	// Without active vertices, the engine would stop before the waiting
+	// vertices and the pending heavy relaxations are processed.
+	if (active.empty() && !buckets.empty())
+		active.push_back(buckets.begin()->second.back());
+	else if (active.empty() && !heavy.empty())
+		active.push_back(heavy.begin()->first);
+	activate_vertices(active.data(), active.size());
+	stats.publish(level, num_in_bucket, min_bucket);
+	num_in_bucket = 0;
+}
+
+class sssp_vertex_program_creater: public vertex_program_creater
+{
+	sssp_iter_stats &stats;
+	double delta;
+	int weight_size;
+public:
+	sssp_vertex_program_creater(sssp_iter_stats &_stats, double delta,
+			int weight_size): stats(_stats) {
+		this->delta = delta;
+		this->weight_size = weight_size;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new sssp_vertex_program(stats, delta,
+					weight_size));
+	}
+};
+
+void sssp_vertex::run(vertex_program &prog)
+{
+	sssp_vertex_program &sprog = (sssp_vertex_program &) prog;
+	if (!updated)
+		return;
+
+	vertex_id_t id = prog.get_vertex_id(*this);
+	size_t bucket = sprog.get_bucket(dist);
+	if (bucket == sprog.get_curr_bucket()) {
+		updated = false;
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, edge_type::OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+	else if (!queued) {
+		queued = true;
+		sprog.add(id, bucket);
+	}
+}
+
+template<class weight_t>
+void relax_edges(sssp_vertex_program &prog, const page_vertex &vertex,
+		double dist)
+{
+	edge_seq_iterator id_it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	safs::page_byte_array::seq_const_iterator<weight_t> weight_it
+		= prog.get_graph().is_directed()
+		? ((const page_directed_vertex &) vertex).get_data_seq_it<weight_t>(
+				edge_type::OUT_EDGE)
+		: ((const page_undirected_vertex &) vertex).get_data_seq_it<weight_t>();
+	while (id_it.has_next())
+		prog.relax(id_it.next(), dist, weight_it.next());
+}
+
+void sssp_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	sssp_vertex_program &sprog = (sssp_vertex_program &) prog;
+	// The weight type follows the one used by the sparse matrix
+	// multiplication: 4-byte edge data is an integer and 8-byte edge
+	// data is a double. All edges weigh 1 without edge data.
+	switch (sprog.get_weight_size()) {
+		case 0: {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+			while (it.has_next())
+				sprog.relax(it.next(), dist, 1);
+			break;
+		}
+		case sizeof(int32_t):
+			relax_edges<int32_t>(sprog, vertex, dist);
+			break;
+		case sizeof(double):
+			relax_edges<double>(sprog, vertex, dist);
+			break;
+		default:
+			assert(0);
+	}
+}
+
+}
+
+namespace fg
+{
+
+FG_vector<double>::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t source,
+		double delta)
+{
+	const graph_header &header = fg->get_graph_header();
+	if (source >= header.get_num_vertices()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("The source vertex %1% doesn't exist") % source;
+		return FG_vector<double>::ptr();
+	}
+	if (delta <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "'delta' must be positive";
+		return FG_vector<double>::ptr();
+	}
+	int weight_size = header.has_edge_data() ? header.get_edge_data_size() : 0;
+	if (weight_size != 0 && weight_size != sizeof(int32_t)
+			&& weight_size != sizeof(double)) {
+		BOOST_LOG_TRIVIAL(error)
+			<< boost::format("SSSP doesn't support edge weights of %1% bytes")
+			% weight_size;
+		return FG_vector<double>::ptr();
+	}
+
+	graph_index::ptr index = NUMA_graph_index<sssp_vertex>::create(header);
+	graph_engine::ptr graph = fg->create_engine(index);
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Starting SSSP from vertex %1% with delta %2%")
+		% source % delta;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	((sssp_vertex &) graph->get_vertex(source)).set_source();
+	sssp_iter_stats stats;
+	graph->start(&source, 1, vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new sssp_vertex_program_creater(
+					stats, delta, weight_size)));
+	graph->wait4complete();
+
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("SSSP took %1% sec to complete and relaxed %2% edges in %3% iterations")
+		% time_diff(start, end) % stats.num_relaxes.get()
+		% graph->get_curr_level();
+
+	FG_vector<double>::ptr ret = FG_vector<double>::create(
+			graph->get_num_vertices());
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<double, sssp_vertex>(ret)));
+	return ret;
+}
+
+}
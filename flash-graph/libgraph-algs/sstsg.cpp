@@ -38,6 +38,7 @@ namespace {
 time_t timestamp;
 time_t time_interval = 1;
 int num_time_intervals = 1;
+ts_index::ptr ts_idx;
 
 class scan_vertex: public compute_vertex
 {
@@ -56,6 +57,7 @@ public:
 		num_joined = 0;
 		local_scans = NULL;
 		neighbors = NULL;
+		result = 0;
 	}
 
 	double get_result() const {
@@ -71,7 +73,10 @@ public:
 
 	void run(vertex_program &prog) {
 		vertex_id_t id = prog.get_vertex_id(*this);
-		request_vertices(&id, 1);
+		// A vertex without edges in the time interval doesn't have
+		// neighbors to scan, so we don't need to read it.
+		if (ts_idx->overlap(id, edge_type::BOTH_EDGES, timestamp, time_interval))
+			request_vertices(&id, 1);
 	}
 
 	void run(vertex_program &prog, const page_vertex &vertex) {
@@ -342,6 +347,7 @@ FG_vector<float>::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
 	timestamp = start_time;
 	time_interval = interval;
 	num_time_intervals = num_intervals;
+	ts_idx = get_ts_index(fg);
 
 	graph_index::ptr index = NUMA_graph_index<scan_vertex>::create(
 			fg->get_graph_header());
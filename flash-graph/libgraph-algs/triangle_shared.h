@@ -21,9 +21,9 @@
 
 #include "graph_engine.h"
 #include "graph_config.h"
-#include "graphlab/cuckoo_set_pow2.hpp"
 #include "FG_vector.h"
 #include "FGlib.h"
+#include "sorted_intersect.h"
 
 /*
  * This contains the data structures shared directed triangle counting
@@ -31,8 +31,6 @@
  */
 
 const double BIN_SEARCH_RATIO = 100;
-const int HASH_SEARCH_RATIO = 16;
-const int hash_threshold = 1000;
 
 static atomic_number<long> num_working_vertices;
 static atomic_number<long> num_completed_vertices;
@@ -52,49 +50,6 @@ public:
 
 struct runtime_data_t
 {
-	class index_entry
-	{
-		fg::vertex_id_t id;
-		uint32_t idx;
-	public:
-		index_entry() {
-			id = -1;
-			idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id) {
-			this->id = id;
-			this->idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id, uint32_t idx) {
-			this->id = id;
-			this->idx = idx;
-		}
-
-		fg::vertex_id_t get_id() const {
-			return id;
-		}
-
-		uint32_t get_idx() const {
-			return idx;
-		}
-
-		bool operator==(const index_entry &e) const {
-			return id == e.get_id();
-		}
-	};
-
-	class index_hash
-	{
-		boost::hash<fg::vertex_id_t> id_hash;
-	public:
-		size_t operator()(const index_entry &e) const {
-			return id_hash(e.get_id());
-		}
-	};
-	typedef graphlab::cuckoo_set_pow2<index_entry, 3, size_t,
-			index_hash> edge_set_t;
 	// It contains part of the edge list.
 	// We only use the neighbors whose ID is smaller than this vertex.
 	std::vector<fg::vertex_id_t> edges;
@@ -107,24 +62,93 @@ struct runtime_data_t
 	size_t num_required;
 	size_t num_triangles;
 
-	edge_set_t edge_set;
+	// The buffers for intersecting the edge list with the edge list of
+	// a neighbor. A vertex only runs in one thread at a time, so they
+	// can be reused for all neighbors.
+	std::vector<fg::vertex_id_t> neigh_edges;
+	std::vector<fg::vsize_t> match_idxs;
 public:
-	runtime_data_t(size_t num_edges, size_t num_triangles): edge_set(
-				index_entry(), 0, 2 * num_edges) {
+	runtime_data_t(size_t num_edges, size_t num_triangles) {
+		edges.reserve(num_edges);
 		num_joined = 0;
 		this->num_required = 0;
 		this->num_triangles = num_triangles;
 	}
 
 	void finalize_init() {
-		// We only build a hash table on large vertices
-		if (edges.size() > (size_t) hash_threshold)
-			for (size_t i = 0; i < edges.size(); i++)
-				edge_set.insert(index_entry(edges[i], i));
+		// The intersection requires the edge list to be sorted and unique.
+		assert(std::is_sorted(edges.begin(), edges.end()));
+		edges.resize(std::unique(edges.begin(), edges.end()) - edges.begin());
 		triangles.resize(edges.size());
 	}
+
+	size_t count_triangles(const fg::page_vertex &v, fg::edge_type type,
+			size_t num_v_edges, fg::vertex_id_t this_id);
 };
 
+/*
+ * Count the triangles formed by this vertex, its neighbor `v' and
+ * the common neighbors of the two vertices, and increase the triangle
+ * counts of the common neighbors. We only use the first `num_v_edges'
+ * edges of the neighbor.
+ */
+inline size_t runtime_data_t::count_triangles(const fg::page_vertex &v,
+		fg::edge_type type, size_t num_v_edges, fg::vertex_id_t this_id)
+{
+	size_t num_local_triangles = 0;
+	if (num_v_edges == 0 || edges.empty())
+		return 0;
+
+	/*
+	 * If the neighbor vertex has way more edges than this vertex, we
+	 * binary search for the edges of this vertex in the neighbor's edge
+	 * list in the page cache instead of copying the neighbor's edge list.
+	 *
+	 * We can reduce binary search overhead by using the new end in
+	 * the search range. We can further reduce overhead by searching
+	 * in a reverse order (start from the largest neighbor).
+	 * Since vertices of smaller ID has more neighbors, it's more likely
+	 * that a neighbor is in the beginning of the adjacency list, and
+	 * the search range will be narrowed faster.
+	 */
+	if (num_v_edges / edges.size() > BIN_SEARCH_RATIO) {
+		fg::edge_iterator other_it = v.get_neigh_begin(type);
+		fg::edge_iterator other_end = other_it + num_v_edges;
+		for (int i = edges.size() - 1; i >= 0; i--) {
+			fg::vertex_id_t this_neighbor = edges[i];
+			// We need to skip loops.
+			if (this_neighbor != v.get_id() && this_neighbor != this_id) {
+				fg::edge_iterator first = std::lower_bound(other_it,
+						other_end, this_neighbor);
+				if (first != other_end && this_neighbor == *first) {
+					num_local_triangles++;
+					triangles[i]++;
+				}
+				other_end = first;
+			}
+		}
+		return num_local_triangles;
+	}
+
+	// Otherwise, we copy the part of the neighbor's edge list that we
+	// intersect to a contiguous buffer and intersect the two lists with
+	// the intersection kernels.
+	neigh_edges.resize(num_v_edges);
+	v.read_edges(type, neigh_edges.data(), num_v_edges);
+	match_idxs.resize(num_v_edges);
+	size_t num_matches = fg::sorted_intersect(edges.data(), edges.size(),
+			neigh_edges.data(), num_v_edges, match_idxs.data());
+	for (size_t i = 0; i < num_matches; i++) {
+		size_t idx = match_idxs[i];
+		// skip loop
+		if (edges[idx] != v.get_id() && edges[idx] != this_id) {
+			num_local_triangles++;
+			triangles[idx]++;
+		}
+	}
+	return num_local_triangles;
+}
+
 enum multi_func_flags
 {
 	NUM_TRIANGLES,
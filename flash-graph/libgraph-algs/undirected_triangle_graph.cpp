@@ -122,7 +122,6 @@ void undirected_triangle_vertex::run_on_itself(vertex_program &prog,
 				|| (num_edges_neigh == data->degree
 					&& neigh_id < id)) {
 			data->edges.push_back(neigh_id);
-			data->num_required++;
 		}
 	}
 
@@ -136,6 +135,7 @@ void undirected_triangle_vertex::run_on_itself(vertex_program &prog,
 	}
 	std::sort(data->edges.begin(), data->edges.end());
 	data->finalize_init();
+	data->num_required = data->edges.size();
 	// We now can request the neighbors.
 	request_vertices(data->edges.data(), data->edges.size());
 }
@@ -179,24 +179,13 @@ int undirected_triangle_vertex::count_triangles(vertex_program &prog,
 		const page_vertex *v) const
 {
 	vertex_id_t this_id = prog.get_vertex_id(*this);
-	int num_local_triangles = 0;
 	assert(v->get_id() != this_id);
 
 	if (v->get_num_edges(edge_type::OUT_EDGE) == 0)
 		return 0;
 
-	/*
-	 * We search for triangles with two different ways:
-	 * binary search if two adjacency lists have very different sizes,
-	 * scan otherwise.
-	 *
-	 * when binary search for multiple neighbors, we can reduce binary search
-	 * overhead by using the new end in the search range. We can further reduce
-	 * overhead by searching in a reverse order (start from the largest neighbor).
-	 * Since vertices of smaller ID has more neighbors, it's more likely
-	 * that a neighbor is in the beginning of the adjacency list, and
-	 * the search range will be narrowed faster.
-	 */
+	// We only need the neighbor's edges whose IDs are smaller than
+	// the neighbor.
 	edge_iterator other_it = v->get_neigh_begin(edge_type::OUT_EDGE);
 	edge_iterator other_end = std::lower_bound(other_it,
 			v->get_neigh_end(edge_type::OUT_EDGE), v->get_id());
@@ -205,70 +194,7 @@ int undirected_triangle_vertex::count_triangles(vertex_program &prog,
 		return 0;
 
 	runtime_data_t *data = local_value.get_runtime_data();
-	if (data->edge_set.size() > 0
-			&& data->edges.size() > HASH_SEARCH_RATIO * num_v_edges) {
-		for (; other_it != other_end; ++other_it) {
-			vertex_id_t neigh_neighbor = *other_it;
-			runtime_data_t::edge_set_t::const_iterator it
-				= data->edge_set.find(neigh_neighbor);
-			if (it != data->edge_set.end()) {
-				if (neigh_neighbor != v->get_id()
-						&& neigh_neighbor != this_id) {
-					num_local_triangles++;
-					int idx = (*it).get_idx();
-					data->triangles[idx]++;
-				}
-			}
-		}
-	}
-	// If the neighbor vertex has way more edges than this vertex.
-	else if (num_v_edges / data->edges.size() > BIN_SEARCH_RATIO) {
-		for (int i = data->edges.size() - 1; i >= 0; i--) {
-			vertex_id_t this_neighbor = data->edges.at(i);
-			// We need to skip loops.
-			if (this_neighbor != v->get_id()
-					&& this_neighbor != this_id) {
-				edge_iterator first = std::lower_bound(other_it, other_end,
-						this_neighbor);
-				if (first != other_end && this_neighbor == *first) {
-					num_local_triangles++;
-					data->triangles[i]++;
-				}
-				other_end = first;
-			}
-		}
-	}
-	else {
-		std::vector<vertex_id_t>::const_iterator this_it = data->edges.cbegin();
-		std::vector<vertex_id_t>::const_iterator this_end
-			= std::lower_bound(this_it, data->edges.cend(), v->get_id());
-		std::vector<int>::iterator count_it = data->triangles.begin();
-
-		edge_seq_iterator other_it = v->get_neigh_seq_it(edge_type::OUT_EDGE, 0,
-					v->get_num_edges(edge_type::OUT_EDGE));
-		while (this_it != this_end && other_it.has_next()) {
-			vertex_id_t this_neighbor = *this_it;
-			vertex_id_t neigh_neighbor = other_it.curr();
-			if (this_neighbor == neigh_neighbor) {
-				// skip loop
-				if (neigh_neighbor != v->get_id()
-						&& neigh_neighbor != this_id) {
-					num_local_triangles++;
-					(*count_it)++;
-				}
-				++this_it;
-				other_it.next();
-				++count_it;
-			}
-			else if (this_neighbor < neigh_neighbor) {
-				++this_it;
-				++count_it;
-			}
-			else
-				other_it.next();
-		}
-	}
-	return num_local_triangles;
+	return data->count_triangles(*v, edge_type::OUT_EDGE, num_v_edges, this_id);
 }
 
 }
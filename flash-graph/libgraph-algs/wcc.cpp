@@ -28,6 +28,7 @@
 #include "FG_vector.h"
 #include "FGlib.h"
 #include "ts_graph.h"
+#include "edge_stream.h"
 
 using namespace fg;
 
@@ -396,6 +397,66 @@ void ts_wcc_vertex::run(vertex_program &prog, const page_vertex &vertex)
 	prog.multicast_msg(out_it, msg);
 }
 
+/*
+ * This vertex computes WCC in the edge-centric streaming mode.
+ * It takes the minimal component ID of its neighbors when its edges are
+ * streamed and updates its component ID at the end of an iteration.
+ */
+class wcc_stream_vertex: public stream_compute_vertex
+{
+	vertex_id_t component_id;
+	vertex_id_t new_component_id;
+	bool empty;
+public:
+	wcc_stream_vertex(vertex_id_t id): stream_compute_vertex(id) {
+		component_id = id;
+		new_component_id = id;
+		empty = true;
+	}
+
+	void gather(stream_program &prog, const page_vertex &vertex,
+			edge_type type) {
+		if (vertex.get_num_edges(type) == 0)
+			return;
+		empty = false;
+		edge_iterator end_it = vertex.get_neigh_end(type);
+		for (edge_iterator it = vertex.get_neigh_begin(type);
+				it != end_it; ++it) {
+			wcc_stream_vertex &v
+				= (wcc_stream_vertex &) prog.get_graph().get_vertex(*it);
+			new_component_id = std::min(new_component_id, v.component_id);
+		}
+	}
+
+	void run_on_engine_start(stream_program &, vertex_id_t) {
+	}
+
+	void run_on_edges(stream_program &prog, const page_vertex &vertex) {
+		// In a directed graph, the vertex only has the edges of
+		// the streamed type.
+		if (vertex.is_directed()) {
+			gather(prog, vertex, IN_EDGE);
+			gather(prog, vertex, OUT_EDGE);
+		}
+		else
+			gather(prog, vertex, OUT_EDGE);
+	}
+
+	void run_on_iteration_end(stream_program &prog, vertex_id_t) {
+		if (new_component_id < component_id) {
+			component_id = new_component_id;
+			prog.notify_change();
+		}
+	}
+
+	vertex_id_t get_result() const {
+		if (!empty)
+			return component_id;
+		else
+			return INVALID_VERTEX_ID;
+	}
+};
+
 }
 
 #include "save_result.h"
@@ -577,4 +638,36 @@ FG_vector<vertex_id_t>::ptr compute_ts_wcc(FG_graph::ptr fg,
 	return vec;
 }
 
+FG_vector<vertex_id_t>::ptr compute_wcc_stream(FG_graph::ptr fg)
+{
+	graph_index::ptr index = NUMA_graph_index<wcc_stream_vertex>::create(
+			fg->get_graph_header());
+	edge_stream_engine::ptr engine = edge_stream_engine::create(fg, index);
+	BOOST_LOG_TRIVIAL(info) << "streaming weakly connected components starts";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	engine->start(BOTH_EDGES, INT_MAX, stream_program_creater::ptr(
+				new def_stream_program_creater<wcc_stream_vertex>()));
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("WCC takes %1% seconds in total")
+		% time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	FG_vector<vertex_id_t>::ptr vec = FG_vector<vertex_id_t>::create(
+			engine->get_graph());
+	engine->query_on_all(vertex_query::ptr(
+				new save_query<vertex_id_t, wcc_stream_vertex>(vec)));
+	return vec;
+}
+
 }
@@ -25,78 +25,81 @@ namespace fg
 {
 
 load_balancer::load_balancer(graph_engine &_graph,
-		worker_thread &_owner): owner(_owner), graph(_graph)
+		worker_thread &_owner): owner(_owner), graph(_graph), rand_gen(
+			_owner.get_worker_id())
 {
-	steal_thread_id = (owner.get_worker_id() + 1) % graph.get_num_threads();
-	// TODO can I have a better way to do it?
-	completed_stolen_vertices = (fifo_queue<vertex_id_t> *) malloc(
-			graph.get_num_threads() * sizeof(fifo_queue<vertex_id_t>));
+	// The threads haven't been created yet, so we have to infer the node
+	// of a thread in the same way as the graph engine assigns threads
+	// to nodes.
+	int num_nodes = graph.get_num_nodes();
 	for (int i = 0; i < graph.get_num_threads(); i++) {
-		new (completed_stolen_vertices + i) fifo_queue<vertex_id_t>(
-				_owner.get_node_id(), 4096, true);
+		if (i == owner.get_worker_id())
+			continue;
+		if (i % num_nodes == owner.get_worker_id() % num_nodes)
+			local_victims.push_back(i);
+		else
+			remote_victims.push_back(i);
 	}
-	num_completed_stolen_vertices = 0;
+	stolen_batch = NULL;
+	stolen_batch_idx = 0;
 }
 
 load_balancer::~load_balancer()
 {
-	for (int i = 0; i < graph.get_num_threads(); i++)
-		completed_stolen_vertices[i].~fifo_queue<vertex_id_t>();
-	free(completed_stolen_vertices);
+	delete stolen_batch;
+}
+
+/*
+ * Try to steal a batch from the victims. We start from a random victim
+ * and try all of them in a round-robin fashion.
+ */
+vertex_batch *load_balancer::steal_batch(const std::vector<int> &victims)
+{
+	if (victims.empty())
+		return NULL;
+
+	size_t start = rand_gen() % victims.size();
+	for (size_t i = 0; i < victims.size(); i++) {
+		worker_thread *t = graph.get_thread(
+				victims[(start + i) % victims.size()]);
+		vertex_batch *batch = t->steal_activated_vertices();
+		if (batch)
+			return batch;
+	}
+	return NULL;
 }
 
 /**
- * This steals vertices from other threads. It tries to steal more vertices
- * than it can process, and the remaining vertices will be placed in its
- * own activated vertex queue.
+ * This steals vertices from other threads. It steals a batch of vertices
+ * each time. If the batch has more vertices than the owner thread can
+ * process now, the remaining vertices are kept for the next invocation.
  */
 int load_balancer::steal_activated_vertices(compute_vertex_pointer vertex_buf[],
 		int buf_size)
 {
-	if (steal_thread_id == owner.get_worker_id())
-		steal_thread_id = (steal_thread_id + 1) % graph.get_num_threads();
-	int num_tries = 0;
-	int num;
-	do {
-		worker_thread *t = graph.get_thread(steal_thread_id);
-		num_tries++;
-
-		num = t->steal_activated_vertices(vertex_buf, buf_size);
-		// If we can't steal vertices from the thread, we should move
-		// to the next thread.
-		if (num == 0)
-			steal_thread_id = (steal_thread_id + 1) % graph.get_num_threads();
-		// If we have tried to steal vertices from all threads.
-	} while (num == 0 && num_tries < graph.get_num_threads());
+	if (stolen_batch == NULL) {
+		stolen_batch = steal_batch(local_victims);
+		if (stolen_batch == NULL)
+			stolen_batch = steal_batch(remote_victims);
+		if (stolen_batch == NULL)
+			return 0;
+		stolen_batch_idx = 0;
+	}
 
+	int num = std::min(buf_size, stolen_batch->num - stolen_batch_idx);
+	memcpy(vertex_buf, stolen_batch->vertices + stolen_batch_idx,
+			sizeof(vertex_buf[0]) * num);
 	// Record the owner thread of the stolen vertices.
 	for (int i = 0; i < num; i++)
 		stolen_vertex_map.insert(vertex_map_t::value_type(
-					vertex_buf[i].get(), steal_thread_id));
-
-	return num;
-}
-
-void load_balancer::process_completed_stolen_vertices()
-{
-	if (num_completed_stolen_vertices == 0)
-		return;
-
-	int num_tot = 0;
-	for (int i = 0; i < graph.get_num_threads(); i++) {
-		fifo_queue<vertex_id_t> &q = completed_stolen_vertices[i];
-		if (!q.is_empty()) {
-			worker_thread *t = graph.get_thread(i);
-			int num_completed = q.get_num_entries();
-			num_tot += num_completed;
-			stack_array<vertex_id_t> buf(num_completed);
-			BOOST_VERIFY(q.fetch(buf.data(), num_completed)
-					== num_completed);
-			t->return_vertices(buf.data(), num_completed);
-		}
+					vertex_buf[i].get(), stolen_batch->part_id));
+	stolen_batch_idx += num;
+	if (stolen_batch_idx == stolen_batch->num) {
+		delete stolen_batch;
+		stolen_batch = NULL;
+		stolen_batch_idx = 0;
 	}
-	assert(num_tot == num_completed_stolen_vertices);
-	num_completed_stolen_vertices = 0;
+	return num;
 }
 
 void load_balancer::return_vertices(const compute_vertex_pointer vs[], int num)
@@ -110,16 +113,9 @@ void load_balancer::return_vertices(const compute_vertex_pointer vs[], int num)
 		// owner because messages are processed in the main vertices and the
 		// main vertices cannot be stolen by other threads.
 		if (!v.is_part()) {
-			if (completed_stolen_vertices[part_id].is_full()) {
-				completed_stolen_vertices[part_id].expand_queue(
-						completed_stolen_vertices[part_id].get_size() * 2);
-			}
-			// TODO we can return compute_vertex_pointer and so we don't
-			// map it back to local_vid_t.
-			vertex_id_t id = graph.get_graph_index().get_vertex_id(part_id,
+			local_vid_t id = graph.get_graph_index().get_local_id(part_id,
 					*v.get());
-			completed_stolen_vertices[part_id].push_back(id);
-			num_completed_stolen_vertices++;
+			graph.get_thread(part_id)->return_vertices(&id, 1);
 		}
 		stolen_vertex_map.erase(it);
 	}
@@ -127,9 +123,8 @@ void load_balancer::return_vertices(const compute_vertex_pointer vs[], int num)
 
 void load_balancer::reset()
 {
-	for (int i = 0; i < graph.get_num_threads(); i++)
-		assert(completed_stolen_vertices[i].is_empty());
-	assert(num_completed_stolen_vertices == 0);
+	assert(stolen_batch == NULL);
+	assert(stolen_vertex_map.empty());
 }
 
 int load_balancer::get_stolen_vertex_part(const compute_vertex &v) const
@@ -21,6 +21,8 @@
  */
 
 #include <unordered_map>
+#include <vector>
+#include <random>
 
 #include "container.h"
 #include "vertex.h"
@@ -32,11 +34,15 @@ class worker_thread;
 class graph_engine;
 class compute_vertex;
 class compute_vertex_pointer;
+struct vertex_batch;
 
 /*
  * This class is to help balance the load.
  * If the owner thread has finished the work originally assigned to it,
  * it can steal work from other threads through this class.
+ * Vertices are stolen in batches from the work-stealing deques of other
+ * threads. The victims are chosen randomly, and the threads on the same
+ * NUMA node are always tried before the threads on the other nodes.
  */
 class load_balancer
 {
@@ -49,12 +55,18 @@ class load_balancer
 	// partition.
 	vertex_map_t stolen_vertex_map;
 
-	// This is a local buffer that contains the completed stolen vertices.
-	// All vertices here need to be returned to their owner threads.
-	fifo_queue<vertex_id_t> *completed_stolen_vertices;
-	int num_completed_stolen_vertices;
-	// The thread where we should steal activated vertices from.
-	int steal_thread_id;
+	// The threads on the same NUMA node as the owner thread.
+	std::vector<int> local_victims;
+	// The threads on the other NUMA nodes.
+	std::vector<int> remote_victims;
+	std::default_random_engine rand_gen;
+
+	// The batch of stolen vertices that hasn't been processed by
+	// the owner thread.
+	vertex_batch *stolen_batch;
+	int stolen_batch_idx;
+
+	vertex_batch *steal_batch(const std::vector<int> &victims);
 public:
 	load_balancer(graph_engine &_graph, worker_thread &_owner);
 
@@ -65,14 +77,11 @@ public:
 	int steal_activated_vertices(compute_vertex_pointer vertices[], int num);
 	/**
 	 * After the thread finishes processing the stolen vertices, it needs to
-	 * return all the vertices to their owner threads.
+	 * return all the vertices to their owner threads. The vertices are
+	 * returned to the owner threads directly.
 	 */
 	void return_vertices(const compute_vertex_pointer vs[], int num);
 
-	// This method is to return all completed stolen vertices to their owner
-	// threads.
-	void process_completed_stolen_vertices();
-
 	void reset();
 };
 
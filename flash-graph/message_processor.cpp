@@ -219,7 +219,7 @@ void message_processor::reset()
 	assert(stolenv_msgs.is_empty());
 }
 
-void message_processor::return_vertices(vertex_id_t ids[], int num)
+void message_processor::return_vertices(const local_vid_t ids[], int num)
 {
 	if (steal_state)
 		steal_state->return_vertices(ids, num);
@@ -257,17 +257,13 @@ void steal_state_t::steal_vertices(compute_vertex_pointer vertices[], int num)
 	num_stolen += num_locals;
 }
 
-void steal_state_t::return_vertices(vertex_id_t ids[], int num)
+void steal_state_t::return_vertices(const local_vid_t ids[], int num)
 {
+	// The stolen bitmap is thread-safe, so the thread that processes
+	// the stolen vertices can return them to the owner thread directly.
+	for (int i = 0; i < num; i++)
+		stolen_bitmap.clear(ids[i].id);
 	num_returned += num;
-	for (int i = 0; i < num; i++) {
-		int part_id;
-		off_t off;
-		graph.get_partitioner()->map2loc(ids[i], part_id, off);
-		// The vertices have to be returned to the owner thread.
-		assert(worker_id == part_id);
-		stolen_bitmap.clear(off);
-	}
 }
 
 }
@@ -72,7 +72,7 @@ public:
 	void process_msgs();
 
 	void steal_vertices(compute_vertex_pointer vertices[], int num);
-	void return_vertices(vertex_id_t ids[], int num);
+	void return_vertices(const local_vid_t ids[], int num);
 
 	msg_queue &get_msg_queue() {
 		return msg_q;
@@ -137,6 +137,54 @@ size_t modulo_graph_partitioner::map2loc(edge_seq_iterator &it,
 	return ret;
 }
 
+size_t edge_balanced_partitioner::get_all_vertices_in_part(int part_id,
+			size_t tot_num_vertices, std::vector<vertex_id_t> &ids) const
+{
+	vertex_id_t end = std::min((size_t) part_starts[part_id + 1],
+			tot_num_vertices);
+	for (vertex_id_t id = part_starts[part_id]; id < end; id++)
+		ids.push_back(id);
+	return ids.size();
+}
+
+void edge_balanced_partitioner::map2loc(vertex_id_t ids[], int num,
+		std::vector<local_vid_t> locs[], int num_parts) const
+{
+	assert(num_parts <= get_num_partitions());
+	int part_id = 0;
+	for (int i = 0; i < num; i++) {
+		part_id = map(ids[i], part_id);
+		locs[part_id].push_back(local_vid_t(ids[i] - part_starts[part_id]));
+	}
+}
+
+void edge_balanced_partitioner::map2loc(edge_seq_iterator &it,
+		std::vector<local_vid_t> locs[], int num_parts) const
+{
+	assert(num_parts <= get_num_partitions());
+	int part_id = 0;
+	PAGE_FOREACH(vertex_id_t, id, it) {
+		part_id = map(id, part_id);
+		locs[part_id].push_back(local_vid_t(id - part_starts[part_id]));
+	} PAGE_FOREACH_END
+}
+
+size_t edge_balanced_partitioner::map2loc(edge_seq_iterator &it,
+		vertex_loc_t locs[], size_t num) const
+{
+	size_t ret = 0;
+	int part_id = 0;
+	PAGE_FOREACH(vertex_id_t, id, it) {
+		if ((size_t) page_foreach_idx == num)
+			break;
+		part_id = map(id, part_id);
+		locs[page_foreach_idx] = vertex_loc_t(part_id,
+				local_vid_t(id - part_starts[part_id]));
+		ret++;
+	} PAGE_FOREACH_END
+	return ret;
+}
+
 size_t range_graph_partitioner::map2loc(edge_seq_iterator &it,
 		vertex_loc_t locs[], size_t num) const
 {
@@ -23,6 +23,9 @@
 #include <math.h>
 
 #include <utility>
+#include <vector>
+#include <memory>
+#include <algorithm>
 
 #include "vertex.h"
 
@@ -176,6 +179,100 @@ public:
 	}
 };
 
+/*
+ * This partitioner splits vertices into contiguous ranges that have roughly
+ * the same number of edges. In a graph with a skewed degree distribution,
+ * a partition with a few hub vertices gets many more edges and messages
+ * than the others if vertices are split evenly. The ranges are cut based on
+ * the degree of vertices, so each worker thread gets a similar amount of
+ * work, and the adjacency lists of a partition are still contiguous in
+ * the graph file. It works with any number of partitions.
+ */
+class edge_balanced_partitioner: public graph_partitioner
+{
+	// The first vertex of each partition. The last element is the number
+	// of vertices in the graph.
+	std::vector<vertex_id_t> part_starts;
+
+	edge_balanced_partitioner(const std::vector<vertex_id_t> &part_starts) {
+		this->part_starts = part_starts;
+	}
+
+	/*
+	 * The vertex IDs in an adjacency list are usually sorted, so we search
+	 * from the partition of the previous vertex.
+	 */
+	int map(vertex_id_t id, int prev_part_id) const {
+		if (part_starts[prev_part_id] <= id
+				&& id < part_starts[prev_part_id + 1])
+			return prev_part_id;
+		return map(id);
+	}
+public:
+	/*
+	 * Create a partitioner for a graph with `num_vertices' vertices.
+	 * `get_num_edges' returns the number of edges of a vertex.
+	 */
+	template<class GetNumEdges>
+	static std::unique_ptr<edge_balanced_partitioner> create(
+			size_t num_vertices, int num_parts, GetNumEdges get_num_edges) {
+		assert(num_parts > 0);
+		// A vertex costs some work even if it doesn't have edges.
+		size_t tot_weight = 0;
+		for (vertex_id_t id = 0; id < num_vertices; id++)
+			tot_weight += get_num_edges(id) + 1;
+
+		std::vector<vertex_id_t> part_starts(1, 0);
+		size_t weight = 0;
+		for (vertex_id_t id = 0; id < num_vertices
+				&& part_starts.size() < (size_t) num_parts; id++) {
+			weight += get_num_edges(id) + 1;
+			if (weight * num_parts >= tot_weight * part_starts.size())
+				part_starts.push_back(id + 1);
+		}
+		part_starts.resize(num_parts + 1, num_vertices);
+		return std::unique_ptr<edge_balanced_partitioner>(
+				new edge_balanced_partitioner(part_starts));
+	}
+
+	int get_num_partitions() const {
+		return part_starts.size() - 1;
+	}
+
+	virtual int map(vertex_id_t id) const {
+		// If some partitions are empty, they have the same start as
+		// the next non-empty partition, and we pick the non-empty one.
+		return std::upper_bound(part_starts.begin(), part_starts.end(), id)
+			- part_starts.begin() - 1;
+	}
+
+	virtual void map2loc(vertex_id_t id, int &part_id, off_t &off) const {
+		part_id = map(id);
+		off = id - part_starts[part_id];
+	}
+
+	virtual void map2loc(vertex_id_t ids[], int num,
+			std::vector<local_vid_t> locs[], int num_parts) const;
+	virtual void map2loc(edge_seq_iterator &, std::vector<local_vid_t> locs[],
+			int num_parts) const;
+	virtual size_t map2loc(edge_seq_iterator &,
+			vertex_loc_t locs[], size_t num) const;
+
+	virtual void loc2map(int part_id, off_t off, vertex_id_t &id) const {
+		id = part_starts[part_id] + off;
+	}
+
+	virtual size_t get_all_vertices_in_part(int part_id,
+			size_t tot_num_vertices, std::vector<vertex_id_t> &ids) const;
+
+	virtual size_t get_part_size(int part_id, size_t num_vertices) const {
+		vertex_id_t start = std::min((size_t) part_starts[part_id], num_vertices);
+		vertex_id_t end = std::min((size_t) part_starts[part_id + 1],
+				num_vertices);
+		return end - start;
+	}
+};
+
 }
 
 #endif
@@ -0,0 +1,456 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_INTERSECT
+#endif
+
+#include "sorted_intersect.h"
+
+namespace fg
+{
+
+/*
+ * If one array is larger than the other one by this ratio, we use
+ * galloping search instead of the block-compare kernels.
+ */
+static const size_t GALLOP_RATIO = 32;
+
+/*
+ * Intersect the remaining elements of the arrays with scalar code.
+ * An element in the first array can match multiple elements in the second
+ * array, so we only move forward in the second array when we find a match.
+ */
+template<bool with_idx>
+static size_t scalar_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, size_t i, size_t j,
+		vsize_t idxs[])
+{
+	size_t num = 0;
+	while (i < len1 && j < len2) {
+		if (arr1[i] < arr2[j])
+			i++;
+		else if (arr2[j] < arr1[i])
+			j++;
+		else {
+			if (with_idx)
+				idxs[num] = i;
+			num++;
+			j++;
+		}
+	}
+	return num;
+}
+
+template<bool with_idx>
+static size_t gallop_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	size_t num = 0;
+	if (len1 <= len2) {
+		const vertex_id_t *it = arr2;
+		const vertex_id_t *end = arr2 + len2;
+		for (size_t i = 0; i < len1 && it != end; i++) {
+			it = gallop_lower_bound(it, end, arr1[i]);
+			for (; it != end && *it == arr1[i]; ++it) {
+				if (with_idx)
+					idxs[num] = i;
+				num++;
+			}
+		}
+	}
+	else {
+		const vertex_id_t *it = arr1;
+		const vertex_id_t *end = arr1 + len1;
+		for (size_t j = 0; j < len2 && it != end; j++) {
+			// The element in the first array may match the next element
+			// in the second array, so we don't move the iterator forward.
+			it = gallop_lower_bound(it, end, arr2[j]);
+			if (it != end && *it == arr2[j]) {
+				if (with_idx)
+					idxs[num] = it - arr1;
+				num++;
+			}
+		}
+	}
+	return num;
+}
+
+#ifdef SIMD_INTERSECT
+
+/*
+ * The block-compare kernel below is always inlined to the functions compiled
+ * for the instruction set of the vector type, so the ABI of passing vectors
+ * doesn't matter.
+ */
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/*
+ * The SIMD operations on a block of vertex IDs with SSE4.2.
+ */
+struct sse_ops
+{
+	typedef __m128i vec_t;
+	static const int NUM_LANES = sizeof(vec_t) / sizeof(vertex_id_t);
+
+	__attribute__((target("sse4.2")))
+	static vec_t load(const vertex_id_t *p) {
+		return _mm_loadu_si128((const vec_t *) p);
+	}
+
+	/*
+	 * Get all rotations of the vertex IDs in the vector, so comparing
+	 * a vector with all rotations of another vector compares every pair
+	 * of their elements.
+	 */
+	__attribute__((target("sse4.2")))
+	static void get_rotations(vec_t v, vec_t rots[]) {
+		rots[0] = v;
+#ifdef FG_64BIT_VERTEX_ID
+		rots[1] = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+#else
+		rots[1] = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 2, 1));
+		rots[2] = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		rots[3] = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 1, 0, 3));
+#endif
+	}
+
+	__attribute__((target("sse4.2")))
+	static vec_t cmpeq(vec_t v1, vec_t v2) {
+#ifdef FG_64BIT_VERTEX_ID
+		return _mm_cmpeq_epi64(v1, v2);
+#else
+		return _mm_cmpeq_epi32(v1, v2);
+#endif
+	}
+
+	__attribute__((target("sse4.2")))
+	static vec_t zero() {
+		return _mm_setzero_si128();
+	}
+
+	__attribute__((target("sse4.2")))
+	static vec_t sub(vec_t v1, vec_t v2) {
+#ifdef FG_64BIT_VERTEX_ID
+		return _mm_sub_epi64(v1, v2);
+#else
+		return _mm_sub_epi32(v1, v2);
+#endif
+	}
+
+	/*
+	 * Get the bitmap of the lanes that aren't zero.
+	 */
+	__attribute__((target("sse4.2")))
+	static int get_nonzero_mask(vec_t v) {
+		vec_t zero_lanes = cmpeq(v, _mm_setzero_si128());
+#ifdef FG_64BIT_VERTEX_ID
+		return (~_mm_movemask_pd(_mm_castsi128_pd(zero_lanes))) & 0x3;
+#else
+		return (~_mm_movemask_ps(_mm_castsi128_ps(zero_lanes))) & 0xf;
+#endif
+	}
+
+	__attribute__((target("sse4.2")))
+	static void store(vertex_id_t *p, vec_t v) {
+		_mm_storeu_si128((vec_t *) p, v);
+	}
+};
+
+/*
+ * The SIMD operations on a block of vertex IDs with AVX2.
+ */
+struct avx2_ops
+{
+	typedef __m256i vec_t;
+	static const int NUM_LANES = sizeof(vec_t) / sizeof(vertex_id_t);
+
+	__attribute__((target("avx2")))
+	static vec_t load(const vertex_id_t *p) {
+		return _mm256_loadu_si256((const vec_t *) p);
+	}
+
+	/*
+	 * Shuffling across the two 128-bit halves is expensive, so we rotate
+	 * the elements inside each half of the vector and of the vector with
+	 * the two halves swapped. They cover all pairs of elements as well.
+	 */
+	__attribute__((target("avx2")))
+	static void get_rotations(vec_t v, vec_t rots[]) {
+		vec_t swapped = _mm256_permute2x128_si256(v, v, 1);
+#ifdef FG_64BIT_VERTEX_ID
+		rots[0] = v;
+		rots[1] = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		rots[2] = swapped;
+		rots[3] = _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(1, 0, 3, 2));
+#else
+		rots[0] = v;
+		rots[1] = _mm256_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 2, 1));
+		rots[2] = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		rots[3] = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 1, 0, 3));
+		rots[4] = swapped;
+		rots[5] = _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(0, 3, 2, 1));
+		rots[6] = _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(1, 0, 3, 2));
+		rots[7] = _mm256_shuffle_epi32(swapped, _MM_SHUFFLE(2, 1, 0, 3));
+#endif
+	}
+
+	__attribute__((target("avx2")))
+	static vec_t cmpeq(vec_t v1, vec_t v2) {
+#ifdef FG_64BIT_VERTEX_ID
+		return _mm256_cmpeq_epi64(v1, v2);
+#else
+		return _mm256_cmpeq_epi32(v1, v2);
+#endif
+	}
+
+	__attribute__((target("avx2")))
+	static vec_t zero() {
+		return _mm256_setzero_si256();
+	}
+
+	__attribute__((target("avx2")))
+	static vec_t sub(vec_t v1, vec_t v2) {
+#ifdef FG_64BIT_VERTEX_ID
+		return _mm256_sub_epi64(v1, v2);
+#else
+		return _mm256_sub_epi32(v1, v2);
+#endif
+	}
+
+	__attribute__((target("avx2")))
+	static int get_nonzero_mask(vec_t v) {
+		vec_t zero_lanes = cmpeq(v, _mm256_setzero_si256());
+#ifdef FG_64BIT_VERTEX_ID
+		return (~_mm256_movemask_pd(_mm256_castsi256_pd(zero_lanes))) & 0xf;
+#else
+		return (~_mm256_movemask_ps(_mm256_castsi256_ps(zero_lanes))) & 0xff;
+#endif
+	}
+
+	__attribute__((target("avx2")))
+	static void store(vertex_id_t *p, vec_t v) {
+		_mm256_storeu_si256((vec_t *) p, v);
+	}
+};
+
+/*
+ * Intersect two arrays block by block. We compare a block of the first
+ * array with all rotations of a block of the second array, so every pair
+ * of elements in the two blocks is compared once. Afterwards, we move
+ * forward in the array whose block has the smaller last element.
+ * When the last elements are the same, we move forward in the second array,
+ * because its next block may contain more copies of the last element.
+ */
+template<class ops, bool with_idx>
+__attribute__((always_inline))
+static inline size_t block_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	const int L = ops::NUM_LANES;
+	size_t num = 0;
+	size_t i = 0;
+	size_t j = 0;
+	// The number of matches of each lane in the first array. A match sets
+	// all bits of a lane in the comparison result, i.e., -1.
+	typename ops::vec_t tot_counts = ops::zero();
+	while (i + L <= len1 && j + L <= len2) {
+		typename ops::vec_t v1 = ops::load(arr1 + i);
+		typename ops::vec_t rots[L];
+		ops::get_rotations(ops::load(arr2 + j), rots);
+		// When we only count the matches, we accumulate the counts of all
+		// blocks in the vector.
+		typename ops::vec_t counts = with_idx ? ops::zero() : tot_counts;
+		for (int r = 0; r < L; r++)
+			counts = ops::sub(counts, ops::cmpeq(v1, rots[r]));
+		if (with_idx) {
+			int mask = ops::get_nonzero_mask(counts);
+			if (mask) {
+				vertex_id_t lane_counts[L];
+				ops::store(lane_counts, counts);
+				// We only visit the lanes with matches.
+				do {
+					int k = __builtin_ctz(mask);
+					mask &= mask - 1;
+					for (vertex_id_t c = 0; c < lane_counts[k]; c++)
+						idxs[num++] = i + k;
+				} while (mask);
+			}
+		}
+		else
+			tot_counts = counts;
+		bool move2 = arr2[j + L - 1] <= arr1[i + L - 1];
+		j += move2 * L;
+		i += (!move2) * L;
+	}
+	if (!with_idx) {
+		vertex_id_t lane_counts[L];
+		ops::store(lane_counts, tot_counts);
+		for (int k = 0; k < L; k++)
+			num += lane_counts[k];
+	}
+	if (with_idx)
+		return num + scalar_intersect<with_idx>(arr1, len1, arr2, len2, i, j,
+				idxs + num);
+	else
+		return num + scalar_intersect<with_idx>(arr1, len1, arr2, len2, i, j,
+				NULL);
+}
+
+template<bool with_idx>
+__attribute__((target("sse4.2")))
+static size_t sse_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	return block_intersect<sse_ops, with_idx>(arr1, len1, arr2, len2, idxs);
+}
+
+template<bool with_idx>
+__attribute__((target("avx2")))
+static size_t avx2_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	return block_intersect<avx2_ops, with_idx>(arr1, len1, arr2, len2, idxs);
+}
+
+#endif
+
+template<bool with_idx>
+static size_t scalar_kernel(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	return scalar_intersect<with_idx>(arr1, len1, arr2, len2, 0, 0, idxs);
+}
+
+typedef size_t (*intersect_func)(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[]);
+
+struct intersect_kernel
+{
+	intersect_impl impl;
+	intersect_func count;
+	intersect_func find;
+};
+
+static bool is_supported(intersect_impl impl)
+{
+#ifdef SIMD_INTERSECT
+	__builtin_cpu_init();
+	switch (impl) {
+		case SCALAR_INTERSECT:
+			return true;
+		case SSE_INTERSECT:
+			return __builtin_cpu_supports("sse4.2");
+		case AVX2_INTERSECT:
+			return __builtin_cpu_supports("avx2");
+		default:
+			return false;
+	}
+#else
+	return impl == SCALAR_INTERSECT;
+#endif
+}
+
+static intersect_kernel get_kernel(intersect_impl impl)
+{
+	intersect_kernel kernel;
+	kernel.impl = impl;
+	switch (impl) {
+#ifdef SIMD_INTERSECT
+		case AVX2_INTERSECT:
+			kernel.count = avx2_intersect<false>;
+			kernel.find = avx2_intersect<true>;
+			break;
+		case SSE_INTERSECT:
+			kernel.count = sse_intersect<false>;
+			kernel.find = sse_intersect<true>;
+			break;
+#endif
+		default:
+			kernel.impl = SCALAR_INTERSECT;
+			kernel.count = scalar_kernel<false>;
+			kernel.find = scalar_kernel<true>;
+	}
+	return kernel;
+}
+
+static intersect_kernel detect_kernel()
+{
+	if (is_supported(AVX2_INTERSECT))
+		return get_kernel(AVX2_INTERSECT);
+	else if (is_supported(SSE_INTERSECT))
+		return get_kernel(SSE_INTERSECT);
+	else
+		return get_kernel(SCALAR_INTERSECT);
+}
+
+static intersect_kernel kernel = detect_kernel();
+
+intersect_impl get_intersect_impl()
+{
+	return kernel.impl;
+}
+
+const char *get_intersect_impl_name()
+{
+	switch (kernel.impl) {
+		case AVX2_INTERSECT:
+			return "avx2";
+		case SSE_INTERSECT:
+			return "sse4.2";
+		default:
+			return "scalar";
+	}
+}
+
+bool set_intersect_impl(intersect_impl impl)
+{
+	if (!is_supported(impl))
+		return false;
+	kernel = get_kernel(impl);
+	return true;
+}
+
+static inline bool use_gallop(size_t len1, size_t len2)
+{
+	return len1 * GALLOP_RATIO < len2 || len2 * GALLOP_RATIO < len1;
+}
+
+size_t sorted_intersect_count(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2)
+{
+	if (len1 == 0 || len2 == 0)
+		return 0;
+	if (use_gallop(len1, len2))
+		return gallop_intersect<false>(arr1, len1, arr2, len2, NULL);
+	return kernel.count(arr1, len1, arr2, len2, NULL);
+}
+
+size_t sorted_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[])
+{
+	if (len1 == 0 || len2 == 0)
+		return 0;
+	if (use_gallop(len1, len2))
+		return gallop_intersect<true>(arr1, len1, arr2, len2, idxs);
+	return kernel.find(arr1, len1, arr2, len2, idxs);
+}
+
+}
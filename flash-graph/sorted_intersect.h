@@ -0,0 +1,108 @@
+#ifndef __SORTED_INTERSECT_H__
+#define __SORTED_INTERSECT_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "FG_basic_types.h"
+
+/*
+ * This is the library that intersects sorted vertex ID arrays, e.g.,
+ * the adjacency lists of two vertices in triangle counting and scan
+ * statistics.
+ *
+ * In all functions, the first array must not have duplicated elements and
+ * the second array may have. A match is a pair of equal elements in
+ * the two arrays, so an element in the first array that appears multiple
+ * times in the second array is matched multiple times.
+ *
+ * When the two arrays have similar sizes, they are intersected with
+ * block-compare kernels, which compare a block of elements of each array
+ * with SIMD instructions. The kernel is chosen at runtime based on
+ * the instruction sets that the CPU supports. When one array is much
+ * larger than the other, the elements of the smaller array are searched
+ * in the larger array with galloping search.
+ */
+
+namespace fg
+{
+
+enum intersect_impl
+{
+	SCALAR_INTERSECT,
+	SSE_INTERSECT,
+	AVX2_INTERSECT,
+};
+
+/*
+ * Get the kernel used for intersection.
+ */
+intersect_impl get_intersect_impl();
+const char *get_intersect_impl_name();
+/*
+ * Choose the kernel used for intersection, which is mainly for testing.
+ * It returns false if the CPU doesn't support the kernel.
+ */
+bool set_intersect_impl(intersect_impl impl);
+
+/*
+ * Count the matches between two sorted arrays.
+ */
+size_t sorted_intersect_count(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2);
+
+/*
+ * Find the matches between two sorted arrays. For each match, it writes
+ * the location of the element in the first array to `idxs', in the ascending
+ * order. `idxs' needs to have space for `len2' elements.
+ * It returns the number of matches.
+ */
+size_t sorted_intersect(const vertex_id_t *arr1, size_t len1,
+		const vertex_id_t *arr2, size_t len2, vsize_t idxs[]);
+
+/*
+ * Find the first element that isn't smaller than the key with galloping
+ * search. It's faster than binary search when the element is close to
+ * the beginning of the range, so it works well when we search for a
+ * sequence of increasing keys in the same range. It works on any random
+ * access iterator, e.g., an edge iterator on the adjacency list of
+ * a vertex in the page cache.
+ */
+template<class iterator>
+iterator gallop_lower_bound(iterator begin, iterator end, vertex_id_t key)
+{
+	size_t len = end - begin;
+	size_t lo = 0;
+	size_t step = 1;
+	while (step <= len && *(begin + (step - 1)) < key) {
+		lo = step;
+		step *= 2;
+	}
+	iterator first = begin;
+	first += lo;
+	iterator last = begin;
+	last += std::min(step, len);
+	return std::lower_bound(first, last, key);
+}
+
+}
+
+#endif
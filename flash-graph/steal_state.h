@@ -77,7 +77,7 @@ public:
 
 	void steal_vertices(compute_vertex_pointer vertices[], int num);
 
-	void return_vertices(vertex_id_t ids[], int num);
+	void return_vertices(const local_vid_t ids[], int num);
 
 	bool steal_mode_enabled() const {
 		// It should be fine to use the relaxed memory order. steal_state
@@ -0,0 +1,488 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This runs a matrix of graph algorithms, graphs, thread counts and cache
+ * sizes and writes the measurements of every run as JSON or CSV, so
+ * the results can be compared across runs and commits.
+ *
+ * The benchmark is described by a file in the format of the FlashGraph
+ * configuration file:
+ *	algs=pagerank:30,wcc,bfs:0
+ *	graphs=twitter:twitter.adj:twitter.index,friendster:fr.adj:fr.index
+ *	threads=16,32
+ *	cache_sizes=1G,4G
+ *	warmup=1
+ *	repeats=3
+ * The arguments of an algorithm follow its name and are separated by ':'.
+ * Each combination of the number of threads and the cache size
+ * reinitializes FlashGraph with the configuration file and these two
+ * options.
+ */
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "FGlib.h"
+
+using namespace fg;
+
+size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type);
+
+/*
+ * The measurements of a run of an algorithm.
+ */
+struct bench_run
+{
+	std::string alg;
+	std::string graph;
+	int num_threads;
+	std::string cache_size;
+	int rep;
+	double seconds;
+	engine_stats stats;
+	// The peak resident memory during the run in bytes.
+	size_t peak_mem;
+	// A summary of the result of the algorithm.
+	std::string result;
+	// "pass" or "fail" if the expected result is given.
+	std::string check;
+};
+
+struct bench_graph
+{
+	std::string name;
+	std::string graph_file;
+	std::string index_file;
+};
+
+static std::vector<std::string> split(const std::string &str, char delim)
+{
+	std::vector<std::string> strs;
+	split_string(str, delim, strs);
+	return strs;
+}
+
+static size_t count_comps(FG_vector<vertex_id_t>::ptr comp_ids)
+{
+	count_map<vertex_id_t> map;
+	comp_ids->count_unique(map);
+	if (map.exists(INVALID_VERTEX_ID))
+		map.remove(INVALID_VERTEX_ID);
+	return map.get_size();
+}
+
+static const std::string supported_algs[] = {
+	"pagerank",
+	"wcc",
+	"scc",
+	"bfs",
+	"sssp",
+	"kcore",
+	"triangle",
+	"local_scan",
+	"diameter",
+};
+static const int num_supported = sizeof(supported_algs)
+	/ sizeof(supported_algs[0]);
+
+static std::string get_arg(const std::vector<std::string> &args, size_t idx,
+		const std::string &def)
+{
+	return args.size() > idx ? args[idx] : def;
+}
+
+/*
+ * Run the algorithm and return a summary of its result. The summary is
+ * compared with the expected result.
+ */
+static std::string run_alg(FG_graph::ptr graph, const std::string &alg,
+		const std::vector<std::string> &args)
+{
+	bool directed = graph->get_graph_header().is_directed_graph();
+	if (alg == "pagerank") {
+		int num_iters = atoi(get_arg(args, 0, "30").c_str());
+		FG_vector<float>::ptr pr = compute_pagerank(graph, num_iters, 0.85);
+		return (boost::format("top=v%1%") % pr->max_val_loc().second).str();
+	}
+	else if (alg == "wcc")
+		return (boost::format("comps=%1%") % count_comps(compute_wcc(graph))).str();
+	else if (alg == "scc")
+		return (boost::format("comps=%1%") % count_comps(compute_scc(graph))).str();
+	else if (alg == "bfs") {
+		vertex_id_t start = atol(get_arg(args, 0, "0").c_str());
+		return (boost::format("visited=%1%")
+				% bfs(graph, start, edge_type::OUT_EDGE)).str();
+	}
+	else if (alg == "sssp") {
+		vertex_id_t source = atol(get_arg(args, 0, "0").c_str());
+		double delta = atof(get_arg(args, 1, "1").c_str());
+		FG_vector<double>::ptr dists = compute_sssp(graph, source, delta);
+		size_t num_reached = 0;
+		for (size_t i = 0; i < dists->get_size(); i++)
+			num_reached += dists->get(i) != std::numeric_limits<double>::infinity();
+		return (boost::format("reached=%1%") % num_reached).str();
+	}
+	else if (alg == "kcore") {
+		size_t k = atol(get_arg(args, 0, "2").c_str());
+		return (boost::format("max_core=%1%")
+				% compute_kcore(graph, k)->max()).str();
+	}
+	else if (alg == "triangle") {
+		FG_vector<size_t>::ptr triangles;
+		if (directed)
+			triangles = compute_directed_triangles_fast(graph,
+					directed_triangle_type::CYCLE);
+		else
+			triangles = compute_undirected_triangles(graph);
+		return (boost::format("triangles=%1%") % triangles->sum()).str();
+	}
+	else if (alg == "local_scan")
+		return (boost::format("max_scan=%1%")
+				% compute_local_scan(graph)->max()).str();
+	else if (alg == "diameter") {
+		int num_bfs = atoi(get_arg(args, 0, "1").c_str());
+		return (boost::format("diameter=%1%")
+				% estimate_diameter(graph, num_bfs, directed)).str();
+	}
+	else
+		throw invalid_arg_exception("unknown algorithm " + alg);
+}
+
+/*
+ * The peak resident memory of the process is reset before each run, so
+ * it's the peak memory of the run.
+ */
+static void reset_peak_mem()
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f == NULL)
+		return;
+	fprintf(f, "5");
+	fclose(f);
+}
+
+static size_t get_peak_mem()
+{
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f == NULL)
+		return 0;
+	char line[256];
+	size_t peak_kb = 0;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "VmHWM: %ld kB", &peak_kb) == 1)
+			break;
+	fclose(f);
+	return peak_kb * 1024;
+}
+
+/*
+ * Read the expected results. Each line has an algorithm with its
+ * arguments, a graph name and the summary of the result.
+ */
+static std::map<std::string, std::string> read_expected(const std::string &file)
+{
+	std::map<std::string, std::string> expected;
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		perror(("fopen " + file).c_str());
+		exit(-1);
+	}
+	char alg[256], graph[256], result[256];
+	while (fscanf(f, "%255s %255s %255s", alg, graph, result) == 3)
+		expected[std::string(alg) + " " + graph] = result;
+	fclose(f);
+	return expected;
+}
+
+static double get_hit_rate(const safs::io_stats &io)
+{
+	return io.num_pg_accesses > 0
+		? (double) io.num_cache_hits / io.num_pg_accesses : 0;
+}
+
+static double get_iops(const bench_run &run)
+{
+	return run.seconds > 0 ? run.stats.io.num_accesses / run.seconds : 0;
+}
+
+static void write_json(const std::vector<bench_run> &runs,
+		const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		perror(("fopen " + file).c_str());
+		return;
+	}
+	fprintf(f, "[\n");
+	for (size_t i = 0; i < runs.size(); i++) {
+		const bench_run &run = runs[i];
+		fprintf(f, "  {\"alg\": \"%s\", \"graph\": \"%s\", \"threads\": %d, ",
+				run.alg.c_str(), run.graph.c_str(), run.num_threads);
+		fprintf(f, "\"cache_size\": \"%s\", \"rep\": %d, \"seconds\": %f, ",
+				run.cache_size.c_str(), run.rep, run.seconds);
+		fprintf(f, "\"engine_runs\": %ld, \"level_seconds\": [",
+				run.stats.num_runs);
+		for (size_t j = 0; j < run.stats.level_seconds.size(); j++)
+			fprintf(f, "%s%f", j > 0 ? ", " : "", run.stats.level_seconds[j]);
+		fprintf(f, "], \"adj_reqs\": %ld, \"adj_bytes\": %ld, ",
+				run.stats.num_adj_reqs, run.stats.num_adj_bytes);
+		fprintf(f, "\"io_accesses\": %ld, \"io_bytes\": %ld, \"iops\": %f, ",
+				run.stats.io.num_accesses, run.stats.io.num_bytes, get_iops(run));
+		fprintf(f, "\"cache_hit_rate\": %f, \"peak_mem\": %ld, ",
+				get_hit_rate(run.stats.io), run.peak_mem);
+		fprintf(f, "\"result\": \"%s\", \"check\": \"%s\"}%s\n",
+				run.result.c_str(), run.check.c_str(),
+				i + 1 < runs.size() ? "," : "");
+	}
+	fprintf(f, "]\n");
+	fclose(f);
+}
+
+static void write_csv(const std::vector<bench_run> &runs,
+		const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		perror(("fopen " + file).c_str());
+		return;
+	}
+	fprintf(f, "alg,graph,threads,cache_size,rep,seconds,engine_runs,num_levels,"
+			"max_level_seconds,adj_reqs,adj_bytes,io_accesses,io_bytes,iops,"
+			"cache_hit_rate,peak_mem,result,check\n");
+	for (size_t i = 0; i < runs.size(); i++) {
+		const bench_run &run = runs[i];
+		double max_level = 0;
+		for (size_t j = 0; j < run.stats.level_seconds.size(); j++)
+			max_level = std::max(max_level, run.stats.level_seconds[j]);
+		fprintf(f, "%s,%s,%d,%s,%d,%f,%ld,%ld,%f,%ld,%ld,%ld,%ld,%f,%f,%ld,%s,%s\n",
+				run.alg.c_str(), run.graph.c_str(), run.num_threads,
+				run.cache_size.c_str(), run.rep, run.seconds, run.stats.num_runs,
+				run.stats.level_seconds.size(), max_level, run.stats.num_adj_reqs,
+				run.stats.num_adj_bytes, run.stats.io.num_accesses,
+				run.stats.io.num_bytes, get_iops(run), get_hit_rate(run.stats.io),
+				run.peak_mem, run.result.c_str(), run.check.c_str());
+	}
+	fclose(f);
+}
+
+void print_usage()
+{
+	fprintf(stderr,
+			"bench_algs [options] conf_file bench_file\n");
+	fprintf(stderr, "-j file: write the results in JSON\n");
+	fprintf(stderr, "-c file: write the results in CSV\n");
+	fprintf(stderr, "-e file: the expected results (alg graph result per line)\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "The bench_file has the following options:\n");
+	fprintf(stderr, "\talgs: the algorithms with arguments separated by ':'\n");
+	fprintf(stderr, "\tgraphs: name:graph_file:index_file of the graphs\n");
+	fprintf(stderr, "\tthreads: the numbers of threads\n");
+	fprintf(stderr, "\tcache_sizes: the sizes of the page cache\n");
+	fprintf(stderr, "\twarmup: the number of runs discarded before measurement\n");
+	fprintf(stderr, "\trepeats: the number of measured runs\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "supported graph algorithms:\n");
+	fprintf(stderr, "\tpagerank[:num_iters]\n");
+	fprintf(stderr, "\twcc\n");
+	fprintf(stderr, "\tscc\n");
+	fprintf(stderr, "\tbfs[:start_vertex]\n");
+	fprintf(stderr, "\tsssp[:source[:delta]]\n");
+	fprintf(stderr, "\tkcore[:k]\n");
+	fprintf(stderr, "\ttriangle\n");
+	fprintf(stderr, "\tlocal_scan\n");
+	fprintf(stderr, "\tdiameter[:num_bfs]\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string json_file;
+	std::string csv_file;
+	std::string expected_file;
+	while ((opt = getopt(argc, argv, "j:c:e:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'j':
+				json_file = optarg;
+				num_opts++;
+				break;
+			case 'c':
+				csv_file = optarg;
+				num_opts++;
+				break;
+			case 'e':
+				expected_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				exit(-1);
+		}
+	}
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+	if (argc < 2) {
+		print_usage();
+		exit(-1);
+	}
+
+	std::string conf_file = argv[0];
+	config_map::ptr bench = config_map::create(argv[1]);
+	if (bench == NULL) {
+		fprintf(stderr, "can't read the benchmark file %s\n", argv[1]);
+		exit(-1);
+	}
+	std::string algs_str, graphs_str;
+	std::string threads_str = "";
+	std::string cache_str = "";
+	int warmup = 1;
+	int repeats = 3;
+	bench->read_option("algs", algs_str);
+	bench->read_option("graphs", graphs_str);
+	bench->read_option("threads", threads_str);
+	bench->read_option("cache_sizes", cache_str);
+	bench->read_option_int("warmup", warmup);
+	bench->read_option_int("repeats", repeats);
+
+	std::vector<std::string> algs = split(algs_str, ',');
+	for (size_t i = 0; i < algs.size(); i++) {
+		std::vector<std::string> parts = split(algs[i], ':');
+		std::string name = parts.empty() ? "" : parts[0];
+		if (std::find(supported_algs, supported_algs + num_supported, name)
+				== supported_algs + num_supported) {
+			fprintf(stderr, "unknown algorithm %s\n", name.c_str());
+			exit(-1);
+		}
+	}
+	std::vector<bench_graph> graphs;
+	std::vector<std::string> graph_strs = split(graphs_str, ',');
+	for (size_t i = 0; i < graph_strs.size(); i++) {
+		std::vector<std::string> parts = split(graph_strs[i], ':');
+		if (parts.size() != 3) {
+			fprintf(stderr, "a graph should be name:graph_file:index_file\n");
+			exit(-1);
+		}
+		bench_graph graph;
+		graph.name = parts[0];
+		graph.graph_file = parts[1];
+		graph.index_file = parts[2];
+		graphs.push_back(graph);
+	}
+	if (algs.empty() || graphs.empty()) {
+		fprintf(stderr, "the benchmark needs algorithms and graphs\n");
+		exit(-1);
+	}
+	// An empty value uses the one in the configuration file.
+	std::vector<std::string> threads = split(threads_str, ',');
+	if (threads.empty())
+		threads.push_back("");
+	std::vector<std::string> cache_sizes = split(cache_str, ',');
+	if (cache_sizes.empty())
+		cache_sizes.push_back("");
+	std::map<std::string, std::string> expected;
+	if (!expected_file.empty())
+		expected = read_expected(expected_file);
+
+	std::vector<bench_run> runs;
+	for (size_t t = 0; t < threads.size(); t++) {
+		for (size_t c = 0; c < cache_sizes.size(); c++) {
+			config_map::ptr configs = config_map::create(conf_file);
+			if (configs == NULL)
+				configs = config_map::create();
+			if (!threads[t].empty())
+				configs->add_options("threads=" + threads[t]);
+			if (!cache_sizes[c].empty())
+				configs->add_options("cache_size=" + cache_sizes[c]);
+			try {
+				graph_engine::init_flash_graph(configs);
+			} catch (std::exception &e) {
+				fprintf(stderr, "%s\n", e.what());
+				exit(-1);
+			}
+
+			for (size_t g = 0; g < graphs.size(); g++) {
+				FG_graph::ptr graph;
+				try {
+					graph = FG_graph::create(graphs[g].graph_file,
+							graphs[g].index_file, configs);
+				} catch (std::exception &e) {
+					fprintf(stderr, "%s\n", e.what());
+					exit(-1);
+				}
+				for (size_t a = 0; a < algs.size(); a++) {
+					std::vector<std::string> args = split(algs[a], ':');
+					std::string name = args[0];
+					args.erase(args.begin());
+					for (int rep = -warmup; rep < repeats; rep++) {
+						graph_engine::reset_stats();
+						reset_peak_mem();
+						struct timeval start, end;
+						gettimeofday(&start, NULL);
+						std::string result = run_alg(graph, name, args);
+						gettimeofday(&end, NULL);
+						if (rep < 0)
+							continue;
+
+						bench_run run;
+						run.alg = algs[a];
+						run.graph = graphs[g].name;
+						run.num_threads = graph_conf.get_num_threads();
+						run.cache_size = cache_sizes[c];
+						run.rep = rep;
+						run.seconds = time_diff(start, end);
+						run.stats = graph_engine::get_stats();
+						run.peak_mem = get_peak_mem();
+						run.result = result;
+						std::map<std::string, std::string>::const_iterator it
+							= expected.find(algs[a] + " " + graphs[g].name);
+						if (it != expected.end())
+							run.check = it->second == result ? "pass" : "fail";
+						printf("%s on %s (%d threads, cache %s) rep %d: %.3f seconds, %s %s\n",
+								run.alg.c_str(), run.graph.c_str(), run.num_threads,
+								run.cache_size.c_str(), rep, run.seconds,
+								result.c_str(), run.check.c_str());
+						runs.push_back(run);
+					}
+				}
+			}
+			graph_engine::destroy_flash_graph();
+		}
+	}
+
+	if (!json_file.empty())
+		write_json(runs, json_file);
+	if (!csv_file.empty())
+		write_csv(runs, csv_file);
+	size_t num_failed = 0;
+	for (size_t i = 0; i < runs.size(); i++)
+		num_failed += runs[i].check == "fail";
+	if (num_failed > 0) {
+		fprintf(stderr, "%ld runs don't have the expected results\n", num_failed);
+		return 1;
+	}
+	return 0;
+}
@@ -77,6 +77,43 @@ void run_triangle(FG_graph::ptr graph, int argc, char *argv[])
 		printf("There are %ld triangles\n", triangles->sum());
 }
 
+void run_approx_triangle(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	double rate = 0.01;
+	double confidence = 0.95;
+	triangle_sampling_method method = triangle_sampling_method::WEDGE_SAMPLING;
+
+	while ((opt = getopt(argc, argv, "r:c:e")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'r':
+				rate = atof(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				confidence = atof(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				method = triangle_sampling_method::EDGE_SAMPLING;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	approx_triangle_count count = estimate_triangles(graph, rate, method,
+			confidence);
+	printf("There are about %.0f triangles, in [%.0f, %.0f] with %ld samples\n",
+			count.num_triangles, count.num_triangles_lower,
+			count.num_triangles_upper, count.num_samples);
+	printf("transitivity: %f, in [%f, %f]\n", count.transitivity,
+			count.transitivity_lower, count.transitivity_upper);
+}
+
 void run_local_scan(FG_graph::ptr graph, int argc, char *argv[])
 {
 	int opt;
@@ -135,7 +172,7 @@ void run_topK_scan(FG_graph::ptr graph, int argc, char *argv[])
 	if (scan) {
 		printf("The top %d scans:\n", topK);
 		for (int i = 0; i < topK; i++)
-			printf("%u\t%ld\n", scan->get(i).first, scan->get(i).second);
+			printf("%ld\t%ld\n", (size_t) scan->get(i).first, scan->get(i).second);
 	}
 }
 
@@ -165,13 +202,21 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 	int opt;
 	int num_opts = 0;
 	bool sync = false;
+	bool stream = false;
+	bool afforest = false;
 	std::string output_file;
-	while ((opt = getopt(argc, argv, "so:")) != -1) {
+	while ((opt = getopt(argc, argv, "seao:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 's':
 				sync = true;
 				break;
+			case 'e':
+				stream = true;
+				break;
+			case 'a':
+				afforest = true;
+				break;
 			case 'o':
 				output_file = optarg;
 				num_opts++;
@@ -182,7 +227,11 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 		}
 	}
 	FG_vector<vertex_id_t>::ptr comp_ids;
-	if (sync)
+	if (afforest)
+		comp_ids = compute_wcc_afforest(graph);
+	else if (stream)
+		comp_ids = compute_wcc_stream(graph);
+	else if (sync)
 		comp_ids = compute_sync_wcc(graph);
 	else
 		comp_ids = compute_wcc(graph);
@@ -196,7 +245,7 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 			return;
 		}
 		for (size_t i = 0; i < comp_ids->get_size(); i++)
-			fprintf(f, "%ld %d\n", i, comp_ids->get(i));
+			fprintf(f, "%ld %ld\n", i, (size_t) comp_ids->get(i));
 		fclose(f);
 	}
 	print_cc(comp_ids);
@@ -250,8 +299,9 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 
 	int num_iters = 30;
 	float damping_factor = 0.85;
+	float epsilon = 1.0E-3;
 
-	while ((opt = getopt(argc, argv, "i:D:")) != -1) {
+	while ((opt = getopt(argc, argv, "i:D:e:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'i':
@@ -262,6 +312,10 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 				damping_factor = atof(optarg);
 				num_opts++;
 				break;
+			case 'e':
+				epsilon = atof(optarg);
+				num_opts++;
+				break;
 			default:
 				print_usage();
 				abort();
@@ -276,6 +330,13 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 		case 2:
 			pr = compute_pagerank2(graph, num_iters, damping_factor);
 			break;
+		case 3:
+			pr = compute_pagerank_stream(graph, num_iters, damping_factor);
+			break;
+		case 4:
+			pr = compute_delta_pagerank(graph, num_iters, damping_factor,
+					epsilon);
+			break;
 		default:
 			abort();
 	}
@@ -531,13 +592,148 @@ int read_vertices(const std::string &file, std::vector<vertex_id_t> &vertices)
 		if (line[ret - 1] == '\n')
 			line[ret - 1] = 0;
 		vertex_id_t id = atol(line);
-		printf("%u\n", id);
+		printf("%ld\n", (size_t) id);
 		vertices.push_back(id);
 	}
 	fclose(f);
 	return vertices.size();
 }
 
+void run_closeness(FG_graph::ptr graph, int argc, char* argv[], bool khop)
+{
+	int opt;
+	int num_opts = 0;
+	std::string write_out = "";
+	std::string vertex_file = "";
+	int k = 2;
+	edge_type traverse_e = edge_type::OUT_EDGE;
+
+	while ((opt = getopt(argc, argv, "w:f:k:e:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'w':
+				write_out = optarg;
+				num_opts++;
+				break;
+			case 'f':
+				vertex_file = optarg;
+				num_opts++;
+				break;
+			case 'k':
+				k = atoi(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				if (std::string(optarg) == "IN")
+					traverse_e = edge_type::IN_EDGE;
+				else if (std::string(optarg) == "BOTH")
+					traverse_e = edge_type::BOTH_EDGES;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<vertex_id_t> ids;
+	if (vertex_file.empty()) {
+		for (vertex_id_t id = 0; id < graph->get_graph_header().get_num_vertices(); id++)
+			ids.push_back(id);
+	}
+	else
+		read_vertices(vertex_file, ids);
+
+	if (khop) {
+		FG_vector<size_t>::ptr reach_v = compute_khop_reach(graph, ids, k,
+				traverse_e);
+		if (!write_out.empty())
+			reach_v->to_file(write_out);
+	}
+	else {
+		FG_vector<float>::ptr closeness_v = compute_closeness(graph, ids,
+				traverse_e);
+		if (!write_out.empty())
+			closeness_v->to_file(write_out);
+	}
+}
+
+/*
+ * Each line of the file is a seed set with vertex IDs separated by spaces.
+ */
+int read_seed_sets(const std::string &file,
+		std::vector<std::vector<vertex_id_t> > &seed_sets)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	assert(f);
+	ssize_t ret;
+	char *line = NULL;
+	size_t line_size = 0;
+	while ((ret = getline(&line, &line_size, f)) > 0) {
+		std::vector<vertex_id_t> seeds;
+		char *saveptr = NULL;
+		for (char *tok = strtok_r(line, " \t\n", &saveptr); tok;
+				tok = strtok_r(NULL, " \t\n", &saveptr))
+			seeds.push_back(atol(tok));
+		if (!seeds.empty())
+			seed_sets.push_back(seeds);
+	}
+	free(line);
+	fclose(f);
+	return seed_sets.size();
+}
+
+void run_ppr(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string seed_file = "";
+	int num_iters = 30;
+	float damping_factor = 0.85;
+	float epsilon = 1.0E-6;
+
+	while ((opt = getopt(argc, argv, "f:i:D:e:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'f':
+				seed_file = optarg;
+				num_opts++;
+				break;
+			case 'i':
+				num_iters = atoi(optarg);
+				num_opts++;
+				break;
+			case 'D':
+				damping_factor = atof(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				epsilon = atof(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	if (seed_file.empty()) {
+		fprintf(stderr, "ppr needs a file with seed sets\n");
+		return;
+	}
+	std::vector<std::vector<vertex_id_t> > seed_sets;
+	read_seed_sets(seed_file, seed_sets);
+	std::vector<FG_vector<float>::ptr> prs = compute_personalized_pagerank(
+			graph, seed_sets, num_iters, damping_factor, epsilon);
+	for (size_t i = 0; i < prs.size(); i++) {
+		std::vector<std::pair<float, off_t> > val_locs;
+		prs[i]->max_val_locs(10, val_locs);
+		printf("seed set %ld: the sum of pagerank: %f\n", i, prs[i]->sum());
+		for (size_t j = 0; j < val_locs.size(); j++)
+			printf("v%ld: %f\n", val_locs[j].second, val_locs[j].first);
+	}
+}
+
 void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 {
 	std::string output_file;
@@ -586,14 +782,112 @@ void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 			for (size_t j = 0; j < num_vertices; j++) {
 				double overlap = overlaps[i][j];
 				if (overlap >= threshold)
-					fprintf(fout, "%u %u %f\n", overlap_vertices[i],
-							overlap_vertices[j], overlap);
+					fprintf(fout, "%ld %ld %f\n", (size_t) overlap_vertices[i],
+							(size_t) overlap_vertices[j], overlap);
 			}
 		}
 		fclose(fout);
 	}
 }
 
+void run_sssp(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	vertex_id_t source = 0;
+	double delta = 1;
+	std::string write_out = "";
+
+	while ((opt = getopt(argc, argv, "s:d:w:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 's':
+				source = atol(optarg);
+				num_opts++;
+				break;
+			case 'd':
+				delta = atof(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				write_out = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<double>::ptr dists = compute_sssp(graph, source, delta);
+	if (dists == NULL)
+		return;
+	size_t num_reached = 0;
+	double max_dist = 0;
+	for (size_t i = 0; i < dists->get_size(); i++) {
+		if (dists->get(i) != std::numeric_limits<double>::infinity()) {
+			num_reached++;
+			max_dist = std::max(max_dist, dists->get(i));
+		}
+	}
+	printf("SSSP from vertex %ld reaches %ld vertices and the max distance is %g\n",
+			(size_t) source, num_reached, max_dist);
+	if (!write_out.empty())
+		dists->to_file(write_out);
+}
+
+void run_random_walk(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_walks = 10;
+	int walk_length = 80;
+	walk_transition transition = UNIFORM_WALK;
+	double p = 1;
+	double q = 1;
+	std::string out_file = "walks.bin";
+
+	while ((opt = getopt(argc, argv, "n:l:t:p:q:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'n':
+				num_walks = atoi(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				walk_length = atoi(optarg);
+				num_opts++;
+				break;
+			case 't':
+				if (std::string(optarg) == "weighted")
+					transition = WEIGHTED_WALK;
+				else if (std::string(optarg) == "node2vec")
+					transition = NODE2VEC_WALK;
+				num_opts++;
+				break;
+			case 'p':
+				p = atof(optarg);
+				num_opts++;
+				break;
+			case 'q':
+				q = atof(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				out_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	size_t num_steps = generate_random_walks(graph, out_file, num_walks,
+			walk_length, transition, p, q);
+	printf("%ld steps are written to %s\n", num_steps, out_file.c_str());
+}
+
 void run_bfs(FG_graph::ptr graph, int argc, char* argv[])
 {
 	int opt;
@@ -633,8 +927,8 @@ void run_bfs(FG_graph::ptr graph, int argc, char* argv[])
 
 	size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type);
 	size_t num_vertices = bfs(graph, start_vertex, edge);
-	printf("BFS from v%u traverses %ld vertices on edge type %d\n",
-			start_vertex, num_vertices, edge);
+	printf("BFS from v%ld traverses %ld vertices on edge type %d\n",
+			(size_t) start_vertex, num_vertices, edge);
 }
 
 void run_spmv(FG_graph::ptr graph, int argc, char* argv[])
@@ -666,21 +960,31 @@ void run_louvain(FG_graph::ptr graph, int argc, char* argv[])
 {
 	int opt;
 	int num_opts = 0;
-	uint32_t levels = 1;
+	uint32_t levels = 0;
+	std::string write_out = "";
 
-	while ((opt = getopt(argc, argv, "l:")) != -1) {
+	while ((opt = getopt(argc, argv, "l:w:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'l':
 				levels = atoi(optarg);
 				break;
+			case 'w':
+				write_out = optarg;
+				break;
 			default:
 				print_usage();
 				assert(0);
 		}
 	}
 
-	compute_louvain(graph, levels);
+	std::vector<double> modularity;
+	FG_vector<vertex_id_t>::ptr clusters = compute_louvain(graph, levels,
+			modularity);
+	for (size_t i = 0; i < modularity.size(); i++)
+		printf("level %ld: modularity %f\n", i, modularity[i]);
+	if (!write_out.empty())
+		clusters->to_file(write_out);
 }
 
 void run_sem_kmeans(FG_graph::ptr graph, int argc, char *argv[])
@@ -718,9 +1022,76 @@ void run_sem_kmeans(FG_graph::ptr graph, int argc, char *argv[])
     compute_sem_kmeans(graph, k, init, max_iters, tolerance);
 }
 
+/*
+ * Compare the vertex-centric and the edge-centric streaming implementations
+ * of PageRank and WCC on the same graph.
+ */
+void run_stream_bench(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_iters = 30;
+
+	while ((opt = getopt(argc, argv, "i:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'i':
+				num_iters = atoi(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	if (!graph->get_graph_header().is_directed_graph()) {
+		fprintf(stderr, "stream_bench works on a directed graph\n");
+		return;
+	}
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	FG_vector<float>::ptr pr = compute_pagerank(graph, num_iters, 0.85);
+	gettimeofday(&end, NULL);
+	float vertex_pr_time = time_diff(start, end);
+
+	gettimeofday(&start, NULL);
+	FG_vector<float>::ptr stream_pr = compute_pagerank_stream(graph,
+			num_iters, 0.85);
+	gettimeofday(&end, NULL);
+	float stream_pr_time = time_diff(start, end);
+
+	float max_diff = 0;
+	for (size_t i = 0; i < pr->get_size(); i++)
+		max_diff = std::max(max_diff, std::fabs(pr->get(i) - stream_pr->get(i)));
+
+	gettimeofday(&start, NULL);
+	FG_vector<vertex_id_t>::ptr comp_ids = compute_wcc(graph);
+	gettimeofday(&end, NULL);
+	float vertex_wcc_time = time_diff(start, end);
+
+	gettimeofday(&start, NULL);
+	FG_vector<vertex_id_t>::ptr stream_comp_ids = compute_wcc_stream(graph);
+	gettimeofday(&end, NULL);
+	float stream_wcc_time = time_diff(start, end);
+
+	count_map<vertex_id_t> map;
+	comp_ids->count_unique(map);
+	count_map<vertex_id_t> stream_map;
+	stream_comp_ids->count_unique(stream_map);
+
+	printf("pagerank: vertex-centric %.3fs, streaming %.3fs, max diff: %f\n",
+			vertex_pr_time, stream_pr_time, max_diff);
+	printf("wcc: vertex-centric %.3fs (%ld comps), streaming %.3fs (%ld comps)\n",
+			vertex_wcc_time, map.get_size(), stream_wcc_time,
+			stream_map.get_size());
+}
+
 std::string supported_algs[] = {
 	"cycle_triangle",
 	"triangle",
+	"approx_triangle",
 	"local_scan",
 	"topK_scan",
 	"wcc",
@@ -728,15 +1099,23 @@ std::string supported_algs[] = {
 	"diameter",
 	"pagerank",
 	"pagerank2",
+	"pagerank_stream",
+	"pagerank_delta",
+	"ppr",
 	"sstsg",
 	"ts_wcc",
 	"kcore",
 	"betweenness",
+	"closeness",
+	"khop",
 	"overlap",
 	"bfs",
+	"sssp",
+	"random_walk",
 	"spmv",
 	"louvain",
-    "sem_kmeans"
+    "sem_kmeans",
+	"stream_bench"
 };
 int num_supported = sizeof(supported_algs) / sizeof(supported_algs[0]);
 
@@ -758,6 +1137,13 @@ void print_usage()
 	fprintf(stderr, "pagerank\n");
 	fprintf(stderr, "-i num: the maximum number of iterations\n");
 	fprintf(stderr, "-D v: damping factor\n");
+	fprintf(stderr, "-e eps: the residual threshold in pagerank_delta\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "ppr\n");
+	fprintf(stderr, "-f file: the file with a seed set on each line\n");
+	fprintf(stderr, "-i num: the maximum number of iterations\n");
+	fprintf(stderr, "-D v: damping factor\n");
+	fprintf(stderr, "-e eps: the residual threshold\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "sstsg\n");
 	fprintf(stderr, "-n num: the number of time intervals\n");
@@ -780,11 +1166,24 @@ void print_usage()
 	fprintf(stderr, "-w output: the file name for a vector written to file\n");
 	fprintf(stderr, "-s vertex id: the vertex where BC starts. (Default runs all)\n");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "closeness, khop\n");
+	fprintf(stderr, "-w output: the file name for a vector written to file\n");
+	fprintf(stderr, "-f file: the file with the vertices to compute (Default runs all)\n");
+	fprintf(stderr, "-k hops: the number of hops in khop\n");
+	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
+	fprintf(stderr, "\n");
 	fprintf(stderr, "cycle_triangle\n");
 	fprintf(stderr, "-f: run the fast implementation\n");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "approx_triangle\n");
+	fprintf(stderr, "-r rate: the sample rate of wedges or edges\n");
+	fprintf(stderr, "-c confidence: the confidence level of the intervals\n");
+	fprintf(stderr, "-e: sample edges instead of wedges\n");
+	fprintf(stderr, "\n");
 	fprintf(stderr, "wcc\n");
 	fprintf(stderr, "-s: run wcc synchronously\n");
+	fprintf(stderr, "-e: run wcc in the edge-centric streaming mode\n");
+	fprintf(stderr, "-a: run wcc with Afforest neighbor sampling\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "overlap vertex_file\n");
 	fprintf(stderr, "-o output: the output file\n");
@@ -794,11 +1193,25 @@ void print_usage()
 	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
 	fprintf(stderr, "-s vertex id: the vertex where the BFS starts\n");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "sssp\n");
+	fprintf(stderr, "-s vertex id: the vertex where the paths start\n");
+	fprintf(stderr, "-d delta: the width of the distance buckets\n");
+	fprintf(stderr, "-w output: the file name for a vector written to file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "random_walk\n");
+	fprintf(stderr, "-n num: the number of walks from each vertex\n");
+	fprintf(stderr, "-l length: the number of steps in a walk\n");
+	fprintf(stderr, "-t type: the transition (uniform, weighted, node2vec)\n");
+	fprintf(stderr, "-p p: the return parameter of node2vec\n");
+	fprintf(stderr, "-q q: the in-out parameter of node2vec\n");
+	fprintf(stderr, "-o output: the file where the walks are written\n");
+	fprintf(stderr, "\n");
 	fprintf(stderr, "spmv\n");
 	fprintf(stderr, "-t: transpose the sparse matrix.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "louvain\n");
-	fprintf(stderr, "-l: how many levels in the hierarchy to compute\n");
+	fprintf(stderr, "-l: how many levels in the hierarchy to compute (Default runs until convergence)\n");
+	fprintf(stderr, "-w output: the file name for a vector written to file\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "sem_kmeans\n");
 	fprintf(stderr, "-k: the number of clusters to use\n");
@@ -806,6 +1219,9 @@ void print_usage()
 	fprintf(stderr, "-t: init type [random, forgy, kmeanspp]. Default: kmeanspp\n");
 	fprintf(stderr, "-l: convergence tolerance (defualt: -1 = no changes)\n");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "stream_bench\n");
+	fprintf(stderr, "-i num: the maximum number of pagerank iterations\n");
+	fprintf(stderr, "\n");
 
 	fprintf(stderr, "supported graph algorithms:\n");
 	for (int i = 0; i < num_supported; i++)
@@ -852,6 +1268,9 @@ int main(int argc, char *argv[])
 	else if (alg == "triangle") {
 		run_triangle(graph, argc, argv);
 	}
+	else if (alg == "approx_triangle") {
+		run_approx_triangle(graph, argc, argv);
+	}
 	else if (alg == "local_scan") {
 		run_local_scan(graph, argc, argv);
 	}
@@ -867,6 +1286,15 @@ int main(int argc, char *argv[])
 	else if (alg == "pagerank2") {
 		run_pagerank(graph, argc, argv, 2);
 	}
+	else if (alg == "pagerank_stream") {
+		run_pagerank(graph, argc, argv, 3);
+	}
+	else if (alg == "pagerank_delta") {
+		run_pagerank(graph, argc, argv, 4);
+	}
+	else if (alg == "ppr") {
+		run_ppr(graph, argc, argv);
+	}
 	else if (alg == "wcc") {
 		run_wcc(graph, argc, argv);
 	}
@@ -888,12 +1316,24 @@ int main(int argc, char *argv[])
 	else if (alg == "betweenness") {
 		run_betweenness_centrality(graph, argc, argv);
 	}
+	else if (alg == "closeness") {
+		run_closeness(graph, argc, argv, false);
+	}
+	else if (alg == "khop") {
+		run_closeness(graph, argc, argv, true);
+	}
 	else if (alg == "overlap") {
 		run_overlap(graph, argc, argv);
 	}
 	else if (alg == "bfs") {
 		run_bfs(graph, argc, argv);
 	}
+	else if (alg == "sssp") {
+		run_sssp(graph, argc, argv);
+	}
+	else if (alg == "random_walk") {
+		run_random_walk(graph, argc, argv);
+	}
 	else if (alg == "spmv") {
 		run_spmv(graph, argc, argv);
 	}
@@ -902,6 +1342,9 @@ int main(int argc, char *argv[])
 	} else if (alg == "sem_kmeans") {
 		run_sem_kmeans(graph, argc, argv);
 	}
+	else if (alg == "stream_bench") {
+		run_stream_bench(graph, argc, argv);
+	}
 	else {
 		fprintf(stderr, "\n[ERROR]: Unknown algorithm '%s'!\n", alg.c_str());
 	}
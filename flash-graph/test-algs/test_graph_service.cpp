@@ -0,0 +1,219 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This drives a graph service with concurrent clients. Each client submits
+ * k-hop queries from random vertices and waits for their results. Some of
+ * the answers are checked against k-hop BFS that runs without the service.
+ * It also checks that personalized PageRank fails on an undirected graph
+ * instead of returning results and that the queries submitted after
+ * the service stops fail.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "thread.h"
+
+#include "FGlib.h"
+#include "libgraph-algs/graph_service.h"
+
+using namespace fg;
+
+class client_thread: public thread
+{
+	graph_service &service;
+	int num_queries;
+	int k;
+	unsigned int seed;
+	std::vector<std::shared_ptr<khop_query> > queries;
+public:
+	client_thread(graph_service &_service, int id, int num_queries,
+			int k): thread("client", -1), service(_service) {
+		this->num_queries = num_queries;
+		this->k = k;
+		this->seed = id;
+	}
+
+	void run() {
+		size_t num_vertices
+			= service.get_graph()->get_graph_header().get_num_vertices();
+		// We submit all queries before waiting, so the service can batch
+		// the queries of all clients.
+		for (int i = 0; i < num_queries; i++) {
+			vertex_id_t vid = rand_r(&seed) % num_vertices;
+			queries.emplace_back(new khop_query(vid, k, edge_type::OUT_EDGE));
+			service.submit(queries.back());
+		}
+		for (size_t i = 0; i < queries.size(); i++)
+			queries[i]->wait4complete();
+		stop();
+	}
+
+	const std::vector<std::shared_ptr<khop_query> > &get_queries() const {
+		return queries;
+	}
+};
+
+void print_usage()
+{
+	fprintf(stderr,
+			"test_graph_service [options] conf_file graph_file index_file\n");
+	fprintf(stderr, "-c num: the number of clients (16)\n");
+	fprintf(stderr, "-q num: the number of queries of a client (64)\n");
+	fprintf(stderr, "-k k: the number of hops of a query (2)\n");
+	fprintf(stderr, "-b size: the maximal number of queries in a batch (256)\n");
+	fprintf(stderr, "-v num: the number of answers checked without the service (16)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_clients = 16;
+	int num_queries = 64;
+	int k = 2;
+	size_t max_batch_size = 256;
+	size_t num_verify = 16;
+	while ((opt = getopt(argc, argv, "c:q:k:b:v:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'c':
+				num_clients = atoi(optarg);
+				num_opts++;
+				break;
+			case 'q':
+				num_queries = atoi(optarg);
+				num_opts++;
+				break;
+			case 'k':
+				k = atoi(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				max_batch_size = atol(optarg);
+				num_opts++;
+				break;
+			case 'v':
+				num_verify = atol(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				exit(-1);
+		}
+	}
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+	if (argc < 3) {
+		print_usage();
+		exit(-1);
+	}
+
+	config_map::ptr configs = config_map::create(argv[0]);
+	if (configs == NULL)
+		configs = config_map::create();
+	FG_graph::ptr fg;
+	try {
+		graph_engine::init_flash_graph(configs);
+		fg = FG_graph::create(argv[1], argv[2], configs);
+	} catch (std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		exit(-1);
+	}
+
+	size_t num_errors = 0;
+	graph_service::ptr service = graph_service::create(fg, max_batch_size);
+	std::vector<client_thread *> clients(num_clients);
+	for (int i = 0; i < num_clients; i++) {
+		clients[i] = new client_thread(*service, i, num_queries, k);
+		clients[i]->start();
+	}
+	std::vector<std::shared_ptr<khop_query> > queries;
+	for (int i = 0; i < num_clients; i++) {
+		clients[i]->join();
+		queries.insert(queries.end(), clients[i]->get_queries().begin(),
+				clients[i]->get_queries().end());
+		delete clients[i];
+	}
+
+	std::vector<double> latencies;
+	for (size_t i = 0; i < queries.size(); i++) {
+		if (queries[i]->has_failed()) {
+			fprintf(stderr, "k-hop query from v%ld fails: %s\n",
+					(size_t) queries[i]->get_vertex(),
+					queries[i]->get_error().c_str());
+			num_errors++;
+		}
+		latencies.push_back(queries[i]->get_latency());
+	}
+
+	// Personalized PageRank only runs on directed graphs, and the query
+	// should fail on an undirected graph.
+	std::vector<vertex_id_t> seeds(1, 0);
+	std::shared_ptr<ppr_query> ppr(new ppr_query(seeds, 10, 0.85, 0.0001));
+	service->run(ppr);
+	if (fg->get_graph_header().is_directed_graph()
+			&& (ppr->has_failed() || ppr->get_ranks() == NULL)) {
+		fprintf(stderr, "personalized PageRank fails on a directed graph\n");
+		num_errors++;
+	}
+	else if (!fg->get_graph_header().is_directed_graph()
+			&& !ppr->has_failed()) {
+		fprintf(stderr, "personalized PageRank runs on an undirected graph\n");
+		num_errors++;
+	}
+
+	service->stop();
+	service_query::ptr late(new khop_query(0, k, edge_type::OUT_EDGE));
+	service->submit(late);
+	if (!late->is_completed() || !late->has_failed()) {
+		fprintf(stderr, "a query submitted after the service stops doesn't fail\n");
+		num_errors++;
+	}
+
+	// Check some answers with k-hop BFS that runs without the service.
+	for (size_t i = 0; i < std::min(num_verify, queries.size()); i++) {
+		std::vector<vertex_id_t> vids(1, queries[i]->get_vertex());
+		size_t expected = compute_khop_reach(fg, vids, k)->get(0);
+		if (expected != queries[i]->get_num_reached()) {
+			fprintf(stderr, "v%ld reaches %ld vertices in %d hops, but the service returns %ld\n",
+					(size_t) vids[0], expected, k, queries[i]->get_num_reached());
+			num_errors++;
+		}
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	if (!latencies.empty())
+		printf("%ld queries: median latency %.3f seconds, max latency %.3f seconds\n",
+				latencies.size(), latencies[latencies.size() / 2],
+				latencies.back());
+	service.reset();
+	fg.reset();
+	graph_engine::destroy_flash_graph();
+	if (num_errors > 0) {
+		fprintf(stderr, "%ld errors\n", num_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+
+#include "common.h"
+#include "native_file.h"
+
+#include "edge_list_constructor.h"
+
+using namespace safs;
+using namespace fg;
+
+void print_usage()
+{
+	fprintf(stderr,
+			"construct-graph [options] adj_file index_file edge_file|edge_dir ...\n");
+	fprintf(stderr, "-u: the graph is undirected\n");
+	fprintf(stderr, "-U: remove duplicated edges\n");
+	fprintf(stderr, "-S: remove self-loops\n");
+	fprintf(stderr, "-s size: the sort buffer size of a thread\n");
+	fprintf(stderr, "-m size: the total size of the merge buffers\n");
+	fprintf(stderr, "-t num: the number of threads\n");
+	fprintf(stderr, "-w dir: the directory for the temporary files\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+
+	bool directed = true;
+	bool dedup = false;
+	bool remove_self_loops = false;
+	size_t sort_buf_size = 0;
+	size_t merge_buf_size = 0;
+	int num_threads = 0;
+	std::string work_dir = ".";
+	while ((opt = getopt(argc, argv, "uUSs:m:t:w:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'u':
+				directed = false;
+				break;
+			case 'U':
+				dedup = true;
+				break;
+			case 'S':
+				remove_self_loops = true;
+				break;
+			case 's':
+				sort_buf_size = str2size(optarg);
+				num_opts++;
+				break;
+			case 'm':
+				merge_buf_size = str2size(optarg);
+				num_opts++;
+				break;
+			case 't':
+				num_threads = atoi(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				work_dir = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				exit(-1);
+		}
+	}
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+
+	if (argc < 3) {
+		print_usage();
+		exit(-1);
+	}
+
+	std::string adj_file = argv[0];
+	std::string index_file = argv[1];
+	std::vector<std::string> edge_files;
+	for (int i = 2; i < argc; i++) {
+		native_dir dir(argv[i]);
+		if (dir.is_dir()) {
+			std::vector<std::string> files;
+			dir.read_all_files(files);
+			for (size_t j = 0; j < files.size(); j++)
+				edge_files.push_back(dir.get_name() + "/" + files[j]);
+		}
+		else
+			edge_files.push_back(argv[i]);
+	}
+
+	edge_list_constructor::ptr constructor = edge_list_constructor::create(
+			directed, work_dir);
+	constructor->set_dedup(dedup);
+	constructor->set_remove_self_loops(remove_self_loops);
+	if (sort_buf_size > 0)
+		constructor->set_sort_buf_size(sort_buf_size);
+	if (merge_buf_size > 0)
+		constructor->set_merge_buf_size(merge_buf_size);
+	if (num_threads > 0)
+		constructor->set_num_threads(num_threads);
+	constructor->construct(edge_files, adj_file, index_file);
+
+	const std::vector<construct_stage_stat> &stats = constructor->get_stats();
+	for (size_t i = 0; i < stats.size(); i++)
+		printf("%s: %ld edges, %.3f seconds, %.0f edges/s\n",
+				stats[i].name.c_str(), stats[i].num_edges, stats[i].seconds,
+				stats[i].get_edges_per_sec());
+}
@@ -1,75 +1,362 @@
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/rmat_graph_generator.hpp>
-#include <boost/random/linear_congruential.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <iostream>
-#include <ctime>
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
 #include <stdio.h>
+#include <sys/time.h>
+#include <omp.h>
+
+#include <vector>
+#include <string>
+
+#include <boost/assert.hpp>
+
+#include "common.h"
+
+#include "edge_list_constructor.h"
+
+using namespace fg;
+
+/*
+ * The number of edges generated in a block. A block is the unit of
+ * parallelization, and the edges in a block only depend on the seed and
+ * the block ID, so the generated graph doesn't depend on the number of
+ * threads.
+ */
+static const size_t EDGES_PER_BLOCK = 1024 * 1024;
+
+/*
+ * This is splitmix64 keyed by the seed and the edge ID. The initial state
+ * is hashed from the edge ID, so the streams of adjacent edges don't
+ * overlap.
+ */
+class edge_rng
+{
+	uint64_t state;
+
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+		return z ^ (z >> 31);
+	}
+public:
+	edge_rng(uint64_t seed, uint64_t edge_id) {
+		state = mix(seed ^ mix(edge_id + 0x9E3779B97F4A7C15UL));
+	}
+
+	uint64_t next() {
+		return mix(state += 0x9E3779B97F4A7C15UL);
+	}
+
+	/*
+	 * Get a random number in [0, 1).
+	 */
+	double next_double() {
+		return (next() >> 11) * (1.0 / (1UL << 53));
+	}
+};
 
-using namespace boost;
-typedef adjacency_list<> Graph;
-// The length of cycle of rand48 is 2^48-1, which is much longer than
-// minstd_rand.
-// http://www.boost.org/doc/libs/1_55_0/doc/html/boost_random/reference.html
-typedef rand48 rand_gen_t;
-typedef rmat_iterator<rand_gen_t, Graph> RMATGen;
-typedef graph_traits<Graph>::vertex_iterator vertex_iter;
-typedef property_map<Graph, vertex_index_t>::type IndexMap;
-
-int main(int argc, char* argv[])
+/*
+ * This generates an R-MAT graph. Each edge is placed by recursively
+ * choosing one of the four quadrants of the adjacency matrix with
+ * the probabilities a, b, c and d = 1 - a - b - c. The default
+ * probabilities are the ones of the Graph500 Kronecker generator.
+ *
+ * With noise, the probabilities of each level of the recursion are
+ * perturbed by a random number in [-noise, noise] as in the noisy
+ * stochastic Kronecker graph model, which smooths the oscillation in
+ * the degree distribution. The vertex IDs are scrambled with a bijective
+ * hash as in Graph500, so the high-degree vertices aren't clustered in
+ * the ID space.
+ */
+class rmat_generator: public edge_generator
 {
-	if (argc < 3) {
-		fprintf(stderr, "usage: make_graph #vertices, #numedges [output]\n");
-		return EXIT_FAILURE;
-	}
-	typedef boost::graph_traits<Graph>::vertices_size_type vertices_size_type;
-	typedef boost::graph_traits<Graph>::edges_size_type edges_size_type;
-	vertices_size_type n = atol(argv[1]);
-	edges_size_type m = atol(argv[2]);
-
-	FILE *f = stdout;
-	std::string out_file;
-	if (argc >= 4) {
-		out_file = argv[3];
-		f = fopen(argv[3], "w");
-		assert(f);
-	}
-
-	fprintf(stderr, "Vertices = %ld\n", n);
-	fprintf(stderr, "Edges = %ld\n", m);
-
-	std::clock_t start;
-	start = std::clock();
-	rand_gen_t gen(time(NULL));
-	RMATGen gen_it(gen, n, m, 0.57, 0.19, 0.19, 0.05, true);
-	RMATGen gen_end;
-	for (; gen_it != gen_end; ++gen_it) {
-		fprintf(f, "%ld %ld\n", gen_it->first, gen_it->second);
-	}
-#if 0
-	// Create graph with 100 nodes and 400 edges
-	Graph g(RMATGen(gen, n, m, 0.57, 0.19, 0.19, 0.05, true), RMATGen(), n);
-
-	IndexMap index = get(vertex_index, g);
-
-	// Get vertex set
-#if 0
-	std::pair<vertex_iter, vertex_iter> vp;
-	for (vp = vertices(g); vp.first != vp.second; ++vp.first)
-		std::cout << index[*vp.first] <<  " ";
-	std::cout << std::endl;
-#endif
-
-	// Get edge set
-	graph_traits<Graph>::edge_iterator ei, ei_end;
-	for (tie(ei, ei_end) = edges(g); ei != ei_end; ++ei)
-		std::cout << index[source(*ei, g)]<< " " << index[target(*ei, g)] << "\n";
-#endif
-	if (f != stdout) {
-		printf("close %s\n", out_file.c_str());
-		fclose(f);
-	}
-
-	std::cerr << "The time to build the graph = " << (std::clock()-start)/(double)CLOCKS_PER_SEC << std::endl;
-	return 0;
+	int scale;
+	size_t num_edges;
+	uint64_t seed;
+	bool permute;
+	// The cumulative probabilities of the quadrants in each level.
+	std::vector<double> ab;
+	std::vector<double> a;
+	std::vector<double> abc;
+	uint64_t perm_mul[2];
+	uint64_t perm_add[2];
+
+	vertex_id_t permute_id(uint64_t id) const {
+		uint64_t mask = get_num_vertices() - 1;
+		for (int i = 0; i < 2; i++) {
+			id = (id * perm_mul[i] + perm_add[i]) & mask;
+			id ^= id >> (scale / 2 + 1);
+		}
+		return id;
+	}
+public:
+	rmat_generator(int scale, size_t edge_factor, double a, double b,
+			double c, double noise, uint64_t seed, bool permute) {
+		this->scale = scale;
+		this->num_edges = edge_factor << scale;
+		this->seed = seed;
+		this->permute = permute;
+
+		// The noise and the hash keys are drawn from the stream of
+		// a non-existing edge.
+		edge_rng rng(seed, UINT64_MAX);
+		double d = 1 - a - b - c;
+		for (int i = 0; i < scale; i++) {
+			double mu = noise * (2 * rng.next_double() - 1);
+			double a1 = a - 2 * mu * a / (a + d);
+			double b1 = b + mu;
+			double c1 = c + mu;
+			this->a.push_back(a1);
+			this->ab.push_back(a1 + b1);
+			this->abc.push_back(a1 + b1 + c1);
+		}
+		for (int i = 0; i < 2; i++) {
+			perm_mul[i] = rng.next() | 1;
+			perm_add[i] = rng.next();
+		}
+	}
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+
+	virtual size_t get_num_vertices() const {
+		return 1UL << scale;
+	}
+
+	virtual size_t get_num_blocks() const {
+		return (num_edges + EDGES_PER_BLOCK - 1) / EDGES_PER_BLOCK;
+	}
+
+	virtual void gen_block(size_t block_id, std::vector<edge_t> &edges) const {
+		size_t start = block_id * EDGES_PER_BLOCK;
+		size_t end = std::min(start + EDGES_PER_BLOCK, num_edges);
+		for (size_t i = start; i < end; i++) {
+			edge_rng rng(seed, i);
+			uint64_t from = 0;
+			uint64_t to = 0;
+			for (int level = 0; level < scale; level++) {
+				double r = rng.next_double();
+				from <<= 1;
+				to <<= 1;
+				if (r < a[level])
+					continue;
+				else if (r < ab[level])
+					to |= 1;
+				else if (r < abc[level])
+					from |= 1;
+				else {
+					from |= 1;
+					to |= 1;
+				}
+			}
+			if (permute)
+				edges.push_back(edge_t(permute_id(from), permute_id(to)));
+			else
+				edges.push_back(edge_t(from, to));
+		}
+	}
+};
+
+/*
+ * Write the edges to a text edge list. The blocks are generated in parallel
+ * and written in the order of the block IDs.
+ */
+static void write_edge_list(const rmat_generator &gen,
+		const std::string &out_file, int num_threads)
+{
+	FILE *f = fopen(out_file.c_str(), "w");
+	if (f == NULL) {
+		perror(("fopen " + out_file).c_str());
+		exit(-1);
+	}
+#pragma omp parallel for num_threads(num_threads) ordered schedule(dynamic)
+	for (size_t i = 0; i < gen.get_num_blocks(); i++) {
+		std::vector<edge_generator::edge_t> edges;
+		gen.gen_block(i, edges);
+		std::string buf;
+		char line[64];
+		for (size_t j = 0; j < edges.size(); j++) {
+			int len = snprintf(line, sizeof(line), "%ld %ld\n",
+					(size_t) edges[j].first, (size_t) edges[j].second);
+			buf.append(line, len);
+		}
+#pragma omp ordered
+		BOOST_VERIFY(fwrite(buf.data(), buf.size(), 1, f) == 1);
+	}
+	fclose(f);
+}
+
+void print_usage()
+{
+	fprintf(stderr,
+			"rmat-gen [options] scale edge_factor adj_file index_file\n");
+	fprintf(stderr,
+			"rmat-gen -T [options] scale edge_factor edge_file\n");
+	fprintf(stderr, "The graph has 2^scale vertices and edge_factor * 2^scale edges\n");
+	fprintf(stderr, "-a a: the probability of the top-left quadrant (0.57)\n");
+	fprintf(stderr, "-b b: the probability of the top-right quadrant (0.19)\n");
+	fprintf(stderr, "-c c: the probability of the bottom-left quadrant (0.19)\n");
+	fprintf(stderr, "-n noise: perturb the probabilities of each level\n");
+	fprintf(stderr, "-r seed: the random seed\n");
+	fprintf(stderr, "-P: don't permute vertex IDs\n");
+	fprintf(stderr, "-T: write a text edge list\n");
+	fprintf(stderr, "-u: the graph is undirected\n");
+	fprintf(stderr, "-U: remove duplicated edges\n");
+	fprintf(stderr, "-S: remove self-loops\n");
+	fprintf(stderr, "-s size: the sort buffer size of a thread\n");
+	fprintf(stderr, "-t num: the number of threads\n");
+	fprintf(stderr, "-w dir: the directory for the temporary files\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+
+	double a = 0.57;
+	double b = 0.19;
+	double c = 0.19;
+	double noise = 0;
+	uint64_t seed = 0;
+	bool permute = true;
+	bool text = false;
+	bool directed = true;
+	bool dedup = false;
+	bool remove_self_loops = false;
+	size_t sort_buf_size = 0;
+	int num_threads = omp_get_max_threads();
+	std::string work_dir = ".";
+	while ((opt = getopt(argc, argv, "a:b:c:n:r:PTuUSs:t:w:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'a':
+				a = atof(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				b = atof(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				c = atof(optarg);
+				num_opts++;
+				break;
+			case 'n':
+				noise = atof(optarg);
+				num_opts++;
+				break;
+			case 'r':
+				seed = strtoull(optarg, NULL, 10);
+				num_opts++;
+				break;
+			case 'P':
+				permute = false;
+				break;
+			case 'T':
+				text = true;
+				break;
+			case 'u':
+				directed = false;
+				break;
+			case 'U':
+				dedup = true;
+				break;
+			case 'S':
+				remove_self_loops = true;
+				break;
+			case 's':
+				sort_buf_size = str2size(optarg);
+				num_opts++;
+				break;
+			case 't':
+				num_threads = atoi(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				work_dir = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				exit(-1);
+		}
+	}
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+
+	if (argc < (text ? 3 : 4)) {
+		print_usage();
+		exit(-1);
+	}
+
+	int scale = atoi(argv[0]);
+	size_t edge_factor = atol(argv[1]);
+	double d = 1 - a - b - c;
+	// The largest vertex ID has to be smaller than INVALID_VERTEX_ID.
+	int max_scale = 8 * sizeof(vertex_id_t) - 1;
+	if (scale <= 0 || scale > max_scale || edge_factor == 0) {
+		fprintf(stderr, "scale must be in [1, %d] and edge_factor must be positive\n",
+				max_scale);
+		exit(-1);
+	}
+	if (edge_factor > (SIZE_MAX >> scale)) {
+		fprintf(stderr, "edge_factor * 2^scale overflows\n");
+		exit(-1);
+	}
+	if (a <= 0 || b <= 0 || c <= 0 || d <= 0) {
+		fprintf(stderr, "the probabilities of the quadrants must be positive\n");
+		exit(-1);
+	}
+	// The perturbed probabilities have to stay positive.
+	if (noise < 0 || noise >= std::min((a + d) / 2, std::min(b, c))) {
+		fprintf(stderr, "noise must be in [0, %g)\n",
+				std::min((a + d) / 2, std::min(b, c)));
+		exit(-1);
+	}
+
+	rmat_generator gen(scale, edge_factor, a, b, c, noise, seed, permute);
+	printf("generate %ld vertices and %ld edges with seed %ld\n",
+			gen.get_num_vertices(), gen.get_num_edges(), seed);
+	if (text) {
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		write_edge_list(gen, argv[2], num_threads);
+		gettimeofday(&end, NULL);
+		printf("write %ld edges in %.3f seconds\n", gen.get_num_edges(),
+				time_diff(start, end));
+		return 0;
+	}
+
+	edge_list_constructor::ptr constructor = edge_list_constructor::create(
+			directed, work_dir);
+	constructor->set_dedup(dedup);
+	constructor->set_remove_self_loops(remove_self_loops);
+	if (sort_buf_size > 0)
+		constructor->set_sort_buf_size(sort_buf_size);
+	constructor->set_num_threads(num_threads);
+	constructor->construct(gen, argv[2], argv[3]);
+
+	const std::vector<construct_stage_stat> &stats = constructor->get_stats();
+	for (size_t i = 0; i < stats.size(); i++)
+		printf("%s: %ld edges, %.3f seconds, %.0f edges/s\n",
+				stats[i].name.c_str(), stats[i].num_edges, stats[i].seconds,
+				stats[i].get_edges_per_sec());
 }
@@ -17,7 +17,13 @@
  * limitations under the License.
  */
 
+#include "in_mem_io.h"
+#include "native_file.h"
+#include "safs_file.h"
+
 #include "ts_graph.h"
+#include "graph_engine.h"
+#include "FGlib.h"
 
 namespace fg
 {
@@ -43,4 +49,211 @@ edge_seq_iterator get_ts_iterator(const page_directed_vertex &v,
 	return v.get_neigh_seq_it(type, start, end);
 }
 
+namespace {
+
+class ts_index_vertex: public compute_vertex
+{
+public:
+	ts_index_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg) {
+	}
+};
+
+class ts_index_vertex_program: public vertex_program_impl<ts_index_vertex>
+{
+	ts_index &index;
+public:
+	ts_index_vertex_program(ts_index &_index): index(_index) {
+	}
+
+	ts_index &get_index() {
+		return index;
+	}
+};
+
+class ts_index_vertex_program_creater: public vertex_program_creater
+{
+	ts_index &index;
+public:
+	ts_index_vertex_program_creater(ts_index &_index): index(_index) {
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new ts_index_vertex_program(index));
+	}
+};
+
+void ts_index_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	ts_index &index = ((ts_index_vertex_program &) prog).get_index();
+	if (!prog.get_graph().is_directed())
+		ABORT_MSG("undirected graph isn't supported");
+
+	// Each vertex only updates its own entries in the index.
+	const page_directed_vertex &dv = (const page_directed_vertex &) vertex;
+	edge_type types[] = {edge_type::IN_EDGE, edge_type::OUT_EDGE};
+	for (int i = 0; i < 2; i++) {
+		size_t num_edges = dv.get_num_edges(types[i]);
+		if (num_edges == 0)
+			continue;
+		safs::page_byte_array::const_iterator<ts_edge_data> it
+			= dv.get_data_begin<ts_edge_data>(types[i]);
+		time_t first = (*it).get_timestamp();
+		it += num_edges - 1;
+		index.set_range(vertex.get_id(), types[i], first, (*it).get_timestamp());
+	}
+}
+
+}
+
+ts_index::ptr ts_index::create(std::shared_ptr<FG_graph> fg)
+{
+	graph_index::ptr index = NUMA_graph_index<ts_index_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	assert(graph->get_graph_header().has_edge_data());
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	ptr ts_idx(new ts_index(graph->get_num_vertices()));
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new ts_index_vertex_program_creater(*ts_idx)));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("It takes %1% seconds to build the time index")
+		% time_diff(start, end);
+	return ts_idx;
+}
+
+ts_index::ptr ts_index::load(const std::string &file, bool in_safs,
+		const graph_header &header)
+{
+	NUMA_mapper mapper(1, 30);
+	safs::NUMA_buffer::ptr buf;
+	if (in_safs) {
+		safs::safs_file f(safs::get_sys_RAID_conf(), file);
+		if (!f.exist())
+			return ptr();
+		buf = safs::NUMA_buffer::load_safs(file, mapper);
+	}
+	else {
+		if (!safs::file_exist(file))
+			return ptr();
+		buf = safs::NUMA_buffer::load(file, mapper);
+	}
+
+	file_header fheader;
+	if (buf->get_length() < sizeof(fheader))
+		return ptr();
+	buf->copy_to((char *) &fheader, sizeof(fheader), 0);
+	size_t num_vertices = header.get_num_vertices();
+	size_t ranges_size = num_vertices * sizeof(time_range);
+	// A file in SAFS may be padded to pages.
+	if (fheader.magic != MAGIC || fheader.version != CURR_VERSION
+			|| fheader.time_size != sizeof(time_t)
+			|| fheader.num_vertices != num_vertices
+			|| fheader.num_edges != header.get_num_edges()
+			|| buf->get_length() < sizeof(fheader) + ranges_size * 2) {
+		BOOST_LOG_TRIVIAL(warning)
+			<< boost::format("The time index in %1% isn't built for the graph")
+			% file;
+		return ptr();
+	}
+
+	ptr ts_idx(new ts_index(num_vertices));
+	buf->copy_to((char *) ts_idx->in_ranges.data(), ranges_size,
+			sizeof(fheader));
+	buf->copy_to((char *) ts_idx->out_ranges.data(), ranges_size,
+			sizeof(fheader) + ranges_size);
+	return ts_idx;
+}
+
+void ts_index::dump(const std::string &file, bool in_safs,
+		const graph_header &header) const
+{
+	file_header fheader;
+	memset(&fheader, 0, sizeof(fheader));
+	fheader.magic = MAGIC;
+	fheader.version = CURR_VERSION;
+	fheader.time_size = sizeof(time_t);
+	fheader.num_vertices = get_num_vertices();
+	fheader.num_edges = header.get_num_edges();
+	size_t ranges_size = get_num_vertices() * sizeof(time_range);
+
+	NUMA_mapper mapper(1, 30);
+	safs::NUMA_buffer::ptr buf = safs::NUMA_buffer::create(
+			sizeof(fheader) + ranges_size * 2, mapper);
+	buf->copy_from((const char *) &fheader, sizeof(fheader), 0);
+	buf->copy_from((const char *) in_ranges.data(), ranges_size,
+			sizeof(fheader));
+	buf->copy_from((const char *) out_ranges.data(), ranges_size,
+			sizeof(fheader) + ranges_size);
+	if (in_safs) {
+		// A SAFS file isn't resized when it's written.
+		safs::safs_file f(safs::get_sys_RAID_conf(), file);
+		if (f.exist() && !f.delete_file())
+			throw safs::io_exception(std::string("can't delete SAFS file ")
+					+ file);
+		buf->dump_safs(file);
+	}
+	else
+		buf->dump(file);
+}
+
+std::pair<time_t, time_t> ts_index::get_time_range() const
+{
+	time_t start_time = std::numeric_limits<time_t>::max();
+	time_t end_time = std::numeric_limits<time_t>::min();
+	for (size_t i = 0; i < in_ranges.size(); i++) {
+		start_time = std::min(start_time,
+				std::min(in_ranges[i].first, out_ranges[i].first));
+		end_time = std::max(end_time,
+				std::max(in_ranges[i].last, out_ranges[i].last));
+	}
+	return std::pair<time_t, time_t>(start_time, end_time);
+}
+
+ts_index::ptr get_ts_index(FG_graph::ptr fg)
+{
+	ts_index::ptr index = fg->get_ts_index();
+	if (index != NULL)
+		return index;
+
+	// A graph created in memory doesn't have an index file.
+	std::string file;
+	if (!fg->get_index_file().empty())
+		file = fg->get_index_file() + ".ts";
+	bool in_safs = fg->is_index_in_safs();
+	if (!file.empty())
+		index = ts_index::load(file, in_safs, fg->get_graph_header());
+	if (index == NULL) {
+		index = ts_index::create(fg);
+		// The graph can still be used if the index can't be saved.
+		if (!file.empty() && (!in_safs || safs::params.is_writable())) {
+			try {
+				index->dump(file, in_safs, fg->get_graph_header());
+			} catch (std::exception &e) {
+				BOOST_LOG_TRIVIAL(warning)
+					<< boost::format("can't save the time index to %1%: %2%")
+					% file % e.what();
+			}
+		}
+	}
+	else
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("load the time index from %1%") % file;
+	fg->set_ts_index(index);
+	return index;
+}
+
 }
@@ -20,13 +20,21 @@
  * limitations under the License.
  */
 
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "vertex.h"
+#include "graph_file_header.h"
 
 namespace fg
 {
 
+class FG_graph;
+
 const int HOUR_SECS = 3600;
 const int DAY_SECS = HOUR_SECS * 24;
 const int MONTH_SECS = DAY_SECS * 30;
@@ -34,6 +42,138 @@ const int MONTH_SECS = DAY_SECS * 30;
 edge_seq_iterator get_ts_iterator(const page_directed_vertex &v,
 		edge_type type, time_t time_start, time_t time_interval);
 
+/*
+ * This is an in-memory time index of a time-series graph. The edges of
+ * a vertex are sorted by their timestamps, so the index only keeps the time
+ * range of the in-edges and the out-edges of each vertex. An algorithm that
+ * works on a time interval can skip the vertices without edges in the
+ * interval, and a vertex whose edges all fall in the interval doesn't need
+ * to be read to get its degree in the interval.
+ *
+ * Building the index needs a scan on the whole graph, so the index is
+ * saved in a file next to the graph index and is loaded by the later runs
+ * on the same graph.
+ */
+class ts_index
+{
+	struct time_range
+	{
+		time_t first;
+		time_t last;
+
+		time_range() {
+			first = std::numeric_limits<time_t>::max();
+			last = std::numeric_limits<time_t>::min();
+		}
+
+		bool overlap(time_t start, time_t interval) const {
+			return first < start + interval && last >= start;
+		}
+
+		bool within(time_t start, time_t interval) const {
+			return first >= start && last < start + interval;
+		}
+	};
+
+	/*
+	 * The header of an index file. The index is only loaded for a graph
+	 * with the same number of vertices and edges.
+	 */
+	struct file_header
+	{
+		int64_t magic;
+		int32_t version;
+		int32_t time_size;
+		size_t num_vertices;
+		size_t num_edges;
+	};
+	static const int64_t MAGIC = 0x7473696e646578LL;
+	static const int32_t CURR_VERSION = 1;
+
+	std::vector<time_range> in_ranges;
+	std::vector<time_range> out_ranges;
+
+	ts_index(size_t num_vertices): in_ranges(num_vertices), out_ranges(
+			num_vertices) {
+	}
+
+	const time_range &get_range(vertex_id_t id, edge_type type) const {
+		assert(type == edge_type::IN_EDGE || type == edge_type::OUT_EDGE);
+		return type == edge_type::IN_EDGE ? in_ranges[id] : out_ranges[id];
+	}
+public:
+	typedef std::shared_ptr<ts_index> ptr;
+
+	/*
+	 * Build the index with a scan on the adjacency lists of all vertices.
+	 */
+	static ptr create(std::shared_ptr<FG_graph> fg);
+
+	/*
+	 * Load the index from a file in SAFS or in the local filesystem.
+	 * It returns NULL if the file doesn't exist or is built for
+	 * another graph.
+	 */
+	static ptr load(const std::string &file, bool in_safs,
+			const graph_header &header);
+	/*
+	 * Save the index to a file in SAFS or in the local filesystem.
+	 * An existing file is overwritten.
+	 */
+	void dump(const std::string &file, bool in_safs,
+			const graph_header &header) const;
+
+	void set_range(vertex_id_t id, edge_type type, time_t first, time_t last) {
+		time_range &range = type == edge_type::IN_EDGE
+			? in_ranges[id] : out_ranges[id];
+		range.first = first;
+		range.last = last;
+	}
+
+	/*
+	 * Test whether the vertex has edges of the specified type in the time
+	 * interval [start, start + interval).
+	 */
+	bool overlap(vertex_id_t id, edge_type type, time_t start,
+			time_t interval) const {
+		if (type == edge_type::BOTH_EDGES)
+			return in_ranges[id].overlap(start, interval)
+				|| out_ranges[id].overlap(start, interval);
+		else
+			return get_range(id, type).overlap(start, interval);
+	}
+
+	/*
+	 * Test whether all edges of the specified type of the vertex are in
+	 * the time interval [start, start + interval).
+	 */
+	bool within(vertex_id_t id, edge_type type, time_t start,
+			time_t interval) const {
+		if (type == edge_type::BOTH_EDGES)
+			return within(id, edge_type::IN_EDGE, start, interval)
+				&& within(id, edge_type::OUT_EDGE, start, interval);
+		const time_range &range = get_range(id, type);
+		// A vertex without edges has an empty range.
+		return range.first > range.last || range.within(start, interval);
+	}
+
+	/*
+	 * Get the time range of all edges in the graph.
+	 */
+	std::pair<time_t, time_t> get_time_range() const;
+
+	size_t get_num_vertices() const {
+		return in_ranges.size();
+	}
+};
+
+/*
+ * Get the time index of a time-series graph. The first time it's requested,
+ * the index is loaded from the file next to the graph index or built and
+ * saved to the file, and it's kept with the graph afterwards.
+ */
+ts_index::ptr get_ts_index(std::shared_ptr<FG_graph> fg);
+
 static inline bool is_time_str(const std::string &str)
 {
 	struct tm tm;
@@ -0,0 +1,50 @@
+#ifndef __MEM_GRAPH_H__
+#define __MEM_GRAPH_H__
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+#include "utils.h"
+#include "in_mem_storage.h"
+
+namespace fg
+{
+
+typedef std::vector<std::vector<vertex_id_t> > adj_list_t;
+
+/*
+ * Create a directed graph in memory from the out-edge lists of vertices,
+ * so the unit tests can run the engine without graph files.
+ */
+static inline FG_graph::ptr create_mem_graph(const adj_list_t &out_edges,
+		const std::string &name, config_map::ptr configs)
+{
+	adj_list_t in_edges(out_edges.size());
+	for (size_t i = 0; i < out_edges.size(); i++)
+		for (size_t j = 0; j < out_edges[i].size(); j++)
+			in_edges[out_edges[i][j]].push_back(i);
+
+	utils::mem_serial_graph::ptr serial_g = utils::mem_serial_graph::create(
+			true, 0);
+	for (size_t i = 0; i < out_edges.size(); i++) {
+		std::vector<vertex_id_t> outs = out_edges[i];
+		std::vector<vertex_id_t> ins = in_edges[i];
+		std::sort(outs.begin(), outs.end());
+		std::sort(ins.begin(), ins.end());
+		in_mem_directed_vertex<> v(i, false);
+		for (size_t j = 0; j < ins.size(); j++)
+			v.add_in_edge(edge<>(ins[j], i));
+		for (size_t j = 0; j < outs.size(); j++)
+			v.add_out_edge(edge<>(i, outs[j]));
+		serial_g->add_vertex(v);
+	}
+	in_mem_graph::ptr graph_data = serial_g->dump_graph(name);
+	vertex_index::ptr index_data = serial_g->dump_index(true);
+	return FG_graph::create(graph_data, index_data, name, configs);
+}
+
+}
+
+#endif
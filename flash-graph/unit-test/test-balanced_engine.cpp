@@ -0,0 +1,145 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#define BOOST_TEST_MODULE balanced_engine
+#include <boost/test/included/unit_test.hpp>
+
+#include "FGlib.h"
+#include "mem_graph.h"
+
+using namespace fg;
+
+/*
+ * This runs the engine with a number of worker threads that isn't 2^n,
+ * which requires the edge-balanced partitioner, and checks the results
+ * of WCC and k-hop BFS with the ones computed serially.
+ */
+
+const int NUM_THREADS = 12;
+const size_t NUM_VERTICES = 5000;
+const size_t NUM_HUBS = 8;
+
+/*
+ * A few hub vertices have many out-edges, so the partitions split on
+ * the number of edges have very different numbers of vertices.
+ * The vertices in the last tenth only link to their neighbor, so the graph
+ * has many components.
+ */
+static adj_list_t gen_graph()
+{
+	adj_list_t out_edges(NUM_VERTICES);
+	size_t num_linked = NUM_VERTICES * 9 / 10;
+	for (size_t i = 0; i < NUM_HUBS; i++)
+		for (size_t j = 0; j < 500; j++)
+			out_edges[i].push_back(random() % num_linked);
+	for (size_t i = NUM_HUBS; i < num_linked; i++) {
+		int num_edges = random() % 3;
+		for (int j = 0; j < num_edges; j++)
+			out_edges[i].push_back(random() % num_linked);
+	}
+	for (size_t i = num_linked; i + 1 < NUM_VERTICES; i += 2)
+		out_edges[i].push_back(i + 1);
+	return out_edges;
+}
+
+static vertex_id_t find_root(std::vector<vertex_id_t> &parents, vertex_id_t id)
+{
+	while (parents[id] != id) {
+		parents[id] = parents[parents[id]];
+		id = parents[id];
+	}
+	return id;
+}
+
+static size_t serial_khop(const adj_list_t &out_edges, vertex_id_t start,
+		int k)
+{
+	std::vector<int> levels(out_edges.size(), -1);
+	std::deque<vertex_id_t> queue;
+	levels[start] = 0;
+	queue.push_back(start);
+	size_t num_reached = 0;
+	while (!queue.empty()) {
+		vertex_id_t id = queue.front();
+		queue.pop_front();
+		if (levels[id] == k)
+			continue;
+		for (size_t i = 0; i < out_edges[id].size(); i++) {
+			vertex_id_t neigh = out_edges[id][i];
+			if (levels[neigh] < 0) {
+				levels[neigh] = levels[id] + 1;
+				num_reached++;
+				queue.push_back(neigh);
+			}
+		}
+	}
+	return num_reached;
+}
+
+BOOST_AUTO_TEST_CASE (test_non_power2_threads)
+{
+	config_map::ptr configs = config_map::create();
+	configs->add_options("threads=12 part_balance_edges=");
+	graph_engine::init_flash_graph(configs);
+	BOOST_REQUIRE_EQUAL(graph_conf.get_num_threads(), NUM_THREADS);
+
+	adj_list_t out_edges = gen_graph();
+	FG_graph::ptr fg = create_mem_graph(out_edges, "balanced", configs);
+	// The delta store is also partitioned based on the number of threads.
+	std::vector<std::pair<vertex_id_t, vertex_id_t> > new_edges;
+	new_edges.push_back(std::pair<vertex_id_t, vertex_id_t>(
+				NUM_VERTICES - 2, NUM_VERTICES - 1));
+	new_edges.push_back(std::pair<vertex_id_t, vertex_id_t>(
+				NUM_VERTICES - 1, 0));
+	fg->add_edges(new_edges);
+	for (size_t i = 0; i < new_edges.size(); i++)
+		out_edges[new_edges[i].first].push_back(new_edges[i].second);
+
+	std::vector<vertex_id_t> parents(NUM_VERTICES);
+	std::vector<size_t> degrees(NUM_VERTICES);
+	for (size_t i = 0; i < NUM_VERTICES; i++)
+		parents[i] = i;
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		for (size_t j = 0; j < out_edges[i].size(); j++) {
+			parents[find_root(parents, i)] = find_root(parents, out_edges[i][j]);
+			degrees[i]++;
+			degrees[out_edges[i][j]]++;
+		}
+	}
+
+	// Two vertices are in the same component in both results or in
+	// neither of them. WCC doesn't assign a component to a vertex without
+	// edges.
+	FG_vector<vertex_id_t>::ptr comps = compute_wcc(fg);
+	BOOST_REQUIRE(comps != NULL);
+	std::vector<vertex_id_t> fg2serial(NUM_VERTICES, INVALID_VERTEX_ID);
+	std::vector<vertex_id_t> serial2fg(NUM_VERTICES, INVALID_VERTEX_ID);
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		vertex_id_t comp = comps->get(i);
+		vertex_id_t root = find_root(parents, i);
+		BOOST_CHECK_EQUAL(comp == INVALID_VERTEX_ID, degrees[i] == 0);
+		if (comp == INVALID_VERTEX_ID || degrees[i] == 0)
+			continue;
+		BOOST_REQUIRE(comp < NUM_VERTICES);
+		if (fg2serial[comp] == INVALID_VERTEX_ID)
+			fg2serial[comp] = root;
+		if (serial2fg[root] == INVALID_VERTEX_ID)
+			serial2fg[root] = comp;
+		BOOST_CHECK_EQUAL(fg2serial[comp], root);
+		BOOST_CHECK_EQUAL(serial2fg[root], comp);
+	}
+
+	std::vector<vertex_id_t> sources;
+	for (size_t i = 0; i < 100; i++)
+		sources.push_back(random() % NUM_VERTICES);
+	sources.push_back(NUM_VERTICES - 2);
+	FG_vector<size_t>::ptr reach = compute_khop_reach(fg, sources, 2);
+	for (size_t i = 0; i < sources.size(); i++)
+		BOOST_CHECK_EQUAL(reach->get(i), serial_khop(out_edges, sources[i], 2));
+
+	fg.reset();
+	graph_engine::destroy_flash_graph();
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE edge_list_constructor
+#include <boost/test/included/unit_test.hpp>
+
+#include "edge_list_constructor.h"
+#include "vertex_index.h"
+#include "vertex.h"
+
+using namespace fg;
+
+/*
+ * This constructs small graphs with buffers so small that the parse stage
+ * writes many more runs than a merge can read at once, and compares
+ * the adjacency lists and the index with the ones built in memory.
+ */
+
+typedef std::pair<vertex_id_t, vertex_id_t> edge_t;
+typedef std::vector<std::vector<vertex_id_t> > adj_list_t;
+
+const size_t NUM_VERTICES = 2000;
+const size_t NUM_EDGES = 20000;
+const int NUM_THREADS = 2;
+// A run in a directed graph has 256 edges, so there are about 80 runs of
+// each type.
+const size_t SORT_BUF_SIZE = 256 * 2 * sizeof(edge_t);
+// The fan-in of a merge is 2, so the runs are merged in several passes.
+const size_t MERGE_BUF_SIZE = 2 * 64 * 1024 * NUM_THREADS;
+
+/*
+ * The edges have self-loops and duplicates. Some duplicates are reversed,
+ * so they only duplicate an edge in an undirected graph.
+ */
+static std::vector<edge_t> gen_edges()
+{
+	std::vector<edge_t> edges;
+	while (edges.size() < NUM_EDGES) {
+		// The last vertex has an edge, so the graph has all vertices.
+		vertex_id_t from = edges.empty() ? NUM_VERTICES - 1
+			: random() % NUM_VERTICES;
+		vertex_id_t to = random() % NUM_VERTICES;
+		if (edges.size() % 50 == 0)
+			to = from;
+		edges.push_back(edge_t(from, to));
+		if (edges.size() % 30 == 0)
+			edges.push_back(edges[random() % edges.size()]);
+		if (edges.size() % 70 == 0)
+			edges.push_back(edge_t(to, from));
+	}
+	return edges;
+}
+
+class edge_vector_generator: public edge_generator
+{
+	const std::vector<edge_t> &edges;
+	static const size_t BLOCK_SIZE = 1000;
+public:
+	edge_vector_generator(const std::vector<edge_t> &_edges): edges(_edges) {
+	}
+
+	virtual size_t get_num_vertices() const {
+		return NUM_VERTICES;
+	}
+
+	virtual size_t get_num_blocks() const {
+		return (edges.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	}
+
+	virtual void gen_block(size_t block_id,
+			std::vector<edge_t> &block) const {
+		size_t end = std::min((block_id + 1) * BLOCK_SIZE, edges.size());
+		block.insert(block.end(), edges.begin() + block_id * BLOCK_SIZE,
+				edges.begin() + end);
+	}
+};
+
+struct work_dir_fixture
+{
+	std::string dir;
+	std::string adj_file;
+	std::string index_file;
+
+	work_dir_fixture() {
+		char tmpl[] = "/tmp/fg-test-XXXXXX";
+		BOOST_REQUIRE(mkdtemp(tmpl) != NULL);
+		dir = tmpl;
+		adj_file = dir + "/graph.adj";
+		index_file = dir + "/graph.index";
+	}
+
+	~work_dir_fixture() {
+		unlink(adj_file.c_str());
+		unlink(index_file.c_str());
+		unlink((dir + "/edges.txt").c_str());
+		rmdir(dir.c_str());
+	}
+};
+
+static edge_list_constructor::ptr create_constructor(bool directed,
+		const std::string &work_dir)
+{
+	edge_list_constructor::ptr constructor = edge_list_constructor::create(
+			directed, work_dir);
+	constructor->set_sort_buf_size(SORT_BUF_SIZE);
+	constructor->set_merge_buf_size(MERGE_BUF_SIZE);
+	constructor->set_num_threads(NUM_THREADS);
+	return constructor;
+}
+
+static std::vector<char> read_file(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	BOOST_REQUIRE(f != NULL);
+	fseek(f, 0, SEEK_END);
+	std::vector<char> buf(ftell(f));
+	fseek(f, 0, SEEK_SET);
+	BOOST_REQUIRE_EQUAL(fread(buf.data(), buf.size(), 1, f), 1U);
+	fclose(f);
+	return buf;
+}
+
+/*
+ * Check the adjacency list stored at the offset, which the index returns
+ * for the vertex.
+ */
+static void check_adj_list(const std::vector<char> &adj, off_t off,
+		vertex_id_t id, const std::vector<vertex_id_t> &expected)
+{
+	BOOST_REQUIRE(off + ext_mem_undirected_vertex::get_header_size()
+			<= adj.size());
+	const ext_mem_undirected_vertex *v
+		= (const ext_mem_undirected_vertex *) (adj.data() + off);
+	BOOST_CHECK_EQUAL(v->get_id(), id);
+	BOOST_REQUIRE_EQUAL(v->get_num_edges(), expected.size());
+	BOOST_REQUIRE(off + v->get_size() <= adj.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		BOOST_CHECK_EQUAL(v->get_neighbor(i), expected[i]);
+}
+
+static void sort_adj_lists(adj_list_t &lists)
+{
+	for (size_t i = 0; i < lists.size(); i++)
+		std::sort(lists[i].begin(), lists[i].end());
+}
+
+/*
+ * The graph keeps the duplicated edges and the self-loops.
+ */
+BOOST_FIXTURE_TEST_CASE (test_directed, work_dir_fixture)
+{
+	std::vector<edge_t> edges = gen_edges();
+	std::string edge_file = dir + "/edges.txt";
+	FILE *f = fopen(edge_file.c_str(), "w");
+	BOOST_REQUIRE(f != NULL);
+	fprintf(f, "# from\tto\n");
+	for (size_t i = 0; i < edges.size(); i++)
+		fprintf(f, "%u\t%u\n", (unsigned) edges[i].first,
+				(unsigned) edges[i].second);
+	fclose(f);
+
+	edge_list_constructor::ptr constructor = create_constructor(true, dir);
+	constructor->construct(std::vector<std::string>(1, edge_file),
+			adj_file, index_file);
+
+	adj_list_t out_edges(NUM_VERTICES);
+	adj_list_t in_edges(NUM_VERTICES);
+	for (size_t i = 0; i < edges.size(); i++) {
+		out_edges[edges[i].first].push_back(edges[i].second);
+		in_edges[edges[i].second].push_back(edges[i].first);
+	}
+	sort_adj_lists(out_edges);
+	sort_adj_lists(in_edges);
+
+	vertex_index::ptr index = vertex_index::load(index_file);
+	const graph_header &header = index->get_graph_header();
+	BOOST_REQUIRE(header.is_directed_graph());
+	BOOST_REQUIRE_EQUAL(header.get_num_vertices(), NUM_VERTICES);
+	BOOST_CHECK_EQUAL(header.get_num_edges(), edges.size());
+	in_mem_cdirected_vertex_index::ptr query
+		= in_mem_cdirected_vertex_index::cast(
+				in_mem_query_vertex_index::create(index, true));
+	std::vector<char> adj = read_file(adj_file);
+	for (vertex_id_t id = 0; id < NUM_VERTICES; id++) {
+		BOOST_CHECK_EQUAL(query->get_num_in_edges(id), in_edges[id].size());
+		BOOST_CHECK_EQUAL(query->get_num_out_edges(id), out_edges[id].size());
+		directed_vertex_entry entry = query->get_vertex(id);
+		check_adj_list(adj, entry.get_in_off(), id, in_edges[id]);
+		check_adj_list(adj, entry.get_out_off(), id, out_edges[id]);
+	}
+}
+
+/*
+ * The graph removes the duplicated edges and the self-loops.
+ */
+BOOST_FIXTURE_TEST_CASE (test_undirected_dedup, work_dir_fixture)
+{
+	std::vector<edge_t> edges = gen_edges();
+	edge_list_constructor::ptr constructor = create_constructor(false, dir);
+	constructor->set_dedup(true);
+	constructor->set_remove_self_loops(true);
+	constructor->construct(edge_vector_generator(edges), adj_file, index_file);
+
+	adj_list_t neighbors(NUM_VERTICES);
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (edges[i].first == edges[i].second)
+			continue;
+		neighbors[edges[i].first].push_back(edges[i].second);
+		neighbors[edges[i].second].push_back(edges[i].first);
+	}
+	size_t num_edges = 0;
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		std::sort(neighbors[i].begin(), neighbors[i].end());
+		neighbors[i].erase(std::unique(neighbors[i].begin(),
+					neighbors[i].end()), neighbors[i].end());
+		num_edges += neighbors[i].size();
+	}
+
+	vertex_index::ptr index = vertex_index::load(index_file);
+	const graph_header &header = index->get_graph_header();
+	BOOST_REQUIRE(!header.is_directed_graph());
+	BOOST_REQUIRE_EQUAL(header.get_num_vertices(), NUM_VERTICES);
+	BOOST_CHECK_EQUAL(header.get_num_edges(), num_edges / 2);
+	in_mem_cundirected_vertex_index::ptr query
+		= in_mem_cundirected_vertex_index::cast(
+				in_mem_query_vertex_index::create(index, true));
+	std::vector<char> adj = read_file(adj_file);
+	for (vertex_id_t id = 0; id < NUM_VERTICES; id++) {
+		BOOST_CHECK_EQUAL(query->get_num_edges(id, edge_type::BOTH_EDGES),
+				neighbors[id].size());
+		check_adj_list(adj, query->get_vertex(id).get_off(), id,
+				neighbors[id]);
+	}
+}
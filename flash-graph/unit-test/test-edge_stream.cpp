@@ -0,0 +1,140 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#define BOOST_TEST_MODULE edge_stream
+#include <boost/test/included/unit_test.hpp>
+
+#include "FGlib.h"
+#include "mem_graph.h"
+
+using namespace fg;
+
+/*
+ * This compares PageRank and WCC computed by the edge-centric streaming
+ * engine with the results of the vertex-centric engine on the same graph.
+ */
+
+const size_t NUM_VERTICES = 3000;
+const float DAMPING_FACTOR = 0.85;
+const int NUM_ITERS = 30;
+
+/*
+ * The graph has self-loops, duplicated edges, vertices without in-edges
+ * or out-edges and many components.
+ */
+static adj_list_t gen_graph()
+{
+	adj_list_t out_edges(NUM_VERTICES);
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		// A tenth of the vertices don't have out-edges.
+		if (i % 10 == 0)
+			continue;
+		int num_edges = random() % 4;
+		// The edges stay in a block of 500 vertices, so each block is
+		// a component or more.
+		size_t block_start = i / 500 * 500;
+		for (int j = 0; j < num_edges; j++)
+			out_edges[i].push_back(block_start + random() % 500);
+		if (i % 97 == 0)
+			out_edges[i].push_back(i);
+		if (i % 89 == 0 && !out_edges[i].empty())
+			out_edges[i].push_back(out_edges[i].front());
+	}
+	return out_edges;
+}
+
+/*
+ * The same synchronous iteration that the streaming PageRank runs.
+ * It stops when no vertex changes more than the tolerance.
+ */
+static std::vector<float> serial_pagerank(const adj_list_t &out_edges)
+{
+	const float TOLERANCE = 1.0E-2;
+	std::vector<float> prs(out_edges.size(), 1 - DAMPING_FACTOR);
+	for (int iter = 0; iter < NUM_ITERS; iter++) {
+		std::vector<float> accums(out_edges.size());
+		for (size_t i = 0; i < out_edges.size(); i++)
+			for (size_t j = 0; j < out_edges[i].size(); j++)
+				accums[out_edges[i][j]] += prs[i] / out_edges[i].size();
+		bool changed = false;
+		for (size_t i = 0; i < out_edges.size(); i++) {
+			float new_pr = (1 - DAMPING_FACTOR) + DAMPING_FACTOR * accums[i];
+			if (fabs(new_pr - prs[i]) > TOLERANCE)
+				changed = true;
+			prs[i] = new_pr;
+		}
+		if (!changed)
+			break;
+	}
+	return prs;
+}
+
+struct engine_fixture
+{
+	config_map::ptr configs;
+	adj_list_t out_edges;
+	FG_graph::ptr fg;
+
+	engine_fixture() {
+		configs = config_map::create();
+		configs->add_options("threads=4");
+		graph_engine::init_flash_graph(configs);
+		out_edges = gen_graph();
+		fg = create_mem_graph(out_edges, "stream", configs);
+	}
+
+	~engine_fixture() {
+		fg.reset();
+		graph_engine::destroy_flash_graph();
+	}
+};
+
+BOOST_FIXTURE_TEST_CASE (test_pagerank_stream, engine_fixture)
+{
+	FG_vector<float>::ptr stream_prs = compute_pagerank_stream(fg, NUM_ITERS,
+			DAMPING_FACTOR);
+	FG_vector<float>::ptr prs = compute_pagerank(fg, NUM_ITERS,
+			DAMPING_FACTOR);
+	BOOST_REQUIRE(stream_prs != NULL && prs != NULL);
+	BOOST_REQUIRE_EQUAL(stream_prs->get_size(), NUM_VERTICES);
+	std::vector<float> expected = serial_pagerank(out_edges);
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		// The streaming engine runs the same iterations as the serial
+		// computation, and only the order of the float additions differs.
+		BOOST_CHECK_CLOSE(stream_prs->get(i), expected[i], 0.1);
+		// The vertex-centric engine stops updating a vertex when its
+		// in-neighbors change less than the tolerance, so it only
+		// converges to the same PageRank.
+		BOOST_CHECK_SMALL(stream_prs->get(i) - prs->get(i), 0.1f);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE (test_wcc_stream, engine_fixture)
+{
+	FG_vector<vertex_id_t>::ptr stream_comps = compute_wcc_stream(fg);
+	FG_vector<vertex_id_t>::ptr comps = compute_wcc(fg);
+	BOOST_REQUIRE(stream_comps != NULL && comps != NULL);
+	BOOST_REQUIRE_EQUAL(stream_comps->get_size(), NUM_VERTICES);
+	// Two vertices are in the same component in both results or in
+	// neither of them. Both engines don't assign a component to a vertex
+	// without edges.
+	std::vector<vertex_id_t> stream2comp(NUM_VERTICES, INVALID_VERTEX_ID);
+	std::vector<vertex_id_t> comp2stream(NUM_VERTICES, INVALID_VERTEX_ID);
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		vertex_id_t stream_comp = stream_comps->get(i);
+		vertex_id_t comp = comps->get(i);
+		BOOST_CHECK_EQUAL(stream_comp == INVALID_VERTEX_ID,
+				comp == INVALID_VERTEX_ID);
+		if (stream_comp == INVALID_VERTEX_ID || comp == INVALID_VERTEX_ID)
+			continue;
+		BOOST_REQUIRE(stream_comp < NUM_VERTICES && comp < NUM_VERTICES);
+		if (stream2comp[stream_comp] == INVALID_VERTEX_ID)
+			stream2comp[stream_comp] = comp;
+		if (comp2stream[comp] == INVALID_VERTEX_ID)
+			comp2stream[comp] = stream_comp;
+		BOOST_CHECK_EQUAL(stream2comp[stream_comp], comp);
+		BOOST_CHECK_EQUAL(comp2stream[comp], stream_comp);
+	}
+}
@@ -0,0 +1,100 @@
+#include <vector>
+
+#define BOOST_TEST_MODULE graph_delta
+#include <boost/test/included/unit_test.hpp>
+
+#include "graph_delta.h"
+
+using namespace fg;
+
+BOOST_AUTO_TEST_SUITE (graph_deltatest) // name of the test suite
+
+static std::vector<vertex_id_t> get_edges(const page_vertex &v, edge_type type)
+{
+	std::vector<vertex_id_t> edges(v.get_num_edges(type));
+	v.read_edges(type, edges.data(), edges.size());
+	return edges;
+}
+
+BOOST_AUTO_TEST_CASE (test_undirected)
+{
+	graph_header header(graph_type::UNDIRECTED, 10, 4, 0);
+	graph_delta::ptr delta = graph_delta::create(header, 4);
+
+	// The adjacency list of vertex 3 in the graph image.
+	vertex_id_t orig_edges[] = {1, 5, 5, 7};
+	size_t size = ext_mem_undirected_vertex::num_edges2vsize(4, 0);
+	std::vector<char> buf(size);
+	ext_mem_undirected_vertex *ext_v = new (buf.data())
+		ext_mem_undirected_vertex(3, 4, 0);
+	for (int i = 0; i < 4; i++)
+		ext_v->set_neighbor(i, orig_edges[i]);
+	mem_byte_array arr(buf.data(), size);
+	page_undirected_vertex v(arr);
+
+	BOOST_CHECK(delta->merge(v) == NULL);
+	delta->add_edge(3, 2);
+	delta->add_edge(9, 3);
+	delta->delete_edge(3, 5);
+	BOOST_CHECK_EQUAL(delta->get_num_updates(), 3U);
+	BOOST_CHECK(delta->has_updates(2));
+	BOOST_CHECK(delta->has_updates(9));
+	BOOST_CHECK(!delta->has_updates(4));
+
+	std::unique_ptr<merged_page_vertex> merged = delta->merge(v);
+	BOOST_REQUIRE(merged != NULL);
+	BOOST_CHECK_EQUAL(merged->get_vertex().get_id(), 3U);
+	std::vector<vertex_id_t> edges = get_edges(merged->get_vertex(),
+			edge_type::OUT_EDGE);
+	vertex_id_t expected[] = {1, 2, 7, 9};
+	BOOST_CHECK_EQUAL_COLLECTIONS(edges.begin(), edges.end(), expected,
+			expected + 4);
+
+	// Adding a deleted edge back only adds one copy of the edge.
+	delta->add_edge(5, 3);
+	merged = delta->merge(v);
+	edges = get_edges(merged->get_vertex(), edge_type::OUT_EDGE);
+	vertex_id_t expected1[] = {1, 2, 5, 7, 9};
+	BOOST_CHECK_EQUAL_COLLECTIONS(edges.begin(), edges.end(), expected1,
+			expected1 + 5);
+
+	BOOST_CHECK_THROW(delta->add_edge(3, 10), invalid_arg_exception);
+	delta->clear();
+	BOOST_CHECK(!delta->has_updates(3));
+	BOOST_CHECK(delta->merge(v) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE (test_directed)
+{
+	graph_header header(graph_type::DIRECTED, 10, 0, 0);
+	graph_delta::ptr delta = graph_delta::create(header, 2);
+	delta->add_edge(1, 2);
+	delta->add_edge(1, 4);
+	delta->delete_edge(3, 1);
+
+	vertex_delta d;
+	BOOST_CHECK(delta->get_updates(1, d));
+	BOOST_CHECK_EQUAL(d.added_out.size(), 2U);
+	BOOST_CHECK_EQUAL(d.deleted_in.size(), 1U);
+	BOOST_CHECK(delta->get_updates(2, d));
+	BOOST_CHECK_EQUAL(d.added_in.size(), 1U);
+	BOOST_CHECK_EQUAL(d.added_in[0], 1U);
+	BOOST_CHECK(!delta->get_updates(5, d));
+}
+
+BOOST_AUTO_TEST_CASE (test_non_power2_parts)
+{
+	// The engine can run on 12 threads with the edge-balanced partitioner.
+	graph_header header(graph_type::DIRECTED, 100000, 0, 0);
+	graph_delta::ptr delta = graph_delta::create(header, 12);
+	for (vertex_id_t id = 0; id + 1 < 100000; id += 997)
+		delta->add_edge(id, id + 1);
+	BOOST_CHECK_EQUAL(delta->get_num_updates(), 101U);
+	vertex_delta d;
+	BOOST_CHECK(delta->get_updates(99700, d));
+	BOOST_CHECK_EQUAL(d.added_out.size(), 1U);
+	BOOST_CHECK(delta->get_updates(99701, d));
+	BOOST_CHECK_EQUAL(d.added_in.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END( )
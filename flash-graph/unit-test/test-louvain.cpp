@@ -0,0 +1,149 @@
+#include <vector>
+
+#define BOOST_TEST_MODULE louvain
+#include <boost/test/included/unit_test.hpp>
+
+#include "FGlib.h"
+#include "mem_graph.h"
+
+using namespace fg;
+
+/*
+ * This runs Louvain on a graph with two levels of communities: cliques
+ * that are grouped by a few edges between each pair of cliques in a group,
+ * and the groups that form a ring. The first level finds the cliques and
+ * the second level merges them into the groups.
+ */
+
+const size_t NUM_GROUPS = 8;
+const size_t CLIQUES_PER_GROUP = 4;
+const size_t CLIQUE_SIZE = 8;
+// The number of edges between two cliques in the same group.
+const size_t NUM_CLIQUE_LINKS = 3;
+const size_t GROUP_SIZE = CLIQUES_PER_GROUP * CLIQUE_SIZE;
+const size_t NUM_VERTICES = NUM_GROUPS * GROUP_SIZE;
+
+/*
+ * Each undirected edge is stored once as an out-edge. A vertex has
+ * at most two edges that leave its clique, so it never gains from
+ * leaving the clique by itself.
+ */
+static adj_list_t gen_graph()
+{
+	adj_list_t out_edges(NUM_VERTICES);
+	for (size_t c = 0; c < NUM_VERTICES / CLIQUE_SIZE; c++) {
+		size_t start = c * CLIQUE_SIZE;
+		for (size_t i = 0; i < CLIQUE_SIZE; i++)
+			for (size_t j = i + 1; j < CLIQUE_SIZE; j++)
+				out_edges[start + i].push_back(start + j);
+	}
+	for (size_t g = 0; g < NUM_GROUPS; g++) {
+		size_t start = g * GROUP_SIZE;
+		size_t link = 0;
+		for (size_t c1 = 0; c1 < CLIQUES_PER_GROUP; c1++)
+			for (size_t c2 = c1 + 1; c2 < CLIQUES_PER_GROUP; c2++)
+				for (size_t i = 0; i < NUM_CLIQUE_LINKS; i++, link++)
+					out_edges[start + c1 * CLIQUE_SIZE + link % CLIQUE_SIZE]
+						.push_back(start + c2 * CLIQUE_SIZE + link % CLIQUE_SIZE);
+		// The groups are linked in a ring by a single edge.
+		out_edges[start + GROUP_SIZE - 1].push_back(
+				(start + GROUP_SIZE) % NUM_VERTICES);
+	}
+	return out_edges;
+}
+
+/*
+ * The modularity of the clusters that `cluster_size' consecutive vertices
+ * form.
+ */
+static double get_modularity(const adj_list_t &out_edges, size_t cluster_size)
+{
+	size_t num_clusters = NUM_VERTICES / cluster_size;
+	std::vector<double> internal(num_clusters);
+	std::vector<double> degrees(num_clusters);
+	double num_edges = 0;
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		for (size_t j = 0; j < out_edges[i].size(); j++) {
+			size_t c1 = i / cluster_size;
+			size_t c2 = out_edges[i][j] / cluster_size;
+			if (c1 == c2)
+				internal[c1]++;
+			degrees[c1]++;
+			degrees[c2]++;
+			num_edges++;
+		}
+	}
+	double modularity = 0;
+	for (size_t c = 0; c < num_clusters; c++)
+		modularity += internal[c] / num_edges
+			- (degrees[c] / 2 / num_edges) * (degrees[c] / 2 / num_edges);
+	return modularity;
+}
+
+/*
+ * Check that the clusters are the ones that `cluster_size' consecutive
+ * vertices form.
+ */
+static void check_clusters(FG_vector<vertex_id_t>::ptr clusters,
+		size_t cluster_size)
+{
+	BOOST_REQUIRE_EQUAL(clusters->get_size(), NUM_VERTICES);
+	std::vector<vertex_id_t> ids(NUM_VERTICES / cluster_size,
+			INVALID_VERTEX_ID);
+	std::vector<bool> used(NUM_VERTICES);
+	for (size_t i = 0; i < NUM_VERTICES; i++) {
+		vertex_id_t id = clusters->get(i);
+		BOOST_REQUIRE(id < NUM_VERTICES);
+		if (ids[i / cluster_size] == INVALID_VERTEX_ID) {
+			// Two expected clusters can't have the same ID.
+			BOOST_CHECK(!used[id]);
+			used[id] = true;
+			ids[i / cluster_size] = id;
+		}
+		BOOST_CHECK_EQUAL(id, ids[i / cluster_size]);
+	}
+}
+
+struct engine_fixture
+{
+	config_map::ptr configs;
+	adj_list_t out_edges;
+	FG_graph::ptr fg;
+
+	engine_fixture() {
+		configs = config_map::create();
+		configs->add_options("threads=4");
+		graph_engine::init_flash_graph(configs);
+		out_edges = gen_graph();
+		fg = create_mem_graph(out_edges, "louvain", configs);
+	}
+
+	~engine_fixture() {
+		fg.reset();
+		graph_engine::destroy_flash_graph();
+	}
+};
+
+BOOST_FIXTURE_TEST_CASE (test_one_level, engine_fixture)
+{
+	std::vector<double> modularity;
+	FG_vector<vertex_id_t>::ptr clusters = compute_louvain(fg, 1, modularity);
+	check_clusters(clusters, CLIQUE_SIZE);
+	BOOST_REQUIRE_EQUAL(modularity.size(), 1U);
+	BOOST_CHECK_CLOSE(modularity[0], get_modularity(out_edges, CLIQUE_SIZE),
+			0.01);
+}
+
+BOOST_FIXTURE_TEST_CASE (test_multi_level, engine_fixture)
+{
+	std::vector<double> modularity;
+	FG_vector<vertex_id_t>::ptr clusters = compute_louvain(fg, 0, modularity);
+	check_clusters(clusters, GROUP_SIZE);
+	BOOST_REQUIRE(modularity.size() >= 2);
+	BOOST_CHECK_CLOSE(modularity[0], get_modularity(out_edges, CLIQUE_SIZE),
+			0.01);
+	BOOST_CHECK_CLOSE(modularity.back(), get_modularity(out_edges, GROUP_SIZE),
+			0.01);
+	for (size_t i = 1; i < modularity.size(); i++)
+		BOOST_CHECK(modularity[i] >= modularity[i - 1]);
+}
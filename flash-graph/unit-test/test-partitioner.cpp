@@ -41,6 +41,63 @@ void test_partitioner(graph_partitioner &partitioner)
 	}
 }
 
+void test_edge_balanced_partitioner()
+{
+	for (int k = 0; k < 10; k++) {
+		size_t num_vertices = random() % M + M;
+		// The partitioner should work with any number of partitions.
+		int num_parts = random() % 30 + 1;
+		printf("there are %ld vertices in %d partitions\n", num_vertices,
+				num_parts);
+		// A few vertices have a large degree.
+		std::vector<vsize_t> degrees(num_vertices);
+		size_t max_weight = 0;
+		size_t tot_weight = 0;
+		for (size_t i = 0; i < num_vertices; i++) {
+			degrees[i] = random() % 10;
+			if (random() % 10000 == 0)
+				degrees[i] = random() % (100 * M);
+			max_weight = std::max(max_weight, (size_t) degrees[i] + 1);
+			tot_weight += degrees[i] + 1;
+		}
+		std::unique_ptr<edge_balanced_partitioner> partitioner
+			= edge_balanced_partitioner::create(num_vertices, num_parts,
+					[&degrees](vertex_id_t id) {
+						return degrees[id];
+					});
+		assert(partitioner->get_num_partitions() == num_parts);
+
+		// The partitions are contiguous ranges that cover all vertices
+		// in order.
+		vertex_id_t start = 0;
+		for (int i = 0; i < num_parts; i++) {
+			std::vector<vertex_id_t> ids;
+			partitioner->get_all_vertices_in_part(i, num_vertices, ids);
+			assert(partitioner->get_part_size(i, num_vertices) == ids.size());
+			for (size_t j = 0; j < ids.size(); j++)
+				assert(ids[j] == start + j);
+			start += ids.size();
+
+			// Each partition has at most one vertex more than its share.
+			size_t weight = 0;
+			for (size_t j = 0; j < ids.size(); j++)
+				weight += degrees[ids[j]] + 1;
+			assert(weight <= tot_weight / num_parts + max_weight);
+		}
+		assert(start == num_vertices);
+
+		for (vertex_id_t id = 0; id < num_vertices; id++) {
+			int part_id;
+			off_t off;
+			partitioner->map2loc(id, part_id, off);
+			assert(part_id == partitioner->map(id));
+			vertex_id_t id2;
+			partitioner->loc2map(part_id, off, id2);
+			assert(id2 == id);
+		}
+	}
+}
+
 int main()
 {
 	printf("test range_graph_partitioner\n");
@@ -51,4 +108,7 @@ int main()
 	modulo_graph_partitioner m_partitioner(num_parts);
 	test_partitioner(m_partitioner);
 
+	printf("test edge_balanced_partitioner\n");
+	test_edge_balanced_partitioner();
+
 }
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+
+#include <vector>
+#include <algorithm>
+
+#define BOOST_TEST_MODULE sorted_intersect
+#include <boost/test/included/unit_test.hpp>
+
+#include "sorted_intersect.h"
+
+using namespace fg;
+
+BOOST_AUTO_TEST_SUITE (sorted_intersecttest) // name of the test suite
+
+/*
+ * Generate a sorted array. If `unique' is false, the array may contain
+ * duplicated elements.
+ */
+static std::vector<vertex_id_t> gen_array(size_t len, vertex_id_t range,
+		bool unique)
+{
+	std::vector<vertex_id_t> arr(len);
+	for (size_t i = 0; i < len; i++)
+		arr[i] = random() % range;
+	std::sort(arr.begin(), arr.end());
+	if (unique)
+		arr.resize(std::unique(arr.begin(), arr.end()) - arr.begin());
+	return arr;
+}
+
+static void check_intersect(const std::vector<vertex_id_t> &arr1,
+		const std::vector<vertex_id_t> &arr2)
+{
+	std::vector<vsize_t> expected;
+	for (size_t i = 0; i < arr1.size(); i++) {
+		size_t num = std::upper_bound(arr2.begin(), arr2.end(), arr1[i])
+			- std::lower_bound(arr2.begin(), arr2.end(), arr1[i]);
+		for (size_t j = 0; j < num; j++)
+			expected.push_back(i);
+	}
+
+	BOOST_CHECK_EQUAL(sorted_intersect_count(arr1.data(), arr1.size(),
+				arr2.data(), arr2.size()), expected.size());
+	std::vector<vsize_t> idxs(arr2.size());
+	size_t num = sorted_intersect(arr1.data(), arr1.size(), arr2.data(),
+			arr2.size(), idxs.data());
+	idxs.resize(num);
+	BOOST_CHECK(idxs == expected);
+}
+
+BOOST_AUTO_TEST_CASE (test_kernels)
+{
+	intersect_impl impls[] = {SCALAR_INTERSECT, SSE_INTERSECT, AVX2_INTERSECT};
+	intersect_impl orig = get_intersect_impl();
+	for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+		if (!set_intersect_impl(impls[k]))
+			continue;
+		BOOST_TEST_MESSAGE(get_intersect_impl_name());
+		// Similar sizes, which use the block-compare kernels.
+		for (size_t len = 0; len < 100; len++) {
+			check_intersect(gen_array(len, 200, true),
+					gen_array(len + random() % 10, 200, false));
+			check_intersect(gen_array(len, 50, true),
+					gen_array(len, 50, false));
+		}
+		check_intersect(gen_array(10000, 30000, true),
+				gen_array(12000, 30000, false));
+		// Skewed sizes, which use galloping search.
+		check_intersect(gen_array(10, 100000, true),
+				gen_array(10000, 100000, false));
+		check_intersect(gen_array(10000, 100000, true),
+				gen_array(10, 100000, false));
+	}
+	set_intersect_impl(orig);
+}
+
+BOOST_AUTO_TEST_CASE (test_gallop)
+{
+	std::vector<vertex_id_t> arr = gen_array(1000, 5000, false);
+	for (vertex_id_t key = 0; key < 5001; key++) {
+		for (size_t start = 0; start < arr.size(); start += 97) {
+			BOOST_CHECK(gallop_lower_bound(arr.begin() + start, arr.end(), key)
+					== std::lower_bound(arr.begin() + start, arr.end(), key));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
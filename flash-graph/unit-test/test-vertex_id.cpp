@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#define BOOST_TEST_MODULE vertex_id
+#include <boost/test/included/unit_test.hpp>
+
+#include "graph_file_header.h"
+#include "vertex.h"
+#include "graph_delta.h"
+#include "vertex_index.h"
+
+using namespace fg;
+
+/*
+ * Build the tests with VID64=1 (or FG_64BIT_VERTEX_ID=ON in cmake) to test
+ * the 64-bit vertex IDs.
+ */
+
+BOOST_AUTO_TEST_SUITE (vertex_idtest) // name of the test suite
+
+BOOST_AUTO_TEST_CASE (test_header)
+{
+	graph_header header(graph_type::UNDIRECTED, 10, 4, 0);
+	BOOST_CHECK_EQUAL(header.get_vertex_id_size(), (int) sizeof(vertex_id_t));
+	BOOST_CHECK(header.is_right_vertex_id_size());
+
+	// The images created before the vertex ID size was recorded have 0
+	// in the field and use 4-byte vertex IDs.
+	std::vector<char> page(graph_header::HEADER_SIZE);
+	graph_header_struct data;
+	graph_header::init(data);
+	memcpy(page.data(), &data, sizeof(data));
+	memcpy((void *) &header, page.data(), page.size());
+	BOOST_CHECK_EQUAL(header.get_vertex_id_size(), 4);
+#ifdef FG_64BIT_VERTEX_ID
+	BOOST_CHECK(!header.is_right_vertex_id_size());
+#else
+	BOOST_CHECK(header.is_right_vertex_id_size());
+#endif
+
+	int size = 8;
+	memcpy(page.data() + graph_header::VERTEX_ID_SIZE_OFF, &size, sizeof(size));
+	memcpy((void *) &header, page.data(), page.size());
+	BOOST_CHECK_EQUAL(header.get_vertex_id_size(), 8);
+	BOOST_CHECK_EQUAL(header.is_right_vertex_id_size(),
+			sizeof(vertex_id_t) == 8);
+}
+
+/*
+ * The header of a vertex index of version 4. The fields of the vertex index
+ * follow the graph header directly, so recording the vertex ID size must
+ * not move them.
+ */
+struct v4_index_header
+{
+	int64_t magic_number;
+	int version_number;
+	int type;
+	size_t num_vertices;
+	size_t num_edges;
+	int edge_data_size;
+	int max_num_timestamps;
+	size_t entry_size;
+	size_t num_entries;
+	off_t out_part_loc;
+	bool compressed;
+	size_t num_large_in_vertices;
+	size_t num_large_out_vertices;
+};
+
+class test_vertex_index: public vertex_index
+{
+public:
+	size_t get_entry_size() const {
+		return h.data.entry_size;
+	}
+
+	size_t get_num_large_out_vertices() const {
+		return h.data.num_large_out_vertices;
+	}
+};
+
+BOOST_AUTO_TEST_CASE (test_v4_index)
+{
+	BOOST_CHECK_EQUAL(sizeof(graph_header_struct), 40U);
+
+	v4_index_header v4;
+	memset(&v4, 0, sizeof(v4));
+	v4.magic_number = MAGIC_NUMBER;
+	v4.version_number = 4;
+	v4.type = graph_type::DIRECTED;
+	v4.num_vertices = 1000;
+	v4.num_edges = 5000;
+	v4.entry_size = 16;
+	v4.num_entries = 1001;
+	v4.out_part_loc = 12345;
+	v4.compressed = true;
+	v4.num_large_in_vertices = 7;
+	v4.num_large_out_vertices = 9;
+	// An image of version 4 is loaded to a page-aligned buffer.
+	char *page = (char *) valloc(graph_header::HEADER_SIZE);
+	memset(page, 0, graph_header::HEADER_SIZE);
+	memcpy(page, &v4, sizeof(v4));
+
+	const test_vertex_index *index = (const test_vertex_index *) page;
+	const graph_header &header = index->get_graph_header();
+	BOOST_CHECK(header.is_graph_file());
+	BOOST_CHECK(header.is_right_version());
+	BOOST_CHECK(header.is_directed_graph());
+	BOOST_CHECK_EQUAL(header.get_num_vertices(), 1000U);
+	BOOST_CHECK_EQUAL(header.get_num_edges(), 5000U);
+	BOOST_CHECK_EQUAL(header.get_vertex_id_size(), 4);
+	BOOST_CHECK_EQUAL(index->get_num_vertices(), 1000U);
+	BOOST_CHECK_EQUAL(index->get_entry_size(), 16U);
+	BOOST_CHECK_EQUAL(index->get_num_entries(), 1001U);
+	BOOST_CHECK_EQUAL(index->get_out_part_loc(), 12345);
+	BOOST_CHECK(index->is_compressed());
+	BOOST_CHECK_EQUAL(index->get_num_large_out_vertices(), 9U);
+	free(page);
+}
+
+BOOST_AUTO_TEST_CASE (test_adj_list)
+{
+	BOOST_CHECK_EQUAL(ext_mem_undirected_vertex::num_edges2vsize(3, 0),
+			ext_mem_undirected_vertex::get_header_size()
+			+ 3 * sizeof(vertex_id_t));
+
+#ifdef FG_64BIT_VERTEX_ID
+	vertex_id_t base = 1UL << 33;
+	BOOST_CHECK(MAX_VERTEX_ID > (vertex_id_t) UINT_MAX);
+#else
+	vertex_id_t base = 1U << 30;
+#endif
+	vertex_id_t ids[] = {base + 1, base + 5, base + 7};
+	size_t size = ext_mem_undirected_vertex::num_edges2vsize(3, 0);
+	std::vector<char> buf(size);
+	ext_mem_undirected_vertex *ext_v = new (buf.data())
+		ext_mem_undirected_vertex(base, 3, 0);
+	for (int i = 0; i < 3; i++)
+		ext_v->set_neighbor(i, ids[i]);
+	mem_byte_array arr(buf.data(), size);
+	page_undirected_vertex v(arr);
+
+	BOOST_CHECK_EQUAL(v.get_id(), base);
+	BOOST_CHECK_EQUAL(v.get_num_edges(edge_type::OUT_EDGE), 3U);
+	std::vector<vertex_id_t> edges(3);
+	v.read_edges(edge_type::OUT_EDGE, edges.data(), edges.size());
+	BOOST_CHECK_EQUAL_COLLECTIONS(edges.begin(), edges.end(), ids, ids + 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#define BOOST_TEST_MODULE ws_deque
+#include <boost/test/included/unit_test.hpp>
+
+#include "ws_deque.h"
+
+using namespace fg;
+
+BOOST_AUTO_TEST_SUITE (ws_dequetest) // name of the test suite
+
+BOOST_AUTO_TEST_CASE (test_serial)
+{
+	ws_deque<long> q(4);
+	long v;
+	BOOST_CHECK(!q.pop(v));
+	BOOST_CHECK(!q.steal(v));
+	// Push more elements than the initial capacity to grow the deque.
+	for (long i = 0; i < 100; i++)
+		q.push(i);
+	BOOST_CHECK(q.get_num_entries() == 100);
+	// The owner pops from the bottom.
+	BOOST_CHECK(q.pop(v) && v == 99);
+	// Thieves steal from the top.
+	BOOST_CHECK(q.steal(v) && v == 0);
+	BOOST_CHECK(q.steal(v) && v == 1);
+	for (long i = 98; i >= 2; i--)
+		BOOST_CHECK(q.pop(v) && v == i);
+	BOOST_CHECK(q.is_empty());
+	BOOST_CHECK(!q.pop(v));
+	q.reset();
+}
+
+struct steal_args
+{
+	ws_deque<long> *q;
+	std::atomic<bool> *done;
+	std::vector<long> stolen;
+};
+
+static void *steal_func(void *arg)
+{
+	steal_args *args = (steal_args *) arg;
+	long v;
+	while (!args->done->load() || !args->q->is_empty()) {
+		if (args->q->steal(v))
+			args->stolen.push_back(v);
+	}
+	return NULL;
+}
+
+BOOST_AUTO_TEST_CASE (test_concurrent)
+{
+	const int num_thieves = 4;
+	const long num_eles = 1000000;
+	ws_deque<long> q;
+	std::atomic<bool> done(false);
+	std::vector<steal_args> args(num_thieves);
+	std::vector<pthread_t> threads(num_thieves);
+	for (int i = 0; i < num_thieves; i++) {
+		args[i].q = &q;
+		args[i].done = &done;
+		pthread_create(&threads[i], NULL, steal_func, &args[i]);
+	}
+
+	// Every element has to be taken exactly once by either the owner
+	// or one of the thieves.
+	std::vector<int> counts(num_eles);
+	long v;
+	for (long i = 0; i < num_eles; i++) {
+		q.push(i);
+		if (i % 3 == 0 && q.pop(v))
+			counts[v]++;
+	}
+	while (q.pop(v))
+		counts[v]++;
+	done = true;
+	for (int i = 0; i < num_thieves; i++) {
+		pthread_join(threads[i], NULL);
+		for (size_t j = 0; j < args[i].stolen.size(); j++)
+			counts[args[i].stolen[j]]++;
+	}
+	for (long i = 0; i < num_eles; i++)
+		BOOST_CHECK_EQUAL(counts[i], 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END( )
@@ -630,7 +630,9 @@ public:
      * \param type The type of edges a user wishes to read
      *      e.g `IN_EDGE`, `OUT_EDGE`.
 	 * \param edges The array of edges returned to a user.
-	 * \param num The maximal number of edges read by a user.
+	 * \param num The maximal number of edges read by a user. If the vertex
+	 *        has more edges, only the first `num' edges are read.
+	 * \return The number of edges read.
      */
 	virtual size_t read_edges(edge_type type, vertex_id_t edges[],
 			size_t num) const {
@@ -994,16 +996,14 @@ public:
 		size_t num_edges;
 		switch(type) {
 			case IN_EDGE:
-				assert(num_in_edges <= num);
 				assert(in_array);
-				num_edges = num_in_edges;
+				num_edges = std::min((size_t) num_in_edges, num);
 				in_array->memcpy(ext_mem_undirected_vertex::get_header_size(),
 						(char *) edges, sizeof(vertex_id_t) * num_edges);
 				break;
 			case OUT_EDGE:
-				assert(num_out_edges <= num);
 				assert(out_array);
-				num_edges = num_out_edges;
+				num_edges = std::min((size_t) num_out_edges, num);
 				out_array->memcpy(ext_mem_undirected_vertex::get_header_size(),
 						(char *) edges, sizeof(vertex_id_t) * num_edges);
 				break;
@@ -1133,8 +1133,7 @@ public:
      */
 	virtual size_t read_edges(edge_type type, vertex_id_t edges[],
 			size_t num) const {
-		vsize_t num_edges = get_num_edges(type);
-		assert(num_edges <= num);
+		size_t num_edges = std::min((size_t) get_num_edges(type), num);
 		array.memcpy(ext_mem_undirected_vertex::get_header_size(),
 				(char *) edges, sizeof(vertex_id_t) * num_edges);
 		return num_edges;
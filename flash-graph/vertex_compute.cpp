@@ -56,10 +56,38 @@ void vertex_compute::finish_run()
 	}
 }
 
+void vertex_compute::issue_hot_request(vertex_id_t id, edge_type type)
+{
+	// The worker thread holds a reference to the vertex compute until
+	// it passes the adjacency list to the vertex compute.
+	inc_ref();
+	num_issued++;
+	issue_thread->add_hot_request(this, graph->get_hot_store()->get_adj_list(
+				id, type, issue_thread->get_node_id()));
+}
+
 void vertex_compute::request_vertices(vertex_id_t ids[], size_t num)
 {
 	num_requested += num;
-	issue_thread->get_index_reader().request_vertices(ids, num, *this);
+	const hot_vertex_store::ptr &hot_store = graph->get_hot_store();
+	if (hot_store == NULL) {
+		issue_thread->get_index_reader().request_vertices(ids, num, *this);
+		return;
+	}
+
+	// The adjacency lists in the hot vertex store don't need to go through
+	// the vertex index and SAFS.
+	stack_array<vertex_id_t> cold_ids(num);
+	size_t num_cold = 0;
+	for (size_t i = 0; i < num; i++) {
+		if (hot_store->is_hot(ids[i]))
+			issue_hot_request(ids[i], edge_type::IN_EDGE);
+		else
+			cold_ids[num_cold++] = ids[i];
+	}
+	if (num_cold > 0)
+		issue_thread->get_index_reader().request_vertices(cold_ids.data(),
+				num_cold, *this);
 }
 
 void vertex_compute::request_num_edges(vertex_id_t ids[], size_t num)
@@ -175,7 +203,31 @@ void directed_vertex_compute::request_partial_vertices(
 		else
 			num_requested++;
 	}
-	issue_thread->get_index_reader().request_vertices(reqs, num, *this);
+	const hot_vertex_store::ptr &hot_store = graph->get_hot_store();
+	if (hot_store == NULL) {
+		issue_thread->get_index_reader().request_vertices(reqs, num, *this);
+		return;
+	}
+
+	stack_array<directed_vertex_request> cold_reqs(num);
+	size_t num_cold = 0;
+	for (size_t i = 0; i < num; i++) {
+		vertex_id_t id = reqs[i].get_id();
+		if (!hot_store->is_hot(id))
+			cold_reqs[num_cold++] = reqs[i];
+		else if (reqs[i].get_type() == edge_type::BOTH_EDGES) {
+			// The two byte arrays are merged in `run' as if they were
+			// read from SAFS.
+			combine_map.insert(combine_map_t::value_type(id, NULL));
+			issue_hot_request(id, edge_type::IN_EDGE);
+			issue_hot_request(id, edge_type::OUT_EDGE);
+		}
+		else
+			issue_hot_request(id, reqs[i].get_type());
+	}
+	if (num_cold > 0)
+		issue_thread->get_index_reader().request_vertices(cold_reqs.data(),
+				num_cold, *this);
 }
 
 void directed_vertex_compute::run_on_vertex_size(vertex_id_t id,
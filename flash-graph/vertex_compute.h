@@ -105,6 +105,11 @@ protected:
 
 	void start_run();
 	void finish_run();
+	/*
+	 * Pass the adjacency list in the hot vertex store to the worker thread,
+	 * which runs the vertex compute on it in its main loop.
+	 */
+	void issue_hot_request(vertex_id_t id, edge_type type);
 public:
 	vertex_compute(graph_engine *graph,
 			safs::compute_allocator *alloc): safs::user_compute(alloc) {
@@ -43,6 +43,8 @@ static void verify_index(vertex_index::ptr idx)
 	if (!idx->get_graph_header().is_graph_file()
 			|| !idx->get_graph_header().is_right_version())
 		throw wrong_format("wrong index file or format version");
+	if (!idx->get_graph_header().is_right_vertex_id_size())
+		throw wrong_format("wrong vertex ID size in the index file");
 
 	bool verify_format;
 	if (idx->get_graph_header().is_directed_graph()) {
@@ -56,6 +56,7 @@ protected:
 		assert(sizeof(*this) == graph_header::HEADER_SIZE);
 		memset(this, 0, sizeof(*this));
 		graph_header::init(h.data.header);
+		graph_header::init_vertex_id_size(h.page);
 		h.data.entry_size = entry_size;
 		h.data.num_entries = 0;
 		h.data.out_part_loc = 0;
@@ -99,6 +99,7 @@ void vertex_program::multicast_msg(vertex_id_t ids[], int num,
 		sender.init(msg);
 		BOOST_VERIFY((size_t) sender.add_dests(vid_bufs[i].data(),
 					vid_bufs[i].size()) == vid_bufs[i].size());
+		num_sent_msgs += vid_bufs[i].size();
 		vid_bufs[i].clear();
 		sender.end_multicast();
 	}
@@ -130,6 +131,7 @@ void vertex_program::multicast_msg(edge_seq_iterator &it, vertex_message &msg)
 		sender.init(msg);
 		BOOST_VERIFY((size_t) sender.add_dests(vid_bufs[i].data(),
 					vid_bufs[i].size()) == vid_bufs[i].size());
+		num_sent_msgs += vid_bufs[i].size();
 		vid_bufs[i].clear();
 		sender.end_multicast();
 	}
@@ -145,6 +147,7 @@ void vertex_program::send_msg(vertex_id_t dest, vertex_message &msg)
 	off_t local_id;
 	graph->get_partitioner()->map2loc(dest, part_id, local_id);
 	msg.set_dest(local_vid_t(local_id));
+	num_sent_msgs++;
 	if (msg.is_flush()) {
 		// Let's flush all messages sent by the thread before sending
 		// the flush message.
@@ -298,9 +301,32 @@ vertex_id_t vertex_program::get_vertex_id(compute_vertex_pointer v) const
 	return id;
 }
 
+vertex_loc_t vertex_program::get_vertex_loc(const compute_vertex &v) const
+{
+	// The vertex may have been moved to this thread by load balancing.
+	int part_id = t->get_worker_id();
+	local_vid_t id = graph->get_graph_index().get_local_id(part_id, v);
+	if (id.id == INVALID_VERTEX_ID) {
+		part_id = t->get_stolen_vertex_part(v);
+		assert(part_id >= 0);
+		id = graph->get_graph_index().get_local_id(part_id, v);
+		assert(id.id != INVALID_VERTEX_ID);
+	}
+	return vertex_loc_t(part_id, id);
+}
+
 vsize_t vertex_program::get_num_edges(vertex_id_t id) const
 {
 	return graph->get_num_edges(id);
 }
 
+std::unique_ptr<merged_page_vertex> vertex_program::merge_delta(
+		const page_vertex &vertex) const
+{
+	const graph_delta::ptr &delta = graph->get_delta();
+	if (delta == NULL || !delta->has_updates(vertex.get_id()))
+		return std::unique_ptr<merged_page_vertex>();
+	return delta->merge(vertex);
+}
+
 }
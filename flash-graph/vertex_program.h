@@ -26,6 +26,9 @@
 #include "vertex.h"
 #include "messaging.h"
 #include "vertex_pointer.h"
+#include "partitioner.h"
+#include "graph_delta.h"
+#include "level_profile.h"
 
 namespace fg
 {
@@ -59,6 +62,11 @@ class vertex_program
 	std::vector<simple_msg_sender *> flush_msg_senders;
 	std::vector<multicast_msg_sender *> multicast_senders;
 	std::vector<multicast_msg_sender *> activate_senders;
+	// The number of messages sent by the vertex program.
+	size_t num_sent_msgs;
+	// The time of running vertices is added here if the levels are
+	// profiled.
+	double *prof_compute_seconds;
     
 	multicast_msg_sender &get_activate_sender(int thread_id) const {
 		return *activate_senders[thread_id];
@@ -82,6 +90,8 @@ public:
 		part_id = 0;
 		t = NULL;
 		graph = NULL;
+		num_sent_msgs = 0;
+		prof_compute_seconds = NULL;
 	}
     
     /** \brief Destructor */
@@ -159,6 +169,21 @@ public:
 	const worker_thread &get_thread() const {
 		return *t;
 	}
+
+    /* Internal */
+	size_t get_num_sent_msgs() const {
+		return num_sent_msgs;
+	}
+
+    /* Internal */
+	void set_prof_compute(double *seconds) {
+		prof_compute_seconds = seconds;
+	}
+
+    /* Internal */
+	double *get_prof_compute() const {
+		return prof_compute_seconds;
+	}
     
     /**
      * \brief Get a pointer to the `graph_engine`.
@@ -228,7 +253,23 @@ public:
 
 	vertex_id_t get_vertex_id(compute_vertex_pointer v) const;
 	vertex_id_t get_vertex_id(const compute_vertex &v) const;
+	/**
+	 * \brief Get the location of a vertex in the partitions of the graph.
+	 *        It's cheaper than getting the vertex ID and it's used to
+	 *        access the vertex state stored outside the vertex.
+	 *        It doesn't apply to the vertices in vertical partitions.
+	 */
+	vertex_loc_t get_vertex_loc(const compute_vertex &v) const;
 	vsize_t get_num_edges(vertex_id_t id) const;
+
+	/**
+	 * \internal
+	 * \brief Merge the edge updates buffered in the delta store of the graph
+	 * to the vertex read from the graph image.
+	 * \return The merged vertex or NULL if the vertex doesn't have updates.
+	 */
+	std::unique_ptr<merged_page_vertex> merge_delta(
+			const page_vertex &vertex) const;
 	int get_partition_id() const {
 		return part_id;
 	}
@@ -274,6 +315,7 @@ public:
      *  \param vertex The current vertex.
 	 */
 	virtual void run(compute_vertex &comp_v) {
+		prof_timer timer(get_prof_compute());
 		((vertex_type &) comp_v).run(*this);
 	}
 
@@ -284,7 +326,12 @@ public:
      * \param vertex The curren `page vertex`.
 	 */
 	virtual void run(compute_vertex &comp_v, const page_vertex &vertex) {
-		((vertex_type &) comp_v).run(*this, vertex);
+		prof_timer timer(get_prof_compute());
+		std::unique_ptr<merged_page_vertex> merged = merge_delta(vertex);
+		if (merged)
+			((vertex_type &) comp_v).run(*this, merged->get_vertex());
+		else
+			((vertex_type &) comp_v).run(*this, vertex);
 	}
 
 	/**
@@ -340,6 +387,7 @@ public:
     
 	virtual void run_on_num_edges(compute_vertex &c_vertex,
 			const vertex_header &header) {
+		prof_timer timer(get_prof_compute());
 		((vertex_type &) c_vertex).run_on_vertex_header(*this, header);
 	}
 
@@ -0,0 +1,190 @@
+#ifndef __VERTEX_STATE_H__
+#define __VERTEX_STATE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <numa.h>
+
+#include <memory>
+#include <vector>
+
+#include "thread.h"
+#include "comm_exception.h"
+
+#include "graph_engine.h"
+#include "FG_vector.h"
+
+namespace fg
+{
+
+/**
+ * \brief This stores a field of the vertex state of all vertices in
+ *        a separate array (struct of arrays).
+ *
+ * By default, all vertex state lives in the compute_vertex objects,
+ * which are stored in an array of structs in each partition. When
+ * a vertex reads a single field of its neighbors (e.g., PageRank),
+ * it brings the whole objects to the CPU cache. A vertex program can
+ * instead declare a vertex_state for each of its fields and keep
+ * the compute_vertex objects empty, so a level only reads the fields
+ * it uses.
+ *
+ * The array is partitioned in the same way as the vertices in
+ * the graph engine, and each partition is allocated on the NUMA node
+ * of the worker thread that owns the partition.
+ */
+template<class T>
+class vertex_state
+{
+	struct state_part
+	{
+		T *data;
+		size_t size;
+		int node_id;
+	};
+
+	class init_thread: public ::thread
+	{
+		state_part &part;
+		T init_val;
+	public:
+		init_thread(state_part &_part, const T &init_val): ::thread(
+				"vstate-init-thread", _part.node_id), part(_part) {
+			this->init_val = init_val;
+		}
+
+		virtual void run() {
+			for (size_t i = 0; i < part.size; i++)
+				new (part.data + i) T(init_val);
+			this->stop();
+		}
+	};
+
+	const graph_partitioner &partitioner;
+	std::vector<state_part> parts;
+
+	vertex_state(const graph_partitioner &_partitioner): partitioner(
+			_partitioner) {
+	}
+public:
+	typedef std::shared_ptr<vertex_state<T> > ptr;
+
+	/**
+	 * \brief Create the state of all vertices in a graph engine.
+	 * \param graph The graph engine that runs the vertex program.
+	 * \param init_val The initial value of the state of every vertex.
+	 */
+	static ptr create(graph_engine &graph, const T &init_val = T()) {
+		const graph_partitioner &partitioner
+			= graph.get_graph_index().get_partitioner();
+		ptr state(new vertex_state<T>(partitioner));
+		int num_parts = partitioner.get_num_partitions();
+		size_t num_vertices = graph.get_num_vertices();
+		state->parts.resize(num_parts);
+		for (int i = 0; i < num_parts; i++) {
+			state_part &part = state->parts[i];
+			part.size = partitioner.get_part_size(i, num_vertices);
+			// The partitions of the graph engine are placed in the same way.
+			part.node_id = i % graph.get_num_nodes();
+			part.data = NULL;
+			if (part.size == 0)
+				continue;
+			part.data = (T *) numa_alloc_onnode(sizeof(T) * part.size,
+					part.node_id);
+			if (part.data == NULL)
+				throw oom_exception("can't allocate memory for vertex state");
+		}
+
+		std::vector<init_thread *> threads;
+		for (int i = 0; i < num_parts; i++) {
+			if (state->parts[i].size == 0)
+				continue;
+			threads.push_back(new init_thread(state->parts[i], init_val));
+			threads.back()->start();
+		}
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i]->join();
+			delete threads[i];
+		}
+		return state;
+	}
+
+	~vertex_state() {
+		for (size_t i = 0; i < parts.size(); i++) {
+			if (parts[i].data)
+				numa_free(parts[i].data, sizeof(T) * parts[i].size);
+		}
+	}
+
+	T &get(vertex_id_t id) {
+		int part_id;
+		off_t off;
+		partitioner.map2loc(id, part_id, off);
+		return parts[part_id].data[off];
+	}
+
+	const T &get(vertex_id_t id) const {
+		int part_id;
+		off_t off;
+		partitioner.map2loc(id, part_id, off);
+		return parts[part_id].data[off];
+	}
+
+	T &get(const vertex_loc_t &loc) {
+		return parts[loc.first].data[loc.second.id];
+	}
+
+	const T &get(const vertex_loc_t &loc) const {
+		return parts[loc.first].data[loc.second.id];
+	}
+
+	/**
+	 * \brief Get the state of a vertex when the vertex runs.
+	 *        This avoids translating the vertex to its vertex ID.
+	 */
+	T &get(const vertex_program &prog, const compute_vertex &v) {
+		return get(prog.get_vertex_loc(v));
+	}
+
+	void set(vertex_id_t id, const T &val) {
+		get(id) = val;
+	}
+
+	/**
+	 * \brief Copy the state of all vertices to a vector indexed by
+	 *        the vertex ID.
+	 */
+	void copy_to(FG_vector<T> &vec) const {
+		for (size_t i = 0; i < parts.size(); i++) {
+			const state_part &part = parts[i];
+#pragma omp parallel for
+			for (size_t j = 0; j < part.size; j++) {
+				vertex_id_t id;
+				partitioner.loc2map(i, j, id);
+				if (id < vec.get_size())
+					vec.set(id, part.data[j]);
+			}
+		}
+	}
+};
+
+}
+
+#endif
@@ -115,9 +115,57 @@ static void split_vertices(const graph_index &index, int part_id,
 	delete_val(vertices, INVALID_VERTEX_ID);
 }
 
+vertex_batch *active_vertex_queue::steal(int part_id, int num_threads)
+{
+	// We want to steal as much as possible, but we don't want
+	// to overloaded by the stolen vertices.
+	size_t num_steal = std::max(1UL, get_num_vertices() / num_threads);
+	vertex_batch *batch = new vertex_batch(part_id);
+	batch->num = fetch(batch->vertices,
+			std::min((size_t) VERTEX_BATCH_SIZE, num_steal));
+	if (batch->num == 0) {
+		delete batch;
+		return NULL;
+	}
+	return batch;
+}
+
+void default_vertex_queue::clear_batches()
+{
+	vertex_batch *batch;
+	while (batches.pop(batch))
+		delete batch;
+	batches.reset();
+	delete curr_batch;
+	curr_batch = NULL;
+	curr_batch_idx = 0;
+}
+
+/*
+ * Split the vertices in the vertex buffer into batches and push them to
+ * the deque. The owner thread pops batches from the bottom of the deque,
+ * so we push the batches in the reverse order to keep the vertices
+ * in the order of the vertex buffer.
+ */
+void default_vertex_queue::push_batches()
+{
+	size_t num_batches = (vertex_buf.size() + VERTEX_BATCH_SIZE - 1)
+		/ VERTEX_BATCH_SIZE;
+	for (size_t i = num_batches; i > 0; i--) {
+		size_t start = (i - 1) * VERTEX_BATCH_SIZE;
+		size_t end = std::min(start + VERTEX_BATCH_SIZE, vertex_buf.size());
+		vertex_batch *batch = new vertex_batch(part_id);
+		batch->num = end - start;
+		memcpy(batch->vertices, vertex_buf.data() + start,
+				batch->num * sizeof(batch->vertices[0]));
+		batches.push(batch);
+	}
+	vertex_buf.clear();
+}
+
 void default_vertex_queue::init(const vertex_id_t buf[], size_t size, bool sorted)
 {
-	pthread_spin_lock(&lock);
+	clear_batches();
 	vertex_buf.clear();
 	vpart_ps.clear();
 	active_vertices->clear();
@@ -134,17 +182,15 @@ void default_vertex_queue::init(const vertex_id_t buf[], size_t size, bool sorte
 	vertex_buf.resize(vertices.size());
 	index.get_vertices(vertices.data(), vertices.size(),
 			compute_vertex_pointer::conv(vertex_buf.data()));
-
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), true);
 	num_active = vertex_buf.size() + vpart_ps.size() * graph_conf.get_num_vparts();
-
-	pthread_spin_unlock(&lock);
+	push_batches();
 	curr_vpart = 0;
 }
 
 void default_vertex_queue::init(worker_thread &t)
 {
-	pthread_spin_lock(&lock);
+	// This is invoked when no other threads access the queue.
+	clear_batches();
 	vertex_buf.clear();
 	vpart_ps.clear();
 	assert(active_vertices->get_num_active_vertices() == 0);
@@ -183,14 +229,12 @@ void default_vertex_queue::init(worker_thread &t)
 	if (graph_conf.get_elevator_enabled())
 		forward = graph.get_curr_level() % 2;
 	active_vertices->set_dir(forward);
-	buf_fetch_idx = scan_pointer(0, true);
-	pthread_spin_unlock(&lock);
 	curr_vpart = 0;
 }
 
 void default_vertex_queue::fetch_from_map()
 {
-	assert(buf_fetch_idx.get_num_remaining() == 0);
+	assert(batches.is_empty());
 	vertex_buf.clear();
 	std::vector<local_vid_t> local_ids;
 	active_vertices->fetch_reset_active_vertices(VERTEX_BUF_SIZE, local_ids);
@@ -201,7 +245,9 @@ void default_vertex_queue::fetch_from_map()
 	bool forward = true;
 	if (graph_conf.get_elevator_enabled())
 		forward = graph.get_curr_level() % 2;
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), forward);
+	if (!forward)
+		std::reverse(vertex_buf.begin(), vertex_buf.end());
+	push_batches();
 }
 
 void default_vertex_queue::fetch_vparts()
@@ -209,7 +255,7 @@ void default_vertex_queue::fetch_vparts()
 	if (curr_vpart >= graph_conf.get_num_vparts())
 		return;
 
-	assert(buf_fetch_idx.get_num_remaining() == 0);
+	assert(batches.is_empty());
 	vertex_buf.clear();
 	vertex_buf.resize(vpart_ps.size());
 	index.get_vpart_vertices(part_id, curr_vpart, vpart_ps.data(),
@@ -217,51 +263,64 @@ void default_vertex_queue::fetch_vparts()
 	curr_vpart++;
 
 	// TODO Right now let's just scan the vertices in one direction.
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), true);
+	push_batches();
 }
 
+/*
+ * This is only invoked by the owner thread.
+ */
 int default_vertex_queue::fetch(compute_vertex_pointer vertices[], int num)
 {
-	if (num_active == 0)
-		return 0;
-
 	int num_fetched = 0;
-	pthread_spin_lock(&lock);
-	if (buf_fetch_idx.get_num_remaining() > 0) {
-		int num_to_fetch = min(num, buf_fetch_idx.get_num_remaining());
-		size_t curr_loc = buf_fetch_idx.get_curr_loc();
-		size_t new_loc = buf_fetch_idx.move(num_to_fetch);
-		memcpy(vertices, vertex_buf.data() + min(curr_loc, new_loc),
+	while (num_fetched < num && num_active > 0) {
+		if (curr_batch == NULL) {
+			if (!batches.pop(curr_batch)) {
+				curr_batch = NULL;
+				// The deque is empty or the last batch was stolen. If
+				// other threads are still stealing batches, we retry.
+				if (!batches.is_empty())
+					continue;
+				// We start with unpartitioned vertices first and then
+				// vertically partitioned vertices.
+				fetch_from_map();
+				if (batches.is_empty() && !vpart_ps.empty())
+					fetch_vparts();
+				if (batches.is_empty())
+					break;
+				continue;
+			}
+			curr_batch_idx = 0;
+		}
+		int num_to_fetch = std::min(num - num_fetched,
+				curr_batch->num - curr_batch_idx);
+		memcpy(vertices + num_fetched, curr_batch->vertices + curr_batch_idx,
 				num_to_fetch * sizeof(vertices[0]));
+		curr_batch_idx += num_to_fetch;
 		num_fetched += num_to_fetch;
-	}
-	// We have fetched all we need.
-	assert(num == num_fetched
-			// the vertex buffer is empty.
-			|| buf_fetch_idx.get_num_remaining() == 0);
-	// If the vertex buffer is empty, let's get some from the bitmap.
-	if (buf_fetch_idx.get_num_remaining() == 0) {
-		// We start with unpartitioned vertices first and then
-		// vertically partitioned vertices.
-		fetch_from_map();
-		if (vertex_buf.empty() && !vpart_ps.empty())
-			fetch_vparts();
-	}
-	// If we still need some vertices.
-	if (buf_fetch_idx.get_num_remaining() > 0 && num_fetched < num) {
-		int fetch_again = min(num - num_fetched, buf_fetch_idx.get_num_remaining());
-		size_t curr_loc = buf_fetch_idx.get_curr_loc();
-		size_t new_loc = buf_fetch_idx.move(fetch_again);
-		memcpy(vertices + num_fetched,
-				vertex_buf.data() + min(curr_loc, new_loc),
-				fetch_again * sizeof(vertices[0]));
-		num_fetched += fetch_again;
+		if (curr_batch_idx == curr_batch->num) {
+			delete curr_batch;
+			curr_batch = NULL;
+			curr_batch_idx = 0;
+		}
 	}
 	num_active -= num_fetched;
-	pthread_spin_unlock(&lock);
 	return num_fetched;
 }
 
+/*
+ * This is invoked by other threads. They can only steal the batches
+ * that have been moved to the deque by the owner thread.
+ */
+vertex_batch *default_vertex_queue::steal(int part_id, int num_threads)
+{
+	vertex_batch *batch;
+	if (num_active == 0 || !batches.steal(batch))
+		return NULL;
+	assert(batch->part_id == this->part_id);
+	num_active -= batch->num;
+	return batch;
+}
+
 void customized_vertex_queue::get_compute_vertex_pointers(
 		const std::vector<vertex_id_t> &vertices,
 		std::vector<vpart_vertex_pointer> &vpart_ps)
@@ -356,8 +415,16 @@ worker_thread::worker_thread(graph_engine *graph,
 	this->io = NULL;
 	this->graph_factory = graph_factory;
 	this->index_factory = index_factory;
+	window_sched = false;
+	num_adj_reqs = 0;
+	num_adj_bytes = 0;
+	prof_levels = graph_conf.prof_levels();
 	vprogram->init(graph, this);
 	vpart_vprogram->init(graph, this);
+	if (prof_levels) {
+		vprogram->set_prof_compute(&curr_prof.compute_seconds);
+		vpart_vprogram->set_prof_compute(&curr_prof.compute_seconds);
+	}
 	balancer = std::unique_ptr<load_balancer>(new load_balancer(*graph, *this));
 	msg_processor = std::unique_ptr<message_processor>(new message_processor(
 				*graph, *this, msg_alloc));
@@ -509,9 +576,10 @@ int worker_thread::process_activated_vertices(int max)
 	process_vertex_buf.resize(max);
 	int num = curr_activated_vertices->fetch(process_vertex_buf.data(), max);
 	if (num == 0) {
-		assert(curr_activated_vertices->is_empty());
+		prof_timer timer(get_prof_counter(&level_profile::steal_seconds));
 		num = balancer->steal_activated_vertices(process_vertex_buf.data(),
 				max);
+		curr_prof.num_stolen += num;
 	}
 	if (num > 0) {
 		num_activated_vertices_in_level.inc(num);
@@ -536,6 +604,7 @@ int worker_thread::process_activated_vertices(int max)
 
 size_t worker_thread::enter_next_level()
 {
+	prof_timer timer(get_prof_counter(&level_profile::msg_seconds));
 	// We have to make sure all messages sent by other threads are processed.
 	msg_processor->process_msgs();
 
@@ -563,22 +632,101 @@ size_t worker_thread::enter_next_level()
 	return curr_activated_vertices->get_num_vertices();
 }
 
+void worker_thread::process_hot_requests()
+{
+	// Running a vertex may request more hot adjacency lists.
+	while (!hot_reqs.empty()) {
+		std::vector<hot_vertex_request> reqs;
+		reqs.swap(hot_reqs);
+		hot_vertex_store &store = *graph->get_hot_store();
+		for (size_t i = 0; i < reqs.size(); i++) {
+			vertex_compute *compute = reqs[i].compute;
+			const hot_adj_list &list = reqs[i].list;
+			hot_byte_array arr(list.buf, list.off, list.size,
+					store.get_array_allocator());
+			compute->run(arr);
+			// The adjacency lists that aren't in the store are queued in
+			// the vertex compute while the hot requests are pending.
+			// SAFS may not hold the vertex compute, so we issue them
+			// explicitly.
+			while (compute->has_requests()) {
+				request_range range = compute->get_next_request();
+				io_request req(compute, range.get_loc(), range.get_size(), READ);
+				issue_io_request(req);
+			}
+			compute->dec_ref();
+			if (compute->get_ref() == 0) {
+				assert(compute->get_num_pending() == 0);
+				compute->get_allocator()->free(compute);
+			}
+		}
+	}
+}
+
+/*
+ * The activated vertices are fetched in the order of their locations in
+ * the partition, which is also the order of their adjacency lists in
+ * the graph file. When a level is sparse, only a few vertices are admitted
+ * every time some vertices complete, and their requests are too far from
+ * each other to be merged. With window scheduling, a worker admits
+ * vertices only when it can admit a window of them, so the index reader
+ * merges the requests of a whole window into large reads.
+ * When most vertices in the partition are active, the vertices admitted
+ * each time are already contiguous, so we don't delay them.
+ * A window only delays vertices while some admitted vertices wait for I/O.
+ * When the graph is in memory, the I/O completes before the worker admits
+ * vertices again, so the requests are the same as without windows.
+ */
+bool worker_thread::use_window_sched()
+{
+	if (graph_conf.get_sched_window_size() <= 0)
+		return false;
+	size_t num_local_vertices = graph->get_partitioner()->get_part_size(
+			worker_id, graph->get_num_vertices());
+	return curr_activated_vertices->get_num_vertices() * 2 < num_local_vertices;
+}
+
+int worker_thread::get_num_vertices_to_admit() const
+{
+	int num_processing = get_num_vertices_processing();
+	int num = graph->get_max_processing_vertices() - num_processing;
+	if (window_sched && num_processing > 0
+			&& num < graph_conf.get_sched_window_size())
+		return 0;
+	return num;
+}
+
 /**
  * This method is the main function of the graph engine.
  */
 void worker_thread::run()
 {
+	double level_start = get_prof_time();
 	while (true) {
 		int num_visited = 0;
 		int num;
+		size_t prev_adj_reqs = num_adj_reqs;
+		size_t prev_adj_bytes = num_adj_bytes;
+		size_t prev_msgs = vprogram->get_num_sent_msgs()
+			+ vpart_vprogram->get_num_sent_msgs();
+		window_sched = use_window_sched();
 		do {
-			balancer->process_completed_stolen_vertices();
-			num = process_activated_vertices(
-					graph->get_max_processing_vertices()
-					- get_num_vertices_processing());
+			num = process_activated_vertices(get_num_vertices_to_admit());
 			num_visited += num;
-			msg_processor->process_msgs();
+			{
+				prof_timer timer(get_prof_counter(&level_profile::msg_seconds),
+						&curr_prof.compute_seconds);
+				msg_processor->process_msgs();
+			}
+			// The vertices run on their adjacency lists when the I/O
+			// completes, so the time of running them is excluded.
+			prof_timer timer(get_prof_counter(&level_profile::io_seconds),
+					&curr_prof.compute_seconds);
 			index_reader->wait4complete(0);
+			process_hot_requests();
+			num_adj_reqs += adj_reqs.size();
+			for (size_t i = 0; i < adj_reqs.size(); i++)
+				num_adj_bytes += adj_reqs[i].get_size();
 			io->access(adj_reqs.data(), adj_reqs.size());
 			adj_reqs.clear();
 			if (io->num_pending_ios() == 0 && index_reader->get_num_pending_tasks() > 0)
@@ -610,44 +758,66 @@ void worker_thread::run()
 		num_completed_vertices_in_level = atomic_number<long>(0);
 
 		// TODO is this the right place to activate vertices?
-		vprogram->run_on_iteration_end();
-		vpart_vprogram->run_on_iteration_end();
-
-		vprogram->flush_msgs();
-		vpart_vprogram->flush_msgs();
-		// We have to make sure all stolen vertices are returned to their owner
-		// threads.
-		balancer->process_completed_stolen_vertices();
+		{
+			prof_timer timer(get_prof_counter(&level_profile::compute_seconds));
+			vprogram->run_on_iteration_end();
+			vpart_vprogram->run_on_iteration_end();
+		}
+
+		{
+			prof_timer timer(get_prof_counter(&level_profile::msg_seconds));
+			vprogram->flush_msgs();
+			vpart_vprogram->flush_msgs();
+		}
+		// All stolen vertices have been returned to their owner threads
+		// when they complete.
 		balancer->reset();
 
-		bool completed = graph->progress_next_level();
+		bool completed;
+		{
+			// The messages processed when entering the next level are
+			// excluded.
+			prof_timer timer(get_prof_counter(&level_profile::barrier_seconds),
+					&curr_prof.msg_seconds);
+			completed = graph->progress_next_level();
+		}
+		if (prof_levels) {
+			double now = get_prof_time();
+			curr_prof.level = level_profs.size();
+			curr_prof.worker_id = worker_id;
+			curr_prof.seconds = now - level_start;
+			curr_prof.num_vertices = num_visited;
+			curr_prof.num_reqs = num_adj_reqs - prev_adj_reqs;
+			curr_prof.num_bytes = num_adj_bytes - prev_adj_bytes;
+			curr_prof.num_msgs = vprogram->get_num_sent_msgs()
+				+ vpart_vprogram->get_num_sent_msgs() - prev_msgs;
+			level_profs.push_back(curr_prof);
+			level_start = now;
+		}
+		curr_prof = level_profile();
 		if (completed)
 			break;
 	}
 	stop();
 }
 
-int worker_thread::steal_activated_vertices(compute_vertex_pointer vertices[], int num)
+vertex_batch *worker_thread::steal_activated_vertices()
 {
 	// This method is called in the context of other worker threads,
 	// curr_activated_vertices may not have been initialized. If so,
 	// skip it.
 	if (curr_activated_vertices == NULL)
-		return 0;
-	// We want to steal as much as possible, but we don't want
-	// to overloaded by the stolen vertices.
-	size_t num_steal = std::max(1UL,
-			curr_activated_vertices->get_num_vertices() / graph->get_num_threads());
-	num = curr_activated_vertices->fetch(vertices,
-			std::min((size_t) num, num_steal));
-	if (num > 0)
+		return NULL;
+	vertex_batch *batch = curr_activated_vertices->steal(worker_id,
+			graph->get_num_threads());
+	if (batch)
 		// If the thread steals vertices from another thread successfully,
 		// it needs to notify the thread of the stolen vertices.
-		msg_processor->steal_vertices(vertices, num);
-	return num;
+		msg_processor->steal_vertices(batch->vertices, batch->num);
+	return batch;
 }
 
-void worker_thread::return_vertices(vertex_id_t ids[], int num)
+void worker_thread::return_vertices(const local_vid_t ids[], int num)
 {
 	msg_processor->return_vertices(ids, num);
 }
@@ -28,6 +28,8 @@
 #include "graph_engine.h"
 #include "bitmap.h"
 #include "scan_pointer.h"
+#include "ws_deque.h"
+#include "level_profile.h"
 
 namespace safs
 {
@@ -39,6 +41,8 @@ namespace fg
 {
 
 static const size_t MAX_ACTIVE_V = 1024;
+// The number of vertices in a batch that can be stolen by other threads.
+static const int VERTEX_BATCH_SIZE = 256;
 
 class worker_thread;
 
@@ -154,6 +158,23 @@ public:
 	void fetch_reset_active_vertices(std::vector<local_vid_t> &local_ids);
 };
 
+/*
+ * A batch of activated vertices. This is the unit of work stealing.
+ * A batch always contains vertices from the same partition, so
+ * the thread that steals a batch knows the owner of the vertices.
+ */
+struct vertex_batch
+{
+	int part_id;
+	int num;
+	compute_vertex_pointer vertices[VERTEX_BATCH_SIZE];
+
+	vertex_batch(int part_id) {
+		this->part_id = part_id;
+		this->num = 0;
+	}
+};
+
 /*
  * The queue for active vertices.
  */
@@ -169,6 +190,11 @@ public:
 	virtual int fetch(compute_vertex_pointer vertices[], int num) = 0;
 	virtual bool is_empty() = 0;
 	virtual size_t get_num_vertices() = 0;
+	/*
+	 * This is invoked by other threads to steal a batch of vertices.
+	 * The stealing thread owns the returned batch.
+	 */
+	virtual vertex_batch *steal(int part_id, int num_threads);
 
 	void init(const std::vector<vertex_id_t> &vec, bool sorted) {
 		init(vec.data(), vec.size(), sorted);
@@ -177,11 +203,14 @@ public:
 
 /*
  * This vertex queue is sorted based on the vertex ID.
+ * The owner thread moves the activated vertices from the bitmap to
+ * a work-stealing deque of vertex batches and processes the batches from
+ * the bottom of the deque. Other threads steal batches from the top of
+ * the deque without locking.
  */
 class default_vertex_queue: public active_vertex_queue
 {
 	static const size_t VERTEX_BUF_SIZE = 64 * 1024;
-	pthread_spinlock_t lock;
 	// It contains the offset of the vertex in the local partition
 	// instead of the real vertex Ids.
 	std::vector<compute_vertex_pointer> vertex_buf;
@@ -190,8 +219,11 @@ class default_vertex_queue: public active_vertex_queue
 	std::vector<vpart_vertex_pointer> vpart_ps;
 	int curr_vpart;
 	std::unique_ptr<active_vertex_set> active_vertices;
-	// The fetch index in the vertex buffer.
-	scan_pointer buf_fetch_idx;
+	// The batches of vertices ready to be processed.
+	ws_deque<vertex_batch *> batches;
+	// The batch being processed by the owner thread.
+	vertex_batch *curr_batch;
+	int curr_batch_idx;
 	graph_engine &graph;
 	const graph_index &index;
 	std::atomic<size_t> num_active;
@@ -199,11 +231,11 @@ class default_vertex_queue: public active_vertex_queue
 
 	void fetch_from_map();
 	void fetch_vparts();
+	void push_batches();
+	void clear_batches();
 public:
 	default_vertex_queue(graph_engine &_graph, int part_id,
-			int node_id): buf_fetch_idx(0, true), graph(_graph), index(
-				_graph.get_graph_index()) {
-		pthread_spin_init(&lock, PTHREAD_PROCESS_PRIVATE);
+			int node_id): graph(_graph), index(_graph.get_graph_index()) {
 		num_active = 0;
 		this->part_id = part_id;
 		size_t num_local_vertices = _graph.get_partitioner()->get_part_size(
@@ -211,11 +243,18 @@ public:
 		this->active_vertices = std::unique_ptr<active_vertex_set>(
 				new active_vertex_set(num_local_vertices, node_id));
 		curr_vpart = 0;
+		curr_batch = NULL;
+		curr_batch_idx = 0;
+	}
+
+	~default_vertex_queue() {
+		clear_batches();
 	}
 
 	virtual void init(const vertex_id_t buf[], size_t size, bool sorted);
 	virtual void init(worker_thread &);
 	virtual int fetch(compute_vertex_pointer vertices[], int num);
+	virtual vertex_batch *steal(int part_id, int num_threads);
 
 	virtual bool is_empty() {
 		return num_active == 0;
@@ -287,6 +326,20 @@ class message_processor;
 class load_balancer;
 class simple_index_reader;
 
+/*
+ * A request for an adjacency list in the hot vertex store.
+ */
+struct hot_vertex_request
+{
+	vertex_compute *compute;
+	hot_adj_list list;
+
+	hot_vertex_request(vertex_compute *compute, const hot_adj_list &list) {
+		this->compute = compute;
+		this->list = list;
+	}
+};
+
 class worker_thread: public thread
 {
 	int worker_id;
@@ -306,6 +359,8 @@ class worker_thread: public thread
 
 	// This buffers the I/O requests for adjacency lists.
 	std::vector<safs::io_request> adj_reqs;
+	// This buffers the requests for adjacency lists in the hot vertex store.
+	std::vector<hot_vertex_request> hot_reqs;
 
 	// When a thread process a vertex, the worker thread should keep
 	// a vertex compute for the vertex. This is useful when a user-defined
@@ -354,6 +409,26 @@ class worker_thread: public thread
 	// The number of vertices completed in the current level.
 	atomic_number<long> num_completed_vertices_in_level;
 
+	// Whether vertices are admitted in windows in the current level.
+	bool window_sched;
+	// The adjacency list requests issued to SAFS.
+	size_t num_adj_reqs;
+	size_t num_adj_bytes;
+
+	// Whether the levels are profiled.
+	bool prof_levels;
+	// The profiling counters of the current level.
+	level_profile curr_prof;
+	// The profiling counters of the levels that have completed.
+	std::vector<level_profile> level_profs;
+
+	/*
+	 * Get the profiling counter, or NULL if the levels aren't profiled.
+	 */
+	double *get_prof_counter(double level_profile::*counter) {
+		return prof_levels ? &(curr_prof.*counter) : NULL;
+	}
+
 	/*
 	 * Get the number of vertices being processed in the current level.
 	 */
@@ -362,6 +437,9 @@ class worker_thread: public thread
 			- num_completed_vertices_in_level.get();
 	}
 	int process_activated_vertices(int max);
+	void process_hot_requests();
+	bool use_window_sched();
+	int get_num_vertices_to_admit() const;
 public:
 	worker_thread(graph_engine *graph, std::shared_ptr<safs::file_io_factory> graph_factory,
 			std::shared_ptr<safs::file_io_factory> index_factory, vertex_program::ptr prog,
@@ -437,8 +515,8 @@ public:
 		notify_vertices->set(id.id);
 	}
 
-	int steal_activated_vertices(compute_vertex_pointer vertices[], int num);
-	void return_vertices(vertex_id_t ids[], int num);
+	vertex_batch *steal_activated_vertices();
+	void return_vertices(const local_vid_t ids[], int num);
 
 	size_t get_num_local_vertices() const {
 		return graph->get_partitioner()->get_part_size(worker_id,
@@ -469,6 +547,15 @@ public:
 		adj_reqs.push_back(req);
 	}
 
+	/*
+	 * The adjacency list in the hot vertex store is passed to the vertex
+	 * compute in the main loop of the worker thread instead of in
+	 * the context of the vertex that requests it.
+	 */
+	void add_hot_request(vertex_compute *compute, const hot_adj_list &list) {
+		hot_reqs.push_back(hot_vertex_request(compute, list));
+	}
+
 	size_t get_activates() const {
 		return curr_activated_vertices->get_num_vertices();
 	}
@@ -483,6 +570,18 @@ public:
 
 	int get_stolen_vertex_part(const compute_vertex &v) const;
 
+	size_t get_num_adj_reqs() const {
+		return num_adj_reqs;
+	}
+
+	size_t get_num_adj_bytes() const {
+		return num_adj_bytes;
+	}
+
+	const std::vector<level_profile> &get_level_profiles() const {
+		return level_profs;
+	}
+
 	friend class load_balancer;
 	friend class default_vertex_queue;
 	friend class customized_vertex_queue;
@@ -0,0 +1,195 @@
+#ifndef __WS_DEQUE_H__
+#define __WS_DEQUE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include <atomic>
+#include <vector>
+
+namespace fg
+{
+
+/*
+ * This is a Chase-Lev work-stealing deque.
+ * The owner thread pushes and pops elements at the bottom of the deque
+ * without any locks; other threads steal elements from the top of
+ * the deque with a single CAS. Only the owner thread is allowed to invoke
+ * push(), pop() and reset().
+ *
+ * The element type should be small and trivially copyable (usually
+ * a pointer). The memory orders follow the C11 version of the algorithm
+ * described in "Correct and Efficient Work-Stealing for Weak Memory Models".
+ */
+template<class T>
+class ws_deque
+{
+	class circular_array
+	{
+		size_t size;
+		std::atomic<T> *buf;
+	public:
+		circular_array(size_t size) {
+			// The size has to be a power of two.
+			assert((size & (size - 1)) == 0);
+			this->size = size;
+			buf = new std::atomic<T>[size];
+		}
+
+		~circular_array() {
+			delete [] buf;
+		}
+
+		size_t get_size() const {
+			return size;
+		}
+
+		T get(long idx) const {
+			return buf[idx & (size - 1)].load(std::memory_order_relaxed);
+		}
+
+		void put(long idx, T v) {
+			buf[idx & (size - 1)].store(v, std::memory_order_relaxed);
+		}
+
+		circular_array *grow(long bottom, long top) const {
+			circular_array *arr = new circular_array(size * 2);
+			for (long i = top; i < bottom; i++)
+				arr->put(i, get(i));
+			return arr;
+		}
+	};
+
+	std::atomic<long> top;
+	std::atomic<long> bottom;
+	std::atomic<circular_array *> array;
+	// Thieves may still read from an array after the owner grows the deque.
+	// The old arrays are kept here and are only freed when no thread can
+	// access the deque concurrently.
+	std::vector<circular_array *> retired;
+
+	ws_deque(const ws_deque &);
+	ws_deque &operator=(const ws_deque &);
+public:
+	ws_deque(size_t init_size = 1024) {
+		top = 0;
+		bottom = 0;
+		array = new circular_array(init_size);
+	}
+
+	~ws_deque() {
+		delete array.load();
+		for (size_t i = 0; i < retired.size(); i++)
+			delete retired[i];
+	}
+
+	/*
+	 * This is invoked by the owner thread.
+	 */
+	void push(T v) {
+		long b = bottom.load(std::memory_order_relaxed);
+		long t = top.load(std::memory_order_acquire);
+		circular_array *a = array.load(std::memory_order_relaxed);
+		if (b - t > (long) a->get_size() - 1) {
+			retired.push_back(a);
+			a = a->grow(b, t);
+			array.store(a, std::memory_order_release);
+		}
+		a->put(b, v);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	/*
+	 * This is invoked by the owner thread.
+	 * It returns false if the deque is empty or the last element is
+	 * taken by a thief.
+	 */
+	bool pop(T &v) {
+		long b = bottom.load(std::memory_order_relaxed) - 1;
+		circular_array *a = array.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			// The deque is empty.
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		v = a->get(b);
+		if (t == b) {
+			// This is the last element. We have to race with the thieves.
+			bool success = top.compare_exchange_strong(t, t + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return success;
+		}
+		return true;
+	}
+
+	/*
+	 * This can be invoked by any thread.
+	 * It returns false if the deque is empty or another thread wins
+	 * the race.
+	 */
+	bool steal(T &v) {
+		long t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return false;
+
+		circular_array *a = array.load(std::memory_order_acquire);
+		v = a->get(t);
+		return top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	/*
+	 * The number of elements in the deque. The value is only an estimate
+	 * if other threads are stealing elements concurrently.
+	 */
+	size_t get_num_entries() const {
+		long b = bottom.load(std::memory_order_relaxed);
+		long t = top.load(std::memory_order_relaxed);
+		return b > t ? b - t : 0;
+	}
+
+	bool is_empty() const {
+		return get_num_entries() == 0;
+	}
+
+	/*
+	 * This frees the arrays retired by the owner thread. It can only be
+	 * invoked when no other threads are accessing the deque.
+	 */
+	void reset() {
+		assert(is_empty());
+		for (size_t i = 0; i < retired.size(); i++)
+			delete retired[i];
+		retired.clear();
+	}
+};
+
+}
+
+#endif
@@ -268,6 +268,42 @@ void NUMA_buffer::dump(const std::string &file_name)
 	fclose(f);
 }
 
+void NUMA_buffer::dump_safs(const std::string &file_name)
+{
+	safs_file f(get_sys_RAID_conf(), file_name);
+	// SAFS accesses data in pages.
+	if (!f.exist() && !f.create_file(ROUNDUP_PAGE(get_length())))
+		throw io_exception(std::string("can't create SAFS file ") + file_name);
+
+	file_io_factory::shared_ptr io_factory = create_io_factory(file_name,
+			REMOTE_ACCESS);
+	if (io_factory == NULL)
+		throw io_exception(std::string("can't create io factory for ")
+				+ file_name);
+	io_interface::ptr io = create_io(io_factory, thread::get_curr_thread());
+	if (io == NULL)
+		throw io_exception(std::string("can't create io instance for ")
+				+ file_name);
+
+	// The data in the buffer may not be stored in contiguous memory or
+	// be aligned, so it is copied to an aligned buffer before being written.
+	const size_t MAX_IO_SIZE = 64 * 1024 * 1024;
+	std::unique_ptr<char[], numa_delete> buf((char *) numa_alloc_local(
+				MAX_IO_SIZE), numa_delete(MAX_IO_SIZE));
+	for (off_t off = 0; (size_t) off < get_length(); ) {
+		size_t size = std::min(MAX_IO_SIZE, get_length() - off);
+		copy_to(buf.get(), size, off);
+		size_t req_size = ROUNDUP_PAGE(size);
+		memset(buf.get() + size, 0, req_size - size);
+		data_loc_t loc(io_factory->get_file_id(), off);
+		io_request req(buf.get(), loc, req_size, WRITE);
+		io->access(&req, 1);
+		io->wait4complete(1);
+		off += size;
+	}
+	io->cleanup();
+}
+
 NUMA_buffer::ptr NUMA_buffer::load_safs(const std::string &file_name,
 		const NUMA_mapper &mapper)
 {
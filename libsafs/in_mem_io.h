@@ -92,6 +92,11 @@ public:
 	void copy_to(char *buf, size_t size, off_t off) const;
 
 	void dump(const std::string &file);
+	/*
+	 * Write the data in the buffer to a file in SAFS. The file is created
+	 * if it doesn't exist.
+	 */
+	void dump_safs(const std::string &file);
 };
 
 /*
@@ -166,6 +171,11 @@ public:
 		return file_id;
 	}
 
+	// The file is in memory, so it may not exist in SAFS.
+	virtual ssize_t get_file_size() const {
+		return data->get_length();
+	}
+
 	virtual io_interface::ptr create_io(thread *t) {
 		return io_interface::ptr(new in_mem_io(data, file_id, t));
 	}
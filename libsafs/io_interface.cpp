@@ -483,6 +483,10 @@ public:
 		BOOST_LOG_TRIVIAL(info) << boost::format("%1% gets %2% I/O accesses")
 			% mapper.get_name() % tot_accesses.load();
 	}
+
+	virtual void get_statistics(io_stats &stats) const {
+		stats.num_accesses += tot_accesses.load();
+	}
 };
 
 class global_cached_io_factory: public file_io_factory
@@ -533,6 +537,13 @@ public:
 			<< boost::format("There are %1% pages accessed, %2% cache hits, %3% of them are in the fast process")
 			% tot_pg_accesses.load() % tot_hits.load() % tot_fast_process.load();
 	}
+
+	virtual void get_statistics(io_stats &stats) const {
+		stats.num_accesses += tot_accesses.load();
+		stats.num_bytes += tot_bytes.load();
+		stats.num_pg_accesses += tot_pg_accesses.load();
+		stats.num_cache_hits += tot_hits.load();
+	}
 };
 
 class direct_comp_io_factory: public file_io_factory
@@ -575,6 +586,11 @@ public:
 			% get_name() % tot_accesses.load() % tot_req_bytes.load()
 			% tot_disk_bytes.load();
 	}
+
+	virtual void get_statistics(io_stats &stats) const {
+		stats.num_accesses += tot_accesses.load();
+		stats.num_bytes += tot_req_bytes.load();
+	}
 };
 
 #ifdef PART_IO
@@ -421,6 +421,36 @@ public:
 	virtual std::shared_ptr<comp_io_scheduler> create(int node_id) const = 0;
 };
 
+/**
+ * The I/O statistics an I/O factory collects from the I/O instances it
+ * created. They are collected when the I/O instances are destroyed.
+ */
+struct io_stats
+{
+	// The number of I/O requests issued by applications.
+	size_t num_accesses;
+	// The number of bytes requested by applications.
+	size_t num_bytes;
+	// The number of pages accessed in the page cache.
+	size_t num_pg_accesses;
+	size_t num_cache_hits;
+
+	io_stats() {
+		num_accesses = 0;
+		num_bytes = 0;
+		num_pg_accesses = 0;
+		num_cache_hits = 0;
+	}
+
+	io_stats &operator+=(const io_stats &stats) {
+		num_accesses += stats.num_accesses;
+		num_bytes += stats.num_bytes;
+		num_pg_accesses += stats.num_pg_accesses;
+		num_cache_hits += stats.num_cache_hits;
+		return *this;
+	}
+};
+
 /**
  * This class defines the interface of creating I/O instances of accessing
  * a file.
@@ -498,11 +528,17 @@ public:
 	virtual void print_statistics() const {
 	}
 
+	/**
+	 * This method adds the I/O statistics of the factory to `stats'.
+	 */
+	virtual void get_statistics(io_stats &stats) const {
+	}
+
 	/**
 	 * This method gets the size of the file accessed by the I/O factory.
 	 * \return the file size.
 	 */
-	ssize_t get_file_size() const;
+	virtual ssize_t get_file_size() const;
 
 	friend io_interface::ptr create_io(file_io_factory::shared_ptr factory, thread *t);
 	friend class io_interface;